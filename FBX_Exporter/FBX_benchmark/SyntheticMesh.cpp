@@ -0,0 +1,284 @@
+#include "SyntheticMesh.h"
+#include <cmath>
+#include <random>
+
+namespace
+{
+	const float kPi = 3.14159265358979f;
+
+	// Row vector 4x4 product, outResult = inA * inB
+	void Multiply(const float* inA, const float* inB, float* outResult)
+	{
+		for (int r = 0; r < 4; ++r)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				outResult[r * 4 + c] = inA[r * 4 + 0] * inB[0 * 4 + c] + inA[r * 4 + 1] * inB[1 * 4 + c] +
+					inA[r * 4 + 2] * inB[2 * 4 + c] + inA[r * 4 + 3] * inB[3 * 4 + c];
+			}
+		}
+	}
+
+	void Normalize(XMFLOAT3& ioVector)
+	{
+		float length = sqrtf(ioVector.x * ioVector.x + ioVector.y * ioVector.y + ioVector.z * ioVector.z);
+		if (length > 0.0f)
+		{
+			ioVector.x /= length;
+			ioVector.y /= length;
+			ioVector.z /= length;
+		}
+	}
+}
+
+SyntheticMesh::SyntheticMesh() :
+	mBoneCount(0),
+	mFrameCount(0)
+{
+}
+
+unsigned int SyntheticMesh::GetTriangleCount() const
+{
+	return mIndices.size() / 3;
+}
+
+void SyntheticMesh::Unweld(std::vector<PNTIWVertex>& outVertices, std::vector<unsigned int>& outIndices) const
+{
+	outVertices.clear();
+	outVertices.reserve(mIndices.size());
+	outIndices.resize(mIndices.size());
+	for (unsigned int i = 0; i < mIndices.size(); ++i)
+	{
+		outVertices.push_back(mVertices[mIndices[i]]);
+		outIndices[i] = i;
+	}
+}
+
+void SyntheticMeshGenerator::GetLatticeSize(unsigned int inTriangleCount, unsigned int& outRows, unsigned int& outColumns)
+{
+	unsigned int cellCount = std::max(inTriangleCount / 2, 1u);
+	outColumns = std::max(static_cast<unsigned int>(sqrt(static_cast<double>(cellCount)) + 0.5), 1u);
+	outRows = (cellCount + outColumns - 1) / outColumns;
+}
+
+void SyntheticMeshGenerator::Triangulate(unsigned int inRows, unsigned int inColumns, unsigned int inMaterialCount, SyntheticMesh& ioMesh)
+{
+	const unsigned int materialCount = std::max(inMaterialCount, 1u);
+	ioMesh.mIndices.clear();
+	ioMesh.mIndices.reserve(inRows * inColumns * 6);
+	ioMesh.mMaterials.clear();
+	ioMesh.mMaterials.reserve(inRows * inColumns * 2);
+
+	for (unsigned int i = 0; i < inRows; ++i)
+	{
+		unsigned int material = static_cast<unsigned int>(static_cast<unsigned long long>(i) * materialCount / inRows);
+		for (unsigned int j = 0; j < inColumns; ++j)
+		{
+			unsigned int a = i * (inColumns + 1) + j;
+			unsigned int b = a + 1;
+			unsigned int c = a + inColumns + 1;
+			unsigned int d = c + 1;
+
+			ioMesh.mIndices.push_back(a);
+			ioMesh.mIndices.push_back(b);
+			ioMesh.mIndices.push_back(d);
+			ioMesh.mIndices.push_back(a);
+			ioMesh.mIndices.push_back(d);
+			ioMesh.mIndices.push_back(c);
+			ioMesh.mMaterials.push_back(material);
+			ioMesh.mMaterials.push_back(material);
+		}
+	}
+}
+
+void SyntheticMeshGenerator::Grid(unsigned int inTriangleCount, unsigned int inMaterialCount, SyntheticMesh& outMesh)
+{
+	unsigned int rows;
+	unsigned int columns;
+	GetLatticeSize(inTriangleCount, rows, columns);
+
+	outMesh = SyntheticMesh();
+	outMesh.mShape = "grid";
+	outMesh.mVertices.resize((rows + 1) * (columns + 1));
+	for (unsigned int i = 0; i <= rows; ++i)
+	{
+		for (unsigned int j = 0; j <= columns; ++j)
+		{
+			PNTIWVertex& currVertex = outMesh.mVertices[i * (columns + 1) + j];
+			float u = static_cast<float>(j) / columns;
+			float v = static_cast<float>(i) / rows;
+			currVertex.mPosition = XMFLOAT3(u, v, 0.0f);
+			currVertex.mNormal = XMFLOAT3(0.0f, 0.0f, 1.0f);
+			currVertex.mUV[0] = XMFLOAT2(u, v);
+		}
+	}
+
+	Triangulate(rows, columns, inMaterialCount, outMesh);
+}
+
+void SyntheticMeshGenerator::Sphere(unsigned int inTriangleCount, unsigned int inMaterialCount, SyntheticMesh& outMesh)
+{
+	unsigned int rows;
+	unsigned int columns;
+	GetLatticeSize(inTriangleCount, rows, columns);
+
+	outMesh = SyntheticMesh();
+	outMesh.mShape = "sphere";
+	outMesh.mVertices.resize((rows + 1) * (columns + 1));
+	for (unsigned int i = 0; i <= rows; ++i)
+	{
+		float theta = kPi * i / rows;
+		for (unsigned int j = 0; j <= columns; ++j)
+		{
+			float phi = 2.0f * kPi * j / columns;
+			PNTIWVertex& currVertex = outMesh.mVertices[i * (columns + 1) + j];
+			currVertex.mPosition = XMFLOAT3(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi));
+			currVertex.mNormal = currVertex.mPosition;
+			currVertex.mUV[0] = XMFLOAT2(static_cast<float>(j) / columns, static_cast<float>(i) / rows);
+		}
+	}
+
+	Triangulate(rows, columns, inMaterialCount, outMesh);
+}
+
+void SyntheticMeshGenerator::NoisyScan(unsigned int inTriangleCount, unsigned int inMaterialCount, unsigned int inSeed, SyntheticMesh& outMesh)
+{
+	unsigned int rows;
+	unsigned int columns;
+	GetLatticeSize(inTriangleCount, rows, columns);
+
+	outMesh = SyntheticMesh();
+	outMesh.mShape = "scan";
+	outMesh.mVertices.resize((rows + 1) * (columns + 1));
+
+	// Jitter of up to a third of a cell, so the lattice never folds over
+	std::mt19937 generator(inSeed);
+	std::uniform_real_distribution<float> jitter(-0.33f, 0.33f);
+	const float cellWidth = 1.0f / columns;
+	const float cellHeight = 1.0f / rows;
+
+	for (unsigned int i = 0; i <= rows; ++i)
+	{
+		for (unsigned int j = 0; j <= columns; ++j)
+		{
+			float x = (j + jitter(generator)) * cellWidth;
+			float y = (i + jitter(generator)) * cellHeight;
+			float noise = jitter(generator) * 0.01f;
+
+			// Smooth surface plus noise, the normal is the smooth one
+			// like a scanner's filtered normals
+			PNTIWVertex& currVertex = outMesh.mVertices[i * (columns + 1) + j];
+			currVertex.mPosition = XMFLOAT3(x, y, 0.05f * sinf(7.0f * x) * cosf(5.0f * y) + noise);
+			currVertex.mNormal = XMFLOAT3(-0.35f * cosf(7.0f * x) * cosf(5.0f * y), 0.25f * sinf(7.0f * x) * sinf(5.0f * y), 1.0f);
+			Normalize(currVertex.mNormal);
+			currVertex.mUV[0] = XMFLOAT2(x, y);
+		}
+	}
+
+	Triangulate(rows, columns, inMaterialCount, outMesh);
+}
+
+void SyntheticMeshGenerator::SkinnedCylinder(unsigned int inTriangleCount, unsigned int inMaterialCount, unsigned int inBoneCount,
+	unsigned int inFrameCount, SyntheticMesh& outMesh)
+{
+	unsigned int rows;
+	unsigned int columns;
+	GetLatticeSize(inTriangleCount, rows, columns);
+	const unsigned int boneCount = std::max(inBoneCount, 1u);
+
+	outMesh = SyntheticMesh();
+	outMesh.mShape = "cylinder";
+	outMesh.mBoneCount = boneCount;
+	outMesh.mFrameCount = inFrameCount;
+	outMesh.mVertices.resize((rows + 1) * (columns + 1));
+
+	// Bone b spans y in [b, b + 1]
+	for (unsigned int i = 0; i <= rows; ++i)
+	{
+		float y = static_cast<float>(boneCount) * i / rows;
+		float t = std::min(std::max(y - 0.5f, 0.0f), static_cast<float>(boneCount - 1));
+		unsigned int bone0 = std::min(static_cast<unsigned int>(t), boneCount - 1);
+		unsigned int bone1 = std::min(bone0 + 1, boneCount - 1);
+		float weight1 = bone0 == bone1 ? 0.0f : t - bone0;
+
+		for (unsigned int j = 0; j <= columns; ++j)
+		{
+			float phi = 2.0f * kPi * j / columns;
+			PNTIWVertex& currVertex = outMesh.mVertices[i * (columns + 1) + j];
+			currVertex.mPosition = XMFLOAT3(0.5f * cosf(phi), y, 0.5f * sinf(phi));
+			currVertex.mNormal = XMFLOAT3(cosf(phi), 0.0f, sinf(phi));
+			currVertex.mUV[0] = XMFLOAT2(static_cast<float>(j) / columns, static_cast<float>(i) / rows);
+
+			// Unused influences are joint 0 with weight 0, as the skin weight stage pads them
+			currVertex.mVertexBlendingInfos.resize(MAX_INFLUENCES);
+			currVertex.mVertexBlendingInfos[0].mBlendingIndex = bone0;
+			currVertex.mVertexBlendingInfos[0].mBlendingWeight = 1.0 - weight1;
+			if (bone1 != bone0)
+			{
+				currVertex.mVertexBlendingInfos[1].mBlendingIndex = bone1;
+				currVertex.mVertexBlendingInfos[1].mBlendingWeight = weight1;
+			}
+			currVertex.SortBlendingInfoByWeight();
+		}
+	}
+
+	Triangulate(rows, columns, inMaterialCount, outMesh);
+
+	// Every joint bends around Z at its base; a bone's global transform
+	// is its own bend followed by its parent's global transform
+	outMesh.mBoneTransforms.resize(inFrameCount * boneCount * 16);
+	for (unsigned int f = 0; f < inFrameCount; ++f)
+	{
+		float* frame = &outMesh.mBoneTransforms[f * boneCount * 16];
+		for (unsigned int b = 0; b < boneCount; ++b)
+		{
+			float angle = 0.4f * sinf(2.0f * kPi * f / inFrameCount + 0.5f * b);
+			float c = cosf(angle);
+			float s = sinf(angle);
+			float pivot = static_cast<float>(b);
+			float local[16] =
+			{
+				c, s, 0.0f, 0.0f,
+				-s, c, 0.0f, 0.0f,
+				0.0f, 0.0f, 1.0f, 0.0f,
+				pivot * s, pivot - pivot * c, 0.0f, 1.0f
+			};
+
+			if (b == 0)
+			{
+				std::copy(local, local + 16, frame);
+			}
+			else
+			{
+				Multiply(local, frame + (b - 1) * 16, frame + b * 16);
+			}
+		}
+	}
+}
+
+bool SyntheticMeshGenerator::Generate(const std::string& inShape, unsigned int inTriangleCount, unsigned int inMaterialCount,
+	unsigned int inBoneCount, unsigned int inFrameCount, SyntheticMesh& outMesh)
+{
+	if (inShape == "grid")
+	{
+		Grid(inTriangleCount, inMaterialCount, outMesh);
+	}
+	else if (inShape == "sphere")
+	{
+		Sphere(inTriangleCount, inMaterialCount, outMesh);
+	}
+	else if (inShape == "scan")
+	{
+		NoisyScan(inTriangleCount, inMaterialCount, inTriangleCount, outMesh);
+	}
+	else if (inShape == "cylinder")
+	{
+		SkinnedCylinder(inTriangleCount, inMaterialCount, inBoneCount, inFrameCount, outMesh);
+	}
+	else
+	{
+		return false;
+	}
+
+	return true;
+}
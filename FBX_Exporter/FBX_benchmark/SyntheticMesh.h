@@ -0,0 +1,58 @@
+#pragma once
+#include "Vertex.h"
+#include <string>
+
+// Procedural stand in for an imported scene, so the processing stages
+// can be measured without the FBX SDK or large input files
+// Every shape is a (rows + 1) x (columns + 1) lattice of welded vertices
+// with two triangles per cell, grouped by material in horizontal bands
+struct SyntheticMesh
+{
+	std::string mShape;
+	std::vector<PNTIWVertex> mVertices;
+	// 3 per triangle
+	std::vector<unsigned int> mIndices;
+	// One per triangle, ascending
+	std::vector<unsigned int> mMaterials;
+
+	unsigned int mBoneCount;
+	unsigned int mFrameCount;
+	// Global bone transforms of every frame, 16 floats each in FbxAMatrix
+	// layout (row vectors), frame major
+	std::vector<float> mBoneTransforms;
+
+	SyntheticMesh();
+
+	unsigned int GetTriangleCount() const;
+
+	// The mesh as the importer hands it to the welder: one vertex
+	// per triangle corner
+	void Unweld(std::vector<PNTIWVertex>& outVertices, std::vector<unsigned int>& outIndices) const;
+};
+
+class SyntheticMeshGenerator
+{
+public:
+	// Flat plane in the XY plane
+	static void Grid(unsigned int inTriangleCount, unsigned int inMaterialCount, SyntheticMesh& outMesh);
+	// Unit UV sphere, the poles and the seam are split like an exported one
+	static void Sphere(unsigned int inTriangleCount, unsigned int inMaterialCount, SyntheticMesh& outMesh);
+	// Height field with per vertex jitter, like a 3D scan. Nothing can be
+	// simplified away for free and the triangles are irregular
+	static void NoisyScan(unsigned int inTriangleCount, unsigned int inMaterialCount, unsigned int inSeed, SyntheticMesh& outMesh);
+	// Cylinder along Y made of inBoneCount segments. Every vertex is
+	// bound to the two nearest bones (padded to MAX_INFLUENCES like the
+	// skin weight stage does) and the chain bends over inFrameCount frames
+	static void SkinnedCylinder(unsigned int inTriangleCount, unsigned int inMaterialCount, unsigned int inBoneCount,
+		unsigned int inFrameCount, SyntheticMesh& outMesh);
+
+	// By name: grid, sphere, scan or cylinder. False for other names
+	static bool Generate(const std::string& inShape, unsigned int inTriangleCount, unsigned int inMaterialCount,
+		unsigned int inBoneCount, unsigned int inFrameCount, SyntheticMesh& outMesh);
+
+private:
+	// Rows and columns of a lattice with about inTriangleCount triangles
+	static void GetLatticeSize(unsigned int inTriangleCount, unsigned int& outRows, unsigned int& outColumns);
+	// Vertices must already be (rows + 1) * (columns + 1), row major
+	static void Triangulate(unsigned int inRows, unsigned int inColumns, unsigned int inMaterialCount, SyntheticMesh& ioMesh);
+};
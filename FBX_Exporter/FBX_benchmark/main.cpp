@@ -0,0 +1,703 @@
+#include "SyntheticMesh.h"
+#include "MeshWelder.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+#include "BvhBuilder.h"
+#include "MeshStatistics.h"
+#include "MeshFileWriter.h"
+#include "MeshFileCompressor.h"
+#include "TextWriter.h"
+#include "AnimationClip.h"
+#include "static_mesh_struct.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <psapi.h>
+
+// Benchmark of the processing stages on synthetic meshes
+// Every stage is timed on its own and reports the heap allocations it
+// made and the most heap it held at once; the results go to stdout
+// as JSON
+
+namespace
+{
+	// Every allocation carries its size in front of it, so the live
+	// heap can be tracked across threads
+	const size_t kAllocationHeader = 16;
+
+	std::atomic<unsigned long long> gAllocationCount(0);
+	std::atomic<unsigned long long> gAllocatedBytes(0);
+	std::atomic<long long> gLiveBytes(0);
+	std::atomic<long long> gPeakBytes(0);
+
+	void* Allocate(size_t inSize)
+	{
+		char* block = static_cast<char*>(malloc(inSize + kAllocationHeader));
+		if (!block)
+		{
+			throw std::bad_alloc();
+		}
+		*reinterpret_cast<size_t*>(block) = inSize;
+
+		++gAllocationCount;
+		gAllocatedBytes += inSize;
+		long long live = gLiveBytes += inSize;
+		long long peak = gPeakBytes;
+		while (live > peak && !gPeakBytes.compare_exchange_weak(peak, live))
+		{
+		}
+
+		return block + kAllocationHeader;
+	}
+
+	void Free(void* inPointer)
+	{
+		if (!inPointer)
+		{
+			return;
+		}
+		char* block = static_cast<char*>(inPointer) - kAllocationHeader;
+		gLiveBytes -= *reinterpret_cast<size_t*>(block);
+		free(block);
+	}
+}
+
+void* operator new(size_t inSize)
+{
+	return Allocate(inSize);
+}
+
+void* operator new[](size_t inSize)
+{
+	return Allocate(inSize);
+}
+
+void operator delete(void* inPointer) noexcept
+{
+	Free(inPointer);
+}
+
+void operator delete[](void* inPointer) noexcept
+{
+	Free(inPointer);
+}
+
+void operator delete(void* inPointer, size_t) noexcept
+{
+	Free(inPointer);
+}
+
+void operator delete[](void* inPointer, size_t) noexcept
+{
+	Free(inPointer);
+}
+
+namespace
+{
+	struct BenchmarkSettings
+	{
+		std::vector<unsigned int> mSizes;
+		std::vector<std::string> mShapes;
+		unsigned int mMaterialCount;
+		unsigned int mBoneCount;
+		unsigned int mFrameCount;
+		// Poses sampled by the animation stages
+		unsigned int mPoseCount;
+		std::string mOutputFile;
+
+		BenchmarkSettings() :
+			mMaterialCount(4),
+			mBoneCount(32),
+			mFrameCount(120),
+			mPoseCount(10000),
+			mOutputFile("benchmark.static_mesh")
+		{
+			unsigned int sizes[] = { 1000, 10000, 100000, 1000000 };
+			mSizes.assign(sizes, sizes + 4);
+			const char* shapes[] = { "grid", "sphere", "scan", "cylinder" };
+			mShapes.assign(shapes, shapes + 4);
+		}
+	};
+
+	// mItems is what the stage processes (triangles, or bone frames for
+	// animation), mBytes the data it reads or writes if that is a better
+	// measure, mOutput the size of its result (welded vertices, file
+	// size, ...)
+	struct StageResult
+	{
+		std::string mName;
+		bool mSkipped;
+		double mSeconds;
+		unsigned long long mItems;
+		unsigned long long mBytes;
+		unsigned long long mOutput;
+		unsigned long long mAllocations;
+		unsigned long long mAllocatedBytes;
+		long long mPeakHeapBytes;
+	};
+
+	class StageTimer
+	{
+	public:
+		StageTimer() :
+			mStartAllocations(gAllocationCount),
+			mStartAllocatedBytes(gAllocatedBytes),
+			mStartLiveBytes(gLiveBytes)
+		{
+			gPeakBytes = mStartLiveBytes;
+			mStart = std::chrono::steady_clock::now();
+		}
+
+		StageResult Stop(const char* inName, unsigned long long inItems, unsigned long long inBytes, unsigned long long inOutput)
+		{
+			StageResult result;
+			result.mSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - mStart).count();
+			result.mName = inName;
+			result.mSkipped = false;
+			result.mItems = inItems;
+			result.mBytes = inBytes;
+			result.mOutput = inOutput;
+			result.mAllocations = gAllocationCount - mStartAllocations;
+			result.mAllocatedBytes = gAllocatedBytes - mStartAllocatedBytes;
+			result.mPeakHeapBytes = gPeakBytes - mStartLiveBytes;
+			return result;
+		}
+
+	private:
+		std::chrono::steady_clock::time_point mStart;
+		unsigned long long mStartAllocations;
+		unsigned long long mStartAllocatedBytes;
+		long long mStartLiveBytes;
+	};
+
+	StageResult Skipped(const char* inName)
+	{
+		StageResult result = StageResult();
+		result.mName = inName;
+		result.mSkipped = true;
+		return result;
+	}
+
+	unsigned long long GetPeakResidentBytes()
+	{
+		PROCESS_MEMORY_COUNTERS counters;
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		{
+			return counters.PeakWorkingSetSize;
+		}
+		return 0;
+	}
+
+	// Uncompressed .static_mesh image with the vertex and triangle sections,
+	// the bulk of every real file
+	void BuildImage(const SyntheticMesh& inMesh, MeshFileWriter& ioWriter, std::vector<SM_section>& outSections)
+	{
+		SM_header* header = ioWriter.ReserveArray<SM_header>(1);
+		memset(header, 0, sizeof(SM_header));
+		header->version = 2.3f;
+		header->NumOf_Vertices = inMesh.mVertices.size();
+		header->NumOf_Triangles = inMesh.GetTriangleCount();
+		header->NumOf_UVSets = 1;
+
+		outSections.clear();
+		SM_section section = SM_section();
+		section.type = SM_SECTION_VERTICES;
+		section.codec = SM_CODEC_VERTEX;
+		section.record_size = sizeof(SM_vertex);
+		section.raw_offset = static_cast<unsigned int>(ioWriter.GetOffset());
+		section.raw_size = sizeof(SM_vertex) * header->NumOf_Vertices;
+		outSections.push_back(section);
+
+		SM_vertex* vertices = ioWriter.ReserveArray<SM_vertex>(header->NumOf_Vertices);
+		for (unsigned int i = 0; i < header->NumOf_Vertices; ++i)
+		{
+			vertices[i].Position = inMesh.mVertices[i].mPosition;
+			vertices[i].Normal = inMesh.mVertices[i].mNormal;
+			vertices[i].Tex0 = inMesh.mVertices[i].mUV[0];
+		}
+
+		section.type = SM_SECTION_TRIANGLES;
+		section.codec = SM_CODEC_INDEX;
+		section.record_size = sizeof(SM_triangle);
+		section.raw_offset = static_cast<unsigned int>(ioWriter.GetOffset());
+		section.raw_size = sizeof(SM_triangle) * header->NumOf_Triangles;
+		outSections.push_back(section);
+
+		SM_triangle* triangles = ioWriter.ReserveArray<SM_triangle>(header->NumOf_Triangles);
+		for (unsigned int i = 0; i < header->NumOf_Triangles; ++i)
+		{
+			for (unsigned int j = 0; j < 3; ++j)
+			{
+				triangles[i].indices[j] = inMesh.mIndices[i * 3 + j];
+			}
+			triangles[i].material_index = inMesh.mMaterials[i];
+		}
+	}
+
+	size_t GetImageSize(const SyntheticMesh& inMesh)
+	{
+		return sizeof(SM_header) + sizeof(SM_vertex) * inMesh.mVertices.size() + sizeof(SM_triangle) * inMesh.GetTriangleCount();
+	}
+
+	// .static_anim image of the bending chain, parent of bone b is b - 1.
+	// The bind pose is the unbent chain, so the inverse bind poses are
+	// the identity
+	void BuildAnimationImage(const SyntheticMesh& inMesh, MeshFileWriter& ioWriter)
+	{
+		SA_header* header = ioWriter.ReserveArray<SA_header>(1);
+		memset(header, 0, sizeof(SA_header));
+		header->version = 1.0f;
+		header->NumOf_Joints = inMesh.mBoneCount;
+		header->NumOf_Frames = inMesh.mFrameCount;
+		header->Frames_per_second = 24.0f;
+		strcpy(header->Name, "bend");
+
+		SA_joint* joints = ioWriter.ReserveArray<SA_joint>(inMesh.mBoneCount);
+		for (unsigned int b = 0; b < inMesh.mBoneCount; ++b)
+		{
+			memset(&joints[b], 0, sizeof(SA_joint));
+			sprintf(joints[b].Name, "bone%u", b);
+			joints[b].Parent = static_cast<int>(b) - 1;
+			for (unsigned int j = 0; j < 4; ++j)
+			{
+				joints[b].Inverse_bindpose[j * 5] = 1.0f;
+			}
+		}
+
+		// Same bend as SyntheticMeshGenerator::SkinnedCylinder, around Z
+		// at the base of the bone
+		SA_key* keys = ioWriter.ReserveArray<SA_key>(inMesh.mBoneCount * inMesh.mFrameCount);
+		for (unsigned int b = 0; b < inMesh.mBoneCount; ++b)
+		{
+			for (unsigned int f = 0; f < inMesh.mFrameCount; ++f)
+			{
+				float angle = 0.4f * sinf(2.0f * 3.14159265358979f * f / inMesh.mFrameCount + 0.5f * b);
+				float pivot = static_cast<float>(b);
+				SA_key& key = keys[b * inMesh.mFrameCount + f];
+				key.Translation = XMFLOAT3(pivot * sinf(angle), pivot - pivot * cosf(angle), 0.0f);
+				key.Rotation = XMFLOAT4(0.0f, 0.0f, sinf(0.5f * angle), cosf(0.5f * angle));
+				key.Scale = XMFLOAT3(1.0f, 1.0f, 1.0f);
+			}
+		}
+	}
+
+	size_t GetAnimationImageSize(const SyntheticMesh& inMesh)
+	{
+		return sizeof(SA_header) + sizeof(SA_joint) * inMesh.mBoneCount + sizeof(SA_key) * inMesh.mBoneCount * inMesh.mFrameCount;
+	}
+
+	void RunStages(const SyntheticMesh& inMesh, const BenchmarkSettings& inSettings, std::vector<StageResult>& outResults)
+	{
+		const unsigned int triangleCount = inMesh.GetTriangleCount();
+		const unsigned int vertexCount = inMesh.mVertices.size();
+
+		// Welding, on the mesh as the importer produces it
+		{
+			std::vector<PNTIWVertex> unweldedVertices;
+			std::vector<unsigned int> indices;
+			inMesh.Unweld(unweldedVertices, indices);
+
+			StageTimer timer;
+			std::vector<PNTIWVertex> uniqueVertices;
+			uniqueVertices.reserve(unweldedVertices.size());
+			MeshWelder::Weld(unweldedVertices, &indices[0], indices.size(), uniqueVertices);
+			outResults.push_back(timer.Stop("weld", triangleCount, sizeof(PNTIWVertex) * unweldedVertices.size(), uniqueVertices.size()));
+		}
+
+		// The other stages start from the welded mesh
+		{
+			StageTimer timer;
+			MeshSimplifier simplifier(inMesh.mVertices);
+			std::vector<unsigned int> simplifiedIndices;
+			simplifier.Simplify(inMesh.mIndices, triangleCount / 2, simplifiedIndices);
+			outResults.push_back(timer.Stop("simplify", triangleCount, 0, simplifiedIndices.size() / 3));
+		}
+
+		{
+			StageTimer timer;
+			MeshletData meshlets;
+			std::vector<unsigned int> rangeIndices;
+			for (unsigned int first = 0; first < triangleCount;)
+			{
+				unsigned int end = first;
+				while (end < triangleCount && inMesh.mMaterials[end] == inMesh.mMaterials[first])
+				{
+					++end;
+				}
+				rangeIndices.assign(inMesh.mIndices.begin() + first * 3, inMesh.mIndices.begin() + end * 3);
+				MeshletBuilder::Build(inMesh.mVertices, rangeIndices, inMesh.mMaterials[first], meshlets);
+				first = end;
+			}
+			outResults.push_back(timer.Stop("meshlets", triangleCount, 0, meshlets.mMeshlets.size()));
+		}
+
+		{
+			StageTimer timer;
+			BvhData bvh;
+			std::vector<unsigned int> triangleIds(triangleCount);
+			for (unsigned int i = 0; i < triangleCount; ++i)
+			{
+				triangleIds[i] = i;
+			}
+			BvhBuilder::Build(inMesh.mVertices, inMesh.mIndices, triangleIds, std::max(std::thread::hardware_concurrency(), 1u), bvh);
+			outResults.push_back(timer.Stop("bvh", triangleCount, 0, bvh.mNodes.size()));
+		}
+
+		{
+			StageTimer timer;
+			std::vector<unsigned int> visited(vertexCount, 0);
+			RangeStatistics statistics = MeshStatistics::Compute(inMesh.mVertices, &inMesh.mIndices[0], inMesh.mIndices.size(), visited, 1);
+			outResults.push_back(timer.Stop("statistics", triangleCount, 0, statistics.mVertexCount));
+		}
+
+		// Writers
+		const size_t imageSize = GetImageSize(inMesh);
+		{
+			StageTimer timer;
+			MeshFileWriter writer;
+			std::vector<SM_section> sections;
+			bool written = writer.Open(inSettings.mOutputFile, imageSize, false);
+			if (written)
+			{
+				BuildImage(inMesh, writer, sections);
+				written = writer.Commit();
+			}
+			outResults.push_back(written ? timer.Stop("write_binary", triangleCount, imageSize, imageSize) : Skipped("write_binary"));
+		}
+
+		MeshFileWriter image;
+		image.OpenMemory(imageSize);
+		std::vector<SM_section> sections;
+		BuildImage(inMesh, image, sections);
+		{
+			StageTimer timer;
+			bool written = MeshFileCompressor::Write(image.GetData(), *reinterpret_cast<const SM_header*>(image.GetData()), sections, inSettings.mOutputFile, false);
+			outResults.push_back(written ? timer.Stop("write_compressed", triangleCount, imageSize, 0) : Skipped("write_compressed"));
+		}
+
+		std::ifstream compressedFile(inSettings.mOutputFile.c_str(), std::ios::binary);
+		std::vector<char> compressed((std::istreambuf_iterator<char>(compressedFile)), std::istreambuf_iterator<char>());
+		compressedFile.close();
+		bool intact = true;
+		if (!outResults.back().mSkipped)
+		{
+			outResults.back().mOutput = compressed.size();
+
+			StageTimer timer;
+			std::vector<char> decompressed;
+			bool read = MeshFileCompressor::Decompress(&compressed[0], compressed.size(), decompressed);
+			outResults.push_back(read ? timer.Stop("decompress", triangleCount, imageSize, decompressed.size()) : Skipped("decompress"));
+
+			// A codec that loses data must not produce a clean number
+			intact = !read || (decompressed.size() == image.GetOffset() && memcmp(&decompressed[0], image.GetData(), decompressed.size()) == 0);
+		}
+		remove(inSettings.mOutputFile.c_str());
+		if (!intact)
+		{
+			throw std::exception("decompressed image differs from the written one");
+		}
+
+		// Text export of the vertices, shortest round trip and %g floats
+		for (int compatible = 0; compatible < 2; ++compatible)
+		{
+			StageTimer timer;
+			std::ostringstream text;
+			TextWriter writer(&text, compatible != 0);
+			for (unsigned int i = 0; i < vertexCount; ++i)
+			{
+				const PNTIWVertex& currVertex = inMesh.mVertices[i];
+				writer << "\t\t<vtx>\n";
+				writer << "\t\t\t<pos>" << currVertex.mPosition.x << "," << currVertex.mPosition.y << "," << -currVertex.mPosition.z << "</pos>\n";
+				writer << "\t\t\t<norm>" << currVertex.mNormal.x << "," << currVertex.mNormal.y << "," << -currVertex.mNormal.z << "</norm>\n";
+				writer << "\t\t\t<tex>" << currVertex.mUV[0].x << "," << 1.0f - currVertex.mUV[0].y << "</tex>\n";
+				writer << "\t\t</vtx>\n";
+			}
+			writer.Flush();
+			unsigned long long textSize = text.tellp();
+			outResults.push_back(timer.Stop(compatible ? "write_text_compatible" : "write_text", vertexCount, textSize, textSize));
+		}
+
+		// Bone transforms of every frame, as the animation export writes them
+		if (inMesh.mBoneCount > 0 && inMesh.mFrameCount > 0)
+		{
+			const unsigned int boneFrames = inMesh.mBoneCount * inMesh.mFrameCount;
+			StageTimer timer;
+			std::ostringstream text;
+			TextWriter writer(&text, false);
+			for (unsigned int i = 0; i < boneFrames; ++i)
+			{
+				const float* transform = &inMesh.mBoneTransforms[i * 16];
+				writer << "\t\t\t<mat>";
+				for (unsigned int j = 0; j < 16; ++j)
+				{
+					writer << transform[j] << (j < 15 ? "," : "</mat>\n");
+				}
+			}
+			writer.Flush();
+			unsigned long long textSize = text.tellp();
+			outResults.push_back(timer.Stop("write_animation_text", boneFrames, textSize, textSize));
+		}
+		else
+		{
+			outResults.push_back(Skipped("write_animation_text"));
+		}
+
+		// Runtime side of the animation: items are joints, once per pose
+		const char* animationStages[] = { "load_animation", "sample_pose", "model_matrices", "skinning_matrices", "validate_animation" };
+		if (inMesh.mBoneCount == 0 || inMesh.mFrameCount == 0 || inSettings.mPoseCount == 0)
+		{
+			for (unsigned int i = 0; i < 5; ++i)
+			{
+				outResults.push_back(Skipped(animationStages[i]));
+			}
+			return;
+		}
+
+		const size_t animationSize = GetAnimationImageSize(inMesh);
+		MeshFileWriter animationImage;
+		animationImage.OpenMemory(animationSize);
+		BuildAnimationImage(inMesh, animationImage);
+
+		AnimationClip clip;
+		{
+			StageTimer timer;
+			bool loaded = clip.Load(animationImage.GetData(), animationSize);
+			outResults.push_back(loaded ? timer.Stop("load_animation", inMesh.mBoneCount * inMesh.mFrameCount, animationSize, clip.GetJointCount()) : Skipped("load_animation"));
+			if (!loaded)
+			{
+				for (unsigned int i = 1; i < 5; ++i)
+				{
+					outResults.push_back(Skipped(animationStages[i]));
+				}
+				return;
+			}
+		}
+
+		const unsigned long long poseJoints = static_cast<unsigned long long>(inSettings.mPoseCount) * inMesh.mBoneCount;
+		const float poseStep = clip.GetDuration() / inSettings.mPoseCount;
+		AnimationPose pose;
+		{
+			StageTimer timer;
+			for (unsigned int i = 0; i < inSettings.mPoseCount; ++i)
+			{
+				clip.Sample(i * poseStep, true, pose);
+			}
+			outResults.push_back(timer.Stop("sample_pose", poseJoints, 0, pose.mLocal.size()));
+		}
+
+		{
+			StageTimer timer;
+			for (unsigned int i = 0; i < inSettings.mPoseCount; ++i)
+			{
+				clip.ComputeModelMatrices(pose);
+			}
+			outResults.push_back(timer.Stop("model_matrices", poseJoints, 0, pose.mModel.size()));
+		}
+
+		{
+			StageTimer timer;
+			for (unsigned int i = 0; i < inSettings.mPoseCount; ++i)
+			{
+				clip.ComputeSkinningMatrices(pose);
+			}
+			outResults.push_back(timer.Stop("skinning_matrices", poseJoints, 0, pose.mSkinning.size()));
+		}
+
+		// Model matrices at every key against the generated globals, the
+		// output is the number of joint frames off by more than 1e-3
+		{
+			StageTimer timer;
+			unsigned long long mismatches = 0;
+			for (unsigned int f = 0; f < inMesh.mFrameCount; ++f)
+			{
+				clip.Sample(f / clip.GetFramesPerSecond(), false, pose);
+				clip.ComputeModelMatrices(pose);
+				for (unsigned int b = 0; b < inMesh.mBoneCount; ++b)
+				{
+					const float* expected = &inMesh.mBoneTransforms[(f * inMesh.mBoneCount + b) * 16];
+					float error = 0.0f;
+					for (unsigned int j = 0; j < 16; ++j)
+					{
+						error = std::max(error, fabsf(pose.mModel[b].m[j / 4][j % 4] - expected[j]));
+					}
+					if (error > 1e-3f)
+					{
+						++mismatches;
+					}
+				}
+			}
+			outResults.push_back(timer.Stop("validate_animation", inMesh.mBoneCount * inMesh.mFrameCount, 0, mismatches));
+		}
+	}
+
+	void PrintStage(const StageResult& inResult, bool inLast)
+	{
+		printf("        { \"name\": \"%s\", \"skipped\": %s", inResult.mName.c_str(), inResult.mSkipped ? "true" : "false");
+		if (!inResult.mSkipped)
+		{
+			double seconds = std::max(inResult.mSeconds, 1e-9);
+			printf(", \"seconds\": %.6f, \"items\": %llu, \"items_per_second\": %.0f", inResult.mSeconds, inResult.mItems, inResult.mItems / seconds);
+			if (inResult.mBytes > 0)
+			{
+				printf(", \"bytes\": %llu, \"megabytes_per_second\": %.2f", inResult.mBytes, inResult.mBytes / seconds / (1024.0 * 1024.0));
+			}
+			printf(", \"output\": %llu, \"allocations\": %llu, \"allocated_bytes\": %llu, \"peak_heap_bytes\": %lld",
+				inResult.mOutput, inResult.mAllocations, inResult.mAllocatedBytes, inResult.mPeakHeapBytes);
+		}
+		printf(" }%s\n", inLast ? "" : ",");
+	}
+
+	bool ParseList(const char* inText, std::vector<std::string>& outList)
+	{
+		outList.clear();
+		std::stringstream stream(inText);
+		std::string item;
+		while (std::getline(stream, item, ','))
+		{
+			if (!item.empty())
+			{
+				outList.push_back(item);
+			}
+		}
+		return !outList.empty();
+	}
+
+	bool ParseUnsigned(const char* inText, unsigned int& outValue)
+	{
+		char* end;
+		unsigned long value = strtoul(inText, &end, 10);
+		if (end == inText || *end != '\0')
+		{
+			return false;
+		}
+		outValue = static_cast<unsigned int>(value);
+		return true;
+	}
+
+	bool ParseArguments(int argc, char** argv, BenchmarkSettings& outSettings)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			std::string option = argv[i];
+			if (i + 1 >= argc)
+			{
+				return false;
+			}
+			const char* value = argv[++i];
+			std::vector<std::string> list;
+
+			if (option == "--sizes" && ParseList(value, list))
+			{
+				outSettings.mSizes.clear();
+				for (unsigned int j = 0; j < list.size(); ++j)
+				{
+					unsigned int size;
+					if (!ParseUnsigned(list[j].c_str(), size) || size == 0)
+					{
+						return false;
+					}
+					outSettings.mSizes.push_back(size);
+				}
+			}
+			else if (option == "--shapes" && ParseList(value, outSettings.mShapes))
+			{
+			}
+			else if (option == "--materials" && ParseUnsigned(value, outSettings.mMaterialCount))
+			{
+			}
+			else if (option == "--bones" && ParseUnsigned(value, outSettings.mBoneCount))
+			{
+			}
+			else if (option == "--frames" && ParseUnsigned(value, outSettings.mFrameCount))
+			{
+			}
+			else if (option == "--poses" && ParseUnsigned(value, outSettings.mPoseCount))
+			{
+			}
+			else if (option == "--output")
+			{
+				outSettings.mOutputFile = value;
+			}
+			else
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	BenchmarkSettings settings;
+	if (!ParseArguments(argc, argv, settings))
+	{
+		fprintf(stderr, "usage: FBX_benchmark [--sizes 1000,10000,...] [--shapes grid,sphere,scan,cylinder]\n"
+			"                     [--materials n] [--bones n] [--frames n] [--poses n]\n"
+			"                     [--output scratch.static_mesh]\n"
+			"sizes are triangle counts, up to 10000000 and more\n");
+		return 1;
+	}
+
+	printf("{\n  \"materials\": %u, \"bones\": %u, \"frames\": %u, \"poses\": %u,\n  \"meshes\": [\n",
+		settings.mMaterialCount, settings.mBoneCount, settings.mFrameCount, settings.mPoseCount);
+
+	bool firstMesh = true;
+	bool failed = false;
+	for (unsigned int s = 0; s < settings.mShapes.size(); ++s)
+	{
+		for (unsigned int i = 0; i < settings.mSizes.size(); ++i)
+		{
+			SyntheticMesh mesh;
+			std::vector<StageResult> results;
+			std::string error;
+			try
+			{
+				if (!SyntheticMeshGenerator::Generate(settings.mShapes[s], settings.mSizes[i], settings.mMaterialCount,
+					settings.mBoneCount, settings.mFrameCount, mesh))
+				{
+					error = "unknown shape";
+				}
+				else
+				{
+					RunStages(mesh, settings, results);
+				}
+			}
+			catch (std::exception& e)
+			{
+				error = e.what();
+			}
+
+			printf("%s    { \"shape\": \"%s\", \"requested_triangles\": %u, \"triangles\": %u, \"vertices\": %u, \"bones\": %u, \"frames\": %u,\n",
+				firstMesh ? "" : ",\n", settings.mShapes[s].c_str(), settings.mSizes[i], mesh.GetTriangleCount(),
+				static_cast<unsigned int>(mesh.mVertices.size()), mesh.mBoneCount, mesh.mFrameCount);
+			if (!error.empty())
+			{
+				printf("      \"error\": \"%s\",\n", error.c_str());
+				failed = true;
+			}
+			printf("      \"stages\": [\n");
+			for (unsigned int j = 0; j < results.size(); ++j)
+			{
+				PrintStage(results[j], j + 1 == results.size());
+			}
+			printf("      ] }");
+			fflush(stdout);
+			firstMesh = false;
+		}
+	}
+
+	printf("\n  ],\n  \"peak_resident_bytes\": %llu\n}\n", GetPeakResidentBytes());
+	return failed ? 1 : 0;
+}
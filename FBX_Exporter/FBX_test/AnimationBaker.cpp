@@ -0,0 +1,132 @@
+#include "AnimationBaker.h"
+#include <emmintrin.h>
+
+void LocalAnimation::Clear()
+{
+	mFrameCount = 0;
+	mFirstFrame = 0;
+	mTranslations.clear();
+	mRotations.clear();
+	mScales.clear();
+}
+
+void AnimationBaker::Bake(const Skeleton& inSkeleton, LocalAnimation& outAnimation)
+{
+	outAnimation.Clear();
+
+	const unsigned int jointCount = inSkeleton.mJoints.size();
+	for (unsigned int i = 0; i < jointCount; ++i)
+	{
+		const Keyframe* firstKey = inSkeleton.mJoints[i].mAnimation;
+		if (firstKey && outAnimation.mFrameCount == 0)
+		{
+			outAnimation.mFirstFrame = firstKey->mFrameNum;
+		}
+		unsigned int keyCount = 0;
+		for (const Keyframe* walker = firstKey; walker; walker = walker->mNext)
+		{
+			++keyCount;
+		}
+		outAnimation.mFrameCount = std::max(outAnimation.mFrameCount, keyCount);
+	}
+
+	const unsigned int frameCount = outAnimation.mFrameCount;
+	if (frameCount == 0)
+	{
+		return;
+	}
+
+	// Nearest ancestor with keys, parents come before their children
+	std::vector<int> keyedParents(jointCount, -1);
+	for (unsigned int i = 0; i < jointCount; ++i)
+	{
+		int parent = inSkeleton.mJoints[i].mParentIndex;
+		while (parent >= 0 && !inSkeleton.mJoints[parent].mAnimation)
+		{
+			parent = inSkeleton.mJoints[parent].mParentIndex;
+		}
+		keyedParents[i] = parent;
+	}
+
+	const size_t keyCount = static_cast<size_t>(jointCount) * frameCount;
+	outAnimation.mTranslations.resize(keyCount);
+	outAnimation.mRotations.resize(keyCount);
+	outAnimation.mScales.resize(keyCount);
+
+	// One joint at a time, its keys in double, then float
+	std::vector<double> localMatrices(static_cast<size_t>(frameCount) * 16);
+	std::vector<XMFLOAT4X4> floatMatrices(frameCount);
+	for (unsigned int i = 0; i < jointCount; ++i)
+	{
+		const Keyframe* walker = inSkeleton.mJoints[i].mAnimation;
+		const Keyframe* parentWalker = keyedParents[i] >= 0 ? inSkeleton.mJoints[keyedParents[i]].mAnimation : nullptr;
+		FbxAMatrix local;
+		local.SetIdentity();
+		for (unsigned int f = 0; f < frameCount; ++f)
+		{
+			// Shorter tracks hold their last key
+			if (walker)
+			{
+				local = parentWalker ? parentWalker->mGlobalTransform.Inverse() * walker->mGlobalTransform : walker->mGlobalTransform;
+				walker = walker->mNext;
+				if (parentWalker && parentWalker->mNext)
+				{
+					parentWalker = parentWalker->mNext;
+				}
+			}
+
+			double* matrix = &localMatrices[static_cast<size_t>(f) * 16];
+			for (int r = 0; r < 4; ++r)
+			{
+				for (int c = 0; c < 4; ++c)
+				{
+					matrix[r * 4 + c] = local.Get(r, c);
+				}
+			}
+		}
+
+		const size_t firstKey = static_cast<size_t>(i) * frameCount;
+		ConvertMatrices(&localMatrices[0], frameCount, &floatMatrices[0]);
+		Decompose(&floatMatrices[0], frameCount, &outAnimation.mTranslations[firstKey], &outAnimation.mRotations[firstKey], &outAnimation.mScales[firstKey]);
+	}
+}
+
+void AnimationBaker::ConvertMatrices(const double* inMatrices, unsigned int inCount, XMFLOAT4X4* outMatrices)
+{
+	for (unsigned int i = 0; i < inCount; ++i)
+	{
+		const double* source = inMatrices + static_cast<size_t>(i) * 16;
+		float* destination = &outMatrices[i].m[0][0];
+		for (int row = 0; row < 4; ++row)
+		{
+			__m128 low = _mm_cvtpd_ps(_mm_loadu_pd(source + row * 4));
+			__m128 high = _mm_cvtpd_ps(_mm_loadu_pd(source + row * 4 + 2));
+			_mm_storeu_ps(destination + row * 4, _mm_movelh_ps(low, high));
+		}
+	}
+}
+
+void AnimationBaker::Decompose(const XMFLOAT4X4* inMatrices, unsigned int inCount, XMFLOAT3* outTranslations, XMFLOAT4* outRotations, XMFLOAT3* outScales)
+{
+	XMVECTOR previous = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+	for (unsigned int i = 0; i < inCount; ++i)
+	{
+		XMVECTOR scale = XMVectorZero();
+		XMVECTOR rotation = previous;
+		XMVECTOR translation = XMVectorSet(inMatrices[i].m[3][0], inMatrices[i].m[3][1], inMatrices[i].m[3][2], 1.0f);
+		if (!XMMatrixDecompose(&scale, &rotation, &translation, XMLoadFloat4x4(&inMatrices[i])))
+		{
+			// Degenerate (zero scale), keep the rotation of the previous key
+			rotation = previous;
+		}
+		if (XMVectorGetX(XMVector4Dot(rotation, previous)) < 0.0f)
+		{
+			rotation = XMVectorNegate(rotation);
+		}
+		previous = rotation;
+
+		XMStoreFloat3(&outTranslations[i], translation);
+		XMStoreFloat4(&outRotations[i], rotation);
+		XMStoreFloat3(&outScales[i], scale);
+	}
+}
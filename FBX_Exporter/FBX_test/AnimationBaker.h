@@ -0,0 +1,42 @@
+#pragma once
+#include "Utilities.h"
+
+// Parent relative transforms of every joint and frame as translation,
+// rotation quaternion and scale. Key f of joint j is at j * mFrameCount + f
+struct LocalAnimation
+{
+	unsigned int mFrameCount;
+	// Of the first key, in frames at 24 per second
+	long long mFirstFrame;
+	std::vector<XMFLOAT3> mTranslations;
+	std::vector<XMFLOAT4> mRotations;
+	std::vector<XMFLOAT3> mScales;
+
+	LocalAnimation() :
+		mFrameCount(0),
+		mFirstFrame(0)
+	{}
+
+	void Clear();
+};
+
+// Turns the sampled keyframes, which are mesh relative global transforms
+// of double precision, into parent relative float TRS keys
+//
+// Local matrices are computed in double, converted to float in batches
+// with SSE2 and decomposed with XNA Math. Joints without keys (not
+// linked to any cluster) get identity keys, and the keys of their
+// children are relative to the nearest ancestor with keys instead, so
+// composing the keys along the hierarchy still gives the globals
+class AnimationBaker
+{
+public:
+	static void Bake(const Skeleton& inSkeleton, LocalAnimation& outAnimation);
+
+	// inCount row major 4x4 double matrices to float
+	static void ConvertMatrices(const double* inMatrices, unsigned int inCount, XMFLOAT4X4* outMatrices);
+
+	// Rotations of consecutive keys of a joint are kept in the same
+	// hemisphere, so they interpolate and delta code well
+	static void Decompose(const XMFLOAT4X4* inMatrices, unsigned int inCount, XMFLOAT3* outTranslations, XMFLOAT4* outRotations, XMFLOAT3* outScales);
+};
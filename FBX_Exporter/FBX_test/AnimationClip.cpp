@@ -0,0 +1,392 @@
+#include "AnimationClip.h"
+#include "MappedFile.h"
+#include <xmmintrin.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	// Components of a group, each a run of four floats
+	enum { TX, TY, TZ, RX, RY, RZ, RW, SX, SY, SZ };
+
+	const float kIdentity[10] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f };
+
+	inline __m128 Lerp(__m128 inA, __m128 inB, __m128 inT)
+	{
+		return _mm_add_ps(inA, _mm_mul_ps(_mm_sub_ps(inB, inA), inT));
+	}
+
+	// Row vectors: row r of the result is row r of inA times inB.
+	// outC may be inA
+	void MultiplyMatrices(const XMFLOAT4X4& inA, const XMFLOAT4X4& inB, XMFLOAT4X4& outC)
+	{
+		const __m128 b0 = _mm_loadu_ps(inB.m[0]);
+		const __m128 b1 = _mm_loadu_ps(inB.m[1]);
+		const __m128 b2 = _mm_loadu_ps(inB.m[2]);
+		const __m128 b3 = _mm_loadu_ps(inB.m[3]);
+		for (int r = 0; r < 4; ++r)
+		{
+			const __m128 a = _mm_loadu_ps(inA.m[r]);
+			__m128 row = _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 0, 0)), b0);
+			row = _mm_add_ps(row, _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 1, 1, 1)), b1));
+			row = _mm_add_ps(row, _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 2, 2)), b2));
+			row = _mm_add_ps(row, _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3)), b3));
+			_mm_storeu_ps(outC.m[r], row);
+		}
+	}
+}
+
+AnimationClip::AnimationClip() :
+	mJointCount(0),
+	mFrameCount(0),
+	mFramesPerSecond(24.0f)
+{
+}
+
+bool AnimationClip::Load(const std::string& inPath)
+{
+	MappedFile file;
+	if (!file.Open(inPath))
+	{
+		return false;
+	}
+	return Load(file.GetData(), file.GetSize());
+}
+
+bool AnimationClip::Load(const char* inData, size_t inSize)
+{
+	SA_header header;
+	if (inSize < sizeof(SA_header))
+	{
+		return false;
+	}
+	memcpy(&header, inData, sizeof(SA_header));
+
+	const bool quantized = (header.Flags & SA_FLAG_QUANTIZED_ROTATIONS) != 0;
+	const size_t keySize = quantized ? sizeof(SA_quantized_key) : sizeof(SA_key);
+	const size_t keyCount = static_cast<size_t>(header.NumOf_Joints) * header.NumOf_Frames;
+	if (header.NumOf_Frames == 0 || !(header.Frames_per_second > 0.0f) ||
+		(inSize - sizeof(SA_header)) / sizeof(SA_joint) < header.NumOf_Joints ||
+		(inSize - sizeof(SA_header) - sizeof(SA_joint) * header.NumOf_Joints) / keySize < keyCount)
+	{
+		return false;
+	}
+
+	// Every check comes before the first member is written, so a file
+	// that fails leaves the clip as it was
+	const char* data = inData + sizeof(SA_header);
+	for (unsigned int j = 0; j < header.NumOf_Joints; ++j)
+	{
+		SA_joint joint;
+		memcpy(&joint, data + j * sizeof(SA_joint), sizeof(SA_joint));
+		if (joint.Parent < -1 || joint.Parent >= static_cast<int>(j))
+		{
+			return false;
+		}
+	}
+
+	mName.assign(header.Name, strnlen(header.Name, sizeof(header.Name)));
+	mJointCount = header.NumOf_Joints;
+	mFrameCount = header.NumOf_Frames;
+	mFramesPerSecond = header.Frames_per_second;
+
+	mJointNames.resize(mJointCount);
+	mParents.resize(mJointCount);
+	mInverseBindposes.resize(mJointCount);
+	for (unsigned int j = 0; j < mJointCount; ++j)
+	{
+		SA_joint joint;
+		memcpy(&joint, data + j * sizeof(SA_joint), sizeof(SA_joint));
+		mJointNames[j].assign(joint.Name, strnlen(joint.Name, sizeof(joint.Name)));
+		mParents[j] = joint.Parent;
+		memcpy(mInverseBindposes[j].m, joint.Inverse_bindpose, sizeof(joint.Inverse_bindpose));
+	}
+	data += sizeof(SA_joint) * mJointCount;
+
+	// Joint major records to frame major groups
+	const unsigned int groupCount = GetGroupCount();
+	mKeys.resize(static_cast<size_t>(mFrameCount) * groupCount * kGroupFloats);
+	for (unsigned int f = 0; f < mFrameCount; ++f)
+	{
+		for (unsigned int j = 0; j < groupCount * 4; ++j)
+		{
+			float* group = &mKeys[(static_cast<size_t>(f) * groupCount + j / 4) * kGroupFloats];
+			float values[10];
+			if (j >= mJointCount)
+			{
+				memcpy(values, kIdentity, sizeof(values));
+			}
+			else if (quantized)
+			{
+				SA_quantized_key key;
+				memcpy(&key, data + (static_cast<size_t>(j) * mFrameCount + f) * keySize, sizeof(key));
+				values[TX] = key.Translation.x;
+				values[TY] = key.Translation.y;
+				values[TZ] = key.Translation.z;
+				for (int c = 0; c < 4; ++c)
+				{
+					values[RX + c] = std::max(key.Rotation[c] / 32767.0f, -1.0f);
+				}
+				values[SX] = key.Scale.x;
+				values[SY] = key.Scale.y;
+				values[SZ] = key.Scale.z;
+			}
+			else
+			{
+				SA_key key;
+				memcpy(&key, data + (static_cast<size_t>(j) * mFrameCount + f) * keySize, sizeof(key));
+				values[TX] = key.Translation.x;
+				values[TY] = key.Translation.y;
+				values[TZ] = key.Translation.z;
+				values[RX] = key.Rotation.x;
+				values[RY] = key.Rotation.y;
+				values[RZ] = key.Rotation.z;
+				values[RW] = key.Rotation.w;
+				values[SX] = key.Scale.x;
+				values[SY] = key.Scale.y;
+				values[SZ] = key.Scale.z;
+			}
+
+			for (int c = 0; c < 10; ++c)
+			{
+				group[c * 4 + j % 4] = values[c];
+			}
+		}
+	}
+
+	return true;
+}
+
+const std::string& AnimationClip::GetName() const
+{
+	return mName;
+}
+
+unsigned int AnimationClip::GetJointCount() const
+{
+	return mJointCount;
+}
+
+unsigned int AnimationClip::GetFrameCount() const
+{
+	return mFrameCount;
+}
+
+float AnimationClip::GetFramesPerSecond() const
+{
+	return mFramesPerSecond;
+}
+
+float AnimationClip::GetDuration() const
+{
+	return mFrameCount > 0 ? (mFrameCount - 1) / mFramesPerSecond : 0.0f;
+}
+
+const std::string& AnimationClip::GetJointName(unsigned int inJoint) const
+{
+	return mJointNames[inJoint];
+}
+
+int AnimationClip::GetParent(unsigned int inJoint) const
+{
+	return mParents[inJoint];
+}
+
+unsigned int AnimationClip::GetGroupCount() const
+{
+	return (mJointCount + 3) / 4;
+}
+
+void AnimationClip::Sample(float inTime, bool inLoop, AnimationPose& ioPose) const
+{
+	const unsigned int groupCount = GetGroupCount();
+	ioPose.mLocal.resize(static_cast<size_t>(groupCount) * kGroupFloats);
+	if (groupCount == 0 || mFrameCount == 0)
+	{
+		return;
+	}
+
+	float frame = inTime * mFramesPerSecond;
+	unsigned int frame0;
+	unsigned int frame1;
+	if (inLoop)
+	{
+		frame = fmodf(frame, static_cast<float>(mFrameCount));
+		if (frame < 0.0f)
+		{
+			frame += mFrameCount;
+		}
+		frame0 = std::min(static_cast<unsigned int>(frame), mFrameCount - 1);
+		frame1 = frame0 + 1 < mFrameCount ? frame0 + 1 : 0;
+	}
+	else
+	{
+		frame = std::min(std::max(frame, 0.0f), static_cast<float>(mFrameCount - 1));
+		frame0 = std::min(static_cast<unsigned int>(frame), mFrameCount - 1);
+		frame1 = std::min(frame0 + 1, mFrameCount - 1);
+	}
+	const float alpha = frame - frame0;
+
+	// Slerp approximation: nlerp with its parameter corrected by a
+	// polynomial in t and |cos| of the angle between the rotations
+	const __m128 t = _mm_set1_ps(alpha);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 tHalf = _mm_sub_ps(t, half);
+	const __m128 tCorrection = _mm_mul_ps(_mm_mul_ps(t, tHalf), _mm_sub_ps(t, _mm_set1_ps(1.0f)));
+	const __m128 tHalfSquared = _mm_mul_ps(tHalf, tHalf);
+	const __m128 signBit = _mm_set1_ps(-0.0f);
+
+	const float* keys0 = &mKeys[static_cast<size_t>(frame0) * groupCount * kGroupFloats];
+	const float* keys1 = &mKeys[static_cast<size_t>(frame1) * groupCount * kGroupFloats];
+	for (unsigned int g = 0; g < groupCount; ++g)
+	{
+		const float* a = keys0 + g * kGroupFloats;
+		const float* b = keys1 + g * kGroupFloats;
+		float* out = &ioPose.mLocal[g * kGroupFloats];
+
+		static const int kLinear[6] = { TX, TY, TZ, SX, SY, SZ };
+		for (int i = 0; i < 6; ++i)
+		{
+			const int c = kLinear[i] * 4;
+			_mm_storeu_ps(out + c, Lerp(_mm_loadu_ps(a + c), _mm_loadu_ps(b + c), t));
+		}
+
+		__m128 ax = _mm_loadu_ps(a + RX * 4);
+		__m128 ay = _mm_loadu_ps(a + RY * 4);
+		__m128 az = _mm_loadu_ps(a + RZ * 4);
+		__m128 aw = _mm_loadu_ps(a + RW * 4);
+		__m128 bx = _mm_loadu_ps(b + RX * 4);
+		__m128 by = _mm_loadu_ps(b + RY * 4);
+		__m128 bz = _mm_loadu_ps(b + RZ * 4);
+		__m128 bw = _mm_loadu_ps(b + RW * 4);
+
+		// Shortest arc: b takes the sign of the dot product
+		__m128 cosAngle = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_add_ps(_mm_mul_ps(az, bz), _mm_mul_ps(aw, bw)));
+		const __m128 sign = _mm_and_ps(cosAngle, signBit);
+		bx = _mm_xor_ps(bx, sign);
+		by = _mm_xor_ps(by, sign);
+		bz = _mm_xor_ps(bz, sign);
+		bw = _mm_xor_ps(bw, sign);
+		const __m128 d = _mm_andnot_ps(signBit, cosAngle);
+
+		__m128 factorA = _mm_sub_ps(_mm_set1_ps(3.55645f), _mm_mul_ps(d, _mm_set1_ps(1.43519f)));
+		factorA = _mm_add_ps(_mm_set1_ps(-3.2452f), _mm_mul_ps(d, factorA));
+		factorA = _mm_add_ps(_mm_set1_ps(1.0904f), _mm_mul_ps(d, factorA));
+		__m128 factorB = _mm_add_ps(_mm_set1_ps(-1.06021f), _mm_mul_ps(d, _mm_set1_ps(0.215638f)));
+		factorB = _mm_add_ps(_mm_set1_ps(0.848013f), _mm_mul_ps(d, factorB));
+		const __m128 k = _mm_add_ps(_mm_mul_ps(factorA, tHalfSquared), factorB);
+		const __m128 correctedT = _mm_add_ps(t, _mm_mul_ps(tCorrection, k));
+
+		__m128 x = Lerp(ax, bx, correctedT);
+		__m128 y = Lerp(ay, by, correctedT);
+		__m128 z = Lerp(az, bz, correctedT);
+		__m128 w = Lerp(aw, bw, correctedT);
+		const __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(w, w))));
+		_mm_storeu_ps(out + RX * 4, _mm_div_ps(x, length));
+		_mm_storeu_ps(out + RY * 4, _mm_div_ps(y, length));
+		_mm_storeu_ps(out + RZ * 4, _mm_div_ps(z, length));
+		_mm_storeu_ps(out + RW * 4, _mm_div_ps(w, length));
+	}
+}
+
+void AnimationClip::GetLocalTransform(const AnimationPose& inPose, unsigned int inJoint, XMFLOAT3& outTranslation, XMFLOAT4& outRotation, XMFLOAT3& outScale) const
+{
+	const float* group = &inPose.mLocal[(inJoint / 4) * kGroupFloats + inJoint % 4];
+	outTranslation = XMFLOAT3(group[TX * 4], group[TY * 4], group[TZ * 4]);
+	outRotation = XMFLOAT4(group[RX * 4], group[RY * 4], group[RZ * 4], group[RW * 4]);
+	outScale = XMFLOAT3(group[SX * 4], group[SY * 4], group[SZ * 4]);
+}
+
+// The local matrices of four joints are built at once, then transposed
+// to one matrix per joint. Parents come first, so each model matrix
+// can replace the local one in place
+void AnimationClip::ComputeModelMatrices(AnimationPose& ioPose) const
+{
+	const unsigned int groupCount = GetGroupCount();
+	ioPose.mModel.resize(groupCount * 4);
+
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+	const __m128 zero = _mm_setzero_ps();
+	for (unsigned int g = 0; g < groupCount; ++g)
+	{
+		const float* local = &ioPose.mLocal[g * kGroupFloats];
+		const __m128 x = _mm_loadu_ps(local + RX * 4);
+		const __m128 y = _mm_loadu_ps(local + RY * 4);
+		const __m128 z = _mm_loadu_ps(local + RZ * 4);
+		const __m128 w = _mm_loadu_ps(local + RW * 4);
+		const __m128 sx = _mm_loadu_ps(local + SX * 4);
+		const __m128 sy = _mm_loadu_ps(local + SY * 4);
+		const __m128 sz = _mm_loadu_ps(local + SZ * 4);
+
+		const __m128 xx = _mm_mul_ps(x, x);
+		const __m128 yy = _mm_mul_ps(y, y);
+		const __m128 zz = _mm_mul_ps(z, z);
+		const __m128 xy = _mm_mul_ps(x, y);
+		const __m128 xz = _mm_mul_ps(x, z);
+		const __m128 yz = _mm_mul_ps(y, z);
+		const __m128 wx = _mm_mul_ps(w, x);
+		const __m128 wy = _mm_mul_ps(w, y);
+		const __m128 wz = _mm_mul_ps(w, z);
+
+		// Scale, then rotation (XMMatrixRotationQuaternion), then translation
+		__m128 row0[4] =
+		{
+			_mm_mul_ps(sx, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz)))),
+			_mm_mul_ps(sx, _mm_mul_ps(two, _mm_add_ps(xy, wz))),
+			_mm_mul_ps(sx, _mm_mul_ps(two, _mm_sub_ps(xz, wy))),
+			zero
+		};
+		__m128 row1[4] =
+		{
+			_mm_mul_ps(sy, _mm_mul_ps(two, _mm_sub_ps(xy, wz))),
+			_mm_mul_ps(sy, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz)))),
+			_mm_mul_ps(sy, _mm_mul_ps(two, _mm_add_ps(yz, wx))),
+			zero
+		};
+		__m128 row2[4] =
+		{
+			_mm_mul_ps(sz, _mm_mul_ps(two, _mm_add_ps(xz, wy))),
+			_mm_mul_ps(sz, _mm_mul_ps(two, _mm_sub_ps(yz, wx))),
+			_mm_mul_ps(sz, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy)))),
+			zero
+		};
+		__m128 row3[4] =
+		{
+			_mm_loadu_ps(local + TX * 4),
+			_mm_loadu_ps(local + TY * 4),
+			_mm_loadu_ps(local + TZ * 4),
+			one
+		};
+		_MM_TRANSPOSE4_PS(row0[0], row0[1], row0[2], row0[3]);
+		_MM_TRANSPOSE4_PS(row1[0], row1[1], row1[2], row1[3]);
+		_MM_TRANSPOSE4_PS(row2[0], row2[1], row2[2], row2[3]);
+		_MM_TRANSPOSE4_PS(row3[0], row3[1], row3[2], row3[3]);
+		for (unsigned int lane = 0; lane < 4; ++lane)
+		{
+			XMFLOAT4X4& matrix = ioPose.mModel[g * 4 + lane];
+			_mm_storeu_ps(matrix.m[0], row0[lane]);
+			_mm_storeu_ps(matrix.m[1], row1[lane]);
+			_mm_storeu_ps(matrix.m[2], row2[lane]);
+			_mm_storeu_ps(matrix.m[3], row3[lane]);
+		}
+	}
+
+	for (unsigned int j = 0; j < mJointCount; ++j)
+	{
+		if (mParents[j] >= 0)
+		{
+			MultiplyMatrices(ioPose.mModel[j], ioPose.mModel[mParents[j]], ioPose.mModel[j]);
+		}
+	}
+}
+
+void AnimationClip::ComputeSkinningMatrices(AnimationPose& ioPose) const
+{
+	ioPose.mSkinning.resize(ioPose.mModel.size());
+	for (unsigned int j = 0; j < mJointCount; ++j)
+	{
+		MultiplyMatrices(mInverseBindposes[j], ioPose.mModel[j], ioPose.mSkinning[j]);
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "MathHelper.h"
+#include "static_anim_struct.h"
+#include <string>
+#include <vector>
+
+// Pose of every joint of a clip. The local pose is stored like the
+// clip's keys: groups of four joints, each group ten runs of four
+// floats (translation x, y, z, rotation x, y, z, w, scale x, y, z)
+// Matrices transform row vectors, like the exported ones. There is
+// one per joint, padded to a multiple of four
+struct AnimationPose
+{
+	std::vector<float> mLocal;
+	std::vector<XMFLOAT4X4> mModel;
+	std::vector<XMFLOAT4X4> mSkinning;
+};
+
+// Runtime side of the .static_anim files: loads a clip and evaluates
+// it without the FBX SDK or the exporter
+//
+// Sampling interpolates two keys of all joints four joints at a time
+// with SSE: translations and scales linearly, rotations with a slerp
+// approximated by a corrected nlerp (within 1e-4 rad of the exact
+// slerp for keys up to 90 degrees apart, 2e-3 rad at 180). The
+// hierarchy pass walks the parent index array once, and the skinning
+// matrices are the model matrices after the inverse bind poses
+class AnimationClip
+{
+public:
+	AnimationClip();
+
+	// False if the file is not a .static_anim file or is truncated
+	bool Load(const std::string& inPath);
+	bool Load(const char* inData, size_t inSize);
+
+	const std::string& GetName() const;
+	unsigned int GetJointCount() const;
+	unsigned int GetFrameCount() const;
+	float GetFramesPerSecond() const;
+	// From the first to the last key, in seconds
+	float GetDuration() const;
+	const std::string& GetJointName(unsigned int inJoint) const;
+	// -1 for roots, parents come before their children
+	int GetParent(unsigned int inJoint) const;
+
+	// Local pose inTime seconds after the first key, clamped to the clip
+	// or, with inLoop, wrapped around it (the last key then blends into
+	// the first one)
+	void Sample(float inTime, bool inLoop, AnimationPose& ioPose) const;
+	// Local translation, rotation and scale of one joint of a pose
+	void GetLocalTransform(const AnimationPose& inPose, unsigned int inJoint, XMFLOAT3& outTranslation, XMFLOAT4& outRotation, XMFLOAT3& outScale) const;
+	// Model (mesh) space matrices of the sampled pose
+	void ComputeModelMatrices(AnimationPose& ioPose) const;
+	// Inverse bind pose followed by the model matrix, what skinning
+	// shaders take. Needs the model matrices
+	void ComputeSkinningMatrices(AnimationPose& ioPose) const;
+
+private:
+	// Floats of one group of four joints in one frame
+	static const unsigned int kGroupFloats = 40;
+
+	unsigned int GetGroupCount() const;
+
+	std::string mName;
+	unsigned int mJointCount;
+	unsigned int mFrameCount;
+	float mFramesPerSecond;
+	std::vector<std::string> mJointNames;
+	std::vector<int> mParents;
+	std::vector<XMFLOAT4X4> mInverseBindposes;
+	// Frame major, groups of four joints as in AnimationPose::mLocal.
+	// Lanes past the last joint hold the identity
+	std::vector<float> mKeys;
+};
@@ -0,0 +1,211 @@
+#include "BatchExporter.h"
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+
+BatchExporter::BatchExporter()
+{
+	mImportThreads = 1;
+	mProcessThreads = 1;
+	mWriteThreads = 1;
+	mQueueCapacity = 2;
+}
+
+BatchExporter::~BatchExporter()
+{
+	DestroyPool();
+}
+
+void BatchExporter::SetStageThreads(unsigned int inImportThreads, unsigned int inProcessThreads, unsigned int inWriteThreads)
+{
+	mImportThreads = std::max(inImportThreads, 1u);
+	mProcessThreads = std::max(inProcessThreads, 1u);
+	mWriteThreads = std::max(inWriteThreads, 1u);
+}
+
+void BatchExporter::SetQueueCapacity(unsigned int inCapacity)
+{
+	mQueueCapacity = std::max(inCapacity, 1u);
+}
+
+void BatchExporter::SetConfiguration(const std::function<void(FBXExporter&)>& inConfigure)
+{
+	mConfigure = inConfigure;
+}
+
+bool BatchExporter::CreatePool()
+{
+	DestroyPool();
+
+	// Each exporter has its own FbxManager, the SDK objects are never
+	// shared between threads. Only the processing threads run scenes
+	// through LOD and BVH generation at the same time, so they split
+	// the hardware threads between them
+	unsigned int poolSize = mImportThreads + mProcessThreads + mWriteThreads + mQueueCapacity;
+	unsigned int workerThreads = std::max(std::thread::hardware_concurrency() / mProcessThreads, 1u);
+	for (unsigned int i = 0; i < poolSize; ++i)
+	{
+		FBXExporter* exporter = new FBXExporter();
+		mPool.push_back(exporter);
+		mLogs.push_back(new std::ostringstream());
+		if (!exporter->Initialize())
+		{
+			return false;
+		}
+		if (mConfigure)
+		{
+			mConfigure(*exporter);
+		}
+		exporter->SetWorkerThreads(workerThreads);
+		exporter->SetLog(mLogs[i]);
+	}
+
+	return true;
+}
+
+void BatchExporter::DestroyPool()
+{
+	for (unsigned int i = 0; i < mPool.size(); ++i)
+	{
+		delete mPool[i];
+	}
+	mPool.clear();
+	for (unsigned int i = 0; i < mLogs.size(); ++i)
+	{
+		delete mLogs[i];
+	}
+	mLogs.clear();
+}
+
+unsigned int BatchExporter::Run(const std::vector<std::string>& inInputFiles)
+{
+	if (inInputFiles.empty() || !CreatePool())
+	{
+		return 0;
+	}
+
+	BoundedQueue<unsigned int> freeExporters(mPool.size());
+	BoundedQueue<Job> processQueue(mQueueCapacity);
+	BoundedQueue<Job> writeQueue(mQueueCapacity);
+	for (unsigned int i = 0; i < mPool.size(); ++i)
+	{
+		freeExporters.Push(i);
+	}
+	std::mutex outputMutex;
+
+	std::atomic<unsigned int> nextFile(0);
+	std::atomic<unsigned int> runningImporters(mImportThreads);
+	std::atomic<unsigned int> runningProcessors(mProcessThreads);
+	std::atomic<unsigned int> exportedFiles(0);
+
+	// The last thread of a stage closes the queue of the next stage.
+	// Failed jobs still travel down the pipeline, only the write stage
+	// hands exporters back to the pool
+	auto importStage = [&]()
+	{
+		for (unsigned int fileIndex = nextFile++; fileIndex < inInputFiles.size(); fileIndex = nextFile++)
+		{
+			Job job;
+			freeExporters.Pop(job.mExporterIndex);
+			job.mFileIndex = fileIndex;
+			const std::string& inputFile = inInputFiles[fileIndex];
+			RunStage(job, *mPool[job.mExporterIndex], [&inputFile](FBXExporter& ioExporter)
+			{
+				if (Utilities::EndsWith(inputFile, SNAPSHOT_SUFFIX))
+				{
+					return ioExporter.LoadSnapshot(inputFile.c_str());
+				}
+				return ioExporter.ImportScene(inputFile.c_str());
+			});
+			processQueue.Push(job);
+		}
+		if (--runningImporters == 0)
+		{
+			processQueue.Close();
+		}
+	};
+
+	auto processStage = [&]()
+	{
+		Job job;
+		while (processQueue.Pop(job))
+		{
+			if (job.mSucceeded)
+			{
+				RunStage(job, *mPool[job.mExporterIndex], [](FBXExporter& ioExporter)
+				{
+					return ioExporter.ProcessScene();
+				});
+			}
+			writeQueue.Push(job);
+		}
+		if (--runningProcessors == 0)
+		{
+			writeQueue.Close();
+		}
+	};
+
+	auto writeStage = [&]()
+	{
+		Job job;
+		while (writeQueue.Pop(job))
+		{
+			FBXExporter& exporter = *mPool[job.mExporterIndex];
+			if (job.mSucceeded)
+			{
+				std::string outputPath = Utilities::RemoveSuffix(inInputFiles[job.mFileIndex]);
+				RunStage(job, exporter, [&outputPath](FBXExporter& ioExporter)
+				{
+					return ioExporter.ExportAsMesh(outputPath.c_str());
+				});
+			}
+			if (job.mSucceeded)
+			{
+				++exportedFiles;
+			}
+			exporter.Reset();
+
+			// The whole log of the file at once
+			std::ostringstream& log = *mLogs[job.mExporterIndex];
+			{
+				std::lock_guard<std::mutex> lock(outputMutex);
+				std::cout << log.str();
+				if (!job.mSucceeded)
+				{
+					std::cout << "Failed to export " << inInputFiles[job.mFileIndex];
+					if (!job.mError.empty())
+					{
+						std::cout << ": " << job.mError;
+					}
+					std::cout << "\n";
+				}
+				std::cout.flush();
+			}
+			log.str("");
+			log.clear();
+
+			freeExporters.Push(job.mExporterIndex);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (unsigned int i = 0; i < mImportThreads; ++i)
+	{
+		threads.push_back(std::thread(importStage));
+	}
+	for (unsigned int i = 0; i < mProcessThreads; ++i)
+	{
+		threads.push_back(std::thread(processStage));
+	}
+	for (unsigned int i = 0; i < mWriteThreads; ++i)
+	{
+		threads.push_back(std::thread(writeStage));
+	}
+	for (unsigned int i = 0; i < threads.size(); ++i)
+	{
+		threads[i].join();
+	}
+
+	return exportedFiles;
+}
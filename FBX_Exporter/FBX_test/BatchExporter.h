@@ -0,0 +1,90 @@
+#pragma once
+#include "FBXExporter.h"
+#include "BoundedQueue.h"
+#include <functional>
+#include <sstream>
+
+// Exports many files through a three stage pipeline: while file N is
+// processed, file N+1 is imported and file N-1 is written
+//
+// Every file in flight owns one FBXExporter from a fixed pool, which is
+// what bounds the memory use. The stages are connected by bounded
+// queues and an exporter only goes back to the pool once its file has
+// been written, so the importers wait when the later stages fall behind
+//
+// A file that throws in any stage is reported and skipped. Every
+// exporter logs into its own buffer, printed in one piece once its file
+// is done, and the processing threads share the hardware threads for
+// their LOD and BVH generation
+class BatchExporter
+{
+public:
+	BatchExporter();
+	~BatchExporter();
+
+	// Threads per stage, at least one each
+	void SetStageThreads(unsigned int inImportThreads, unsigned int inProcessThreads, unsigned int inWriteThreads);
+
+	// Capacity of the queues between the stages. The pool holds one
+	// exporter per thread plus this many, so it also caps how many
+	// loaded scenes can wait between the stages
+	void SetQueueCapacity(unsigned int inCapacity);
+
+	// Called once on every pooled exporter after it is initialized,
+	// to apply the export options (SetLodChain etc.). The pool then sets
+	// the exporter's log and worker threads itself
+	void SetConfiguration(const std::function<void(FBXExporter&)>& inConfigure);
+
+	// Writes <input without suffix>.static_mesh for every input file
+	// Inputs ending in SNAPSHOT_SUFFIX are loaded as scene snapshots
+	// Returns how many files were exported successfully
+	unsigned int Run(const std::vector<std::string>& inInputFiles);
+
+private:
+	struct Job
+	{
+		// Into mPool and mLogs
+		unsigned int mExporterIndex;
+		unsigned int mFileIndex;
+		bool mSucceeded;
+		// what() of the exception the file failed with, if any
+		std::string mError;
+	};
+
+	BatchExporter(const BatchExporter&);
+	BatchExporter& operator=(const BatchExporter&);
+
+	bool CreatePool();
+	void DestroyPool();
+
+	// Runs inStage on the job's exporter, a throwing stage fails the job
+	template<typename Stage>
+	static void RunStage(Job& ioJob, FBXExporter& ioExporter, Stage inStage);
+
+	unsigned int mImportThreads;
+	unsigned int mProcessThreads;
+	unsigned int mWriteThreads;
+	unsigned int mQueueCapacity;
+	std::function<void(FBXExporter&)> mConfigure;
+	std::vector<FBXExporter*> mPool;
+	std::vector<std::ostringstream*> mLogs;
+};
+
+template<typename Stage>
+void BatchExporter::RunStage(Job& ioJob, FBXExporter& ioExporter, Stage inStage)
+{
+	try
+	{
+		ioJob.mSucceeded = inStage(ioExporter);
+	}
+	catch (const std::exception& e)
+	{
+		ioJob.mSucceeded = false;
+		ioJob.mError = e.what();
+	}
+	catch (...)
+	{
+		ioJob.mSucceeded = false;
+		ioJob.mError = "Unknown error";
+	}
+}
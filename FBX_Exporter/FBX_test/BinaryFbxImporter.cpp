@@ -0,0 +1,1268 @@
+#include "BinaryFbxImporter.h"
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	const long long kTicksPerSecond = 46186158000LL;
+	// FbxTime::eFrames24, the rate FBXExporter samples animation at
+	const long long kTicksPerFrame = kTicksPerSecond / 24;
+	// Cache key of the transforms without animation
+	const long long kStaticTime = LLONG_MIN;
+
+	// KeyAttrFlags
+	const int kInterpolationConstant = 0x02;
+	const int kInterpolationCubic = 0x08;
+	const int kConstantNext = 0x100;
+
+	enum Mapping { kByControlPoint, kByPolygonVertex, kByPolygon, kAllSame };
+
+	const double kZero[3] = { 0.0, 0.0, 0.0 };
+	const double kOne[3] = { 1.0, 1.0, 1.0 };
+	// Defaults of the FbxSurfaceLambert and FbxSurfacePhong properties,
+	// for files without property templates
+	const double kDefaultAmbient[3] = { 0.2, 0.2, 0.2 };
+	const double kDefaultDiffuse[3] = { 0.8, 0.8, 0.8 };
+	const double kDefaultSpecular[3] = { 0.2, 0.2, 0.2 };
+
+	// Attribute layer of a mesh (LayerElementNormal etc)
+	struct LayerElement
+	{
+		int mMapping;
+		bool mIndexed;
+		unsigned int mComponents;
+		std::vector<double> mValues;
+		std::vector<int> mIndices;
+
+		// Null for corners the layer has no value for
+		const double* Get(unsigned int inControlPoint, unsigned int inCorner, unsigned int inPolygon) const
+		{
+			size_t index;
+			switch (mMapping)
+			{
+			case kByControlPoint:
+				index = inControlPoint;
+				break;
+			case kByPolygonVertex:
+				index = inCorner;
+				break;
+			case kByPolygon:
+				index = inPolygon;
+				break;
+			default:
+				index = 0;
+				break;
+			}
+
+			if (mIndexed)
+			{
+				if (index >= mIndices.size() || mIndices[index] < 0)
+				{
+					return nullptr;
+				}
+				index = mIndices[index];
+			}
+			if ((index + 1) * mComponents > mValues.size())
+			{
+				return nullptr;
+			}
+			return &mValues[index * mComponents];
+		}
+	};
+
+	bool ReadMapping(const std::string& inMapping, int& outMapping)
+	{
+		if (inMapping == "ByVertice" || inMapping == "ByVertex" || inMapping == "ByControlPoint")
+		{
+			outMapping = kByControlPoint;
+		}
+		else if (inMapping == "ByPolygonVertex")
+		{
+			outMapping = kByPolygonVertex;
+		}
+		else if (inMapping == "ByPolygon")
+		{
+			outMapping = kByPolygon;
+		}
+		else if (inMapping == "AllSame")
+		{
+			outMapping = kAllSame;
+		}
+		else
+		{
+			return false;
+		}
+		return true;
+	}
+
+	bool ReadLayerElement(const BinaryFbxParser& inParser, unsigned int inNode, const char* inValues, const char* inIndices, unsigned int inComponents, LayerElement& outElement)
+	{
+		unsigned int mapping = inParser.FindChild(inNode, "MappingInformationType");
+		unsigned int reference = inParser.FindChild(inNode, "ReferenceInformationType");
+		unsigned int values = inParser.FindChild(inNode, inValues);
+		if (!mapping || !values || !ReadMapping(inParser.GetString(mapping, 0), outElement.mMapping))
+		{
+			return false;
+		}
+
+		std::string referenceMode = reference ? inParser.GetString(reference, 0) : "Direct";
+		outElement.mIndexed = referenceMode == "IndexToDirect" || referenceMode == "Index";
+		outElement.mComponents = inComponents;
+		if (!inParser.GetArray(values, 0, outElement.mValues))
+		{
+			return false;
+		}
+		outElement.mIndices.clear();
+		if (outElement.mIndexed)
+		{
+			unsigned int indices = inParser.FindChild(inNode, inIndices);
+			if (!indices || !inParser.GetArray(indices, 0, outElement.mIndices))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Matrices are 16 doubles in FbxAMatrix layout (row vectors,
+	// translation in [12..14]); Multiply(a, b) is FbxAMatrix a * b,
+	// which applies b first
+	void SetIdentity(double* outMatrix)
+	{
+		memset(outMatrix, 0, sizeof(double) * 16);
+		outMatrix[0] = outMatrix[5] = outMatrix[10] = outMatrix[15] = 1.0;
+	}
+
+	void Multiply(const double* inLeft, const double* inRight, double* outMatrix)
+	{
+		double result[16];
+		for (int row = 0; row < 4; ++row)
+		{
+			for (int column = 0; column < 4; ++column)
+			{
+				result[row * 4 + column] =
+					inRight[row * 4] * inLeft[column] +
+					inRight[row * 4 + 1] * inLeft[4 + column] +
+					inRight[row * 4 + 2] * inLeft[8 + column] +
+					inRight[row * 4 + 3] * inLeft[12 + column];
+			}
+		}
+		memcpy(outMatrix, result, sizeof(result));
+	}
+
+	// ioMatrix = ioMatrix * inRight
+	void Append(double* ioMatrix, const double* inRight)
+	{
+		Multiply(ioMatrix, inRight, ioMatrix);
+	}
+
+	void AppendTranslation(double* ioMatrix, const double* inTranslation, double inSign)
+	{
+		double translation[16];
+		SetIdentity(translation);
+		translation[12] = inTranslation[0] * inSign;
+		translation[13] = inTranslation[1] * inSign;
+		translation[14] = inTranslation[2] * inSign;
+		Append(ioMatrix, translation);
+	}
+
+	void AppendScaling(double* ioMatrix, const double* inScaling)
+	{
+		double scaling[16];
+		SetIdentity(scaling);
+		scaling[0] = inScaling[0];
+		scaling[5] = inScaling[1];
+		scaling[10] = inScaling[2];
+		Append(ioMatrix, scaling);
+	}
+
+	// Rotations in degrees, inOrder is FbxEuler::EOrder (XYZ rotates
+	// about X first). With inInverse the transposed rotation is appended
+	void AppendRotation(double* ioMatrix, const double* inDegrees, int inOrder, bool inInverse)
+	{
+		static const int kAxisOrders[6][3] = { { 0, 1, 2 }, { 0, 2, 1 }, { 1, 2, 0 }, { 1, 0, 2 }, { 2, 0, 1 }, { 2, 1, 0 } };
+		const int* axes = kAxisOrders[inOrder >= 0 && inOrder < 6 ? inOrder : 0];
+
+		double rotation[16];
+		SetIdentity(rotation);
+		for (int i = 2; i >= 0; --i)
+		{
+			int axis = axes[i];
+			double radians = inDegrees[axis] * 3.14159265358979323846 / 180.0;
+			double c = cos(radians);
+			double s = sin(radians);
+			// Rows of the rotation about one axis
+			int u = (axis + 1) % 3;
+			int v = (axis + 2) % 3;
+			double axisRotation[16];
+			SetIdentity(axisRotation);
+			axisRotation[u * 4 + u] = c;
+			axisRotation[u * 4 + v] = s;
+			axisRotation[v * 4 + u] = -s;
+			axisRotation[v * 4 + v] = c;
+			Append(rotation, axisRotation);
+		}
+
+		if (inInverse)
+		{
+			for (int row = 0; row < 3; ++row)
+			{
+				for (int column = row + 1; column < 3; ++column)
+				{
+					std::swap(rotation[row * 4 + column], rotation[column * 4 + row]);
+				}
+			}
+		}
+		Append(ioMatrix, rotation);
+	}
+
+	// Of a matrix whose last column is (0, 0, 0, 1)
+	void AffineInverse(const double* inMatrix, double* outMatrix)
+	{
+		const double* m = inMatrix;
+		double result[16];
+		result[0] = m[5] * m[10] - m[6] * m[9];
+		result[1] = m[2] * m[9] - m[1] * m[10];
+		result[2] = m[1] * m[6] - m[2] * m[5];
+		result[4] = m[6] * m[8] - m[4] * m[10];
+		result[5] = m[0] * m[10] - m[2] * m[8];
+		result[6] = m[2] * m[4] - m[0] * m[6];
+		result[8] = m[4] * m[9] - m[5] * m[8];
+		result[9] = m[1] * m[8] - m[0] * m[9];
+		result[10] = m[0] * m[5] - m[1] * m[4];
+
+		double determinant = m[0] * result[0] + m[1] * result[4] + m[2] * result[8];
+		double inverseDeterminant = determinant != 0.0 ? 1.0 / determinant : 0.0;
+		for (int row = 0; row < 3; ++row)
+		{
+			for (int column = 0; column < 3; ++column)
+			{
+				result[row * 4 + column] *= inverseDeterminant;
+			}
+			result[row * 4 + 3] = 0.0;
+		}
+		for (int column = 0; column < 3; ++column)
+		{
+			result[12 + column] = -(m[12] * result[column] + m[13] * result[4 + column] + m[14] * result[8 + column]);
+		}
+		result[15] = 1.0;
+		memcpy(outMatrix, result, sizeof(result));
+	}
+
+	// "Name\x00\x01Class" to "Name"
+	std::string GetObjectName(const std::string& inName)
+	{
+		size_t separator = inName.find(std::string("\x00\x01", 2));
+		return separator != std::string::npos ? inName.substr(0, separator) : inName;
+	}
+
+	std::string ToLower(std::string inText)
+	{
+		std::transform(inText.begin(), inText.end(), inText.begin(), [](char inChar)
+		{
+			return static_cast<char>(tolower(static_cast<unsigned char>(inChar)));
+		});
+		return inText;
+	}
+}
+
+BinaryFbxImporter::BinaryFbxImporter() :
+	mUVSetCount(1),
+	mColorSetCount(0),
+	mStages(GetImportStages(IMPORT_FULL)),
+	mSnapshot(nullptr),
+	mAnimationStack(0),
+	mAnimationStart(0),
+	mAnimationStop(0)
+{
+}
+
+const std::string& BinaryFbxImporter::GetError() const
+{
+	return mError;
+}
+
+bool BinaryFbxImporter::Fail(const char* inError)
+{
+	mError = inError;
+	return false;
+}
+
+bool BinaryFbxImporter::Import(const std::string& inPath, unsigned int inUVSetCount, unsigned int inColorSetCount, const ImportStages& inStages, unsigned int inThreads, SceneSnapshot& outSnapshot)
+{
+	mError.clear();
+	mStages = inStages;
+	mUVSetCount = std::min(inUVSetCount, MAX_UV_SETS);
+	mColorSetCount = std::min(inColorSetCount, MAX_COLOR_SETS);
+	mSnapshot = &outSnapshot;
+	outSnapshot.Clear();
+
+	if (!mParser.Parse(inPath, inThreads))
+	{
+		return Fail("Not a binary FBX file, or a corrupt one");
+	}
+
+	ReadObjects();
+	ReadConnections();
+	if (mStages.mAnimation)
+	{
+		ReadAnimation();
+	}
+	else
+	{
+		mAnimationStack = 0;
+	}
+
+	mGlobalTransforms.assign(mObjects.size() * 16, 0.0);
+	mGlobalTimes.assign(mObjects.size(), 0);
+	mGlobalValid.assign(mObjects.size(), false);
+
+	outSnapshot.mSourceFile = inPath;
+	outSnapshot.mUVSetCount = mUVSetCount;
+	outSnapshot.mColorSetCount = mColorSetCount;
+
+	mJointModels.clear();
+	for (const Connection& child : mChildren[0])
+	{
+		if (mStages.mSkeleton && mParentModels[child.mObject] == 0 && mObjects[child.mObject].mClass == "Model")
+		{
+			CollectJoints(child.mObject, 0, -1);
+		}
+	}
+	mJointBound.assign(mJointModels.size(), false);
+	outSnapshot.mHasAnimation = !outSnapshot.mJoints.empty();
+
+	bool succeeded = true;
+	for (const Connection& child : mChildren[0])
+	{
+		if (mParentModels[child.mObject] == 0 && mObjects[child.mObject].mClass == "Model" && !ProcessGeometry(child.mObject))
+		{
+			succeeded = false;
+			break;
+		}
+	}
+
+	mParser.Clear();
+	mObjects.clear();
+	mObjectIndices.clear();
+	mChildren.clear();
+	mParentModels.clear();
+	mMaterialIndices.clear();
+	mCurves.clear();
+	mModelAnimations.clear();
+	if (!succeeded)
+	{
+		outSnapshot.Clear();
+	}
+	return succeeded;
+}
+
+void BinaryFbxImporter::ReadObjects()
+{
+	mObjects.clear();
+	mObjectIndices.clear();
+
+	Object root;
+	root.mId = 0;
+	root.mNode = 0;
+	root.mProperties = 0;
+	root.mTemplate = 0;
+	mObjects.push_back(root);
+	mObjectIndices[0] = 0;
+
+	// Property templates by object class, in file order
+	std::unordered_map<std::string, std::vector<std::pair<std::string, unsigned int>>> templates;
+	unsigned int definitions = mParser.FindChild(0, "Definitions");
+	for (unsigned int type = definitions ? mParser.GetFirstChild(definitions) : 0; type != 0; type = mParser.GetNextSibling(type))
+	{
+		if (!mParser.IsNamed(type, "ObjectType"))
+		{
+			continue;
+		}
+		for (unsigned int propertyTemplate = mParser.GetFirstChild(type); propertyTemplate != 0; propertyTemplate = mParser.GetNextSibling(propertyTemplate))
+		{
+			unsigned int properties = mParser.FindChild(propertyTemplate, "Properties70");
+			if (mParser.IsNamed(propertyTemplate, "PropertyTemplate") && properties)
+			{
+				templates[mParser.GetString(type, 0)].push_back(std::make_pair(mParser.GetString(propertyTemplate, 0), properties));
+			}
+		}
+	}
+
+	unsigned int objects = mParser.FindChild(0, "Objects");
+	for (unsigned int node = objects ? mParser.GetFirstChild(objects) : 0; node != 0; node = mParser.GetNextSibling(node))
+	{
+		if (mParser.GetPropertyCount(node) < 3)
+		{
+			continue;
+		}
+
+		Object object;
+		object.mId = mParser.GetInteger(node, 0);
+		object.mNode = node;
+		object.mName = GetObjectName(mParser.GetString(node, 1));
+		object.mSubclass = mParser.GetString(node, 2);
+		object.mProperties = mParser.FindChild(node, "Properties70");
+		object.mTemplate = 0;
+
+		// The record name is the class, both for the Skin Deformer and
+		// its Cluster SubDeformers
+		static const char* kClasses[] = { "Model", "Geometry", "Material", "Texture", "LayeredTexture", "Deformer", "AnimationStack", "AnimationLayer", "AnimationCurveNode", "AnimationCurve" };
+		for (const char* objectClass : kClasses)
+		{
+			if (mParser.IsNamed(node, objectClass))
+			{
+				object.mClass = objectClass;
+				break;
+			}
+		}
+
+		auto found = templates.find(object.mClass);
+		if (found != templates.end())
+		{
+			object.mTemplate = found->second.front().second;
+			// Lambert and Phong materials have templates of their own
+			if (object.mClass == "Material")
+			{
+				unsigned int shadingModelNode = mParser.FindChild(node, "ShadingModel");
+				std::string shadingModel = shadingModelNode ? ToLower(mParser.GetString(shadingModelNode, 0)) : std::string();
+				for (const auto& propertyTemplate : found->second)
+				{
+					if (ToLower(propertyTemplate.first).find(shadingModel == "phong" ? "phong" : "lambert") != std::string::npos)
+					{
+						object.mTemplate = propertyTemplate.second;
+					}
+				}
+			}
+		}
+
+		mObjectIndices[object.mId] = static_cast<unsigned int>(mObjects.size());
+		mObjects.push_back(object);
+	}
+}
+
+void BinaryFbxImporter::ReadConnections()
+{
+	mChildren.assign(mObjects.size(), std::vector<Connection>());
+	mParentModels.assign(mObjects.size(), 0);
+	std::vector<bool> hasParent(mObjects.size(), false);
+
+	unsigned int connections = mParser.FindChild(0, "Connections");
+	for (unsigned int node = connections ? mParser.GetFirstChild(connections) : 0; node != 0; node = mParser.GetNextSibling(node))
+	{
+		if (!mParser.IsNamed(node, "C") || mParser.GetPropertyCount(node) < 3)
+		{
+			continue;
+		}
+
+		auto child = mObjectIndices.find(mParser.GetInteger(node, 1));
+		auto parent = mObjectIndices.find(mParser.GetInteger(node, 2));
+		if (child == mObjectIndices.end() || parent == mObjectIndices.end())
+		{
+			continue;
+		}
+
+		Connection connection;
+		connection.mObject = child->second;
+		if (mParser.GetString(node, 0) == "OP")
+		{
+			connection.mProperty = mParser.GetString(node, 3);
+		}
+		mChildren[parent->second].push_back(connection);
+
+		// The node hierarchy
+		const Object& childObject = mObjects[child->second];
+		const Object& parentObject = mObjects[parent->second];
+		if (childObject.mClass == "Model" && (parent->second == 0 || parentObject.mClass == "Model") && !hasParent[child->second])
+		{
+			mParentModels[child->second] = parent->second;
+			hasParent[child->second] = true;
+		}
+	}
+}
+
+// The curve nodes of the layers of the first animation stack
+void BinaryFbxImporter::ReadAnimation()
+{
+	mCurves.clear();
+	mModelAnimations.clear();
+	mAnimationStack = 0;
+	mAnimationStart = 0;
+	mAnimationStop = 0;
+
+	for (unsigned int i = 1; i < mObjects.size(); ++i)
+	{
+		if (mObjects[i].mClass == "AnimationStack")
+		{
+			mAnimationStack = i;
+			break;
+		}
+	}
+	if (mAnimationStack == 0)
+	{
+		return;
+	}
+
+	// Time span of the take, as FbxTakeInfo::mLocalTimeSpan
+	bool foundTake = false;
+	unsigned int takes = mParser.FindChild(0, "Takes");
+	for (unsigned int take = takes ? mParser.GetFirstChild(takes) : 0; take != 0; take = mParser.GetNextSibling(take))
+	{
+		unsigned int localTime = mParser.FindChild(take, "LocalTime");
+		if (mParser.IsNamed(take, "Take") && localTime && mParser.GetString(take, 0) == mObjects[mAnimationStack].mName)
+		{
+			mAnimationStart = mParser.GetInteger(localTime, 0);
+			mAnimationStop = mParser.GetInteger(localTime, 1);
+			foundTake = true;
+			break;
+		}
+	}
+	if (!foundTake)
+	{
+		unsigned int start = FindProperty(mAnimationStack, "LocalStart");
+		unsigned int stop = FindProperty(mAnimationStack, "LocalStop");
+		mAnimationStart = start ? mParser.GetInteger(start, 4) : 0;
+		mAnimationStop = stop ? mParser.GetInteger(stop, 4) : 0;
+	}
+
+	std::vector<bool> activeCurveNodes(mObjects.size(), false);
+	for (const Connection& layer : mChildren[mAnimationStack])
+	{
+		if (mObjects[layer.mObject].mClass != "AnimationLayer")
+		{
+			continue;
+		}
+		for (const Connection& curveNode : mChildren[layer.mObject])
+		{
+			activeCurveNodes[curveNode.mObject] = mObjects[curveNode.mObject].mClass == "AnimationCurveNode";
+		}
+	}
+
+	static const char* kChannels[3] = { "Lcl Translation", "Lcl Rotation", "Lcl Scaling" };
+	static const char* kAxes[3] = { "d|X", "d|Y", "d|Z" };
+	for (unsigned int model = 1; model < mObjects.size(); ++model)
+	{
+		if (mObjects[model].mClass != "Model")
+		{
+			continue;
+		}
+
+		for (const Connection& curveNode : mChildren[model])
+		{
+			if (!activeCurveNodes[curveNode.mObject])
+			{
+				continue;
+			}
+
+			for (int channel = 0; channel < 3; ++channel)
+			{
+				if (curveNode.mProperty != kChannels[channel])
+				{
+					continue;
+				}
+
+				auto inserted = mModelAnimations.insert(std::make_pair(model, ModelAnimation()));
+				ModelAnimation& animation = inserted.first->second;
+				if (inserted.second)
+				{
+					memset(animation.mAnimated, 0, sizeof(animation.mAnimated));
+					memset(animation.mCurves, -1, sizeof(animation.mCurves));
+				}
+				animation.mAnimated[channel] = true;
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					animation.mValues[channel][axis] = GetPropertyNumber(curveNode.mObject, kAxes[axis], channel == 2 ? 1.0 : 0.0);
+				}
+
+				for (const Connection& curve : mChildren[curveNode.mObject])
+				{
+					for (int axis = 0; axis < 3; ++axis)
+					{
+						Curve currCurve;
+						if (curve.mProperty == kAxes[axis] && mObjects[curve.mObject].mClass == "AnimationCurve" && ReadCurve(mObjects[curve.mObject], currCurve))
+						{
+							animation.mCurves[channel][axis] = static_cast<int>(mCurves.size());
+							mCurves.push_back(currCurve);
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+// Key attributes are shared by runs of keys, KeyAttrRefCount holds
+// the length of every run
+bool BinaryFbxImporter::ReadCurve(const Object& inObject, Curve& outCurve)
+{
+	unsigned int times = mParser.FindChild(inObject.mNode, "KeyTime");
+	unsigned int values = mParser.FindChild(inObject.mNode, "KeyValueFloat");
+	if (!times || !values || !mParser.GetArray(times, 0, outCurve.mTimes) || !mParser.GetArray(values, 0, outCurve.mValues) ||
+		outCurve.mTimes.empty() || outCurve.mTimes.size() != outCurve.mValues.size())
+	{
+		return false;
+	}
+
+	std::vector<int> flags;
+	std::vector<double> data;
+	std::vector<int> referenceCounts;
+	unsigned int flagsNode = mParser.FindChild(inObject.mNode, "KeyAttrFlags");
+	unsigned int dataNode = mParser.FindChild(inObject.mNode, "KeyAttrDataFloat");
+	unsigned int referenceCountsNode = mParser.FindChild(inObject.mNode, "KeyAttrRefCount");
+	if (flagsNode)
+	{
+		mParser.GetArray(flagsNode, 0, flags);
+	}
+	if (dataNode)
+	{
+		mParser.GetArray(dataNode, 0, data);
+	}
+	if (referenceCountsNode)
+	{
+		mParser.GetArray(referenceCountsNode, 0, referenceCounts);
+	}
+
+	size_t keyCount = outCurve.mTimes.size();
+	// Keys without attributes are linear
+	outCurve.mFlags.assign(keyCount, 0);
+	outCurve.mRightSlopes.assign(keyCount, 0.0);
+	outCurve.mNextLeftSlopes.assign(keyCount, 0.0);
+	size_t key = 0;
+	for (size_t attribute = 0; attribute < flags.size() && attribute < referenceCounts.size() && key < keyCount; ++attribute)
+	{
+		for (int i = 0; i < referenceCounts[attribute] && key < keyCount; ++i, ++key)
+		{
+			outCurve.mFlags[key] = flags[attribute];
+			if (data.size() >= attribute * 4 + 2)
+			{
+				outCurve.mRightSlopes[key] = data[attribute * 4];
+				outCurve.mNextLeftSlopes[key] = data[attribute * 4 + 1];
+			}
+		}
+	}
+	return true;
+}
+
+unsigned int BinaryFbxImporter::FindProperty(unsigned int inObject, const char* inName) const
+{
+	const Object& object = mObjects[inObject];
+	const unsigned int lists[2] = { object.mProperties, object.mTemplate };
+	for (unsigned int list : lists)
+	{
+		for (unsigned int property = list ? mParser.GetFirstChild(list) : 0; property != 0; property = mParser.GetNextSibling(property))
+		{
+			if (mParser.GetString(property, 0) == inName)
+			{
+				return property;
+			}
+		}
+	}
+	return 0;
+}
+
+double BinaryFbxImporter::GetPropertyNumber(unsigned int inObject, const char* inName, double inDefault) const
+{
+	unsigned int property = FindProperty(inObject, inName);
+	// Name, type, label and flags come before the value
+	return property && mParser.GetPropertyCount(property) > 4 ? mParser.GetNumber(property, 4) : inDefault;
+}
+
+void BinaryFbxImporter::GetPropertyVector(unsigned int inObject, const char* inName, const double* inDefault, double* outVector) const
+{
+	unsigned int property = FindProperty(inObject, inName);
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		outVector[i] = property && mParser.GetPropertyCount(property) > 4 + i ? mParser.GetNumber(property, 4 + i) : inDefault[i];
+	}
+}
+
+std::string BinaryFbxImporter::GetChildString(unsigned int inObject, const char* inName) const
+{
+	unsigned int child = mParser.FindChild(mObjects[inObject].mNode, inName);
+	return child ? mParser.GetString(child, 0) : std::string();
+}
+
+// First object connected to inObject of that class (and subclass)
+unsigned int BinaryFbxImporter::FindConnected(unsigned int inObject, const char* inClass, const char* inSubclass) const
+{
+	for (const Connection& child : mChildren[inObject])
+	{
+		const Object& object = mObjects[child.mObject];
+		if (object.mClass == inClass && (!inSubclass || object.mSubclass == inSubclass))
+		{
+			return child.mObject;
+		}
+	}
+	return 0;
+}
+
+double BinaryFbxImporter::EvaluateCurve(const Curve& inCurve, long long inTime) const
+{
+	if (inTime <= inCurve.mTimes.front())
+	{
+		return inCurve.mValues.front();
+	}
+	if (inTime >= inCurve.mTimes.back())
+	{
+		return inCurve.mValues.back();
+	}
+
+	size_t key = std::upper_bound(inCurve.mTimes.begin(), inCurve.mTimes.end(), inTime) - inCurve.mTimes.begin() - 1;
+	int flags = inCurve.mFlags[key];
+	double value0 = inCurve.mValues[key];
+	double value1 = inCurve.mValues[key + 1];
+	if (flags & kInterpolationConstant)
+	{
+		return (flags & kConstantNext) ? value1 : value0;
+	}
+
+	double span = static_cast<double>(inCurve.mTimes[key + 1] - inCurve.mTimes[key]);
+	double t = (inTime - inCurve.mTimes[key]) / span;
+	if (flags & kInterpolationCubic)
+	{
+		// Hermite, the slopes are per second
+		double seconds = span / kTicksPerSecond;
+		double t2 = t * t;
+		double t3 = t2 * t;
+		return (2.0 * t3 - 3.0 * t2 + 1.0) * value0 + (t3 - 2.0 * t2 + t) * seconds * inCurve.mRightSlopes[key] +
+			(3.0 * t2 - 2.0 * t3) * value1 + (t3 - t2) * seconds * inCurve.mNextLeftSlopes[key];
+	}
+	return value0 + (value1 - value0) * t;
+}
+
+// T * Roff * Rp * Rpre * R * Rpost^-1 * Rp^-1 * Soff * Sp * S * Sp^-1
+void BinaryFbxImporter::EvaluateLocalTransform(unsigned int inModel, long long inTime, bool inAnimated, double* outMatrix) const
+{
+	double channels[3][3];
+	GetPropertyVector(inModel, "Lcl Translation", kZero, channels[0]);
+	GetPropertyVector(inModel, "Lcl Rotation", kZero, channels[1]);
+	GetPropertyVector(inModel, "Lcl Scaling", kOne, channels[2]);
+
+	auto animation = mModelAnimations.find(inModel);
+	if (inAnimated && animation != mModelAnimations.end())
+	{
+		for (int channel = 0; channel < 3; ++channel)
+		{
+			for (int axis = 0; axis < 3 && animation->second.mAnimated[channel]; ++axis)
+			{
+				int curve = animation->second.mCurves[channel][axis];
+				channels[channel][axis] = curve >= 0 ? EvaluateCurve(mCurves[curve], inTime) : animation->second.mValues[channel][axis];
+			}
+		}
+	}
+
+	double rotationOffset[3];
+	double rotationPivot[3];
+	double preRotation[3];
+	double postRotation[3];
+	double scalingOffset[3];
+	double scalingPivot[3];
+	GetPropertyVector(inModel, "RotationOffset", kZero, rotationOffset);
+	GetPropertyVector(inModel, "RotationPivot", kZero, rotationPivot);
+	GetPropertyVector(inModel, "PreRotation", kZero, preRotation);
+	GetPropertyVector(inModel, "PostRotation", kZero, postRotation);
+	GetPropertyVector(inModel, "ScalingOffset", kZero, scalingOffset);
+	GetPropertyVector(inModel, "ScalingPivot", kZero, scalingPivot);
+
+	// Rotation order and pre and post rotation only apply to active rotations
+	bool rotationActive = GetPropertyNumber(inModel, "RotationActive", 0.0) != 0.0;
+	int rotationOrder = rotationActive ? static_cast<int>(GetPropertyNumber(inModel, "RotationOrder", 0.0)) : 0;
+
+	SetIdentity(outMatrix);
+	AppendTranslation(outMatrix, channels[0], 1.0);
+	AppendTranslation(outMatrix, rotationOffset, 1.0);
+	AppendTranslation(outMatrix, rotationPivot, 1.0);
+	if (rotationActive)
+	{
+		AppendRotation(outMatrix, preRotation, 0, false);
+	}
+	AppendRotation(outMatrix, channels[1], rotationOrder, false);
+	if (rotationActive)
+	{
+		AppendRotation(outMatrix, postRotation, 0, true);
+	}
+	AppendTranslation(outMatrix, rotationPivot, -1.0);
+	AppendTranslation(outMatrix, scalingOffset, 1.0);
+	AppendTranslation(outMatrix, scalingPivot, 1.0);
+	AppendScaling(outMatrix, channels[2]);
+	AppendTranslation(outMatrix, scalingPivot, -1.0);
+}
+
+// Cached per model for the last point in time it was evaluated at, the
+// result stays valid until the model is evaluated at another time
+const double* BinaryFbxImporter::EvaluateGlobalTransform(unsigned int inModel, long long inTime, bool inAnimated)
+{
+	double* global = &mGlobalTransforms[inModel * 16];
+	long long key = inAnimated ? inTime : kStaticTime;
+	if (mGlobalValid[inModel] && mGlobalTimes[inModel] == key)
+	{
+		return global;
+	}
+
+	if (inModel == 0)
+	{
+		SetIdentity(global);
+	}
+	else
+	{
+		double local[16];
+		EvaluateLocalTransform(inModel, inTime, inAnimated, local);
+		Multiply(EvaluateGlobalTransform(mParentModels[inModel], inTime, inAnimated), local, global);
+	}
+	mGlobalTimes[inModel] = key;
+	mGlobalValid[inModel] = true;
+	return global;
+}
+
+void BinaryFbxImporter::GetGeometricTransform(unsigned int inModel, double* outMatrix) const
+{
+	double translation[3];
+	double rotation[3];
+	double scaling[3];
+	GetPropertyVector(inModel, "GeometricTranslation", kZero, translation);
+	GetPropertyVector(inModel, "GeometricRotation", kZero, rotation);
+	GetPropertyVector(inModel, "GeometricScaling", kOne, scaling);
+
+	SetIdentity(outMatrix);
+	AppendTranslation(outMatrix, translation, 1.0);
+	AppendRotation(outMatrix, rotation, 0, false);
+	AppendScaling(outMatrix, scaling);
+}
+
+// Same order and parent indices as FBXExporter::ProcessSkeletonHierarchyRecursively
+void BinaryFbxImporter::CollectJoints(unsigned int inModel, int inMyIndex, int inParentIndex)
+{
+	const std::string& type = mObjects[inModel].mSubclass;
+	if (type == "LimbNode" || type == "Limb" || type == "Root")
+	{
+		SnapshotJoint joint;
+		joint.mName = mObjects[inModel].mName;
+		joint.mParentIndex = inParentIndex;
+		SetIdentity(joint.mGlobalBindposeInverse);
+		mSnapshot->mJoints.push_back(joint);
+		mJointModels.push_back(inModel);
+	}
+
+	for (const Connection& child : mChildren[inModel])
+	{
+		if (mParentModels[child.mObject] == inModel && mObjects[child.mObject].mClass == "Model")
+		{
+			CollectJoints(child.mObject, static_cast<int>(mSnapshot->mJoints.size()), inMyIndex);
+		}
+	}
+}
+
+bool BinaryFbxImporter::ProcessGeometry(unsigned int inModel)
+{
+	unsigned int geometry = FindConnected(inModel, "Geometry", "Mesh");
+	if (geometry && !ProcessMesh(inModel, geometry))
+	{
+		return false;
+	}
+
+	for (const Connection& child : mChildren[inModel])
+	{
+		if (mParentModels[child.mObject] == inModel && mObjects[child.mObject].mClass == "Model" && !ProcessGeometry(child.mObject))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool BinaryFbxImporter::ProcessMesh(unsigned int inModel, unsigned int inGeometry)
+{
+	unsigned int geometryNode = mObjects[inGeometry].mNode;
+	std::vector<double> controlPoints;
+	std::vector<int> polygonVertices;
+	unsigned int verticesNode = mParser.FindChild(geometryNode, "Vertices");
+	unsigned int polygonsNode = mParser.FindChild(geometryNode, "PolygonVertexIndex");
+	if (!verticesNode || !polygonsNode || !mParser.GetArray(verticesNode, 0, controlPoints) || !mParser.GetArray(polygonsNode, 0, polygonVertices))
+	{
+		return Fail("Mesh without vertices or polygons");
+	}
+	unsigned int controlPointCount = static_cast<unsigned int>(controlPoints.size() / 3);
+
+	std::vector<std::vector<VertexBlendingInfo>> blending;
+	if (mSnapshot->mHasAnimation)
+	{
+		blending.resize(controlPointCount);
+		if (!ProcessSkin(inModel, inGeometry, blending))
+		{
+			return false;
+		}
+	}
+
+	std::vector<unsigned int> nodeMaterials;
+	if (mStages.mMaterials && !ProcessMaterials(inModel, nodeMaterials))
+	{
+		return false;
+	}
+	// Profiles without geometry only need the skin and the materials
+	if (!mStages.mMesh)
+	{
+		return true;
+	}
+
+	LayerElement normals;
+	std::vector<LayerElement> uvSets;
+	std::vector<LayerElement> colorSets;
+	bool hasNormals = false;
+	unsigned int materialsNode = 0;
+	for (unsigned int child = mParser.GetFirstChild(geometryNode); child != 0; child = mParser.GetNextSibling(child))
+	{
+		if (!hasNormals && mParser.IsNamed(child, "LayerElementNormal"))
+		{
+			if (!ReadLayerElement(mParser, child, "Normals", "NormalsIndex", 3, normals))
+			{
+				return Fail("Unsupported normal layer");
+			}
+			hasNormals = true;
+		}
+		else if (uvSets.size() < mUVSetCount && mParser.IsNamed(child, "LayerElementUV"))
+		{
+			uvSets.push_back(LayerElement());
+			if (!ReadLayerElement(mParser, child, "UV", "UVIndex", 2, uvSets.back()))
+			{
+				return Fail("Unsupported UV layer");
+			}
+		}
+		else if (colorSets.size() < mColorSetCount && mParser.IsNamed(child, "LayerElementColor"))
+		{
+			colorSets.push_back(LayerElement());
+			if (!ReadLayerElement(mParser, child, "Colors", "ColorIndex", 4, colorSets.back()))
+			{
+				return Fail("Unsupported vertex color layer");
+			}
+		}
+		else if (mStages.mMaterials && !materialsNode && mParser.IsNamed(child, "LayerElementMaterial"))
+		{
+			materialsNode = child;
+		}
+	}
+	if (!hasNormals)
+	{
+		return Fail("Invalid Normal Number");
+	}
+
+	SnapshotNode node;
+	node.mName = mObjects[inModel].mName;
+	double geometryTransform[16];
+	GetGeometricTransform(inModel, geometryTransform);
+	Multiply(EvaluateGlobalTransform(inModel, 0, false), geometryTransform, node.mGlobalTransform);
+	node.mFirstTriangle = static_cast<unsigned int>(mSnapshot->mMaterialIndices.size());
+	node.mFirstVertex = static_cast<unsigned int>(mSnapshot->mVertices.size());
+
+	// Per polygon materials, as FBXExporter::AssociateMaterialToMesh
+	int materialMapping = kAllSame;
+	std::vector<int> materials;
+	if (materialsNode)
+	{
+		unsigned int mapping = mParser.FindChild(materialsNode, "MappingInformationType");
+		unsigned int indices = mParser.FindChild(materialsNode, "Materials");
+		if (!mapping || !ReadMapping(mParser.GetString(mapping, 0), materialMapping) ||
+			(materialMapping != kAllSame && materialMapping != kByPolygon) || !indices || !mParser.GetArray(indices, 0, materials))
+		{
+			return Fail("Invalid mapping mode for material");
+		}
+	}
+
+	// A negative index ends a polygon (as its bitwise complement)
+	unsigned int polygon = 0;
+	size_t polygonCount = std::count_if(polygonVertices.begin(), polygonVertices.end(), [](int inIndex) { return inIndex < 0; });
+	for (size_t polygonBegin = 0; polygonBegin < polygonVertices.size(); ++polygon)
+	{
+		size_t polygonEnd = polygonBegin;
+		while (polygonEnd < polygonVertices.size() && polygonVertices[polygonEnd] >= 0)
+		{
+			++polygonEnd;
+		}
+		if (polygonEnd == polygonVertices.size())
+		{
+			return Fail("Unterminated polygon");
+		}
+		++polygonEnd;
+
+		unsigned int materialIndex = 0;
+		if (!materials.empty() && (materialMapping == kAllSame || materials.size() == polygonCount))
+		{
+			// -1 is a polygon without material, like FBXExporter::GetNodeMaterial
+			int localIndex = materials[materialMapping == kAllSame ? 0 : polygon];
+			if (localIndex >= 0 && static_cast<size_t>(localIndex) >= nodeMaterials.size())
+			{
+				return Fail("Invalid material index");
+			}
+			materialIndex = localIndex < 0 ? 0 : nodeMaterials[localIndex];
+		}
+
+		// Fan triangulation
+		for (size_t second = polygonBegin + 1; second + 1 < polygonEnd; ++second)
+		{
+			const size_t corners[3] = { polygonBegin, second, second + 1 };
+			for (size_t corner : corners)
+			{
+				int controlPoint = polygonVertices[corner];
+				if (controlPoint < 0)
+				{
+					controlPoint = ~controlPoint;
+				}
+				if (static_cast<unsigned int>(controlPoint) >= controlPointCount)
+				{
+					return Fail("Invalid control point index");
+				}
+
+				PNTIWVertex vertex;
+				vertex.mPosition.x = static_cast<float>(controlPoints[controlPoint * 3]);
+				vertex.mPosition.y = static_cast<float>(controlPoints[controlPoint * 3 + 1]);
+				vertex.mPosition.z = static_cast<float>(controlPoints[controlPoint * 3 + 2]);
+
+				unsigned int cornerIndex = static_cast<unsigned int>(corner);
+				const double* normal = normals.Get(controlPoint, cornerIndex, polygon);
+				vertex.mNormal.x = normal ? static_cast<float>(normal[0]) : 0.0f;
+				vertex.mNormal.y = normal ? static_cast<float>(normal[1]) : 0.0f;
+				vertex.mNormal.z = normal ? static_cast<float>(normal[2]) : 0.0f;
+				for (size_t k = 0; k < uvSets.size(); ++k)
+				{
+					const double* uv = uvSets[k].Get(controlPoint, cornerIndex, polygon);
+					if (uv)
+					{
+						vertex.mUV[k].x = static_cast<float>(uv[0]);
+						vertex.mUV[k].y = static_cast<float>(uv[1]);
+					}
+				}
+				for (size_t k = 0; k < colorSets.size(); ++k)
+				{
+					const double* color = colorSets[k].Get(controlPoint, cornerIndex, polygon);
+					if (color)
+					{
+						vertex.mColor[k].x = static_cast<float>(color[0]);
+						vertex.mColor[k].y = static_cast<float>(color[1]);
+						vertex.mColor[k].z = static_cast<float>(color[2]);
+						vertex.mColor[k].w = static_cast<float>(color[3]);
+					}
+				}
+				if (!blending.empty())
+				{
+					vertex.mVertexBlendingInfos = blending[controlPoint];
+					vertex.SortBlendingInfoByWeight();
+				}
+
+				mSnapshot->mIndices.push_back(static_cast<unsigned int>(mSnapshot->mVertices.size()));
+				mSnapshot->mVertices.push_back(vertex);
+			}
+			mSnapshot->mMaterialIndices.push_back(materialIndex);
+		}
+		polygonBegin = polygonEnd;
+	}
+
+	node.mTriangleCount = static_cast<unsigned int>(mSnapshot->mMaterialIndices.size()) - node.mFirstTriangle;
+	node.mVertexCount = node.mTriangleCount * 3;
+	mSnapshot->mNodes.push_back(node);
+	return true;
+}
+
+bool BinaryFbxImporter::ProcessSkin(unsigned int inModel, unsigned int inGeometry, std::vector<std::vector<VertexBlendingInfo>>& outBlending)
+{
+	double geometryTransform[16];
+	GetGeometricTransform(inModel, geometryTransform);
+
+	std::vector<int> indices;
+	std::vector<double> weights;
+	std::vector<double> transform;
+	std::vector<double> transformLink;
+	for (const Connection& skin : mChildren[inGeometry])
+	{
+		if (mObjects[skin.mObject].mClass != "Deformer" || mObjects[skin.mObject].mSubclass != "Skin")
+		{
+			continue;
+		}
+
+		for (const Connection& cluster : mChildren[skin.mObject])
+		{
+			const Object& clusterObject = mObjects[cluster.mObject];
+			if (clusterObject.mClass != "Deformer" || clusterObject.mSubclass != "Cluster")
+			{
+				continue;
+			}
+
+			unsigned int link = FindConnected(cluster.mObject, "Model", nullptr);
+			if (!link)
+			{
+				return Fail("Cluster without a joint");
+			}
+			auto joint = std::find(mJointModels.begin(), mJointModels.end(), link);
+			if (joint == mJointModels.end())
+			{
+				return Fail("Skeleton information in FBX file is corrupted.");
+			}
+			unsigned int jointIndex = static_cast<unsigned int>(joint - mJointModels.begin());
+
+			unsigned int transformNode = mParser.FindChild(clusterObject.mNode, "Transform");
+			unsigned int transformLinkNode = mParser.FindChild(clusterObject.mNode, "TransformLink");
+			if (!transformNode || !transformLinkNode || !mParser.GetArray(transformNode, 0, transform) || !mParser.GetArray(transformLinkNode, 0, transformLink) ||
+				transform.size() != 16 || transformLink.size() != 16)
+			{
+				return Fail("Cluster without bind pose");
+			}
+
+			// Same as FBXExporter::ProcessJointsAndAnimations, the first
+			// mesh bound to the joint gives its bind pose and keyframes.
+			// Files older than FBX 2012 store Transform already relative
+			// to the link, the SDK multiplies it back by TransformLink on
+			// import
+			SnapshotJoint& currJoint = mSnapshot->mJoints[jointIndex];
+			const bool firstBinding = !mJointBound[jointIndex];
+			if (firstBinding)
+			{
+				if (mParser.GetVersion() < 7200)
+				{
+					memcpy(currJoint.mGlobalBindposeInverse, transform.data(), sizeof(currJoint.mGlobalBindposeInverse));
+				}
+				else
+				{
+					double inverseLink[16];
+					AffineInverse(transformLink.data(), inverseLink);
+					Multiply(inverseLink, transform.data(), currJoint.mGlobalBindposeInverse);
+				}
+				Append(currJoint.mGlobalBindposeInverse, geometryTransform);
+			}
+
+			unsigned int indicesNode = mParser.FindChild(clusterObject.mNode, "Indexes");
+			unsigned int weightsNode = mParser.FindChild(clusterObject.mNode, "Weights");
+			indices.clear();
+			weights.clear();
+			if (indicesNode && weightsNode && (!mParser.GetArray(indicesNode, 0, indices) || !mParser.GetArray(weightsNode, 0, weights) || indices.size() != weights.size()))
+			{
+				return Fail("Cluster with invalid weights");
+			}
+			for (size_t i = 0; i < indices.size(); ++i)
+			{
+				if (indices[i] < 0 || static_cast<size_t>(indices[i]) >= outBlending.size())
+				{
+					return Fail("Invalid control point index");
+				}
+				VertexBlendingInfo currBlendingInfo;
+				currBlendingInfo.mBlendingIndex = jointIndex;
+				currBlendingInfo.mBlendingWeight = weights[i];
+				outBlending[indices[i]].push_back(currBlendingInfo);
+			}
+
+			if (firstBinding)
+			{
+				SampleAnimation(inModel, link, geometryTransform, currJoint);
+				mJointBound[jointIndex] = true;
+			}
+		}
+	}
+
+	// Like FBXExporter::ProcessJointsAndAnimations, all influences are
+	// kept for SkinWeights
+	return true;
+}
+
+bool BinaryFbxImporter::ProcessMaterials(unsigned int inModel, std::vector<unsigned int>& outNodeMaterials)
+{
+	for (const Connection& connection : mChildren[inModel])
+	{
+		const Object& object = mObjects[connection.mObject];
+		if (object.mClass != "Material")
+		{
+			continue;
+		}
+
+		// Materials shared between nodes are only processed once
+		auto found = mMaterialIndices.find(object.mId);
+		if (found != mMaterialIndices.end())
+		{
+			outNodeMaterials.push_back(found->second);
+			continue;
+		}
+		unsigned int materialIndex = static_cast<unsigned int>(mSnapshot->mMaterials.size());
+		mMaterialIndices[object.mId] = materialIndex;
+		outNodeMaterials.push_back(materialIndex);
+
+		SnapshotMaterial material = SnapshotMaterial();
+		material.mName = object.mName;
+		material.mPhong = ToLower(GetChildString(connection.mObject, "ShadingModel")) == "phong";
+
+		double color[3];
+		GetPropertyVector(connection.mObject, "AmbientColor", kDefaultAmbient, color);
+		material.mAmbient = XMFLOAT3(static_cast<float>(color[0]), static_cast<float>(color[1]), static_cast<float>(color[2]));
+		GetPropertyVector(connection.mObject, "DiffuseColor", kDefaultDiffuse, color);
+		material.mDiffuse = XMFLOAT3(static_cast<float>(color[0]), static_cast<float>(color[1]), static_cast<float>(color[2]));
+		GetPropertyVector(connection.mObject, "EmissiveColor", kZero, color);
+		material.mEmissive = XMFLOAT3(static_cast<float>(color[0]), static_cast<float>(color[1]), static_cast<float>(color[2]));
+		material.mTransparencyFactor = GetPropertyNumber(connection.mObject, "TransparencyFactor", 0.0);
+		if (material.mPhong)
+		{
+			GetPropertyVector(connection.mObject, "SpecularColor", kDefaultSpecular, color);
+			material.mSpecular = XMFLOAT3(static_cast<float>(color[0]), static_cast<float>(color[1]), static_cast<float>(color[2]));
+			GetPropertyVector(connection.mObject, "ReflectionColor", kZero, color);
+			material.mReflection = XMFLOAT3(static_cast<float>(color[0]), static_cast<float>(color[1]), static_cast<float>(color[2]));
+			material.mShininess = GetPropertyNumber(connection.mObject, "ShininessExponent", 20.0);
+			material.mSpecularPower = GetPropertyNumber(connection.mObject, "SpecularFactor", 1.0);
+			material.mReflectionFactor = GetPropertyNumber(connection.mObject, "ReflectionFactor", 1.0);
+		}
+
+		// Same channels as FBXExporter::ProcessMaterialTexture
+		for (const Connection& texture : mChildren[connection.mObject])
+		{
+			const Object& textureObject = mObjects[texture.mObject];
+			if (textureObject.mClass == "LayeredTexture")
+			{
+				return Fail("Layered Texture is currently unsupported");
+			}
+			if (textureObject.mClass != "Texture")
+			{
+				continue;
+			}
+
+			std::string fileName = GetChildString(texture.mObject, "FileName");
+			if (texture.mProperty == "DiffuseColor")
+			{
+				material.mDiffuseMapName = fileName;
+			}
+			else if (texture.mProperty == "SpecularColor")
+			{
+				material.mSpecularMapName = fileName;
+			}
+			else if (texture.mProperty == "Bump")
+			{
+				material.mNormalMapName = fileName;
+			}
+		}
+		mSnapshot->mMaterials.push_back(material);
+	}
+	return true;
+}
+
+// Keyframes of the first stack at 24 frames per second, relative to
+// the skinned mesh like FBXExporter::ProcessJointsAndAnimations
+void BinaryFbxImporter::SampleAnimation(unsigned int inModel, unsigned int inJointModel, const double* inGeometryTransform, SnapshotJoint& ioJoint)
+{
+	if (mAnimationStack == 0)
+	{
+		return;
+	}
+
+	long long startFrame = mAnimationStart / kTicksPerFrame;
+	long long endFrame = mAnimationStop / kTicksPerFrame;
+	mSnapshot->mAnimationName = mObjects[mAnimationStack].mName;
+	mSnapshot->mAnimationLength = endFrame - startFrame + 1;
+
+	for (long long frame = startFrame; frame <= endFrame; ++frame)
+	{
+		long long time = frame * kTicksPerFrame;
+		double meshTransform[16];
+		Multiply(EvaluateGlobalTransform(inModel, time, true), inGeometryTransform, meshTransform);
+		AffineInverse(meshTransform, meshTransform);
+
+		SnapshotKeyframe keyframe;
+		keyframe.mFrameNum = frame;
+		Multiply(meshTransform, EvaluateGlobalTransform(inJointModel, time, true), keyframe.mGlobalTransform);
+		ioJoint.mAnimation.push_back(keyframe);
+	}
+}
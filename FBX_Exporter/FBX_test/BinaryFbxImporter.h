@@ -0,0 +1,126 @@
+#pragma once
+#include "BinaryFbxParser.h"
+#include "SceneSnapshot.h"
+#include "ImportProfile.h"
+#include <unordered_map>
+
+// Extracts a binary FBX file into a SceneSnapshot without the FBX SDK,
+// the same data FBXExporter extracts from an imported FbxScene:
+// - mesh nodes with their global and geometric transforms, polygons
+//   fan triangulated, normals, UV sets and color sets per corner
+// - the skeleton, skin clusters and bind poses, and the animation of
+//   the first stack sampled at 24 frames per second
+// - Lambert and Phong materials with their diffuse, specular and bump
+//   map file names
+//
+// Node transforms follow the FBX transform chain (pivots, offsets,
+// pre and post rotation, rotation order). Cubic keys are interpolated
+// with their slopes, tangent weights are ignored
+class BinaryFbxImporter
+{
+public:
+	BinaryFbxImporter();
+
+	// Vertices get at most inUVSetCount UV and inColorSetCount color sets,
+	// only inStages are extracted. inThreads inflate the compressed
+	// arrays. False if the file is not a binary FBX file or uses something
+	// this importer cannot read
+	bool Import(const std::string& inPath, unsigned int inUVSetCount, unsigned int inColorSetCount, const ImportStages& inStages, unsigned int inThreads, SceneSnapshot& outSnapshot);
+
+	// Why the last Import failed
+	const std::string& GetError() const;
+
+private:
+	struct Object
+	{
+		long long mId;
+		unsigned int mNode;
+		std::string mName;
+		std::string mClass;
+		std::string mSubclass;
+		// Properties70 of the object and of its class template, 0 if none
+		unsigned int mProperties;
+		unsigned int mTemplate;
+	};
+
+	// Object index and, for object to property connections, the property
+	struct Connection
+	{
+		unsigned int mObject;
+		std::string mProperty;
+	};
+
+	struct Curve
+	{
+		std::vector<long long> mTimes;
+		std::vector<double> mValues;
+		std::vector<int> mFlags;
+		std::vector<double> mRightSlopes;
+		std::vector<double> mNextLeftSlopes;
+	};
+
+	// Lcl Translation, Lcl Rotation and Lcl Scaling of a model
+	struct ModelAnimation
+	{
+		bool mAnimated[3];
+		double mValues[3][3];
+		int mCurves[3][3];
+	};
+
+	BinaryFbxImporter(const BinaryFbxImporter&);
+	BinaryFbxImporter& operator=(const BinaryFbxImporter&);
+
+	bool Fail(const char* inError);
+
+	void ReadObjects();
+	void ReadConnections();
+	void ReadAnimation();
+	bool ReadCurve(const Object& inObject, Curve& outCurve);
+
+	unsigned int FindProperty(unsigned int inObject, const char* inName) const;
+	double GetPropertyNumber(unsigned int inObject, const char* inName, double inDefault) const;
+	void GetPropertyVector(unsigned int inObject, const char* inName, const double* inDefault, double* outVector) const;
+	std::string GetChildString(unsigned int inObject, const char* inName) const;
+	unsigned int FindConnected(unsigned int inObject, const char* inClass, const char* inSubclass) const;
+
+	double EvaluateCurve(const Curve& inCurve, long long inTime) const;
+	void EvaluateLocalTransform(unsigned int inModel, long long inTime, bool inAnimated, double* outMatrix) const;
+	const double* EvaluateGlobalTransform(unsigned int inModel, long long inTime, bool inAnimated);
+	void GetGeometricTransform(unsigned int inModel, double* outMatrix) const;
+
+	void CollectJoints(unsigned int inModel, int inMyIndex, int inParentIndex);
+	bool ProcessGeometry(unsigned int inModel);
+	bool ProcessMesh(unsigned int inModel, unsigned int inGeometry);
+	bool ProcessSkin(unsigned int inModel, unsigned int inGeometry, std::vector<std::vector<VertexBlendingInfo>>& outBlending);
+	bool ProcessMaterials(unsigned int inModel, std::vector<unsigned int>& outNodeMaterials);
+	void SampleAnimation(unsigned int inModel, unsigned int inJointModel, const double* inGeometryTransform, SnapshotJoint& ioJoint);
+
+	BinaryFbxParser mParser;
+	std::string mError;
+	unsigned int mUVSetCount;
+	unsigned int mColorSetCount;
+	ImportStages mStages;
+	SceneSnapshot* mSnapshot;
+
+	// Object 0 is the scene root (id 0)
+	std::vector<Object> mObjects;
+	std::unordered_map<long long, unsigned int> mObjectIndices;
+	std::vector<std::vector<Connection>> mChildren;
+	std::vector<unsigned int> mParentModels;
+	std::unordered_map<long long, unsigned int> mMaterialIndices;
+
+	std::vector<Curve> mCurves;
+	std::unordered_map<unsigned int, ModelAnimation> mModelAnimations;
+	unsigned int mAnimationStack;
+	long long mAnimationStart;
+	long long mAnimationStop;
+
+	// Global transforms of one point in time, see EvaluateGlobalTransform
+	std::vector<double> mGlobalTransforms;
+	std::vector<long long> mGlobalTimes;
+	std::vector<bool> mGlobalValid;
+
+	// Model of every joint and whether a mesh already bound it
+	std::vector<unsigned int> mJointModels;
+	std::vector<bool> mJointBound;
+};
@@ -0,0 +1,500 @@
+#include "BinaryFbxParser.h"
+#include "Inflater.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+namespace
+{
+	const char kMagic[] = "Kaydara FBX Binary  ";
+	// Magic, its terminating zero, 0x1A 0x00 and the version
+	const size_t kHeaderSize = 27;
+	// Records get 64 bit offsets from FBX 7.5 on
+	const unsigned int kLongRecordVersion = 7500;
+	const unsigned int kMaxDepth = 64;
+
+	template<typename T>
+	T ReadValue(const char* inData)
+	{
+		T value;
+		memcpy(&value, inData, sizeof(T));
+		return value;
+	}
+
+	// Bytes per element of an array property, 0 if not an array
+	unsigned int GetElementSize(char inType)
+	{
+		switch (inType)
+		{
+		case 'b':
+			return 1;
+		case 'i':
+		case 'f':
+			return 4;
+		case 'l':
+		case 'd':
+			return 8;
+		default:
+			return 0;
+		}
+	}
+
+	// Stored as S, returned as T
+	template<typename S, typename T>
+	void ConvertElements(const char* inData, unsigned int inCount, T* outValues)
+	{
+		if (std::is_same<S, T>::value)
+		{
+			memcpy(outValues, inData, inCount * sizeof(T));
+			return;
+		}
+		for (unsigned int i = 0; i < inCount; ++i)
+		{
+			outValues[i] = static_cast<T>(ReadValue<S>(inData + i * sizeof(S)));
+		}
+	}
+}
+
+BinaryFbxParser::BinaryFbxParser() :
+	mVersion(0)
+{
+}
+
+bool BinaryFbxParser::Parse(const std::string& inPath, unsigned int inThreads)
+{
+	Clear();
+	if (!mFile.Open(inPath))
+	{
+		return false;
+	}
+
+	const char* data = mFile.GetData();
+	size_t size = mFile.GetSize();
+	if (size < kHeaderSize || memcmp(data, kMagic, sizeof(kMagic)) != 0)
+	{
+		Clear();
+		return false;
+	}
+	mVersion = ReadValue<unsigned int>(data + 23);
+
+	Node root;
+	memset(&root, 0, sizeof(root));
+	root.mName = data;
+	mNodes.push_back(root);
+
+	size_t offset = kHeaderSize;
+	if (!ParseRecords(offset, size, 0, 0) || !InflateArrays(inThreads))
+	{
+		Clear();
+		return false;
+	}
+
+	return true;
+}
+
+void BinaryFbxParser::Clear()
+{
+	mVersion = 0;
+	mNodes.clear();
+	mProperties.clear();
+	mCompressedArrays.clear();
+	mInflated.clear();
+	mFile.Close();
+}
+
+unsigned int BinaryFbxParser::GetVersion() const
+{
+	return mVersion;
+}
+
+// A record is its end offset, property count, property list size and
+// name length followed by the name, the properties and its children,
+// which end with a record of zeros. Top level records end the same way
+bool BinaryFbxParser::ParseRecords(size_t& ioOffset, size_t inEnd, unsigned int inParent, unsigned int inDepth)
+{
+	if (inDepth > kMaxDepth)
+	{
+		return false;
+	}
+
+	const char* data = mFile.GetData();
+	bool longRecords = mVersion >= kLongRecordVersion;
+	size_t recordHeaderSize = longRecords ? 25 : 13;
+	unsigned int lastChild = 0;
+
+	while (ioOffset < inEnd)
+	{
+		if (inEnd - ioOffset < recordHeaderSize)
+		{
+			return false;
+		}
+
+		const char* header = data + ioOffset;
+		unsigned long long endOffset;
+		unsigned long long propertyCount;
+		unsigned long long propertyListSize;
+		if (longRecords)
+		{
+			endOffset = ReadValue<unsigned long long>(header);
+			propertyCount = ReadValue<unsigned long long>(header + 8);
+			propertyListSize = ReadValue<unsigned long long>(header + 16);
+		}
+		else
+		{
+			endOffset = ReadValue<unsigned int>(header);
+			propertyCount = ReadValue<unsigned int>(header + 4);
+			propertyListSize = ReadValue<unsigned int>(header + 8);
+		}
+		unsigned int nameLength = static_cast<unsigned char>(header[recordHeaderSize - 1]);
+		ioOffset += recordHeaderSize;
+
+		if (endOffset == 0)
+		{
+			return true;
+		}
+
+		size_t propertiesBegin = ioOffset + nameLength;
+		if (endOffset > inEnd || propertiesBegin > endOffset || propertyListSize > endOffset - propertiesBegin)
+		{
+			return false;
+		}
+
+		unsigned int nodeIndex = static_cast<unsigned int>(mNodes.size());
+		Node node;
+		node.mName = data + ioOffset;
+		node.mNameLength = nameLength;
+		node.mFirstProperty = static_cast<unsigned int>(mProperties.size());
+		node.mPropertyCount = static_cast<unsigned int>(propertyCount);
+		node.mFirstChild = 0;
+		node.mNextSibling = 0;
+		mNodes.push_back(node);
+		if (lastChild == 0)
+		{
+			mNodes[inParent].mFirstChild = nodeIndex;
+		}
+		else
+		{
+			mNodes[lastChild].mNextSibling = nodeIndex;
+		}
+		lastChild = nodeIndex;
+
+		ioOffset = propertiesBegin;
+		size_t propertiesEnd = propertiesBegin + static_cast<size_t>(propertyListSize);
+		for (unsigned long long i = 0; i < propertyCount; ++i)
+		{
+			if (!ParseProperty(ioOffset, propertiesEnd))
+			{
+				return false;
+			}
+		}
+		ioOffset = propertiesEnd;
+
+		if (ioOffset < endOffset && !ParseRecords(ioOffset, static_cast<size_t>(endOffset), nodeIndex, inDepth + 1))
+		{
+			return false;
+		}
+		ioOffset = static_cast<size_t>(endOffset);
+	}
+
+	// Some writers leave out the terminating record
+	return true;
+}
+
+bool BinaryFbxParser::ParseProperty(size_t& ioOffset, size_t inEnd)
+{
+	const char* data = mFile.GetData();
+	if (ioOffset >= inEnd)
+	{
+		return false;
+	}
+
+	Property property;
+	property.mType = data[ioOffset++];
+	property.mData = data + ioOffset;
+	property.mCount = 1;
+	property.mCompressedSize = 0;
+	property.mInflatedOffset = 0;
+
+	size_t size;
+	switch (property.mType)
+	{
+	case 'C':
+		size = 1;
+		break;
+	case 'Y':
+		size = 2;
+		break;
+	case 'I':
+	case 'F':
+		size = 4;
+		break;
+	case 'L':
+	case 'D':
+		size = 8;
+		break;
+	case 'S':
+	case 'R':
+		if (inEnd - ioOffset < 4)
+		{
+			return false;
+		}
+		property.mCount = ReadValue<unsigned int>(data + ioOffset);
+		ioOffset += 4;
+		property.mData = data + ioOffset;
+		size = property.mCount;
+		break;
+	case 'b':
+	case 'i':
+	case 'f':
+	case 'l':
+	case 'd':
+	{
+		if (inEnd - ioOffset < 12)
+		{
+			return false;
+		}
+		property.mCount = ReadValue<unsigned int>(data + ioOffset);
+		unsigned int encoding = ReadValue<unsigned int>(data + ioOffset + 4);
+		size = ReadValue<unsigned int>(data + ioOffset + 8);
+		ioOffset += 12;
+		property.mData = data + ioOffset;
+
+		// 64 bit, so no count wraps it. Inflater takes 32 bit sizes
+		unsigned long long rawSize = static_cast<unsigned long long>(property.mCount) * GetElementSize(property.mType);
+		if (rawSize > 0xffffffffULL)
+		{
+			return false;
+		}
+		if (encoding == 0)
+		{
+			if (size != rawSize)
+			{
+				return false;
+			}
+		}
+		else if (encoding == 1)
+		{
+			// Inflated arrays start 8 byte aligned
+			property.mCompressedSize = static_cast<unsigned int>(size);
+			property.mInflatedOffset = (mInflated.size() + 7) & ~static_cast<size_t>(7);
+			mInflated.resize(property.mInflatedOffset + static_cast<size_t>(rawSize));
+			mCompressedArrays.push_back(static_cast<unsigned int>(mProperties.size()));
+		}
+		else
+		{
+			return false;
+		}
+	}
+	break;
+	default:
+		return false;
+	}
+
+	if (inEnd - ioOffset < size)
+	{
+		return false;
+	}
+	ioOffset += size;
+	mProperties.push_back(property);
+	return true;
+}
+
+// Largest arrays first, so no thread is left with a big one at the end
+bool BinaryFbxParser::InflateArrays(unsigned int inThreads)
+{
+	std::sort(mCompressedArrays.begin(), mCompressedArrays.end(), [this](unsigned int inLeft, unsigned int inRight)
+	{
+		return mProperties[inLeft].mCompressedSize > mProperties[inRight].mCompressedSize;
+	});
+
+	std::atomic<unsigned int> nextArray(0);
+	std::atomic<bool> succeeded(true);
+	auto inflate = [&]()
+	{
+		for (unsigned int i = nextArray++; i < mCompressedArrays.size() && succeeded; i = nextArray++)
+		{
+			const Property& property = mProperties[mCompressedArrays[i]];
+			// ParseProperty made sure this fits in 32 bits
+			size_t rawSize = static_cast<size_t>(property.mCount) * GetElementSize(property.mType);
+			if (!Inflater::Decompress(property.mData, property.mCompressedSize, mInflated.data() + property.mInflatedOffset, static_cast<unsigned int>(rawSize)))
+			{
+				succeeded = false;
+			}
+		}
+	};
+
+	unsigned int threadCount = std::min(std::max(inThreads, 1u), static_cast<unsigned int>(mCompressedArrays.size()));
+	std::vector<std::thread> threads;
+	for (unsigned int i = 1; i < threadCount; ++i)
+	{
+		threads.push_back(std::thread(inflate));
+	}
+	inflate();
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	return succeeded;
+}
+
+unsigned int BinaryFbxParser::GetFirstChild(unsigned int inNode) const
+{
+	return mNodes[inNode].mFirstChild;
+}
+
+unsigned int BinaryFbxParser::GetNextSibling(unsigned int inNode) const
+{
+	return mNodes[inNode].mNextSibling;
+}
+
+unsigned int BinaryFbxParser::FindChild(unsigned int inNode, const char* inName) const
+{
+	for (unsigned int child = mNodes[inNode].mFirstChild; child != 0; child = mNodes[child].mNextSibling)
+	{
+		if (IsNamed(child, inName))
+		{
+			return child;
+		}
+	}
+	return 0;
+}
+
+bool BinaryFbxParser::IsNamed(unsigned int inNode, const char* inName) const
+{
+	const Node& node = mNodes[inNode];
+	return strlen(inName) == node.mNameLength && memcmp(node.mName, inName, node.mNameLength) == 0;
+}
+
+unsigned int BinaryFbxParser::GetPropertyCount(unsigned int inNode) const
+{
+	return mNodes[inNode].mPropertyCount;
+}
+
+const BinaryFbxParser::Property* BinaryFbxParser::GetProperty(unsigned int inNode, unsigned int inProperty) const
+{
+	const Node& node = mNodes[inNode];
+	return inProperty < node.mPropertyCount ? &mProperties[node.mFirstProperty + inProperty] : nullptr;
+}
+
+char BinaryFbxParser::GetPropertyType(unsigned int inNode, unsigned int inProperty) const
+{
+	const Property* property = GetProperty(inNode, inProperty);
+	return property ? property->mType : 0;
+}
+
+long long BinaryFbxParser::GetInteger(unsigned int inNode, unsigned int inProperty) const
+{
+	const Property* property = GetProperty(inNode, inProperty);
+	if (!property)
+	{
+		return 0;
+	}
+
+	switch (property->mType)
+	{
+	case 'C':
+		return *property->mData != 0;
+	case 'Y':
+		return ReadValue<short>(property->mData);
+	case 'I':
+		return ReadValue<int>(property->mData);
+	case 'L':
+		return ReadValue<long long>(property->mData);
+	case 'F':
+		return static_cast<long long>(ReadValue<float>(property->mData));
+	case 'D':
+		return static_cast<long long>(ReadValue<double>(property->mData));
+	default:
+		return 0;
+	}
+}
+
+double BinaryFbxParser::GetNumber(unsigned int inNode, unsigned int inProperty) const
+{
+	const Property* property = GetProperty(inNode, inProperty);
+	if (!property)
+	{
+		return 0.0;
+	}
+
+	switch (property->mType)
+	{
+	case 'F':
+		return ReadValue<float>(property->mData);
+	case 'D':
+		return ReadValue<double>(property->mData);
+	default:
+		return static_cast<double>(GetInteger(inNode, inProperty));
+	}
+}
+
+std::string BinaryFbxParser::GetString(unsigned int inNode, unsigned int inProperty) const
+{
+	const Property* property = GetProperty(inNode, inProperty);
+	if (!property || (property->mType != 'S' && property->mType != 'R'))
+	{
+		return std::string();
+	}
+	return std::string(property->mData, property->mCount);
+}
+
+const char* BinaryFbxParser::GetArrayData(const Property& inProperty) const
+{
+	return inProperty.mCompressedSize > 0 ? mInflated.data() + inProperty.mInflatedOffset : inProperty.mData;
+}
+
+template<typename T>
+bool BinaryFbxParser::ConvertArray(unsigned int inNode, unsigned int inProperty, std::vector<T>& outValues) const
+{
+	const Property* property = GetProperty(inNode, inProperty);
+	unsigned int elementSize = property ? GetElementSize(property->mType) : 0;
+	if (elementSize == 0)
+	{
+		return false;
+	}
+
+	const char* data = GetArrayData(*property);
+	outValues.resize(property->mCount);
+	if (outValues.empty())
+	{
+		return true;
+	}
+
+	switch (property->mType)
+	{
+	case 'b':
+		ConvertElements<unsigned char>(data, property->mCount, outValues.data());
+		break;
+	case 'i':
+		ConvertElements<int>(data, property->mCount, outValues.data());
+		break;
+	case 'f':
+		ConvertElements<float>(data, property->mCount, outValues.data());
+		break;
+	case 'l':
+		ConvertElements<long long>(data, property->mCount, outValues.data());
+		break;
+	default:
+		ConvertElements<double>(data, property->mCount, outValues.data());
+		break;
+	}
+	return true;
+}
+
+bool BinaryFbxParser::GetArray(unsigned int inNode, unsigned int inProperty, std::vector<double>& outValues) const
+{
+	return ConvertArray(inNode, inProperty, outValues);
+}
+
+bool BinaryFbxParser::GetArray(unsigned int inNode, unsigned int inProperty, std::vector<int>& outValues) const
+{
+	return ConvertArray(inNode, inProperty, outValues);
+}
+
+bool BinaryFbxParser::GetArray(unsigned int inNode, unsigned int inProperty, std::vector<long long>& outValues) const
+{
+	return ConvertArray(inNode, inProperty, outValues);
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include "MappedFile.h"
+#include <string>
+#include <vector>
+
+// Reader for the binary FBX container, independent of the FBX SDK
+//
+// The file is memory mapped and its node records are walked once into
+// flat arrays. Names, strings and uncompressed arrays point into the
+// mapping; the zlib compressed arrays (vertices, indices, normals, UVs,
+// weights, keys, ...) are inflated on several threads into one buffer
+// Node 0 is a root holding the top level records, and 0 also stands
+// for "no node" in the navigation functions
+class BinaryFbxParser
+{
+public:
+	BinaryFbxParser();
+
+	// False if the file is not a binary FBX file or is corrupt
+	bool Parse(const std::string& inPath, unsigned int inThreads);
+	void Clear();
+
+	// 7400 for FBX 7.4 etc
+	unsigned int GetVersion() const;
+
+	unsigned int GetFirstChild(unsigned int inNode) const;
+	unsigned int GetNextSibling(unsigned int inNode) const;
+	// First child with that name
+	unsigned int FindChild(unsigned int inNode, const char* inName) const;
+	bool IsNamed(unsigned int inNode, const char* inName) const;
+
+	unsigned int GetPropertyCount(unsigned int inNode) const;
+	char GetPropertyType(unsigned int inNode, unsigned int inProperty) const;
+	// Numeric properties convert to either type, anything else is 0
+	long long GetInteger(unsigned int inNode, unsigned int inProperty) const;
+	double GetNumber(unsigned int inNode, unsigned int inProperty) const;
+	// Raw bytes of a string property, object names keep their
+	// "\x00\x01Class" suffix
+	std::string GetString(unsigned int inNode, unsigned int inProperty) const;
+
+	// Array properties of any element type, converted. False if the
+	// property is not an array
+	bool GetArray(unsigned int inNode, unsigned int inProperty, std::vector<double>& outValues) const;
+	bool GetArray(unsigned int inNode, unsigned int inProperty, std::vector<int>& outValues) const;
+	bool GetArray(unsigned int inNode, unsigned int inProperty, std::vector<long long>& outValues) const;
+
+private:
+	struct Node
+	{
+		const char* mName;
+		unsigned int mNameLength;
+		unsigned int mFirstProperty;
+		unsigned int mPropertyCount;
+		unsigned int mFirstChild;
+		unsigned int mNextSibling;
+	};
+
+	struct Property
+	{
+		char mType;
+		// Into the mapping, not aligned
+		const char* mData;
+		// Elements of an array, bytes of a string or raw property
+		unsigned int mCount;
+		// Of the zlib stream, 0 for uncompressed arrays
+		unsigned int mCompressedSize;
+		// Of the inflated array in mInflated
+		size_t mInflatedOffset;
+	};
+
+	BinaryFbxParser(const BinaryFbxParser&);
+	BinaryFbxParser& operator=(const BinaryFbxParser&);
+
+	bool ParseRecords(size_t& ioOffset, size_t inEnd, unsigned int inParent, unsigned int inDepth);
+	bool ParseProperty(size_t& ioOffset, size_t inEnd);
+	bool InflateArrays(unsigned int inThreads);
+	const Property* GetProperty(unsigned int inNode, unsigned int inProperty) const;
+	const char* GetArrayData(const Property& inProperty) const;
+
+	template<typename T>
+	bool ConvertArray(unsigned int inNode, unsigned int inProperty, std::vector<T>& outValues) const;
+
+	MappedFile mFile;
+	unsigned int mVersion;
+	std::vector<Node> mNodes;
+	std::vector<Property> mProperties;
+	// Indices of the compressed array properties
+	std::vector<unsigned int> mCompressedArrays;
+	std::vector<char> mInflated;
+};
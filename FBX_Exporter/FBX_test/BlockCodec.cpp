@@ -0,0 +1,248 @@
+#include "BlockCodec.h"
+#include <cstring>
+
+namespace
+{
+	const unsigned int kHashBits = 12;
+	const unsigned int kMinMatch = 4;
+	// LZ4: the last match starts at least 12 bytes before the end of
+	// the block and the last 5 bytes are literals
+	const unsigned int kMatchStartLimit = 12;
+	const unsigned int kLastLiterals = 5;
+	const unsigned int kMaxOffset = 65535;
+
+	unsigned int Read32(const unsigned char* inData)
+	{
+		unsigned int value;
+		memcpy(&value, inData, sizeof(value));
+		return value;
+	}
+
+	unsigned int Hash(unsigned int inValue)
+	{
+		return (inValue * 2654435761u) >> (32 - kHashBits);
+	}
+
+	// 15 in the token, then 255 per byte until the rest fits
+	bool WriteLength(unsigned int inLength, unsigned char*& ioOut, const unsigned char* inEnd)
+	{
+		for (inLength -= 15; inLength >= 255; inLength -= 255)
+		{
+			if (ioOut >= inEnd)
+			{
+				return false;
+			}
+			*ioOut++ = 255;
+		}
+		if (ioOut >= inEnd)
+		{
+			return false;
+		}
+		*ioOut++ = static_cast<unsigned char>(inLength);
+		return true;
+	}
+
+	bool ReadLength(unsigned int& ioLength, const unsigned char*& ioIn, const unsigned char* inEnd)
+	{
+		unsigned char byte;
+		do
+		{
+			if (ioIn >= inEnd)
+			{
+				return false;
+			}
+			byte = *ioIn++;
+			ioLength += byte;
+		} while (byte == 255);
+		return true;
+	}
+
+	bool WriteSequence(const unsigned char* inLiterals, unsigned int inLiteralCount, unsigned int inOffset, unsigned int inMatchLength,
+		unsigned char*& ioOut, const unsigned char* inEnd)
+	{
+		if (ioOut >= inEnd)
+		{
+			return false;
+		}
+		unsigned char* token = ioOut++;
+		*token = static_cast<unsigned char>((inLiteralCount >= 15 ? 15 : inLiteralCount) << 4);
+		if (inLiteralCount >= 15 && !WriteLength(inLiteralCount, ioOut, inEnd))
+		{
+			return false;
+		}
+		if (static_cast<unsigned int>(inEnd - ioOut) < inLiteralCount)
+		{
+			return false;
+		}
+		memcpy(ioOut, inLiterals, inLiteralCount);
+		ioOut += inLiteralCount;
+
+		// The last sequence has literals only
+		if (inMatchLength == 0)
+		{
+			return true;
+		}
+
+		if (inEnd - ioOut < 2)
+		{
+			return false;
+		}
+		*ioOut++ = static_cast<unsigned char>(inOffset);
+		*ioOut++ = static_cast<unsigned char>(inOffset >> 8);
+		unsigned int matchCode = inMatchLength - kMinMatch;
+		*token |= static_cast<unsigned char>(matchCode >= 15 ? 15 : matchCode);
+		return matchCode < 15 || WriteLength(matchCode, ioOut, inEnd);
+	}
+}
+
+unsigned int BlockCodec::Compress(const char* inSource, unsigned int inSize, char* outDestination)
+{
+	const unsigned char* source = reinterpret_cast<const unsigned char*>(inSource);
+	unsigned char* out = reinterpret_cast<unsigned char*>(outDestination);
+	// Anything not smaller than the input is useless
+	const unsigned char* outEnd = out + (inSize > 0 ? inSize - 1 : 0);
+
+	// Positions + 1, 0 is empty
+	unsigned int table[1 << kHashBits];
+	memset(table, 0, sizeof(table));
+
+	unsigned int anchor = 0;
+	if (inSize > kMatchStartLimit)
+	{
+		const unsigned int matchStartEnd = inSize - kMatchStartLimit;
+		const unsigned int matchEnd = inSize - kLastLiterals;
+		unsigned int position = 0;
+		while (position < matchStartEnd)
+		{
+			unsigned int value = Read32(source + position);
+			unsigned int& entry = table[Hash(value)];
+			unsigned int candidate = entry;
+			entry = position + 1;
+			if (candidate == 0 || position + 1 - candidate > kMaxOffset || Read32(source + candidate - 1) != value)
+			{
+				++position;
+				continue;
+			}
+
+			unsigned int match = candidate - 1;
+			unsigned int length = kMinMatch;
+			while (position + length < matchEnd && source[match + length] == source[position + length])
+			{
+				++length;
+			}
+			while (position > anchor && match > 0 && source[match - 1] == source[position - 1])
+			{
+				--position;
+				--match;
+				++length;
+			}
+
+			if (!WriteSequence(source + anchor, position - anchor, position - match, length, out, outEnd))
+			{
+				return 0;
+			}
+			position += length;
+			anchor = position;
+			if (position - 2 < matchStartEnd)
+			{
+				table[Hash(Read32(source + position - 2))] = position - 1;
+			}
+		}
+	}
+
+	if (!WriteSequence(source + anchor, inSize - anchor, 0, 0, out, outEnd))
+	{
+		return 0;
+	}
+
+	return static_cast<unsigned int>(out - reinterpret_cast<unsigned char*>(outDestination));
+}
+
+bool BlockCodec::Decompress(const char* inSource, unsigned int inCompressedSize, char* outDestination, unsigned int inRawSize)
+{
+	const unsigned char* in = reinterpret_cast<const unsigned char*>(inSource);
+	const unsigned char* inEnd = in + inCompressedSize;
+	unsigned char* outBegin = reinterpret_cast<unsigned char*>(outDestination);
+	unsigned char* out = outBegin;
+	unsigned char* outEnd = out + inRawSize;
+
+	while (in < inEnd)
+	{
+		unsigned int token = *in++;
+		unsigned int literalCount = token >> 4;
+		if (literalCount == 15 && !ReadLength(literalCount, in, inEnd))
+		{
+			return false;
+		}
+		if (static_cast<unsigned int>(inEnd - in) < literalCount || static_cast<unsigned int>(outEnd - out) < literalCount)
+		{
+			return false;
+		}
+		memcpy(out, in, literalCount);
+		in += literalCount;
+		out += literalCount;
+
+		if (in == inEnd)
+		{
+			break;
+		}
+
+		if (inEnd - in < 2)
+		{
+			return false;
+		}
+		unsigned int offset = in[0] | (in[1] << 8);
+		in += 2;
+		unsigned int matchLength = token & 15;
+		if (matchLength == 15 && !ReadLength(matchLength, in, inEnd))
+		{
+			return false;
+		}
+		matchLength += kMinMatch;
+		if (offset == 0 || offset > static_cast<unsigned int>(out - outBegin) || static_cast<unsigned int>(outEnd - out) < matchLength)
+		{
+			return false;
+		}
+
+		// Byte by byte, matches may overlap their own output
+		const unsigned char* match = out - offset;
+		for (unsigned int i = 0; i < matchLength; ++i)
+		{
+			out[i] = match[i];
+		}
+		out += matchLength;
+	}
+
+	return out == outEnd;
+}
+
+void BlockCodec::Shuffle(const char* inSource, unsigned int inSize, unsigned int inStride, char* outDestination)
+{
+	const unsigned int count = inStride > 0 ? inSize / inStride : 0;
+	unsigned char previous = 0;
+	for (unsigned int b = 0; b < inStride && count > 0; ++b)
+	{
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			unsigned char byte = static_cast<unsigned char>(inSource[i * inStride + b]);
+			outDestination[b * count + i] = static_cast<char>(byte - previous);
+			previous = byte;
+		}
+	}
+	memcpy(outDestination + count * inStride, inSource + count * inStride, inSize - count * inStride);
+}
+
+void BlockCodec::Unshuffle(const char* inSource, unsigned int inSize, unsigned int inStride, char* outDestination)
+{
+	const unsigned int count = inStride > 0 ? inSize / inStride : 0;
+	unsigned char previous = 0;
+	for (unsigned int b = 0; b < inStride && count > 0; ++b)
+	{
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			previous = static_cast<unsigned char>(previous + static_cast<unsigned char>(inSource[b * count + i]));
+			outDestination[i * inStride + b] = static_cast<char>(previous);
+		}
+	}
+	memcpy(outDestination + count * inStride, inSource + count * inStride, inSize - count * inStride);
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <vector>
+
+// LZ4 block format compressor, written for the exporter so no library
+// has to be linked. Every block is self contained (no dictionary),
+// so blocks can be decompressed in any order or in parallel, and the
+// output can be read by any LZ4 block decoder
+//
+// The shuffle filter regroups a block of fixed size records by byte
+// (byte 0 of every record, then byte 1, ...) and stores every byte as
+// the difference to the one before. Neighbouring vertices differ
+// little, so this turns vertex data into long runs of small values
+class BlockCodec
+{
+public:
+	static const unsigned int kBlockSize = 1 << 16;
+
+	// Returns the compressed size, or 0 if the result would not be
+	// smaller than inSize (store the block raw then)
+	static unsigned int Compress(const char* inSource, unsigned int inSize, char* outDestination);
+
+	// outDestination must hold inRawSize bytes. False on corrupt input
+	static bool Decompress(const char* inSource, unsigned int inCompressedSize, char* outDestination, unsigned int inRawSize);
+
+	// inSize does not have to be a multiple of inStride, the tail is
+	// left untouched
+	static void Shuffle(const char* inSource, unsigned int inSize, unsigned int inStride, char* outDestination);
+	static void Unshuffle(const char* inSource, unsigned int inSize, unsigned int inStride, char* outDestination);
+};
@@ -0,0 +1,182 @@
+#include "BonePartitioner.h"
+#include <climits>
+
+unsigned int BonePartitioner::GetInfluenceCount(const PNTIWVertex& inVertex)
+{
+	// Influences are sorted by weight, the weighted ones come first
+	unsigned int count = 0;
+	while (count < inVertex.mVertexBlendingInfos.size() && count < MAX_INFLUENCES &&
+		inVertex.mVertexBlendingInfos[count].mBlendingWeight > 0.0)
+	{
+		++count;
+	}
+	return count;
+}
+
+void BonePartitioner::Partition(const std::vector<PNTIWVertex>& inVertices, const std::vector<unsigned int>& inIndices,
+	unsigned int inPaletteSize, std::vector<BonePartition>& outPartitions)
+{
+	outPartitions.clear();
+	const unsigned int triangleCount = inIndices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// Distinct joints of every triangle
+	std::vector<unsigned int> jointOffsets(triangleCount + 1, 0);
+	std::vector<unsigned int> triangleJoints;
+	triangleJoints.reserve(inIndices.size());
+	unsigned int jointCount = 0;
+	for (unsigned int i = 0; i < triangleCount; ++i)
+	{
+		const size_t firstJoint = triangleJoints.size();
+		for (unsigned int j = 0; j < 3; ++j)
+		{
+			const PNTIWVertex& currVertex = inVertices[inIndices[i * 3 + j]];
+			const unsigned int influenceCount = GetInfluenceCount(currVertex);
+			for (unsigned int k = 0; k < influenceCount; ++k)
+			{
+				unsigned int joint = currVertex.mVertexBlendingInfos[k].mBlendingIndex;
+				if (std::find(triangleJoints.begin() + firstJoint, triangleJoints.end(), joint) == triangleJoints.end())
+				{
+					triangleJoints.push_back(joint);
+					jointCount = std::max(jointCount, joint + 1);
+				}
+			}
+		}
+		jointOffsets[i + 1] = triangleJoints.size();
+	}
+
+	// Joint to triangle adjacency
+	std::vector<unsigned int> adjacencyOffsets(jointCount + 1, 0);
+	for (unsigned int i = 0; i < triangleJoints.size(); ++i)
+	{
+		++adjacencyOffsets[triangleJoints[i] + 1];
+	}
+	for (unsigned int i = 0; i < jointCount; ++i)
+	{
+		adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+	}
+	std::vector<unsigned int> adjacency(triangleJoints.size());
+	{
+		std::vector<unsigned int> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (unsigned int i = 0; i < triangleCount; ++i)
+		{
+			for (unsigned int k = jointOffsets[i]; k < jointOffsets[i + 1]; ++k)
+			{
+				adjacency[cursor[triangleJoints[k]]++] = i;
+			}
+		}
+	}
+
+	// Unskinned triangles fit in any palette, they go to the first one
+	std::vector<unsigned char> assigned(triangleCount, 0);
+	std::vector<unsigned int> unskinnedTriangles;
+	for (unsigned int i = 0; i < triangleCount; ++i)
+	{
+		if (jointOffsets[i] == jointOffsets[i + 1])
+		{
+			assigned[i] = 1;
+			unskinnedTriangles.push_back(i);
+		}
+	}
+
+	// Joints of the current palette and, for the triangles sharing one
+	// of them, how many of their joints it still lacks. Valid if the
+	// owner matches the current partition
+	std::vector<unsigned int> jointOwner(jointCount, UINT_MAX);
+	std::vector<unsigned int> missingJoints(triangleCount);
+	std::vector<unsigned int> missingOwner(triangleCount, UINT_MAX);
+	// Candidates by missing joint count, entries go stale when the
+	// count drops further or the triangle is taken
+	std::vector<unsigned int> candidates[kMinPaletteSize + 1];
+	unsigned int nextSeed = 0;
+
+	while (true)
+	{
+		while (nextSeed < triangleCount && assigned[nextSeed])
+		{
+			++nextSeed;
+		}
+		if (nextSeed == triangleCount)
+		{
+			break;
+		}
+
+		const unsigned int partitionId = outPartitions.size();
+		outPartitions.push_back(BonePartition());
+		BonePartition& currPartition = outPartitions.back();
+		for (unsigned int m = 0; m <= kMinPaletteSize; ++m)
+		{
+			candidates[m].clear();
+		}
+
+		unsigned int triangle = nextSeed;
+		while (triangle != UINT_MAX)
+		{
+			assigned[triangle] = 1;
+			currPartition.mTriangles.push_back(triangle);
+			for (unsigned int k = jointOffsets[triangle]; k < jointOffsets[triangle + 1]; ++k)
+			{
+				unsigned int joint = triangleJoints[k];
+				if (jointOwner[joint] == partitionId)
+				{
+					continue;
+				}
+				jointOwner[joint] = partitionId;
+				currPartition.mJoints.push_back(joint);
+
+				for (unsigned int a = adjacencyOffsets[joint]; a < adjacencyOffsets[joint + 1]; ++a)
+				{
+					unsigned int neighbour = adjacency[a];
+					if (assigned[neighbour])
+					{
+						continue;
+					}
+					if (missingOwner[neighbour] != partitionId)
+					{
+						missingOwner[neighbour] = partitionId;
+						missingJoints[neighbour] = jointOffsets[neighbour + 1] - jointOffsets[neighbour];
+					}
+					--missingJoints[neighbour];
+					candidates[missingJoints[neighbour]].push_back(neighbour);
+				}
+			}
+
+			// Triangles adding no joint first, then the fewest that fit
+			triangle = UINT_MAX;
+			const unsigned int freeJoints = inPaletteSize - currPartition.mJoints.size();
+			const unsigned int maxMissing = freeJoints < kMinPaletteSize ? freeJoints : kMinPaletteSize;
+			for (unsigned int m = 0; m <= maxMissing && triangle == UINT_MAX; ++m)
+			{
+				while (!candidates[m].empty())
+				{
+					unsigned int candidate = candidates[m].back();
+					candidates[m].pop_back();
+					if (!assigned[candidate] && missingJoints[candidate] == m)
+					{
+						triangle = candidate;
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	if (!unskinnedTriangles.empty())
+	{
+		if (outPartitions.empty())
+		{
+			outPartitions.push_back(BonePartition());
+		}
+		outPartitions[0].mTriangles.insert(outPartitions[0].mTriangles.end(), unskinnedTriangles.begin(), unskinnedTriangles.end());
+	}
+
+	// Source order keeps the vertex cache locality of the triangle list
+	for (unsigned int i = 0; i < outPartitions.size(); ++i)
+	{
+		std::sort(outPartitions[i].mTriangles.begin(), outPartitions[i].mTriangles.end());
+		std::sort(outPartitions[i].mJoints.begin(), outPartitions[i].mJoints.end());
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "Vertex.h"
+
+// Triangles of a draw range whose vertices are only influenced by the
+// joints of one bone palette. A vertex's blend index is the position
+// of its joint in mJoints
+struct BonePartition
+{
+	// Into the partitioned triangle list, ascending
+	std::vector<unsigned int> mTriangles;
+	// Skeleton joint indices, ascending
+	std::vector<unsigned int> mJoints;
+};
+
+class BonePartitioner
+{
+public:
+	// Every palette must hold the joints of any single triangle, and
+	// palette local indices are bytes
+	static const unsigned int kMinPaletteSize = 3 * MAX_INFLUENCES;
+	static const unsigned int kMaxPaletteSize = 256;
+
+	// Greedily clusters the triangle list inIndices (3 per triangle)
+	// into partitions referencing at most inPaletteSize joints. A
+	// partition grows by the triangles all of whose joints are already
+	// in its palette, then by the one adding the fewest new joints, and
+	// is closed when no triangle sharing a joint with it fits anymore
+	// Only the first MAX_INFLUENCES influences with a weight count
+	static void Partition(const std::vector<PNTIWVertex>& inVertices, const std::vector<unsigned int>& inIndices,
+		unsigned int inPaletteSize, std::vector<BonePartition>& outPartitions);
+
+	// Number of joints inVertex's written influences reference
+	static unsigned int GetInfluenceCount(const PNTIWVertex& inVertex);
+};
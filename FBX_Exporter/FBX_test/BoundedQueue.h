@@ -0,0 +1,60 @@
+#pragma once
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+// Blocking FIFO with a fixed capacity, used to connect the stages of
+// the batch export pipeline
+// Push blocks while the queue is full, so a slow stage holds back the
+// stages feeding it. After Close, Pop drains what is left and then
+// returns false
+template<typename T>
+class BoundedQueue
+{
+public:
+	explicit BoundedQueue(size_t inCapacity) :
+		mCapacity(inCapacity > 0 ? inCapacity : 1),
+		mClosed(false)
+	{
+	}
+
+	void Push(const T& inItem)
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		mNotFull.wait(lock, [this] { return mItems.size() < mCapacity; });
+		mItems.push_back(inItem);
+		mNotEmpty.notify_one();
+	}
+
+	bool Pop(T& outItem)
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		mNotEmpty.wait(lock, [this] { return !mItems.empty() || mClosed; });
+		if (mItems.empty())
+		{
+			return false;
+		}
+		outItem = mItems.front();
+		mItems.pop_front();
+		mNotFull.notify_one();
+		return true;
+	}
+
+	void Close()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mClosed = true;
+		mNotEmpty.notify_all();
+	}
+
+private:
+	BoundedQueue(const BoundedQueue&);
+	BoundedQueue& operator=(const BoundedQueue&);
+
+	size_t mCapacity;
+	bool mClosed;
+	std::deque<T> mItems;
+	std::mutex mMutex;
+	std::condition_variable mNotFull;
+	std::condition_variable mNotEmpty;
+};
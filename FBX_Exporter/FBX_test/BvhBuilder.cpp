@@ -0,0 +1,301 @@
+#include "BvhBuilder.h"
+#include <future>
+#include <thread>
+#include <cfloat>
+
+namespace
+{
+	const unsigned int kBinCount = 16;
+
+	struct Bounds
+	{
+		float mMin[3];
+		float mMax[3];
+
+		Bounds()
+		{
+			for (int i = 0; i < 3; ++i)
+			{
+				mMin[i] = FLT_MAX;
+				mMax[i] = -FLT_MAX;
+			}
+		}
+
+		void Grow(const float inPoint[3])
+		{
+			for (int i = 0; i < 3; ++i)
+			{
+				mMin[i] = std::min(mMin[i], inPoint[i]);
+				mMax[i] = std::max(mMax[i], inPoint[i]);
+			}
+		}
+
+		void Grow(const Bounds& inOther)
+		{
+			for (int i = 0; i < 3; ++i)
+			{
+				mMin[i] = std::min(mMin[i], inOther.mMin[i]);
+				mMax[i] = std::max(mMax[i], inOther.mMax[i]);
+			}
+		}
+
+		float HalfArea() const
+		{
+			if (mMin[0] > mMax[0])
+			{
+				return 0.0f;
+			}
+			float dx = mMax[0] - mMin[0];
+			float dy = mMax[1] - mMin[1];
+			float dz = mMax[2] - mMin[2];
+			return dx * dy + dy * dz + dz * dx;
+		}
+	};
+
+	// Shared, read only state of one build
+	struct BuildContext
+	{
+		std::vector<Bounds> mTriangleBounds;
+		std::vector<XMFLOAT3> mCentroids;
+		// Triangle order, partitioned in place; tasks work on disjoint ranges
+		std::vector<unsigned int>* mOrder;
+		unsigned int mParallelDepth;
+	};
+
+	BvhNode MakeNode(const Bounds& inBounds, unsigned int inLeftOrFirst, unsigned int inCount)
+	{
+		BvhNode node;
+		node.mMin = XMFLOAT3(inBounds.mMin[0], inBounds.mMin[1], inBounds.mMin[2]);
+		node.mMax = XMFLOAT3(inBounds.mMax[0], inBounds.mMax[1], inBounds.mMax[2]);
+		node.mLeftOrFirst = inLeftOrFirst;
+		node.mCount = inCount;
+		return node;
+	}
+
+	// Finds the binned SAH split of [inBegin, inEnd) and partitions the
+	// range. Returns the first triangle of the right half, or inBegin
+	// if the range should become a leaf
+	unsigned int Split(BuildContext& ioContext, unsigned int inBegin, unsigned int inEnd, const Bounds& inBounds)
+	{
+		std::vector<unsigned int>& order = *ioContext.mOrder;
+		const unsigned int count = inEnd - inBegin;
+		if (count <= 2)
+		{
+			return inBegin;
+		}
+
+		Bounds centroidBounds;
+		for (unsigned int i = inBegin; i < inEnd; ++i)
+		{
+			const XMFLOAT3& c = ioContext.mCentroids[order[i]];
+			float p[3] = { c.x, c.y, c.z };
+			centroidBounds.Grow(p);
+		}
+
+		float bestCost = FLT_MAX;
+		int bestAxis = -1;
+		unsigned int bestBin = 0;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			float extent = centroidBounds.mMax[axis] - centroidBounds.mMin[axis];
+			if (extent <= 0.0f)
+			{
+				continue;
+			}
+
+			Bounds binBounds[kBinCount];
+			unsigned int binCounts[kBinCount] = { 0 };
+			float scale = kBinCount / extent;
+			for (unsigned int i = inBegin; i < inEnd; ++i)
+			{
+				const float* c = &ioContext.mCentroids[order[i]].x;
+				unsigned int bin = std::min(kBinCount - 1, static_cast<unsigned int>((c[axis] - centroidBounds.mMin[axis]) * scale));
+				++binCounts[bin];
+				binBounds[bin].Grow(ioContext.mTriangleBounds[order[i]]);
+			}
+
+			// Sweep from the right, then evaluate every split from the left
+			float rightAreas[kBinCount];
+			unsigned int rightCounts[kBinCount];
+			Bounds rightBounds;
+			unsigned int rightCount = 0;
+			for (unsigned int bin = kBinCount - 1; bin > 0; --bin)
+			{
+				rightBounds.Grow(binBounds[bin]);
+				rightCount += binCounts[bin];
+				rightAreas[bin] = rightBounds.HalfArea();
+				rightCounts[bin] = rightCount;
+			}
+			Bounds leftBounds;
+			unsigned int leftCount = 0;
+			for (unsigned int bin = 0; bin < kBinCount - 1; ++bin)
+			{
+				leftBounds.Grow(binBounds[bin]);
+				leftCount += binCounts[bin];
+				if (leftCount == 0 || rightCounts[bin + 1] == 0)
+				{
+					continue;
+				}
+				float cost = leftBounds.HalfArea() * leftCount + rightAreas[bin + 1] * rightCounts[bin + 1];
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestBin = bin;
+				}
+			}
+		}
+
+		// Keep a leaf if splitting does not pay off
+		float leafCost = inBounds.HalfArea() * count;
+		if (bestAxis == -1 || (count <= BvhBuilder::kMaxLeafTriangles && bestCost >= leafCost))
+		{
+			if (count <= BvhBuilder::kMaxLeafTriangles)
+			{
+				return inBegin;
+			}
+			// All centroids coincide, split by count
+			return inBegin + count / 2;
+		}
+
+		float scale = kBinCount / (centroidBounds.mMax[bestAxis] - centroidBounds.mMin[bestAxis]);
+		float minimum = centroidBounds.mMin[bestAxis];
+		std::vector<XMFLOAT3>& centroids = ioContext.mCentroids;
+		unsigned int* middle = std::partition(&order[0] + inBegin, &order[0] + inEnd, [&](unsigned int inTriangle)
+		{
+			const float* c = &centroids[inTriangle].x;
+			return std::min(kBinCount - 1, static_cast<unsigned int>((c[bestAxis] - minimum) * scale)) <= bestBin;
+		});
+		return static_cast<unsigned int>(middle - &order[0]);
+	}
+
+	void BuildRecursive(BuildContext& ioContext, unsigned int inBegin, unsigned int inEnd, std::vector<BvhNode>& ioNodes)
+	{
+		const std::vector<unsigned int>& order = *ioContext.mOrder;
+		Bounds bounds;
+		for (unsigned int i = inBegin; i < inEnd; ++i)
+		{
+			bounds.Grow(ioContext.mTriangleBounds[order[i]]);
+		}
+
+		unsigned int middle = Split(ioContext, inBegin, inEnd, bounds);
+		if (middle == inBegin)
+		{
+			ioNodes.push_back(MakeNode(bounds, inBegin, inEnd - inBegin));
+			return;
+		}
+
+		unsigned int nodeIndex = ioNodes.size();
+		ioNodes.push_back(MakeNode(bounds, 0, 0));
+		BuildRecursive(ioContext, inBegin, middle, ioNodes);
+		ioNodes[nodeIndex].mLeftOrFirst = ioNodes.size();
+		BuildRecursive(ioContext, middle, inEnd, ioNodes);
+	}
+
+	// The upper levels build their subtrees on separate threads into
+	// separate arrays which are then spliced together depth first
+	std::vector<BvhNode> BuildParallel(BuildContext& ioContext, unsigned int inBegin, unsigned int inEnd, unsigned int inDepth)
+	{
+		std::vector<BvhNode> nodes;
+		if (inDepth >= ioContext.mParallelDepth || inEnd - inBegin < 4096)
+		{
+			BuildRecursive(ioContext, inBegin, inEnd, nodes);
+			return nodes;
+		}
+
+		const std::vector<unsigned int>& order = *ioContext.mOrder;
+		Bounds bounds;
+		for (unsigned int i = inBegin; i < inEnd; ++i)
+		{
+			bounds.Grow(ioContext.mTriangleBounds[order[i]]);
+		}
+		unsigned int middle = Split(ioContext, inBegin, inEnd, bounds);
+		if (middle == inBegin)
+		{
+			nodes.push_back(MakeNode(bounds, inBegin, inEnd - inBegin));
+			return nodes;
+		}
+
+		std::future<std::vector<BvhNode> > leftTask = std::async(std::launch::async, BuildParallel, std::ref(ioContext), inBegin, middle, inDepth + 1);
+		std::vector<BvhNode> right = BuildParallel(ioContext, middle, inEnd, inDepth + 1);
+		std::vector<BvhNode> left = leftTask.get();
+
+		nodes.reserve(1 + left.size() + right.size());
+		nodes.push_back(MakeNode(bounds, 1 + left.size(), 0));
+		for (unsigned int i = 0; i < left.size(); ++i)
+		{
+			nodes.push_back(left[i]);
+			if (left[i].mCount == 0)
+			{
+				nodes.back().mLeftOrFirst += 1;
+			}
+		}
+		for (unsigned int i = 0; i < right.size(); ++i)
+		{
+			nodes.push_back(right[i]);
+			if (right[i].mCount == 0)
+			{
+				nodes.back().mLeftOrFirst += 1 + left.size();
+			}
+		}
+		return nodes;
+	}
+}
+
+unsigned int BvhBuilder::Build(const std::vector<PNTIWVertex>& inVertices, const std::vector<unsigned int>& inIndices,
+	const std::vector<unsigned int>& inTriangleIds, unsigned int inThreads, BvhData& ioBvh)
+{
+	// A node with count 0 is an inner node, an empty hierarchy has no
+	// node at all
+	if (inTriangleIds.empty())
+	{
+		return kNoRoot;
+	}
+	const unsigned int rootIndex = ioBvh.mNodes.size();
+	const unsigned int firstTriangle = ioBvh.mTriangles.size();
+
+	// Bounds and centroids are indexed by position in inTriangleIds
+	BuildContext context;
+	context.mTriangleBounds.resize(inTriangleIds.size());
+	context.mCentroids.resize(inTriangleIds.size());
+	for (unsigned int i = 0; i < inTriangleIds.size(); ++i)
+	{
+		for (unsigned int j = 0; j < 3; ++j)
+		{
+			const XMFLOAT3& p = inVertices[inIndices[inTriangleIds[i] * 3 + j]].mPosition;
+			float point[3] = { p.x, p.y, p.z };
+			context.mTriangleBounds[i].Grow(point);
+		}
+		const Bounds& b = context.mTriangleBounds[i];
+		context.mCentroids[i] = XMFLOAT3((b.mMin[0] + b.mMax[0]) * 0.5f, (b.mMin[1] + b.mMax[1]) * 0.5f, (b.mMin[2] + b.mMax[2]) * 0.5f);
+	}
+
+	std::vector<unsigned int> order(inTriangleIds.size());
+	for (unsigned int i = 0; i < order.size(); ++i)
+	{
+		order[i] = i;
+	}
+	context.mOrder = &order;
+
+	// Enough levels to give every thread a subtree
+	context.mParallelDepth = 0;
+	for (unsigned int threads = inThreads; threads > 1; threads >>= 1)
+	{
+		++context.mParallelDepth;
+	}
+
+	std::vector<BvhNode> nodes = BuildParallel(context, 0, order.size(), 0);
+
+	// Make the node references absolute within ioBvh
+	for (unsigned int i = 0; i < nodes.size(); ++i)
+	{
+		nodes[i].mLeftOrFirst += nodes[i].mCount == 0 ? rootIndex : firstTriangle;
+	}
+	ioBvh.mNodes.insert(ioBvh.mNodes.end(), nodes.begin(), nodes.end());
+	for (unsigned int i = 0; i < order.size(); ++i)
+	{
+		ioBvh.mTriangles.push_back(inTriangleIds[order[i]]);
+	}
+
+	return rootIndex;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include "Vertex.h"
+#include "static_mesh_struct.h"
+
+// 32 byte node of a flat, depth first bounding volume hierarchy
+// An inner node (mCount == 0) is followed by its left child and
+// mLeftOrFirst is the index of its right child
+// A leaf holds the triangles mTriangles[mLeftOrFirst, mLeftOrFirst + mCount)
+struct BvhNode
+{
+	XMFLOAT3 mMin;
+	unsigned int mLeftOrFirst;
+	XMFLOAT3 mMax;
+	unsigned int mCount;
+};
+
+struct BvhData
+{
+	std::vector<BvhNode> mNodes;
+	// Triangle indices referenced by the leaves
+	std::vector<unsigned int> mTriangles;
+};
+
+class BvhBuilder
+{
+public:
+	static const unsigned int kMaxLeafTriangles = 4;
+	static const unsigned int kNoRoot = SM_BVH_NO_ROOT;
+
+	// Builds a binned SAH hierarchy over the triangles inTriangleIds
+	// (indices of triangles in inIndices, 3 indices per triangle) and
+	// appends it to ioBvh. The upper levels are built in parallel, on
+	// about inThreads threads
+	// Returns the index of the root node, or kNoRoot without appending
+	// anything if inTriangleIds is empty
+	static unsigned int Build(const std::vector<PNTIWVertex>& inVertices, const std::vector<unsigned int>& inIndices,
+		const std::vector<unsigned int>& inTriangleIds, unsigned int inThreads, BvhData& ioBvh);
+};
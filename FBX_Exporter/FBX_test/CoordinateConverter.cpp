@@ -0,0 +1,159 @@
+#include "CoordinateConverter.h"
+
+CoordinateConverter::CoordinateConverter() :
+	mScale(1.0f),
+	mFlipV(false)
+{
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		mAxes[i] = i;
+		mSigns[i] = 1.0f;
+	}
+}
+
+CoordinateConverter CoordinateConverter::LeftHanded()
+{
+	CoordinateConverter converter;
+	converter.mSigns[2] = -1.0f;
+	converter.mFlipV = true;
+	return converter;
+}
+
+CoordinateConverter CoordinateConverter::LeftHandedFromZUp()
+{
+	// Swapping y and z is a mirror by itself
+	CoordinateConverter converter;
+	converter.mAxes[1] = 2;
+	converter.mAxes[2] = 1;
+	converter.mFlipV = true;
+	return converter;
+}
+
+bool CoordinateConverter::SetAxes(const unsigned int* inAxes, const float* inSigns)
+{
+	bool used[3] = { false, false, false };
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		if (inAxes[i] > 2 || used[inAxes[i]] || (inSigns[i] != 1.0f && inSigns[i] != -1.0f))
+		{
+			return false;
+		}
+		used[inAxes[i]] = true;
+	}
+
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		mAxes[i] = inAxes[i];
+		mSigns[i] = inSigns[i];
+	}
+	return true;
+}
+
+void CoordinateConverter::SetUnitScale(float inScale)
+{
+	mScale = inScale;
+}
+
+void CoordinateConverter::SetFlipV(bool inFlipV)
+{
+	mFlipV = inFlipV;
+}
+
+unsigned int CoordinateConverter::GetAxis(unsigned int inTargetAxis) const
+{
+	return mAxes[inTargetAxis];
+}
+
+float CoordinateConverter::GetSign(unsigned int inTargetAxis) const
+{
+	return mSigns[inTargetAxis];
+}
+
+bool CoordinateConverter::IsIdentity() const
+{
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		if (mAxes[i] != i || mSigns[i] != 1.0f)
+		{
+			return false;
+		}
+	}
+	return mScale == 1.0f && !mFlipV;
+}
+
+bool CoordinateConverter::FlipsWinding() const
+{
+	// Parity of the permutation times the signs
+	unsigned int swaps = 0;
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		for (unsigned int j = i + 1; j < 3; ++j)
+		{
+			swaps += mAxes[i] > mAxes[j] ? 1 : 0;
+		}
+	}
+	float determinant = (swaps & 1) ? -1.0f : 1.0f;
+	return determinant * mSigns[0] * mSigns[1] * mSigns[2] * mScale < 0.0f;
+}
+
+// With the SIMD stream transforms of XNA Math. Only one product per
+// component is non zero, so the results are exact apart from the scale
+void CoordinateConverter::ConvertPositions(XMFLOAT3* ioData, unsigned int inStride, unsigned int inCount) const
+{
+	float m[3][3] = {};
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		m[mAxes[i]][i] = mSigns[i] * mScale;
+	}
+	XMMATRIX conversion = XMMatrixSet(
+		m[0][0], m[0][1], m[0][2], 0.0f,
+		m[1][0], m[1][1], m[1][2], 0.0f,
+		m[2][0], m[2][1], m[2][2], 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f);
+	XMVector3TransformCoordStream(ioData, inStride, ioData, inStride, inCount, conversion);
+}
+
+// Unscaled, the axes only permute and mirror, so normals stay unit length
+void CoordinateConverter::ConvertNormals(XMFLOAT3* ioData, unsigned int inStride, unsigned int inCount) const
+{
+	float m[3][3] = {};
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		m[mAxes[i]][i] = mScale < 0.0f ? -mSigns[i] : mSigns[i];
+	}
+	XMMATRIX conversion = XMMatrixSet(
+		m[0][0], m[0][1], m[0][2], 0.0f,
+		m[1][0], m[1][1], m[1][2], 0.0f,
+		m[2][0], m[2][1], m[2][2], 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f);
+	XMVector3TransformNormalStream(ioData, inStride, ioData, inStride, inCount, conversion);
+}
+
+void CoordinateConverter::ConvertUVs(XMFLOAT2* ioData, unsigned int inStride, unsigned int inCount) const
+{
+	if (!mFlipV)
+	{
+		return;
+	}
+
+	char* data = reinterpret_cast<char*>(ioData);
+	for (unsigned int i = 0; i < inCount; ++i)
+	{
+		XMFLOAT2* uv = reinterpret_cast<XMFLOAT2*>(data + static_cast<size_t>(i) * inStride);
+		uv->y = 1.0f - uv->y;
+	}
+}
+
+// FbxAMatrix transforms row vectors, the translation is row 3
+void CoordinateConverter::ConvertTransform(FbxAMatrix& ioMatrix) const
+{
+	const FbxAMatrix source = ioMatrix;
+	for (int r = 0; r < 3; ++r)
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			ioMatrix[r][c] = mSigns[r] * mSigns[c] * source.Get(mAxes[r], mAxes[c]);
+		}
+		ioMatrix[3][r] = mScale * mSigns[r] * source.Get(3, mAxes[r]);
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <fbxsdk.h>
+#include "MathHelper.h"
+
+// Converts extracted data, which is in the axis system and units of
+// the FBX file, to the axis system and units of the written files
+//
+// Target axis i is the source axis GetAxis(i) times GetSign(i), times
+// the unit scale. Positions, normals and joint transforms go through
+// the same change of basis, so skinning and node hierarchies stay
+// consistent, and triangle winding flips when the conversion mirrors
+class CoordinateConverter
+{
+public:
+	// The identity
+	CoordinateConverter();
+
+	// Mirrors z and flips v, the convention of the exported files and
+	// the exporter's default
+	static CoordinateConverter LeftHanded();
+	// From Z up right handed (3ds Max) to Y up left handed, with v flipped
+	static CoordinateConverter LeftHandedFromZUp();
+
+	// inAxes[i] (0 x, 1 y, 2 z) and inSigns[i] (+1 or -1) of target
+	// axis i, the axes must be a permutation. False otherwise
+	bool SetAxes(const unsigned int* inAxes, const float* inSigns);
+	// Source units to target units, e.g. 0.01 for centimeters to meters
+	void SetUnitScale(float inScale);
+	// Texture coordinates v becomes 1 - v
+	void SetFlipV(bool inFlipV);
+
+	unsigned int GetAxis(unsigned int inTargetAxis) const;
+	float GetSign(unsigned int inTargetAxis) const;
+	bool IsIdentity() const;
+	// An odd number of mirrored axes turns the winding of triangles
+	bool FlipsWinding() const;
+
+	// Strided in place conversion of inCount elements, the first at ioData
+	void ConvertPositions(XMFLOAT3* ioData, unsigned int inStride, unsigned int inCount) const;
+	void ConvertNormals(XMFLOAT3* ioData, unsigned int inStride, unsigned int inCount) const;
+	void ConvertUVs(XMFLOAT2* ioData, unsigned int inStride, unsigned int inCount) const;
+	// C * M * C^-1 for the change of basis C, exact since C only permutes,
+	// negates and scales
+	void ConvertTransform(FbxAMatrix& ioMatrix) const;
+
+private:
+	unsigned int mAxes[3];
+	float mSigns[3];
+	float mScale;
+	bool mFlipV;
+};
@@ -1,10 +1,14 @@
 #include "FBXExporter.h"
 #include "Utilities.h"
+#include "BinaryFbxImporter.h"
 #include <fstream>
 #include <sstream>
 #include <iomanip>
+#include <climits>
+#include <thread>
 
 #include "static_mesh_struct.h"
+#include "static_anim_struct.h"
 
 FBXExporter::FBXExporter()
 {
@@ -12,9 +16,147 @@ FBXExporter::FBXExporter()
 	mFBXScene = nullptr;
 	mTriangleCount = 0;
 	mHasAnimation = true;
+	mSceneLoaded = false;
+	mAnimationLength = 0;
+	mUVSetCount = 1;
+	mColorSetCount = 0;
+	mCoordinateConverter = CoordinateConverter::LeftHanded();
+	mInstancing = false;
+	mStaticBatching = false;
+	mSplitBatchesAt64k = false;
+	mLodLevelCount = 0;
+	mLodTriangleRatio = 0.5f;
+	mGenerateMeshlets = false;
+	mGenerateBvh = false;
+	mQuantizeRotations = false;
+	mBonePaletteSize = 0;
+	// One quantization step of the written weights
+	mMinSkinWeight = 1.0f / 255.0f;
+	mSyncOutput = false;
+	mStreamCompatibleText = false;
+	mTextThreads = 1;
+	mCompressOutput = false;
+	mShuffleVertices = false;
+	mGeometryCodec = false;
+	mNativeImport = false;
+	mInflateThreads = 1;
+	mImportProfile = IMPORT_FULL;
+	mImportStages = GetImportStages(IMPORT_FULL);
+	mHasSnapshot = false;
+	mKeepSnapshot = false;
+	mLog = &std::cout;
+	mWorkerThreads = std::max(std::thread::hardware_concurrency(), 1u);
 	QueryPerformanceFrequency(&mCPUFreq);
 }
 
+void FBXExporter::SetVertexLayout(unsigned int inUVSetCount, unsigned int inColorSetCount)
+{
+	mUVSetCount = std::min(inUVSetCount, MAX_UV_SETS);
+	mColorSetCount = std::min(inColorSetCount, MAX_COLOR_SETS);
+}
+
+void FBXExporter::SetCoordinateConversion(const CoordinateConverter& inConverter)
+{
+	mCoordinateConverter = inConverter;
+}
+
+void FBXExporter::SetInstancing(bool inEnable)
+{
+	mInstancing = inEnable;
+}
+
+void FBXExporter::SetStaticBatching(bool inEnable, bool inSplitAt64k)
+{
+	mStaticBatching = inEnable;
+	mSplitBatchesAt64k = inSplitAt64k;
+}
+
+void FBXExporter::SetLodChain(unsigned int inLevelCount, float inTriangleRatio)
+{
+	mLodLevelCount = inLevelCount;
+	mLodTriangleRatio = inTriangleRatio;
+}
+
+void FBXExporter::SetMeshletGeneration(bool inEnable)
+{
+	mGenerateMeshlets = inEnable;
+}
+
+void FBXExporter::SetBvhGeneration(bool inEnable)
+{
+	mGenerateBvh = inEnable;
+}
+
+void FBXExporter::SetAnimationOutput(bool inQuantizeRotations)
+{
+	mQuantizeRotations = inQuantizeRotations;
+}
+
+void FBXExporter::SetSkinWeights(float inMinWeight)
+{
+	mMinSkinWeight = std::min(std::max(inMinWeight, 0.0f), 1.0f);
+}
+
+void FBXExporter::SetBonePalettes(unsigned int inMaxBones)
+{
+	if (inMaxBones == 0)
+	{
+		mBonePaletteSize = 0;
+		return;
+	}
+	mBonePaletteSize = inMaxBones < BonePartitioner::kMinPaletteSize ? BonePartitioner::kMinPaletteSize :
+		(inMaxBones > BonePartitioner::kMaxPaletteSize ? BonePartitioner::kMaxPaletteSize : inMaxBones);
+}
+
+void FBXExporter::SetSyncOutput(bool inEnable)
+{
+	mSyncOutput = inEnable;
+}
+
+void FBXExporter::SetCompression(bool inEnable, bool inShuffleVertices)
+{
+	mCompressOutput = inEnable;
+	mShuffleVertices = inShuffleVertices;
+}
+
+void FBXExporter::SetGeometryCodec(bool inEnable)
+{
+	mGeometryCodec = inEnable;
+}
+
+void FBXExporter::SetTextOutput(bool inStreamCompatible, unsigned int inThreads)
+{
+	mStreamCompatibleText = inStreamCompatible;
+	mTextThreads = std::max(inThreads, 1u);
+}
+
+void FBXExporter::SetNativeImport(bool inEnable, unsigned int inInflateThreads)
+{
+	mNativeImport = inEnable;
+	mInflateThreads = std::max(inInflateThreads, 1u);
+}
+
+void FBXExporter::SetWorkerThreads(unsigned int inThreads)
+{
+	mWorkerThreads = std::max(inThreads, 1u);
+}
+
+void FBXExporter::SetKeepSnapshot(bool inEnable)
+{
+	mKeepSnapshot = inEnable;
+}
+
+void FBXExporter::SetLog(std::ostream* inLog)
+{
+	mLog = inLog;
+}
+
+void FBXExporter::SetImportProfile(ImportProfile inProfile)
+{
+	mImportProfile = inProfile;
+	mImportStages = GetImportStages(inProfile);
+}
+
 bool FBXExporter::Initialize()
 {
 	mFBXManager = FbxManager::Create();
@@ -32,73 +174,439 @@ bool FBXExporter::Initialize()
 }
 
 bool FBXExporter::LoadScene(const char* inFileName)
+{
+	if (!ImportScene(inFileName))
+	{
+		return false;
+	}
+
+	ProcessScene();
+
+	return true;
+}
+
+bool FBXExporter::ImportScene(const char* inFileName)
 {
 	LARGE_INTEGER start;
 	LARGE_INTEGER end;
 	mInputFilePath = inFileName;
 	//mOutputFilePath = inOutputPath;
 
-	QueryPerformanceCounter(&start);
-	FbxImporter* fbxImporter = FbxImporter::Create(mFBXManager, "myImporter");
+	// Reuse the manager and IO settings of the previous scene
+	if (mSceneLoaded || mHasSnapshot)
+	{
+		Reset();
+	}
 
-	if (!fbxImporter)
+	QueryPerformanceCounter(&start);
+	if (mNativeImport)
 	{
-		return false;
+		// Extracts the scene as well, ProcessScene only restores it
+		BinaryFbxImporter nativeImporter;
+		if (nativeImporter.Import(inFileName, mUVSetCount, mColorSetCount, mImportStages, mInflateThreads, mSnapshot))
+		{
+			mHasSnapshot = true;
+			QueryPerformanceCounter(&end);
+			*mLog << "Loading FBX File: " << ((end.QuadPart - start.QuadPart) / static_cast<float>(mCPUFreq.QuadPart)) << "s\n";
+			return true;
+		}
+		*mLog << "Native import failed (" << nativeImporter.GetError() << "), using the FBX SDK\n";
+		if (!mFBXManager)
+		{
+			return false;
+		}
 	}
 
-	if (!fbxImporter->Initialize(inFileName, -1, mFBXManager->GetIOSettings()))
+	ConfigureImportSettings();
+	FbxImporter* fbxImporter = FbxImporter::Create(mFBXManager, "myImporter");
+
+	if (!fbxImporter)
 	{
 		return false;
 	}
 
-	if (!fbxImporter->Import(mFBXScene))
+	// A failed import can leave a partial scene behind
+	mSceneLoaded = true;
+	if (!fbxImporter->Initialize(inFileName, -1, mFBXManager->GetIOSettings()) || !fbxImporter->Import(mFBXScene))
 	{
+		fbxImporter->Destroy();
 		return false;
 	}
 	fbxImporter->Destroy();
 	QueryPerformanceCounter(&end);
-	std::cout << "Loading FBX File: " << ((end.QuadPart - start.QuadPart) / static_cast<float>(mCPUFreq.QuadPart)) << "s\n";
-
-	ProcessScene();
+	*mLog << "Loading FBX File: " << ((end.QuadPart - start.QuadPart) / static_cast<float>(mCPUFreq.QuadPart)) << "s\n";
 
 	return true;
 }
 
-void FBXExporter::ExportFBX()
+// Categories the import profile does not need are not read at all
+void FBXExporter::ConfigureImportSettings()
+{
+	FbxIOSettings* fbxIOSettings = mFBXManager->GetIOSettings();
+	bool full = mImportProfile == IMPORT_FULL;
+
+	fbxIOSettings->SetBoolProp(IMP_FBX_MATERIAL, mImportStages.mMaterials);
+	fbxIOSettings->SetBoolProp(IMP_FBX_TEXTURE, mImportStages.mMaterials);
+	fbxIOSettings->SetBoolProp(IMP_FBX_LINK, mImportStages.mSkeleton);
+	fbxIOSettings->SetBoolProp(IMP_FBX_ANIMATION, mImportStages.mAnimation);
+	fbxIOSettings->SetBoolProp(IMP_FBX_SHAPE, full);
+	fbxIOSettings->SetBoolProp(IMP_FBX_GOBO, full);
+	fbxIOSettings->SetBoolProp(IMP_FBX_CHARACTER, full);
+	fbxIOSettings->SetBoolProp(IMP_FBX_CONSTRAINT, full);
+	// Only the texture file names are exported
+	fbxIOSettings->SetBoolProp(IMP_FBX_EXTRACT_EMBEDDED_DATA, full);
+}
+
+// The only step that reads the FbxScene
+void FBXExporter::ExtractScene()
 {
 	LARGE_INTEGER start;
 	LARGE_INTEGER end;
-	
-	// Get the clean name of the model
-	std::string genericFileName = Utilities::GetFileName(mInputFilePath);
-	genericFileName = Utilities::RemoveSuffix(genericFileName);
 
-	QueryPerformanceCounter(&start);
-	ProcessSkeletonHierarchy(mFBXScene->GetRootNode());
-	if(mSkeleton.mJoints.empty())
+	if (mImportStages.mSkeleton)
+	{
+		QueryPerformanceCounter(&start);
+		ProcessSkeletonHierarchy(mFBXScene->GetRootNode());
+		QueryPerformanceCounter(&end);
+		*mLog << "Processing Skeleton Hierarchy: " << ((end.QuadPart - start.QuadPart) / static_cast<float>(mCPUFreq.QuadPart)) << "s\n";
+	}
+	if (mSkeleton.mJoints.empty())
 	{
 		mHasAnimation = false;
 	}
 
-	std::cout << "\n\n\n\nExporting Model:" << genericFileName << "\n";
-	QueryPerformanceCounter(&end);
-	std::cout << "Processing Skeleton Hierarchy: " << ((end.QuadPart - start.QuadPart) / static_cast<float>(mCPUFreq.QuadPart)) << "s\n";
-
 	QueryPerformanceCounter(&start);
+	if (mImportStages.mMesh)
+	{
+		// One allocation for the whole scene rather than one per node
+		const unsigned int polygonCount = CountPolygons(mFBXScene->GetRootNode());
+		mTriangles.reserve(polygonCount);
+		mVertices.reserve(polygonCount * 3);
+	}
 	ProcessGeometry(mFBXScene->GetRootNode());
 	QueryPerformanceCounter(&end);
-	std::cout << "Processing Geometry: " << ((end.QuadPart - start.QuadPart) / static_cast<float>(mCPUFreq.QuadPart)) << "s\n";
+	*mLog << "Processing Geometry: " << ((end.QuadPart - start.QuadPart) / static_cast<float>(mCPUFreq.QuadPart)) << "s\n";
+
+	AddDefaultMaterial();
+}
+
+// Triangles of a scene without materials reference material 0
+void FBXExporter::AddDefaultMaterial()
+{
+	if (mMaterialLookUp.empty() && !mTriangles.empty())
+	{
+		mMaterialLookUp[0] = CreateDefaultMaterial();
+	}
+}
+
+// Grey Lambert without textures, for shading models other than
+// Lambert and Phong and for scenes without materials
+Material* FBXExporter::CreateDefaultMaterial()
+{
+	LambertMaterial* material = mArena.New<LambertMaterial>();
+	material->mAmbient = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	material->mDiffuse = XMFLOAT3(0.8f, 0.8f, 0.8f);
+	material->mEmissive = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	material->mTransparencyFactor = 0.0;
+	return material;
+}
+
+// Extracted scene data for the processing stages, which change it in
+// place. Without a snapshot to restore, the FbxScene is extracted again
+bool FBXExporter::PrepareSceneData()
+{
+	if (!mHasSnapshot)
+	{
+		if (!mSceneLoaded)
+		{
+			*mLog << "No scene to process, it was imported without the FBX SDK and already processed\n";
+			return false;
+		}
+		ClearProcessedData();
+		ExtractScene();
+		if (!mKeepSnapshot)
+		{
+			return true;
+		}
+		CaptureSnapshot();
+	}
+
+	LARGE_INTEGER start;
+	LARGE_INTEGER end;
 
 	QueryPerformanceCounter(&start);
-	Optimize();
+	RestoreSnapshot();
 	QueryPerformanceCounter(&end);
-	std::cout << "Optimization: " << ((end.QuadPart - start.QuadPart) / static_cast<float>(mCPUFreq.QuadPart)) << "s\n";
-	std::cout << "\n\n";
+	*mLog << "Restoring Snapshot: " << ((end.QuadPart - start.QuadPart) / static_cast<float>(mCPUFreq.QuadPart)) << "s\n";
+
+	return true;
+}
+
+// Moves the extracted scene into the snapshot, the extracted data is
+// cleared afterwards
+void FBXExporter::CaptureSnapshot()
+{
+	mSnapshot.Clear();
+	mSnapshot.mSourceFile = mInputFilePath;
+	mSnapshot.mUVSetCount = mUVSetCount;
+	mSnapshot.mColorSetCount = mColorSetCount;
+
+	mSnapshot.mVertices.swap(mVertices);
+	mSnapshot.mIndices.reserve(mTriangles.size() * 3);
+	mSnapshot.mMaterialIndices.reserve(mTriangles.size());
+	for (const Triangle& triangle : mTriangles)
+	{
+		mSnapshot.mIndices.insert(mSnapshot.mIndices.end(), triangle.mIndices.begin(), triangle.mIndices.begin() + 3);
+		mSnapshot.mMaterialIndices.push_back(triangle.mMaterialIndex);
+	}
+
+	mSnapshot.mNodes.resize(mMeshNodes.size());
+	for (size_t i = 0; i < mMeshNodes.size(); ++i)
+	{
+		const MeshNode& node = mMeshNodes[i];
+		SnapshotNode& snapshotNode = mSnapshot.mNodes[i];
+		snapshotNode.mName = node.mName;
+		for (int j = 0; j < 16; ++j)
+		{
+			snapshotNode.mGlobalTransform[j] = node.mGlobalTransform.Get(j / 4, j % 4);
+		}
+		snapshotNode.mFirstTriangle = node.mFirstTriangle;
+		snapshotNode.mTriangleCount = node.mTriangleCount;
+		snapshotNode.mFirstVertex = node.mFirstVertex;
+		snapshotNode.mVertexCount = node.mVertexCount;
+	}
+
+	mSnapshot.mMaterials.resize(mMaterialLookUp.size());
+	for (unsigned int i = 0; i < mMaterialLookUp.size(); ++i)
+	{
+		SnapshotMaterial& snapshotMaterial = mSnapshot.mMaterials[i];
+		snapshotMaterial = SnapshotMaterial();
+		Material* material = mMaterialLookUp[i];
+		snapshotMaterial.mName = material->mName;
+		snapshotMaterial.mAmbient = material->mAmbient;
+		snapshotMaterial.mDiffuse = material->mDiffuse;
+		snapshotMaterial.mEmissive = material->mEmissive;
+		snapshotMaterial.mTransparencyFactor = material->mTransparencyFactor;
+		snapshotMaterial.mDiffuseMapName = material->mDiffuseMapName;
+		snapshotMaterial.mEmissiveMapName = material->mEmissiveMapName;
+		snapshotMaterial.mGlossMapName = material->mGlossMapName;
+		snapshotMaterial.mNormalMapName = material->mNormalMapName;
+		snapshotMaterial.mSpecularMapName = material->mSpecularMapName;
+
+		PhongMaterial* phong = dynamic_cast<PhongMaterial*>(material);
+		if (phong)
+		{
+			snapshotMaterial.mPhong = true;
+			snapshotMaterial.mSpecular = phong->mSpecular;
+			snapshotMaterial.mReflection = phong->mReflection;
+			snapshotMaterial.mSpecularPower = phong->mSpecularPower;
+			snapshotMaterial.mShininess = phong->mShininess;
+			snapshotMaterial.mReflectionFactor = phong->mReflectionFactor;
+		}
+	}
+
+	mSnapshot.mHasAnimation = mHasAnimation;
+	mSnapshot.mAnimationName = mAnimationName;
+	mSnapshot.mAnimationLength = mAnimationLength;
+	mSnapshot.mJoints.resize(mSkeleton.mJoints.size());
+	for (size_t i = 0; i < mSkeleton.mJoints.size(); ++i)
+	{
+		const Joint& joint = mSkeleton.mJoints[i];
+		SnapshotJoint& snapshotJoint = mSnapshot.mJoints[i];
+		snapshotJoint.mName = joint.mName;
+		snapshotJoint.mParentIndex = joint.mParentIndex;
+		for (int j = 0; j < 16; ++j)
+		{
+			snapshotJoint.mGlobalBindposeInverse[j] = joint.mGlobalBindposeInverse.Get(j / 4, j % 4);
+		}
+
+		snapshotJoint.mAnimation.clear();
+		for (Keyframe* keyframe = joint.mAnimation; keyframe; keyframe = keyframe->mNext)
+		{
+			SnapshotKeyframe snapshotKeyframe;
+			snapshotKeyframe.mFrameNum = keyframe->mFrameNum;
+			for (int j = 0; j < 16; ++j)
+			{
+				snapshotKeyframe.mGlobalTransform[j] = keyframe->mGlobalTransform.Get(j / 4, j % 4);
+			}
+			snapshotJoint.mAnimation.push_back(snapshotKeyframe);
+		}
+	}
+
+	ClearProcessedData();
+	mHasSnapshot = true;
+}
+
+// Copies the snapshot with SetKeepSnapshot, otherwise takes its data
+// over and drops it
+void FBXExporter::RestoreSnapshot()
+{
+	ClearProcessedData();
+
+	mInputFilePath = mSnapshot.mSourceFile;
+	mUVSetCount = mSnapshot.mUVSetCount;
+	mColorSetCount = mSnapshot.mColorSetCount;
+	mHasAnimation = mSnapshot.mHasAnimation;
+	mAnimationName = mSnapshot.mAnimationName;
+	mAnimationLength = mSnapshot.mAnimationLength;
+
+	if (mKeepSnapshot)
+	{
+		mVertices = mSnapshot.mVertices;
+	}
+	else
+	{
+		mVertices.swap(mSnapshot.mVertices);
+	}
+	mTriangleCount = static_cast<unsigned int>(mSnapshot.mMaterialIndices.size());
+	mTriangles.resize(mTriangleCount);
+	for (unsigned int i = 0; i < mTriangleCount; ++i)
+	{
+		mTriangles[i].mIndices.assign(mSnapshot.mIndices.begin() + i * 3, mSnapshot.mIndices.begin() + i * 3 + 3);
+		mTriangles[i].mMaterialIndex = mSnapshot.mMaterialIndices[i];
+	}
+
+	mMeshNodes.resize(mSnapshot.mNodes.size());
+	for (size_t i = 0; i < mSnapshot.mNodes.size(); ++i)
+	{
+		const SnapshotNode& snapshotNode = mSnapshot.mNodes[i];
+		MeshNode& node = mMeshNodes[i];
+		node.mName = snapshotNode.mName;
+		for (int j = 0; j < 16; ++j)
+		{
+			node.mGlobalTransform[j / 4][j % 4] = snapshotNode.mGlobalTransform[j];
+		}
+		node.mFirstTriangle = snapshotNode.mFirstTriangle;
+		node.mTriangleCount = snapshotNode.mTriangleCount;
+		node.mFirstVertex = snapshotNode.mFirstVertex;
+		node.mVertexCount = snapshotNode.mVertexCount;
+	}
+
+	for (unsigned int i = 0; i < mSnapshot.mMaterials.size(); ++i)
+	{
+		const SnapshotMaterial& snapshotMaterial = mSnapshot.mMaterials[i];
+		Material* material;
+		if (snapshotMaterial.mPhong)
+		{
+			PhongMaterial* phong = mArena.New<PhongMaterial>();
+			phong->mSpecular = snapshotMaterial.mSpecular;
+			phong->mReflection = snapshotMaterial.mReflection;
+			phong->mSpecularPower = snapshotMaterial.mSpecularPower;
+			phong->mShininess = snapshotMaterial.mShininess;
+			phong->mReflectionFactor = snapshotMaterial.mReflectionFactor;
+			material = phong;
+		}
+		else
+		{
+			material = mArena.New<LambertMaterial>();
+		}
+
+		material->mName = snapshotMaterial.mName;
+		material->mAmbient = snapshotMaterial.mAmbient;
+		material->mDiffuse = snapshotMaterial.mDiffuse;
+		material->mEmissive = snapshotMaterial.mEmissive;
+		material->mTransparencyFactor = snapshotMaterial.mTransparencyFactor;
+		material->mDiffuseMapName = snapshotMaterial.mDiffuseMapName;
+		material->mEmissiveMapName = snapshotMaterial.mEmissiveMapName;
+		material->mGlossMapName = snapshotMaterial.mGlossMapName;
+		material->mNormalMapName = snapshotMaterial.mNormalMapName;
+		material->mSpecularMapName = snapshotMaterial.mSpecularMapName;
+		// Resolved by OptimizeMaterials
+		material->mDiffuseMap_index = -1;
+		material->mEmissiveMap_index = -1;
+		material->mGlossMap_index = -1;
+		material->mNormalMap_index = -1;
+		material->mSpecularMap_index = -1;
+		mMaterialLookUp[i] = material;
+	}
+	AddDefaultMaterial();
+
+	mSkeleton.mJoints.resize(mSnapshot.mJoints.size());
+	for (size_t i = 0; i < mSnapshot.mJoints.size(); ++i)
+	{
+		const SnapshotJoint& snapshotJoint = mSnapshot.mJoints[i];
+		Joint& joint = mSkeleton.mJoints[i];
+		joint.mName = snapshotJoint.mName;
+		joint.mParentIndex = snapshotJoint.mParentIndex;
+		joint.mNode = nullptr;
+		for (int j = 0; j < 16; ++j)
+		{
+			joint.mGlobalBindposeInverse[j / 4][j % 4] = snapshotJoint.mGlobalBindposeInverse[j];
+		}
+
+		joint.mAnimation = nullptr;
+		Keyframe** next = &joint.mAnimation;
+		for (const SnapshotKeyframe& snapshotKeyframe : snapshotJoint.mAnimation)
+		{
+			Keyframe* keyframe = mArena.New<Keyframe>();
+			keyframe->mFrameNum = snapshotKeyframe.mFrameNum;
+			for (int j = 0; j < 16; ++j)
+			{
+				keyframe->mGlobalTransform[j / 4][j % 4] = snapshotKeyframe.mGlobalTransform[j];
+			}
+			*next = keyframe;
+			next = &keyframe->mNext;
+		}
+	}
+
+	if (!mKeepSnapshot)
+	{
+		mSnapshot.Clear();
+		mHasSnapshot = false;
+	}
+}
+
+bool FBXExporter::SaveSnapshot(const char* inPath)
+{
+	if (!mHasSnapshot)
+	{
+		if (!mSceneLoaded)
+		{
+			return false;
+		}
+		ClearProcessedData();
+		ExtractScene();
+		CaptureSnapshot();
+	}
+
+	return mSnapshot.Save(inPath, mSyncOutput);
+}
+
+bool FBXExporter::LoadSnapshot(const char* inPath)
+{
+	LARGE_INTEGER start;
+	LARGE_INTEGER end;
+
+	if (mSceneLoaded || mHasSnapshot)
+	{
+		Reset();
+	}
 
 	QueryPerformanceCounter(&start);
-	ProcessMaterials(mFBXScene->GetRootNode());
+	if (!mSnapshot.Load(inPath))
+	{
+		return false;
+	}
 	QueryPerformanceCounter(&end);
-	std::cout << "Processing Materials: " << ((end.QuadPart - start.QuadPart) / static_cast<float>(mCPUFreq.QuadPart)) << "s\n";
+	*mLog << "Loading Snapshot: " << ((end.QuadPart - start.QuadPart) / static_cast<float>(mCPUFreq.QuadPart)) << "s\n";
+
+	mHasSnapshot = true;
+	mInputFilePath = mSnapshot.mSourceFile;
+
+	return true;
+}
+
+void FBXExporter::ExportFBX()
+{
+	// Get the clean name of the model
+	std::string genericFileName = Utilities::GetFileName(mInputFilePath);
+	genericFileName = Utilities::RemoveSuffix(genericFileName);
+
+	*mLog << "\n\n\n\nExporting Model:" << genericFileName << "\n";
+	if (!RunStages(false))
+	{
+		return;
+	}
 	PrintMaterial();
 	
 
@@ -112,8 +620,7 @@ void FBXExporter::ExportFBX()
 		std::ofstream animOutput(outputNnimName);
 		WriteAnimationToStream(animOutput);
 	}
-	CleanupFbxManager();
-	std::cout << "\n\nExport Done!\n";
+	*mLog << "\n\nExport Done!\n";
 }
 
 void FBXExporter::ProcessGeometry(FbxNode* inNode)
@@ -123,14 +630,32 @@ void FBXExporter::ProcessGeometry(FbxNode* inNode)
 		switch (inNode->GetNodeAttribute()->GetAttributeType())
 		{
 		case FbxNodeAttribute::eMesh:
-			ProcessControlPoints(inNode);
+			if (mImportStages.mMesh || mHasAnimation)
+			{
+				ProcessControlPoints(inNode);
+			}
 			if(mHasAnimation)
 			{
 				ProcessJointsAndAnimations(inNode);
 			}
-			ProcessMesh(inNode);
-			AssociateMaterialToMesh(inNode);
-			ProcessMaterials(inNode);
+			if (mImportStages.mMesh)
+			{
+				ProcessMesh(inNode);
+			}
+			else
+			{
+				mControlPoints.clear();
+			}
+			// Materials first, so the node's material slots can be
+			// translated to global material indices
+			if (mImportStages.mMaterials)
+			{
+				ProcessMaterials(inNode);
+				if (mImportStages.mMesh)
+				{
+					AssociateMaterialToMesh(inNode);
+				}
+			}
 			break;
 		}
 	}
@@ -141,6 +666,21 @@ void FBXExporter::ProcessGeometry(FbxNode* inNode)
 	}
 }
 
+// Polygons of all the meshes below inNode, triangles once triangulated
+unsigned int FBXExporter::CountPolygons(FbxNode* inNode)
+{
+	unsigned int count = 0;
+	if (inNode->GetNodeAttribute() && inNode->GetNodeAttribute()->GetAttributeType() == FbxNodeAttribute::eMesh)
+	{
+		count += inNode->GetMesh()->GetPolygonCount();
+	}
+	for (int i = 0; i < inNode->GetChildCount(); ++i)
+	{
+		count += CountPolygons(inNode->GetChild(i));
+	}
+	return count;
+}
+
 void FBXExporter::ProcessSkeletonHierarchy(FbxNode* inRootNode)
 {
 
@@ -172,7 +712,7 @@ void FBXExporter::ProcessControlPoints(FbxNode* inNode)
 	unsigned int ctrlPointCount = currMesh->GetControlPointsCount();
 	for(unsigned int i = 0; i < ctrlPointCount; ++i)
 	{
-		CtrlPoint* currCtrlPoint = new CtrlPoint();
+		CtrlPoint* currCtrlPoint = mArena.New<CtrlPoint>();
 		XMFLOAT3 currPosition;
 		currPosition.x = static_cast<float>(currMesh->GetControlPointAt(i).mData[0]);
 		currPosition.y = static_cast<float>(currMesh->GetControlPointAt(i).mData[1]);
@@ -220,9 +760,17 @@ void FBXExporter::ProcessJointsAndAnimations(FbxNode* inNode)
 			currCluster->GetTransformLinkMatrix(transformLinkMatrix);	// The transformation of the cluster(joint) at binding time from joint space to world space
 			globalBindposeInverseMatrix = transformLinkMatrix.Inverse() * transformMatrix * geometryTransform;
 
-			// Update the information in mSkeleton 
-			mSkeleton.mJoints[currJointIndex].mGlobalBindposeInverse = globalBindposeInverseMatrix;
-			mSkeleton.mJoints[currJointIndex].mNode = currCluster->GetLink();
+			// Update the information in mSkeleton
+			// A joint can skin several meshes. Its bind pose and keyframes
+			// are both relative to the first one, the others are expected
+			// to share its transform (usually all of them sit at the
+			// skeleton's origin)
+			const bool firstBinding = mSkeleton.mJoints[currJointIndex].mNode == nullptr;
+			if (firstBinding)
+			{
+				mSkeleton.mJoints[currJointIndex].mGlobalBindposeInverse = globalBindposeInverseMatrix;
+				mSkeleton.mJoints[currJointIndex].mNode = currCluster->GetLink();
+			}
 
 			// Associate each joint with the control points it affects
 			unsigned int numOfIndices = currCluster->GetControlPointIndicesCount();
@@ -234,6 +782,11 @@ void FBXExporter::ProcessJointsAndAnimations(FbxNode* inNode)
 				mControlPoints[currCluster->GetControlPointIndices()[i]]->mBlendingInfo.push_back(currBlendingIndexWeightPair);
 			}
 
+			if (!mImportStages.mAnimation || !firstBinding)
+			{
+				continue;
+			}
+
 			// Get animation information
 			// Now only supports one take
 			FbxAnimStack* currAnimStack = mFBXScene->GetSrcObject<FbxAnimStack>(0);
@@ -249,7 +802,7 @@ void FBXExporter::ProcessJointsAndAnimations(FbxNode* inNode)
 			{
 				FbxTime currTime;
 				currTime.SetFrame(i, FbxTime::eFrames24);
-				*currAnim = new Keyframe();
+				*currAnim = mArena.New<Keyframe>();
 				(*currAnim)->mFrameNum = i;
 				FbxAMatrix currentTransformOffset = inNode->EvaluateGlobalTransform(currTime) * geometryTransform;
 				(*currAnim)->mGlobalTransform = currentTransformOffset.Inverse() * currCluster->GetLink()->EvaluateGlobalTransform(currTime);
@@ -258,20 +811,8 @@ void FBXExporter::ProcessJointsAndAnimations(FbxNode* inNode)
 		}
 	}
 
-	// Some of the control points only have less than 4 joints
-	// affecting them.
-	// For a normal renderer, there are usually 4 joints
-	// I am adding more dummy joints if there isn't enough
-	BlendingIndexWeightPair currBlendingIndexWeightPair;
-	currBlendingIndexWeightPair.mBlendingIndex = 0;
-	currBlendingIndexWeightPair.mBlendingWeight = 0;
-	for(auto itr = mControlPoints.begin(); itr != mControlPoints.end(); ++itr)
-	{
-		for(unsigned int i = itr->second->mBlendingInfo.size(); i <= 4; ++i)
-		{
-			itr->second->mBlendingInfo.push_back(currBlendingIndexWeightPair);
-		}
-	}
+	// The control points keep all their influences, ProcessSkinWeights
+	// selects, prunes and pads them on the vertices
 }
 
 unsigned int FBXExporter::FindJointIndexUsingName(const std::string& inJointName)
@@ -292,17 +833,25 @@ void FBXExporter::ProcessMesh(FbxNode* inNode)
 {
 	FbxMesh* currMesh = inNode->GetMesh();
 
-	mTriangleCount = currMesh->GetPolygonCount();
+	MeshNode currNode;
+	currNode.mName = inNode->GetName();
+	currNode.mGlobalTransform = inNode->EvaluateGlobalTransform() * Utilities::GetGeometryTransformation(inNode);
+	currNode.mFirstTriangle = mTriangles.size();
+	currNode.mTriangleCount = currMesh->GetPolygonCount();
+	currNode.mFirstVertex = mVertices.size();
+	currNode.mVertexCount = currNode.mTriangleCount * 3;
+	mMeshNodes.push_back(currNode);
+
+	mTriangleCount += currNode.mTriangleCount;
 	int vertexCounter = 0;
-	mTriangles.reserve(mTriangleCount);
 
-	for (unsigned int i = 0; i < mTriangleCount; ++i)
+	for (unsigned int i = 0; i < currNode.mTriangleCount; ++i)
 	{
 		XMFLOAT3 normal[3];
 		XMFLOAT3 tangent[3];
 		XMFLOAT3 binormal[3];
-		XMFLOAT2 UV[3][2];
 		Triangle currTriangle;
+		currTriangle.mMaterialIndex = 0;
 		mTriangles.push_back(currTriangle);
 
 		for (unsigned int j = 0; j < 3; ++j)
@@ -312,17 +861,20 @@ void FBXExporter::ProcessMesh(FbxNode* inNode)
 
 
 			ReadNormal(currMesh, ctrlPointIndex, vertexCounter, normal[j]);
-			// We only have diffuse texture
-			for (int k = 0; k < 1; ++k)
-			{
-				ReadUV(currMesh, ctrlPointIndex, currMesh->GetTextureUVIndex(i, j), k, UV[j][k]);
-			}
-
 
 			PNTIWVertex temp;
 			temp.mPosition = currCtrlPoint->mPosition;
 			temp.mNormal = normal[j];
-			temp.mUV = UV[j][0];
+
+			// Sets the mesh does not have are left as zero
+			for (int k = 0; k < static_cast<int>(mUVSetCount) && k < currMesh->GetElementUVCount(); ++k)
+			{
+				ReadUV(currMesh, ctrlPointIndex, vertexCounter, k, temp.mUV[k]);
+			}
+			for (int k = 0; k < static_cast<int>(mColorSetCount) && k < currMesh->GetElementVertexColorCount(); ++k)
+			{
+				ReadColor(currMesh, ctrlPointIndex, vertexCounter, k, temp.mColor[k]);
+			}
 			// Copy the blending info from each control point
 			for(unsigned int i = 0; i < currCtrlPoint->mBlendingInfo.size(); ++i)
 			{
@@ -336,23 +888,19 @@ void FBXExporter::ProcessMesh(FbxNode* inNode)
 			temp.SortBlendingInfoByWeight();
 
 			mVertices.push_back(temp);
-			mTriangles.back().mIndices.push_back(vertexCounter);
+			mTriangles.back().mIndices.push_back(currNode.mFirstVertex + vertexCounter);
 			++vertexCounter;
 		}
 	}
 
 	// Now mControlPoints has served its purpose
-	// We can free its memory
-	for(auto itr = mControlPoints.begin(); itr != mControlPoints.end(); ++itr)
-	{
-		delete itr->second;
-	}
+	// The control points themselves are released with the scene arena
 	mControlPoints.clear();
 }
 
-void FBXExporter::ReadUV(FbxMesh* inMesh, int inCtrlPointIndex, int inTextureUVIndex, int inUVLayer, XMFLOAT2& outUV)
+void FBXExporter::ReadUV(FbxMesh* inMesh, int inCtrlPointIndex, int inVertexCounter, int inUVLayer, XMFLOAT2& outUV)
 {
-	if(inUVLayer >= 2 || inMesh->GetElementUVCount() <= inUVLayer)
+	if(inUVLayer >= static_cast<int>(MAX_UV_SETS) || inMesh->GetElementUVCount() <= inUVLayer)
 	{
 		throw std::exception("Invalid UV Layer Number");
 	}
@@ -383,14 +931,23 @@ void FBXExporter::ReadUV(FbxMesh* inMesh, int inCtrlPointIndex, int inTextureUVI
 		}
 		break;
 
+	// Every set has its own index array, GetTextureUVIndex only
+	// returns the one of the first set
 	case FbxGeometryElement::eByPolygonVertex:
 		switch(vertexUV->GetReferenceMode())
 		{
 		case FbxGeometryElement::eDirect:
+		{
+			outUV.x = static_cast<float>(vertexUV->GetDirectArray().GetAt(inVertexCounter).mData[0]);
+			outUV.y = static_cast<float>(vertexUV->GetDirectArray().GetAt(inVertexCounter).mData[1]);
+		}
+		break;
+
 		case FbxGeometryElement::eIndexToDirect:
 		{
-			outUV.x = static_cast<float>(vertexUV->GetDirectArray().GetAt(inTextureUVIndex).mData[0]);
-			outUV.y = static_cast<float>(vertexUV->GetDirectArray().GetAt(inTextureUVIndex).mData[1]);
+			int index = vertexUV->GetIndexArray().GetAt(inVertexCounter);
+			outUV.x = static_cast<float>(vertexUV->GetDirectArray().GetAt(index).mData[0]);
+			outUV.y = static_cast<float>(vertexUV->GetDirectArray().GetAt(index).mData[1]);
 		}
 		break;
 
@@ -401,6 +958,59 @@ void FBXExporter::ReadUV(FbxMesh* inMesh, int inCtrlPointIndex, int inTextureUVI
 	}
 }
 
+void FBXExporter::ReadColor(FbxMesh* inMesh, int inCtrlPointIndex, int inVertexCounter, int inColorLayer, XMFLOAT4& outColor)
+{
+	if(inColorLayer >= static_cast<int>(MAX_COLOR_SETS) || inMesh->GetElementVertexColorCount() <= inColorLayer)
+	{
+		throw std::exception("Invalid Vertex Color Layer Number");
+	}
+	FbxGeometryElementVertexColor* vertexColor = inMesh->GetElementVertexColor(inColorLayer);
+	FbxColor color;
+
+	switch(vertexColor->GetMappingMode())
+	{
+	case FbxGeometryElement::eByControlPoint:
+		switch(vertexColor->GetReferenceMode())
+		{
+		case FbxGeometryElement::eDirect:
+			color = vertexColor->GetDirectArray().GetAt(inCtrlPointIndex);
+			break;
+
+		case FbxGeometryElement::eIndexToDirect:
+			color = vertexColor->GetDirectArray().GetAt(vertexColor->GetIndexArray().GetAt(inCtrlPointIndex));
+			break;
+
+		default:
+			throw std::exception("Invalid Reference");
+		}
+		break;
+
+	case FbxGeometryElement::eByPolygonVertex:
+		switch(vertexColor->GetReferenceMode())
+		{
+		case FbxGeometryElement::eDirect:
+			color = vertexColor->GetDirectArray().GetAt(inVertexCounter);
+			break;
+
+		case FbxGeometryElement::eIndexToDirect:
+			color = vertexColor->GetDirectArray().GetAt(vertexColor->GetIndexArray().GetAt(inVertexCounter));
+			break;
+
+		default:
+			throw std::exception("Invalid Reference");
+		}
+		break;
+
+	default:
+		throw std::exception("Invalid mapping mode for vertex color");
+	}
+
+	outColor.x = static_cast<float>(color.mRed);
+	outColor.y = static_cast<float>(color.mGreen);
+	outColor.z = static_cast<float>(color.mBlue);
+	outColor.w = static_cast<float>(color.mAlpha);
+}
+
 void FBXExporter::ReadNormal(FbxMesh* inMesh, int inCtrlPointIndex, int inVertexCounter, XMFLOAT3& outNormal)
 {
 	if(inMesh->GetElementNormalCount() < 1)
@@ -587,102 +1197,642 @@ void FBXExporter::ReadTangent(FbxMesh* inMesh, int inCtrlPointIndex, int inVerte
 	}
 }
 
+// Drops the triangles and vertices of every node that is a copy of an
+// earlier node, so the later stages only process one of them
+void FBXExporter::DetectInstances()
+{
+	std::vector<unsigned int> indices;
+	std::vector<unsigned int> materials;
+	indices.reserve(mTriangles.size() * 3);
+	materials.reserve(mTriangles.size());
+	for(unsigned int i = 0; i < mTriangles.size(); ++i)
+	{
+		indices.insert(indices.end(), mTriangles[i].mIndices.begin(), mTriangles[i].mIndices.begin() + 3);
+		materials.push_back(mTriangles[i].mMaterialIndex);
+	}
+
+	std::unordered_multimap<unsigned long long, unsigned int> nodesByHash;
+	std::vector<unsigned int> newFirstTriangles(mMeshNodes.size(), 0);
+	std::vector<unsigned int> newFirstVertices(mMeshNodes.size(), 0);
+	std::vector<Triangle> uniqueTriangles;
+	std::vector<PNTIWVertex> uniqueVertices;
+	uniqueTriangles.reserve(mTriangles.size());
+	uniqueVertices.reserve(mVertices.size());
+	for(unsigned int nodeIndex = 0; nodeIndex < mMeshNodes.size(); ++nodeIndex)
+	{
+		MeshNode& currNode = mMeshNodes[nodeIndex];
+		const unsigned int* nodeIndices = currNode.mTriangleCount > 0 ? &indices[currNode.mFirstTriangle * 3] : nullptr;
+		const unsigned int* nodeMaterials = currNode.mTriangleCount > 0 ? &materials[currNode.mFirstTriangle] : nullptr;
+		unsigned long long hash = MeshInstancer::Hash(mVertices, nodeIndices, nodeMaterials, currNode.mTriangleCount);
+
+		auto candidates = nodesByHash.equal_range(hash);
+		for(auto itr = candidates.first; itr != candidates.second && currNode.mTriangleCount > 0; ++itr)
+		{
+			const MeshNode& sourceNode = mMeshNodes[itr->second];
+			if(sourceNode.mTriangleCount == currNode.mTriangleCount &&
+				MeshInstancer::SameGeometry(mVertices, &indices[sourceNode.mFirstTriangle * 3], &materials[sourceNode.mFirstTriangle], nodeIndices, nodeMaterials, currNode.mTriangleCount))
+			{
+				currNode.mInstanceOf = itr->second;
+				break;
+			}
+		}
+		if(currNode.mInstanceOf >= 0)
+		{
+			continue;
+		}
+
+		unsigned int firstTriangle = uniqueTriangles.size();
+		unsigned int firstVertex = uniqueVertices.size();
+		uniqueTriangles.insert(uniqueTriangles.end(), mTriangles.begin() + currNode.mFirstTriangle, mTriangles.begin() + currNode.mFirstTriangle + currNode.mTriangleCount);
+		uniqueVertices.insert(uniqueVertices.end(), mVertices.begin() + currNode.mFirstVertex, mVertices.begin() + currNode.mFirstVertex + currNode.mVertexCount);
+		for(unsigned int i = firstTriangle; i < uniqueTriangles.size(); ++i)
+		{
+			for(unsigned int j = 0; j < 3; ++j)
+			{
+				uniqueTriangles[i].mIndices[j] = uniqueTriangles[i].mIndices[j] - currNode.mFirstVertex + firstVertex;
+			}
+		}
+		nodesByHash.insert(std::make_pair(hash, nodeIndex));
+		// The comparisons need the old ranges until all nodes are done
+		newFirstTriangles[nodeIndex] = firstTriangle;
+		newFirstVertices[nodeIndex] = firstVertex;
+	}
+
+	for(unsigned int nodeIndex = 0; nodeIndex < mMeshNodes.size(); ++nodeIndex)
+	{
+		MeshNode& currNode = mMeshNodes[nodeIndex];
+		if(currNode.mInstanceOf < 0)
+		{
+			currNode.mFirstTriangle = newFirstTriangles[nodeIndex];
+			currNode.mFirstVertex = newFirstVertices[nodeIndex];
+		}
+	}
+	mTriangles.swap(uniqueTriangles);
+	mVertices.swap(uniqueVertices);
+	mTriangleCount = mTriangles.size();
+}
+
 // This function removes the duplicated vertices and
 // adjust the index buffer properly
-// This function should take a while, though........
+// Vertices are only welded within their node so that every
+// node keeps its own contiguous vertex range
 void FBXExporter::Optimize()
 {
-	// First get a list of unique vertices
 	std::vector<PNTIWVertex> uniqueVertices;
-	for(unsigned int i = 0; i < mTriangles.size(); ++i)
+	uniqueVertices.reserve(mVertices.size());
+	std::vector<unsigned int> nodeIndices;
+	for(unsigned int nodeIndex = 0; nodeIndex < mMeshNodes.size(); ++nodeIndex)
 	{
-		for(unsigned int j = 0; j < 3; ++j)
+		MeshNode& currNode = mMeshNodes[nodeIndex];
+		// Instances point at the (earlier) node they copy
+		if(currNode.mInstanceOf >= 0)
+		{
+			const MeshNode& sourceNode = mMeshNodes[currNode.mInstanceOf];
+			currNode.mFirstTriangle = sourceNode.mFirstTriangle;
+			currNode.mTriangleCount = sourceNode.mTriangleCount;
+			currNode.mFirstVertex = sourceNode.mFirstVertex;
+			currNode.mVertexCount = sourceNode.mVertexCount;
+			continue;
+		}
+
+		unsigned int firstVertex = uniqueVertices.size();
+		unsigned int endTriangle = currNode.mFirstTriangle + currNode.mTriangleCount;
+
+		nodeIndices.clear();
+		for(unsigned int i = currNode.mFirstTriangle; i < endTriangle; ++i)
+		{
+			nodeIndices.insert(nodeIndices.end(), mTriangles[i].mIndices.begin(), mTriangles[i].mIndices.end());
+		}
+		if(!nodeIndices.empty())
 		{
-			// If current vertex has not been added to
-			// our unique vertex list, then we add it
-			if(FindVertex(mVertices[i * 3 + j], uniqueVertices) == -1)
+			MeshWelder::Weld(mVertices, &nodeIndices[0], nodeIndices.size(), uniqueVertices);
+		}
+		for(unsigned int i = currNode.mFirstTriangle; i < endTriangle; ++i)
+		{
+			std::copy(nodeIndices.begin() + (i - currNode.mFirstTriangle) * 3, nodeIndices.begin() + (i - currNode.mFirstTriangle + 1) * 3, mTriangles[i].mIndices.begin());
+		}
+
+		currNode.mFirstVertex = firstVertex;
+		currNode.mVertexCount = uniqueVertices.size() - firstVertex;
+
+		// Now we sort the node's triangles by materials to reduce 
+		// shader's workload
+		std::sort(mTriangles.begin() + currNode.mFirstTriangle, mTriangles.begin() + endTriangle);
+		BuildDrawRanges(nodeIndex);
+	}
+
+	mVertices.swap(uniqueVertices);
+}
+
+// Before instancing and welding, so they compare the final influences
+void FBXExporter::ProcessSkinWeights()
+{
+	SkinWeights::Process(mVertices, mMinSkinWeight);
+}
+
+// Local keys of the converted keyframes, for the .static_anim file
+void FBXExporter::BakeLocalAnimation()
+{
+	AnimationBaker::Bake(mSkeleton, mLocalAnimation);
+}
+
+// Splits every draw range into partitions with bounded bone palettes
+// and lays the vertices out again, each partition's vertices after
+// each other. A vertex used by several partitions is duplicated, as
+// its blend indices become positions in its partition's palette
+// Skinned scenes are neither instanced nor batched, so every node owns
+// its ranges
+void FBXExporter::PartitionBones()
+{
+	std::vector<Triangle> partitionedTriangles;
+	partitionedTriangles.reserve(mTriangles.size());
+	std::vector<PNTIWVertex> partitionedVertices;
+	partitionedVertices.reserve(mVertices.size());
+	std::vector<DrawRange> partitionedRanges;
+	mBonePalettes.clear();
+	mPaletteJoints.clear();
+
+	// New index of a vertex in the current partition, valid if
+	// vertexOwner matches it
+	std::vector<unsigned int> vertexMap(mVertices.size());
+	std::vector<unsigned int> vertexOwner(mVertices.size(), UINT_MAX);
+	std::vector<unsigned int> localJoints(mSkeleton.mJoints.size(), 0);
+	std::vector<unsigned int> rangeIndices;
+	std::vector<BonePartition> partitions;
+
+	unsigned int rangeIndex = 0;
+	for(unsigned int nodeIndex = 0; nodeIndex < mMeshNodes.size(); ++nodeIndex)
+	{
+		MeshNode& currNode = mMeshNodes[nodeIndex];
+		const unsigned int firstVertex = partitionedVertices.size();
+		for(; rangeIndex < mDrawRanges.size() && mDrawRanges[rangeIndex].mNodeIndex == nodeIndex; ++rangeIndex)
+		{
+			const DrawRange& baseRange = mDrawRanges[rangeIndex];
+			rangeIndices.clear();
+			for(unsigned int i = baseRange.mFirstTriangle; i < baseRange.mFirstTriangle + baseRange.mTriangleCount; ++i)
 			{
-				uniqueVertices.push_back(mVertices[i * 3 + j]);
+				rangeIndices.insert(rangeIndices.end(), mTriangles[i].mIndices.begin(), mTriangles[i].mIndices.end());
+			}
+			BonePartitioner::Partition(mVertices, rangeIndices, mBonePaletteSize, partitions);
+
+			for(unsigned int p = 0; p < partitions.size(); ++p)
+			{
+				const BonePartition& currPartition = partitions[p];
+				const unsigned int paletteIndex = mBonePalettes.size();
+				BonePalette currPalette;
+				currPalette.mFirstJoint = mPaletteJoints.size();
+				currPalette.mJointCount = currPartition.mJoints.size();
+				mBonePalettes.push_back(currPalette);
+				for(unsigned int j = 0; j < currPartition.mJoints.size(); ++j)
+				{
+					localJoints[currPartition.mJoints[j]] = j;
+					mPaletteJoints.push_back(currPartition.mJoints[j]);
+				}
+
+				DrawRange currRange = baseRange;
+				currRange.mFirstTriangle = partitionedTriangles.size();
+				currRange.mTriangleCount = currPartition.mTriangles.size();
+				currRange.mFirstVertex = partitionedVertices.size();
+				for(unsigned int t = 0; t < currPartition.mTriangles.size(); ++t)
+				{
+					Triangle& currTriangle = mTriangles[baseRange.mFirstTriangle + currPartition.mTriangles[t]];
+					for(unsigned int j = 0; j < 3; ++j)
+					{
+						unsigned int vertex = currTriangle.mIndices[j];
+						if(vertexOwner[vertex] != paletteIndex)
+						{
+							vertexOwner[vertex] = paletteIndex;
+							vertexMap[vertex] = partitionedVertices.size();
+							partitionedVertices.push_back(mVertices[vertex]);
+
+							// Only the written influences are kept
+							PNTIWVertex& newVertex = partitionedVertices.back();
+							const unsigned int influenceCount = BonePartitioner::GetInfluenceCount(newVertex);
+							newVertex.mVertexBlendingInfos.resize(MAX_INFLUENCES);
+							for(unsigned int k = 0; k < MAX_INFLUENCES; ++k)
+							{
+								VertexBlendingInfo& currInfo = newVertex.mVertexBlendingInfos[k];
+								currInfo.mBlendingIndex = k < influenceCount ? localJoints[currInfo.mBlendingIndex] : 0;
+								if(k >= influenceCount)
+								{
+									currInfo.mBlendingWeight = 0.0;
+								}
+							}
+						}
+						currTriangle.mIndices[j] = vertexMap[vertex];
+					}
+					partitionedTriangles.push_back(std::move(currTriangle));
+				}
+				currRange.mVertexCount = partitionedVertices.size() - currRange.mFirstVertex;
+				partitionedRanges.push_back(currRange);
 			}
 		}
+
+		// Triangles keep their node, only their order within it changes
+		currNode.mFirstVertex = firstVertex;
+		currNode.mVertexCount = partitionedVertices.size() - firstVertex;
 	}
 
-	// Now we update the index buffer
-	for(unsigned int i = 0; i < mTriangles.size(); ++i)
+	mTriangles.swap(partitionedTriangles);
+	mVertices.swap(partitionedVertices);
+	mDrawRanges.swap(partitionedRanges);
+}
+
+// Runs once per processing, before anything derives bounds, LODs or
+// meshlets from the geometry, so the writers need no conversion
+void FBXExporter::ConvertCoordinates()
+{
+	if(mCoordinateConverter.IsIdentity())
 	{
-		for(unsigned int j = 0; j < 3; ++j)
+		return;
+	}
+
+	const unsigned int vertexCount = mVertices.size();
+	if(vertexCount > 0)
+	{
+		const unsigned int stride = sizeof(PNTIWVertex);
+		mCoordinateConverter.ConvertPositions(&mVertices[0].mPosition, stride, vertexCount);
+		mCoordinateConverter.ConvertNormals(&mVertices[0].mNormal, stride, vertexCount);
+		for(unsigned int k = 0; k < mUVSetCount; ++k)
 		{
-			mTriangles[i].mIndices[j] = FindVertex(mVertices[i * 3 + j], uniqueVertices);
+			mCoordinateConverter.ConvertUVs(&mVertices[0].mUV[k], stride, vertexCount);
 		}
 	}
-	
-	mVertices.clear();
-	mVertices = uniqueVertices;
-	uniqueVertices.clear();
 
-	// Now we sort the triangles by materials to reduce 
-	// shader's workload
-	std::sort(mTriangles.begin(), mTriangles.end());
+	if(mCoordinateConverter.FlipsWinding())
+	{
+		for(unsigned int i = 0; i < mTriangleCount; ++i)
+		{
+			std::swap(mTriangles[i].mIndices[1], mTriangles[i].mIndices[2]);
+		}
+	}
+
+	for(unsigned int i = 0; i < mMeshNodes.size(); ++i)
+	{
+		mCoordinateConverter.ConvertTransform(mMeshNodes[i].mGlobalTransform);
+	}
+
+	for(unsigned int i = 0; i < mSkeleton.mJoints.size(); ++i)
+	{
+		mCoordinateConverter.ConvertTransform(mSkeleton.mJoints[i].mGlobalBindposeInverse);
+		for(Keyframe* walker = mSkeleton.mJoints[i].mAnimation; walker; walker = walker->mNext)
+		{
+			mCoordinateConverter.ConvertTransform(walker->mGlobalTransform);
+		}
+	}
 }
 
-int FBXExporter::FindVertex(const PNTIWVertex& inTargetVertex, const std::vector<PNTIWVertex>& uniqueVertices)
+// Splits the (material sorted) triangles of a node into
+// one draw range per material
+void FBXExporter::BuildDrawRanges(unsigned int inNodeIndex)
 {
-	for(unsigned int i = 0; i < uniqueVertices.size(); ++i)
+	const MeshNode& currNode = mMeshNodes[inNodeIndex];
+	unsigned int endTriangle = currNode.mFirstTriangle + currNode.mTriangleCount;
+
+	for(unsigned int i = currNode.mFirstTriangle; i < endTriangle; ++i)
 	{
-		if(inTargetVertex == uniqueVertices[i])
+		if(i == currNode.mFirstTriangle || mTriangles[i].mMaterialIndex != mDrawRanges.back().mMaterialIndex)
 		{
-			return i;
+			DrawRange currRange;
+			currRange.mNodeIndex = inNodeIndex;
+			currRange.mMaterialIndex = mTriangles[i].mMaterialIndex;
+			currRange.mFirstTriangle = i;
+			currRange.mTriangleCount = 0;
+			currRange.mFirstVertex = mTriangles[i].mIndices[0];
+			currRange.mVertexCount = 0;
+			mDrawRanges.push_back(currRange);
+		}
+
+		// mVertexCount holds the last used vertex until the range is done
+		DrawRange& currRange = mDrawRanges.back();
+		++currRange.mTriangleCount;
+		for(unsigned int j = 0; j < 3; ++j)
+		{
+			currRange.mFirstVertex = std::min(currRange.mFirstVertex, mTriangles[i].mIndices[j]);
+			currRange.mVertexCount = std::max(currRange.mVertexCount, mTriangles[i].mIndices[j]);
+		}
+
+		if(i + 1 == endTriangle || mTriangles[i + 1].mMaterialIndex != currRange.mMaterialIndex)
+		{
+			currRange.mVertexCount = currRange.mVertexCount - currRange.mFirstVertex + 1;
 		}
 	}
+}
 
-	return -1;
+// Moves the vertices of a node into scene space
+// Normals use the cofactor matrix of the node transform, which
+// is the inverse transpose up to a (positive) scale
+void FBXExporter::BakeNodeTransform(const MeshNode& inNode)
+{
+	double m[4][3];
+	for(int r = 0; r < 4; ++r)
+	{
+		for(int c = 0; c < 3; ++c)
+		{
+			m[r][c] = inNode.mGlobalTransform.Get(r, c);
+		}
+	}
+
+	double cofactor[3][3];
+	for(int r = 0; r < 3; ++r)
+	{
+		for(int c = 0; c < 3; ++c)
+		{
+			cofactor[r][c] = m[(r + 1) % 3][(c + 1) % 3] * m[(r + 2) % 3][(c + 2) % 3] -
+				m[(r + 1) % 3][(c + 2) % 3] * m[(r + 2) % 3][(c + 1) % 3];
+		}
+	}
+	double determinant = m[0][0] * cofactor[0][0] + m[0][1] * cofactor[0][1] + m[0][2] * cofactor[0][2];
+	double normalSign = determinant < 0.0 ? -1.0 : 1.0;
+
+	for(unsigned int i = inNode.mFirstVertex; i < inNode.mFirstVertex + inNode.mVertexCount; ++i)
+	{
+		double p[3] = { mVertices[i].mPosition.x, mVertices[i].mPosition.y, mVertices[i].mPosition.z };
+		double n[3] = { mVertices[i].mNormal.x, mVertices[i].mNormal.y, mVertices[i].mNormal.z };
+		double outP[3];
+		double outN[3];
+		for(int c = 0; c < 3; ++c)
+		{
+			outP[c] = p[0] * m[0][c] + p[1] * m[1][c] + p[2] * m[2][c] + m[3][c];
+			outN[c] = (n[0] * cofactor[0][c] + n[1] * cofactor[1][c] + n[2] * cofactor[2][c]) * normalSign;
+		}
+		double length = sqrt(outN[0] * outN[0] + outN[1] * outN[1] + outN[2] * outN[2]);
+		if(length > 0.0)
+		{
+			outN[0] /= length;
+			outN[1] /= length;
+			outN[2] /= length;
+		}
+		mVertices[i].mPosition = XMFLOAT3(static_cast<float>(outP[0]), static_cast<float>(outP[1]), static_cast<float>(outP[2]));
+		mVertices[i].mNormal = XMFLOAT3(static_cast<float>(outN[0]), static_cast<float>(outN[1]), static_cast<float>(outN[2]));
+	}
+
+	// A mirroring transform turns the triangles inside out
+	if(determinant < 0.0)
+	{
+		for(unsigned int i = inNode.mFirstTriangle; i < inNode.mFirstTriangle + inNode.mTriangleCount; ++i)
+		{
+			std::swap(mTriangles[i].mIndices[1], mTriangles[i].mIndices[2]);
+		}
+	}
 }
 
-/*
-void FBXExporter::ReduceVertices()
+// Turns the welded per node data into one batch per material:
+// transforms are baked, all triangles are grouped by material and
+// every batch gets its own contiguous vertex range
+// Vertices used by several materials are duplicated into each batch
+void FBXExporter::BatchStaticGeometry()
 {
-	CleanupFbxManager();
-	std::vector<Vertex::PNTVertex> newVertices;
-	for (unsigned int i = 0; i < mVertices.size(); ++i)
+	for(unsigned int i = 0; i < mMeshNodes.size(); ++i)
 	{
-		int index = FindVertex(mVertices[i], newVertices);
-		if (index == -1)
+		BakeNodeTransform(mMeshNodes[i]);
+	}
+
+	// Stable, so that each batch keeps the node order
+	std::stable_sort(mTriangles.begin(), mTriangles.end());
+
+	const unsigned int maxBatchVertices = mSplitBatchesAt64k ? 65536 : UINT_MAX;
+	std::vector<PNTIWVertex> batchedVertices;
+	batchedVertices.reserve(mVertices.size());
+	// remap[i] is the batched index of vertex i, valid if remapBatch[i]
+	// is the current batch
+	std::vector<unsigned int> remap(mVertices.size());
+	std::vector<unsigned int> remapBatch(mVertices.size(), UINT_MAX);
+	mDrawRanges.clear();
+
+	for(unsigned int i = 0; i < mTriangles.size(); ++i)
+	{
+		unsigned int currBatch = mDrawRanges.size() - 1;
+		unsigned int newVertices = 0;
+		for(unsigned int j = 0; j < 3; ++j)
 		{
-			mIndexBuffer[i] = newVertices.size();
-			newVertices.push_back(mVertices[i]);
+			if(mDrawRanges.empty() || remapBatch[mTriangles[i].mIndices[j]] != currBatch)
+			{
+				++newVertices;
+			}
 		}
-		else
+
+		if(mDrawRanges.empty() ||
+			mTriangles[i].mMaterialIndex != mDrawRanges.back().mMaterialIndex ||
+			mDrawRanges.back().mVertexCount + newVertices > maxBatchVertices)
+		{
+			DrawRange currRange;
+			currRange.mNodeIndex = 0;
+			currRange.mMaterialIndex = mTriangles[i].mMaterialIndex;
+			currRange.mFirstTriangle = i;
+			currRange.mTriangleCount = 0;
+			currRange.mFirstVertex = batchedVertices.size();
+			currRange.mVertexCount = 0;
+			mDrawRanges.push_back(currRange);
+			currBatch = mDrawRanges.size() - 1;
+		}
+
+		DrawRange& currRange = mDrawRanges.back();
+		for(unsigned int j = 0; j < 3; ++j)
 		{
-			mIndexBuffer[i] = index;
+			unsigned int index = mTriangles[i].mIndices[j];
+			if(remapBatch[index] != currBatch)
+			{
+				remapBatch[index] = currBatch;
+				remap[index] = batchedVertices.size();
+				batchedVertices.push_back(mVertices[index]);
+				++currRange.mVertexCount;
+			}
+			mTriangles[i].mIndices[j] = remap[index];
 		}
+		++currRange.mTriangleCount;
 	}
 
-	mVertices = newVertices;
+	mVertices.swap(batchedVertices);
+
+	// The whole scene is now a single node in scene space
+	MeshNode batchNode;
+	batchNode.mName = "StaticBatch";
+	batchNode.mTriangleCount = mTriangles.size();
+	batchNode.mVertexCount = mVertices.size();
+	mMeshNodes.clear();
+	mMeshNodes.push_back(batchNode);
+}
+
+// Every level is simplified from the full resolution mesh, so the
+// levels are independent and are spread over the worker threads
+void FBXExporter::GenerateLods()
+{
+	mLodLevels.clear();
+	mLodLevels.resize(mLodLevelCount);
+	MeshSimplifier simplifier(mVertices);
+
+	const unsigned int threadCount = std::min(mLodLevelCount, mWorkerThreads);
+	std::vector<std::thread> workers;
+	for(unsigned int t = 0; t < threadCount; ++t)
+	{
+		workers.push_back(std::thread([this, &simplifier, t, threadCount]()
+		{
+			for(unsigned int level = t; level < mLodLevelCount; level += threadCount)
+			{
+				GenerateLodLevel(simplifier, level);
+			}
+		}));
+	}
+	for(unsigned int i = 0; i < workers.size(); ++i)
+	{
+		workers[i].join();
+	}
+}
+
+// Draw ranges are simplified one by one, so materials and nodes
+// are kept and the edges between them stay where they are
+void FBXExporter::GenerateLodLevel(const MeshSimplifier& inSimplifier, unsigned int inLevel)
+{
+	LodLevel& currLevel = mLodLevels[inLevel];
+	double ratio = pow(static_cast<double>(mLodTriangleRatio), static_cast<double>(inLevel + 1));
+	std::vector<unsigned int> rangeIndices;
+	std::vector<unsigned int> simplifiedIndices;
+
+	for(unsigned int i = 0; i < mDrawRanges.size(); ++i)
+	{
+		const DrawRange& baseRange = mDrawRanges[i];
+		rangeIndices.assign(mIndices.begin() + baseRange.mFirstTriangle * 3, mIndices.begin() + (baseRange.mFirstTriangle + baseRange.mTriangleCount) * 3);
+
+		unsigned int targetTriangleCount = static_cast<unsigned int>(baseRange.mTriangleCount * ratio);
+		float error = inSimplifier.Simplify(rangeIndices, targetTriangleCount, simplifiedIndices);
+		currLevel.mError = std::max(currLevel.mError, error);
+
+		DrawRange currRange = baseRange;
+		currRange.mFirstTriangle = currLevel.mIndices.size() / 3;
+		currRange.mTriangleCount = simplifiedIndices.size() / 3;
+		if(!simplifiedIndices.empty())
+		{
+			unsigned int minIndex = *std::min_element(simplifiedIndices.begin(), simplifiedIndices.end());
+			unsigned int maxIndex = *std::max_element(simplifiedIndices.begin(), simplifiedIndices.end());
+			currRange.mFirstVertex = minIndex;
+			currRange.mVertexCount = maxIndex - minIndex + 1;
+		}
+		currLevel.mIndices.insert(currLevel.mIndices.end(), simplifiedIndices.begin(), simplifiedIndices.end());
+		currLevel.mDrawRanges.push_back(currRange);
+	}
+}
+
+// Meshlets never cross a draw range, so each one has a single
+// material and belongs to a single node
+void FBXExporter::GenerateMeshlets()
+{
+	mMeshlets.mMeshlets.clear();
+	mMeshlets.mVertices.clear();
+	mMeshlets.mTriangles.clear();
+
+	std::vector<unsigned int> rangeIndices;
+	for(unsigned int i = 0; i < mDrawRanges.size(); ++i)
+	{
+		const DrawRange& currRange = mDrawRanges[i];
+		rangeIndices.assign(mIndices.begin() + currRange.mFirstTriangle * 3, mIndices.begin() + (currRange.mFirstTriangle + currRange.mTriangleCount) * 3);
+		MeshletBuilder::Build(mVertices, rangeIndices, currRange.mMaterialIndex, mMeshlets);
+	}
 }
-*/
 
-/*
+// One hierarchy per node, in the node's own space
+void FBXExporter::GenerateBvh()
+{
+	mBvh.mNodes.clear();
+	mBvh.mTriangles.clear();
+	mBvhRoots.clear();
+
+	std::vector<unsigned int> nodeTriangles;
+	for(unsigned int i = 0; i < mMeshNodes.size(); ++i)
+	{
+		if(mMeshNodes[i].mInstanceOf >= 0)
+		{
+			mBvhRoots.push_back(mBvhRoots[mMeshNodes[i].mInstanceOf]);
+			continue;
+		}
+
+		nodeTriangles.clear();
+		for(unsigned int j = mMeshNodes[i].mFirstTriangle; j < mMeshNodes[i].mFirstTriangle + mMeshNodes[i].mTriangleCount; ++j)
+		{
+			nodeTriangles.push_back(j);
+		}
+		mBvhRoots.push_back(BvhBuilder::Build(mVertices, mIndices, nodeTriangles, mWorkerThreads, mBvh));
+	}
+}
 
-int FBXExporter::FindVertex(const Vertex::PNTVertex& inTarget, const std::vector<Vertex::PNTVertex>& inVertices)
+// Flattens the triangles into mIndices for the stages after it, and
+// computes the bounds and areas of every draw range in the same pass,
+// while its indices are still in the cache. The range statistics are
+// merged into node statistics and scene space bounds
+// The draw ranges cover every triangle
+void FBXExporter::ComputeStatistics()
 {
-	int index = -1;
-	for (unsigned int i = 0; i < inVertices.size(); ++i)
+	mNodeStatistics.assign(mMeshNodes.size(), RangeStatistics());
+	mRangeStatistics.clear();
+	mSceneBounds = BoundingVolume();
+	mIndices.resize(mTriangles.size() * 3);
+
+	std::vector<unsigned int> visited(mVertices.size(), UINT_MAX);
+	for(unsigned int i = 0; i < mDrawRanges.size(); ++i)
 	{
-		if (inTarget == inVertices[i])
+		const DrawRange& currRange = mDrawRanges[i];
+		RangeStatistics currStats;
+		if(currRange.mTriangleCount > 0)
 		{
-			index = i;
+			unsigned int* rangeIndices = &mIndices[currRange.mFirstTriangle * 3];
+			for(unsigned int j = 0; j < currRange.mTriangleCount; ++j)
+			{
+				const Triangle& currTriangle = mTriangles[currRange.mFirstTriangle + j];
+				rangeIndices[j * 3 + 0] = currTriangle.mIndices[0];
+				rangeIndices[j * 3 + 1] = currTriangle.mIndices[1];
+				rangeIndices[j * 3 + 2] = currTriangle.mIndices[2];
+			}
+			currStats = MeshStatistics::Compute(mVertices, rangeIndices, currRange.mTriangleCount * 3, visited, i);
 		}
+		mRangeStatistics.push_back(currStats);
+		mNodeStatistics[currRange.mNodeIndex].Merge(currStats);
 	}
 
-	return index;
+	for(unsigned int i = 0; i < mMeshNodes.size(); ++i)
+	{
+		// Instances have no draw ranges of their own
+		if(mMeshNodes[i].mInstanceOf >= 0)
+		{
+			mNodeStatistics[i] = mNodeStatistics[mMeshNodes[i].mInstanceOf];
+		}
+		// Ranges of a node share vertices
+		mNodeStatistics[i].mVertexCount = mMeshNodes[i].mVertexCount;
+
+		const BoundingVolume& nodeBounds = mNodeStatistics[i].mBounds;
+		if(nodeBounds.mEmpty)
+		{
+			continue;
+		}
+
+		// Corners of the node's box and its sphere into scene space
+		const FbxAMatrix& transform = mMeshNodes[i].mGlobalTransform;
+		BoundingVolume sceneBounds;
+		for(unsigned int corner = 0; corner < 8; ++corner)
+		{
+			FbxVector4 point((corner & 1) ? nodeBounds.mMax.x : nodeBounds.mMin.x,
+				(corner & 2) ? nodeBounds.mMax.y : nodeBounds.mMin.y,
+				(corner & 4) ? nodeBounds.mMax.z : nodeBounds.mMin.z);
+			point = transform.MultT(point);
+			sceneBounds.Grow(XMFLOAT3(static_cast<float>(point[0]), static_cast<float>(point[1]), static_cast<float>(point[2])));
+		}
+		FbxVector4 center = transform.MultT(FbxVector4(nodeBounds.mCenter.x, nodeBounds.mCenter.y, nodeBounds.mCenter.z));
+		double maxScale = 0.0;
+		for(int r = 0; r < 3; ++r)
+		{
+			maxScale = std::max(maxScale, sqrt(transform.Get(r, 0) * transform.Get(r, 0) + transform.Get(r, 1) * transform.Get(r, 1) + transform.Get(r, 2) * transform.Get(r, 2)));
+		}
+		sceneBounds.mCenter = XMFLOAT3(static_cast<float>(center[0]), static_cast<float>(center[1]), static_cast<float>(center[2]));
+		sceneBounds.mRadius = static_cast<float>(nodeBounds.mRadius * maxScale);
+		mSceneBounds.Merge(sceneBounds);
+	}
 }
-*/
 
 void FBXExporter::AssociateMaterialToMesh(FbxNode* inNode)
 {
 	FbxLayerElementArrayTemplate<int>* materialIndices;
 	FbxGeometryElement::EMappingMode materialMappingMode = FbxGeometryElement::eNone;
 	FbxMesh* currMesh = inNode->GetMesh();
+	const MeshNode& currNode = mMeshNodes.back();
 
 	if(currMesh->GetElementMaterial())
 	{
@@ -695,12 +1845,11 @@ void FBXExporter::AssociateMaterialToMesh(FbxNode* inNode)
 			{
 			case FbxGeometryElement::eByPolygon:
 			{
-				if (materialIndices->GetCount() == mTriangleCount)
+				if (materialIndices->GetCount() == currNode.mTriangleCount)
 				{
-					for (unsigned int i = 0; i < mTriangleCount; ++i)
+					for (unsigned int i = 0; i < currNode.mTriangleCount; ++i)
 					{
-						unsigned int materialIndex = materialIndices->GetAt(i);
-						mTriangles[i].mMaterialIndex = materialIndex;
+						mTriangles[currNode.mFirstTriangle + i].mMaterialIndex = GetNodeMaterial(materialIndices->GetAt(i));
 					}
 				}
 			}
@@ -708,10 +1857,10 @@ void FBXExporter::AssociateMaterialToMesh(FbxNode* inNode)
 
 			case FbxGeometryElement::eAllSame:
 			{
-				unsigned int materialIndex = materialIndices->GetAt(0);
-				for (unsigned int i = 0; i < mTriangleCount; ++i)
+				unsigned int materialIndex = GetNodeMaterial(materialIndices->GetAt(0));
+				for (unsigned int i = 0; i < currNode.mTriangleCount; ++i)
 				{
-					mTriangles[i].mMaterialIndex = materialIndex;
+					mTriangles[currNode.mFirstTriangle + i].mMaterialIndex = materialIndex;
 				}
 			}
 			break;
@@ -723,24 +1872,50 @@ void FBXExporter::AssociateMaterialToMesh(FbxNode* inNode)
 	}
 }
 
+// Global material of one of the current node's slots. Polygons without
+// a material (slot -1) get material 0 like meshes without any
+unsigned int FBXExporter::GetNodeMaterial(int inSlot)
+{
+	if (inSlot < 0)
+	{
+		return 0;
+	}
+	if (static_cast<unsigned int>(inSlot) >= mNodeMaterials.size())
+	{
+		throw std::exception("Invalid material index");
+	}
+	return mNodeMaterials[inSlot];
+}
+
 void FBXExporter::ProcessMaterials(FbxNode* inNode)
 {
 	unsigned int materialCount = inNode->GetMaterialCount();
+	mNodeMaterials.clear();
 
 	for(unsigned int i = 0; i < materialCount; ++i)
 	{
 		FbxSurfaceMaterial* surfaceMaterial = inNode->GetMaterial(i);
-		ProcessMaterialAttribute(surfaceMaterial, i);
-		ProcessMaterialTexture(surfaceMaterial, mMaterialLookUp[i]);
-		mMaterialLookUp[i]->mDiffuseMap_index = -1;
-		mMaterialLookUp[i]->mEmissiveMap_index = -1;
-		mMaterialLookUp[i]->mGlossMap_index = -1;
-		mMaterialLookUp[i]->mNormalMap_index = -1;
-		mMaterialLookUp[i]->mSpecularMap_index = -1;
-	}
 
-	OptimizeMaterials();
+		// Materials shared between nodes are only processed once
+		auto found = mMaterialIndices.find(surfaceMaterial);
+		if (found != mMaterialIndices.end())
+		{
+			mNodeMaterials.push_back(found->second);
+			continue;
+		}
 
+		unsigned int materialIndex = mMaterialIndices.size();
+		mMaterialIndices[surfaceMaterial] = materialIndex;
+		mNodeMaterials.push_back(materialIndex);
+
+		ProcessMaterialAttribute(surfaceMaterial, materialIndex);
+		ProcessMaterialTexture(surfaceMaterial, mMaterialLookUp[materialIndex]);
+		mMaterialLookUp[materialIndex]->mDiffuseMap_index = -1;
+		mMaterialLookUp[materialIndex]->mEmissiveMap_index = -1;
+		mMaterialLookUp[materialIndex]->mGlossMap_index = -1;
+		mMaterialLookUp[materialIndex]->mNormalMap_index = -1;
+		mMaterialLookUp[materialIndex]->mSpecularMap_index = -1;
+	}
 }
 
 void FBXExporter::ProcessMaterialAttribute(FbxSurfaceMaterial* inMaterial, unsigned int inMaterialIndex)
@@ -749,7 +1924,7 @@ void FBXExporter::ProcessMaterialAttribute(FbxSurfaceMaterial* inMaterial, unsig
 	FbxDouble double1;
 	if (inMaterial->GetClassId().Is(FbxSurfacePhong::ClassId))
 	{
-		PhongMaterial* currMaterial = new PhongMaterial();
+		PhongMaterial* currMaterial = mArena.New<PhongMaterial>();
 
 		// Amibent Color
 		double3 = reinterpret_cast<FbxSurfacePhong *>(inMaterial)->Ambient;
@@ -801,7 +1976,7 @@ void FBXExporter::ProcessMaterialAttribute(FbxSurfaceMaterial* inMaterial, unsig
 	}
 	else if (inMaterial->GetClassId().Is(FbxSurfaceLambert::ClassId))
 	{
-		LambertMaterial* currMaterial = new LambertMaterial();
+		LambertMaterial* currMaterial = mArena.New<LambertMaterial>();
 
 		// Amibent Color
 		double3 = reinterpret_cast<FbxSurfaceLambert *>(inMaterial)->Ambient;
@@ -827,6 +2002,10 @@ void FBXExporter::ProcessMaterialAttribute(FbxSurfaceMaterial* inMaterial, unsig
 
 		mMaterialLookUp[inMaterialIndex] = currMaterial;
 	}
+	else
+	{
+		mMaterialLookUp[inMaterialIndex] = CreateDefaultMaterial();
+	}
 }
 
 void FBXExporter::ProcessMaterialTexture(FbxSurfaceMaterial * inMaterial, Material * ioMaterial)
@@ -881,15 +2060,15 @@ void FBXExporter::ProcessMaterialTexture(FbxSurfaceMaterial * inMaterial, Materi
 
 void FBXExporter::PrintMaterial()
 {
-	printf("\nTextures:\n");
+	*mLog << "\nTextures:\n";
 	for (int i = 0; i < mTextures.size(); i++)
 	{
-		printf("\nid: %d\ntype: %d\nname: %s\n\n", mTextures[i].texture_id, mTextures[i].texture_type, mTextures[i].name);
+		*mLog << "\nid: " << mTextures[i].texture_id << "\ntype: " << mTextures[i].texture_type << "\nname: " << mTextures[i].name << "\n\n";
 	}
 	for(auto itr = mMaterialLookUp.begin(); itr != mMaterialLookUp.end(); ++itr)
 	{
-		itr->second->WriteToStream(std::cout);
-		std::cout << "\n\n";
+		itr->second->WriteToStream(*mLog);
+		*mLog << "\n\n";
 	}
 }
 
@@ -898,122 +2077,259 @@ void FBXExporter::PrintTriangles()
 {
 	for(unsigned int i = 0; i < mTriangles.size(); ++i)
 	{
-		std::cout << "Triangle# " << i + 1 << " Material Index: " << mTriangles[i].mMaterialIndex << "\n";
+		*mLog << "Triangle# " << i + 1 << " Material Index: " << mTriangles[i].mMaterialIndex << "\n";
 	}
 }
 
+FBXExporter::~FBXExporter()
+{
+	if (mFBXManager)
+	{
+		CleanupFbxManager();
+	}
+}
+
+void FBXExporter::Reset()
+{
+	// Clear keeps the scene object, only its node tree is deleted
+	if (mFBXScene)
+	{
+		mFBXScene->Clear();
+	}
+	ClearSceneData();
+	mSceneLoaded = false;
+}
+
 void FBXExporter::CleanupFbxManager()
 {
-	mFBXScene->Destroy();
+	// Destroying the manager destroys every object created with it
 	mFBXManager->Destroy();
+	mFBXManager = nullptr;
+	mFBXScene = nullptr;
+
+	ClearSceneData();
+	mSceneLoaded = false;
+}
+
+// Containers are cleared but keep their capacity, so a long lived
+// exporter stops allocating once it has seen its largest scene
+void FBXExporter::ClearSceneData()
+{
+	ClearProcessedData();
+	mSnapshot.Clear();
+	mHasSnapshot = false;
+}
+
+// Everything but the snapshot
+void FBXExporter::ClearProcessedData()
+{
+	mHasAnimation = true;
+	mAnimationLength = 0;
+	mAnimationName.clear();
+	mLocalAnimation.Clear();
 
 	mTriangles.clear();
+	mTriangleCount = 0;
 
 	mVertices.clear();
 
+	mMeshNodes.clear();
+	mDrawRanges.clear();
+	mBonePalettes.clear();
+	mPaletteJoints.clear();
+	mLodLevels.clear();
+	mMeshlets.mMeshlets.clear();
+	mMeshlets.mVertices.clear();
+	mMeshlets.mTriangles.clear();
+	mBvh.mNodes.clear();
+	mBvh.mTriangles.clear();
+	mBvhRoots.clear();
+	mIndices.clear();
+	mNodeStatistics.clear();
+	mRangeStatistics.clear();
+	mSceneBounds = BoundingVolume();
+
 	mSkeleton.mJoints.clear();
 
-	for(auto itr = mMaterialLookUp.begin(); itr != mMaterialLookUp.end(); ++itr)
-	{
-		delete itr->second;
-	}
 	mMaterialLookUp.clear();
+	mMaterialIndices.clear();
+	mNodeMaterials.clear();
+	mTextures.clear();
+
+	// Control points, keyframes and materials (which own the texture
+	// names) all go away with the arena
+	mArena.Reset();
 }
 
 void FBXExporter::WriteMeshToStream(std::ostream& inStream)
 {
-	
-	inStream << "<?xml version='1.0' encoding='UTF-8' ?>" << std::endl;
-	inStream << "<itpmesh>" << std::endl;
+	TextWriter writer(&inStream, mStreamCompatibleText);
+	writer << "<?xml version='1.0' encoding='UTF-8' ?>\n";
+	writer << "<itpmesh>\n";
 	if(mHasAnimation)
 	{
-		inStream << "\t<!-- position, normal, skinning weights, skinning indices, texture-->" << std::endl;
-		inStream << "\t<format>pnst</format>" << std::endl;
+		writer << "\t<!-- position, normal, skinning weights, skinning indices, texture-->\n";
+		writer << "\t<format>pnst</format>\n";
 	}
 	else
 	{
-		inStream << "\t<format>pnt</format>" << std::endl;
+		writer << "\t<format>pnt</format>\n";
+	}
+	if(mUVSetCount > 1 || mColorSetCount > 0)
+	{
+		// Extra sets follow <tex> as <tex1>.. and <col0>..
+		writer << "\t<uvsets>" << mUVSetCount << "</uvsets>\n";
+		writer << "\t<colorsets>" << mColorSetCount << "</colorsets>\n";
 	}
 	for (int i = 0; i < mMaterialLookUp.size(); i++)
 	{
-		inStream << "\t<texture>" << mMaterialLookUp[i]->mDiffuseMapName << "</texture>" << std::endl;
+		writer << "\t<texture>" << mMaterialLookUp[i]->mDiffuseMapName << "</texture>\n";
 	}
-	inStream << "\t<triangles count='" << mTriangleCount << "'>" << std::endl;
+	writer << "\t<triangles count='" << mTriangleCount << "'>\n";
 
 	for (unsigned int i = 0; i < mTriangleCount; ++i)
 	{
-		// We need to change the culling order
-		inStream << "\t\t<tri>" << mTriangles[i].mIndices[0] << "," << mTriangles[i].mIndices[2] << "," << mTriangles[i].mIndices[1] << "</tri>" << std::endl;
+		writer << "\t\t<tri>" << mTriangles[i].mIndices[0] << "," << mTriangles[i].mIndices[1] << "," << mTriangles[i].mIndices[2] << "</tri>\n";
 	}
-	inStream << "\t</triangles>" << std::endl;
+	writer << "\t</triangles>\n";
 
-	
-	inStream << "\t<vertices count='" << mVertices.size() << "'>" << std::endl;
-	for (unsigned int i = 0; i < mVertices.size(); ++i)
+	// With bone palettes <si> indexes the joints of the palette whose
+	// triangles use the vertex
+	if (!mBonePalettes.empty())
 	{
-		inStream << "\t\t<vtx>" << std::endl;
-		inStream << "\t\t\t<pos>" << mVertices[i].mPosition.x << "," << mVertices[i].mPosition.y << "," << -mVertices[i].mPosition.z << "</pos>" << std::endl;
-		inStream << "\t\t\t<norm>" << mVertices[i].mNormal.x << "," << mVertices[i].mNormal.y << "," << -mVertices[i].mNormal.z << "</norm>" << std::endl;
-		if(mHasAnimation)
+		writer << "\t<palettes count='" << mBonePalettes.size() << "'>\n";
+		for (unsigned int i = 0; i < mBonePalettes.size(); ++i)
 		{
-			inStream << "\t\t\t<sw>" << static_cast<float>(mVertices[i].mVertexBlendingInfos[0].mBlendingWeight) << "," << static_cast<float>(mVertices[i].mVertexBlendingInfos[1].mBlendingWeight) << "," << static_cast<float>(mVertices[i].mVertexBlendingInfos[2].mBlendingWeight) << "," << static_cast<float>(mVertices[i].mVertexBlendingInfos[3].mBlendingWeight) << "</sw>" << std::endl;
-			inStream << "\t\t\t<si>" << mVertices[i].mVertexBlendingInfos[0].mBlendingIndex << "," << mVertices[i].mVertexBlendingInfos[1].mBlendingIndex << "," << mVertices[i].mVertexBlendingInfos[2].mBlendingIndex << "," << mVertices[i].mVertexBlendingInfos[3].mBlendingIndex << "</si>" << std::endl;
+			writer << "\t\t<palette first='" << mDrawRanges[i].mFirstTriangle << "' count='" << mDrawRanges[i].mTriangleCount << "'>";
+			for (unsigned int j = 0; j < mBonePalettes[i].mJointCount; ++j)
+			{
+				writer << mPaletteJoints[mBonePalettes[i].mFirstJoint + j] << (j + 1 < mBonePalettes[i].mJointCount ? "," : "");
+			}
+			writer << "</palette>\n";
 		}
-		inStream << "\t\t\t<tex>" << mVertices[i].mUV.x << "," << 1.0f - mVertices[i].mUV.y << "</tex>" << std::endl;
-		inStream << "\t\t</vtx>" << std::endl;
+		writer << "\t</palettes>\n";
+	}
+
+	
+	writer << "\t<vertices count='" << mVertices.size() << "'>\n";
+	if (mHasAnimation)
+	{
+		WriteVerticesText<true>(writer);
+	}
+	else
+	{
+		WriteVerticesText<false>(writer);
 	}
 	
-	inStream << "\t</vertices>" << std::endl;
-	inStream << "</itpmesh>" << std::endl;
+	writer << "\t</vertices>\n";
+	writer << "</itpmesh>\n";
+}
+
+template<bool Skinned>
+void FBXExporter::WriteVertexText(TextWriter& ioWriter, const PNTIWVertex& inVertex)
+{
+	ioWriter << "\t\t<vtx>\n";
+	ioWriter << "\t\t\t<pos>" << inVertex.mPosition.x << "," << inVertex.mPosition.y << "," << inVertex.mPosition.z << "</pos>\n";
+	ioWriter << "\t\t\t<norm>" << inVertex.mNormal.x << "," << inVertex.mNormal.y << "," << inVertex.mNormal.z << "</norm>\n";
+	if (Skinned)
+	{
+		// MAX_INFLUENCES values each, see SkinWeights
+		ioWriter << "\t\t\t<sw>";
+		for (unsigned int k = 0; k < MAX_INFLUENCES; ++k)
+		{
+			ioWriter << static_cast<float>(inVertex.mVertexBlendingInfos[k].mBlendingWeight) << (k + 1 < MAX_INFLUENCES ? "," : "</sw>\n");
+		}
+		ioWriter << "\t\t\t<si>";
+		for (unsigned int k = 0; k < MAX_INFLUENCES; ++k)
+		{
+			ioWriter << inVertex.mVertexBlendingInfos[k].mBlendingIndex << (k + 1 < MAX_INFLUENCES ? "," : "</si>\n");
+		}
+	}
+	ioWriter << "\t\t\t<tex>" << inVertex.mUV[0].x << "," << inVertex.mUV[0].y << "</tex>\n";
+	for (unsigned int k = 1; k < mUVSetCount; ++k)
+	{
+		ioWriter << "\t\t\t<tex" << k << ">" << inVertex.mUV[k].x << "," << inVertex.mUV[k].y << "</tex" << k << ">\n";
+	}
+	for (unsigned int k = 0; k < mColorSetCount; ++k)
+	{
+		const XMFLOAT4& color = inVertex.mColor[k];
+		ioWriter << "\t\t\t<col" << k << ">" << color.x << "," << color.y << "," << color.z << "," << color.w << "</col" << k << ">\n";
+	}
+	ioWriter << "\t\t</vtx>\n";
+}
+
+// Vertex blocks are formatted on mTextThreads threads and appended in order
+template<bool Skinned>
+void FBXExporter::WriteVerticesText(TextWriter& ioWriter)
+{
+	const unsigned int vertexCount = mVertices.size();
+	const unsigned int threadCount = std::max(std::min(mTextThreads, vertexCount / 1024), 1u);
+	if (threadCount == 1)
+	{
+		for (unsigned int i = 0; i < vertexCount; ++i)
+		{
+			WriteVertexText<Skinned>(ioWriter, mVertices[i]);
+		}
+		return;
+	}
+
+	std::vector<TextWriter> blocks(threadCount, TextWriter(nullptr, mStreamCompatibleText));
+	std::vector<std::thread> threads;
+	for (unsigned int t = 0; t < threadCount; ++t)
+	{
+		threads.push_back(std::thread([this, &blocks, t, threadCount, vertexCount]()
+		{
+			unsigned int begin = static_cast<unsigned int>(static_cast<unsigned long long>(vertexCount) * t / threadCount);
+			unsigned int end = static_cast<unsigned int>(static_cast<unsigned long long>(vertexCount) * (t + 1) / threadCount);
+			for (unsigned int i = begin; i < end; ++i)
+			{
+				WriteVertexText<Skinned>(blocks[t], mVertices[i]);
+			}
+		}));
+	}
+	for (unsigned int t = 0; t < threadCount; ++t)
+	{
+		threads[t].join();
+		ioWriter.Append(blocks[t]);
+	}
 }
 
 void FBXExporter::WriteAnimationToStream(std::ostream& inStream)
 {
-	inStream << "<?xml version='1.0' encoding='UTF-8' ?>" << std::endl;
-	inStream << "<itpanim>" << std::endl;
-	inStream << "\t<skeleton count='" << mSkeleton.mJoints.size() << "'>" << std::endl;
+	TextWriter writer(&inStream, mStreamCompatibleText);
+	writer << "<?xml version='1.0' encoding='UTF-8' ?>\n";
+	writer << "<itpanim>\n";
+	writer << "\t<skeleton count='" << mSkeleton.mJoints.size() << "'>\n";
 	for (unsigned int i = 0; i < mSkeleton.mJoints.size(); ++i)
 	{
-		inStream << "\t\t<joint id='" << i << "' name='" << mSkeleton.mJoints[i].mName << "' parent='" << mSkeleton.mJoints[i].mParentIndex << "'>\n";
-		inStream << "\t\t\t";
-		FbxVector4 translation = mSkeleton.mJoints[i].mGlobalBindposeInverse.GetT();
-		FbxVector4 rotation = mSkeleton.mJoints[i].mGlobalBindposeInverse.GetR();
-		translation.Set(translation.mData[0], translation.mData[1], -translation.mData[2]);
-		rotation.Set(-rotation.mData[0], -rotation.mData[1], rotation.mData[2]);
-		mSkeleton.mJoints[i].mGlobalBindposeInverse.SetT(translation);
-		mSkeleton.mJoints[i].mGlobalBindposeInverse.SetR(rotation);
+		writer << "\t\t<joint id='" << i << "' name='" << mSkeleton.mJoints[i].mName << "' parent='" << mSkeleton.mJoints[i].mParentIndex << "'>\n";
+		writer << "\t\t\t";
 		FbxMatrix out = mSkeleton.mJoints[i].mGlobalBindposeInverse;
 
-		Utilities::WriteMatrix(inStream, out.Transpose(), true);
-		inStream << "\t\t</joint>\n";
+		Utilities::WriteMatrix(writer, out.Transpose(), true);
+		writer << "\t\t</joint>\n";
 	}
-	inStream << "\t</skeleton>\n";
-	inStream << "\t<animations>\n";
-	inStream << "\t\t<animation name='" << mAnimationName << "' length='" << mAnimationLength << "'>\n";
+	writer << "\t</skeleton>\n";
+	writer << "\t<animations>\n";
+	writer << "\t\t<animation name='" << mAnimationName << "' length='" << mAnimationLength << "'>\n";
 	for (unsigned int i = 0; i < mSkeleton.mJoints.size(); ++i)
 	{
-		inStream << "\t\t\t" << "<track id = '" << i << "' name='" << mSkeleton.mJoints[i].mName << "'>\n";
+		writer << "\t\t\t" << "<track id = '" << i << "' name='" << mSkeleton.mJoints[i].mName << "'>\n";
 		Keyframe* walker = mSkeleton.mJoints[i].mAnimation;
 		while(walker)
 		{
-			inStream << "\t\t\t\t" << "<frame num='" << walker->mFrameNum - 1 << "'>\n";
-			inStream << "\t\t\t\t\t";
-			FbxVector4 translation = walker->mGlobalTransform.GetT();
-			FbxVector4 rotation = walker->mGlobalTransform.GetR();
-			translation.Set(translation.mData[0], translation.mData[1], -translation.mData[2]);
-			rotation.Set(-rotation.mData[0], -rotation.mData[1], rotation.mData[2]);
-			walker->mGlobalTransform.SetT(translation);
-			walker->mGlobalTransform.SetR(rotation);
+			writer << "\t\t\t\t" << "<frame num='" << walker->mFrameNum - 1 << "'>\n";
+			writer << "\t\t\t\t\t";
 			FbxMatrix out = walker->mGlobalTransform;
-			Utilities::WriteMatrix(inStream, out.Transpose(), true);
-			inStream << "\t\t\t\t" << "</frame>\n";
+			Utilities::WriteMatrix(writer, out.Transpose(), true);
+			writer << "\t\t\t\t" << "</frame>\n";
 			walker = walker->mNext;
 		}
-		inStream << "\t\t\t" << "</track>\n";
+		writer << "\t\t\t" << "</track>\n";
 	}
-	inStream << "\t\t</animation>\n";
-	inStream << "</animations>\n";
-	inStream << "</itpanim>";
+	writer << "\t\t</animation>\n";
+	writer << "</animations>\n";
+	writer << "</itpanim>";
 }
 
 
@@ -1068,8 +2384,7 @@ void FBXExporter::OptimizeMaterials()
 						temp_texture.texture_id = mTextures.size();
 						temp_texture.texture_type = DIFFUSE_MAP;
 						temp_texture.length_of_name = mMaterialLookUp[i]->mDiffuseMapName.length();
-						temp_texture.name = new char[temp_texture.length_of_name];
-						strcpy(temp_texture.name, mMaterialLookUp[i]->mDiffuseMapName.c_str());
+						temp_texture.name = mMaterialLookUp[i]->mDiffuseMapName.c_str();
 						mTextures.push_back(temp_texture);
 
 						mMaterialLookUp[i]->mDiffuseMap_index = temp_texture.texture_id;
@@ -1081,8 +2396,7 @@ void FBXExporter::OptimizeMaterials()
 						temp_texture.texture_id = mTextures.size();
 						temp_texture.texture_type = EMMISIVE_MAP;
 						temp_texture.length_of_name = mMaterialLookUp[i]->mEmissiveMapName.length();
-						temp_texture.name = new char[temp_texture.length_of_name];
-						strcpy(temp_texture.name, mMaterialLookUp[i]->mEmissiveMapName.c_str());
+						temp_texture.name = mMaterialLookUp[i]->mEmissiveMapName.c_str();
 						mTextures.push_back(temp_texture);
 
 						mMaterialLookUp[i]->mEmissiveMap_index = temp_texture.texture_id;
@@ -1094,8 +2408,7 @@ void FBXExporter::OptimizeMaterials()
 						temp_texture.texture_id = mTextures.size();
 						temp_texture.texture_type = GLOSS_MAP;
 						temp_texture.length_of_name = mMaterialLookUp[i]->mGlossMapName.length();
-						temp_texture.name = new char[temp_texture.length_of_name];
-						strcpy(temp_texture.name, mMaterialLookUp[i]->mGlossMapName.c_str());
+						temp_texture.name = mMaterialLookUp[i]->mGlossMapName.c_str();
 						mTextures.push_back(temp_texture);
 
 						mMaterialLookUp[i]->mGlossMap_index = temp_texture.texture_id;
@@ -1107,8 +2420,7 @@ void FBXExporter::OptimizeMaterials()
 						temp_texture.texture_id = mTextures.size();
 						temp_texture.texture_type = NORMAL_MAP;
 						temp_texture.length_of_name = mMaterialLookUp[i]->mNormalMapName.length();
-						temp_texture.name = new char[temp_texture.length_of_name];
-						strcpy(temp_texture.name, mMaterialLookUp[i]->mNormalMapName.c_str());
+						temp_texture.name = mMaterialLookUp[i]->mNormalMapName.c_str();
 						mTextures.push_back(temp_texture);
 
 						mMaterialLookUp[i]->mNormalMap_index = temp_texture.texture_id;
@@ -1120,8 +2432,7 @@ void FBXExporter::OptimizeMaterials()
 						temp_texture.texture_id = mTextures.size();
 						temp_texture.texture_type = SPECULAR_MAP;
 						temp_texture.length_of_name = mMaterialLookUp[i]->mSpecularMapName.length();
-						temp_texture.name = new char[temp_texture.length_of_name];
-						strcpy(temp_texture.name, mMaterialLookUp[i]->mSpecularMapName.c_str());
+						temp_texture.name = mMaterialLookUp[i]->mSpecularMapName.c_str();
 						mTextures.push_back(temp_texture);
 
 						mMaterialLookUp[i]->mSpecularMap_index = temp_texture.texture_id;
@@ -1139,37 +2450,113 @@ void FBXExporter::OptimizeMaterials()
 }
 
 
-// Instead of first half of ExportFBX function
 bool FBXExporter::ProcessScene()
+{
+	return RunStages(true);
+}
+
+// The stages shared by ProcessScene and ExportFBX. Instancing, batching,
+// LODs, meshlets and the BVH only have a place in the .static_mesh file
+bool FBXExporter::RunStages(bool inMeshFileStages)
 {
 	LARGE_INTEGER start;
 	LARGE_INTEGER end;
 
-	QueryPerformanceCounter(&start);
-	ProcessSkeletonHierarchy(mFBXScene->GetRootNode());
-	if (mSkeleton.mJoints.empty())
+	if (!PrepareSceneData())
 	{
-		mHasAnimation = false;
+		return false;
+	}
+
+	if (mHasAnimation)
+	{
+		QueryPerformanceCounter(&start);
+		ProcessSkinWeights();
+		QueryPerformanceCounter(&end);
+		*mLog << "Processing Skin Weights: " << ((end.QuadPart - start.QuadPart) / static_cast<float>(mCPUFreq.QuadPart)) << "s\n";
+	}
+
+	// Batching bakes every node, skinned nodes keep their own bind space
+	if (inMeshFileStages && mInstancing && !mStaticBatching && !mHasAnimation)
+	{
+		QueryPerformanceCounter(&start);
+		DetectInstances();
+		QueryPerformanceCounter(&end);
+		*mLog << "Detecting Instances: " << ((end.QuadPart - start.QuadPart) / static_cast<float>(mCPUFreq.QuadPart)) << "s\n";
 	}
+
+	QueryPerformanceCounter(&start);
+	Optimize();
 	QueryPerformanceCounter(&end);
-	std::cout << "Processing Skeleton Hierarchy: " << ((end.QuadPart - start.QuadPart) / static_cast<float>(mCPUFreq.QuadPart)) << "s\n";
+	*mLog << "Optimization: " << ((end.QuadPart - start.QuadPart) / static_cast<float>(mCPUFreq.QuadPart)) << "s\n";
+
+	// Skinned meshes must stay in their bind space
+	if (inMeshFileStages && mStaticBatching && !mHasAnimation)
+	{
+		QueryPerformanceCounter(&start);
+		BatchStaticGeometry();
+		QueryPerformanceCounter(&end);
+		*mLog << "Static Batching: " << ((end.QuadPart - start.QuadPart) / static_cast<float>(mCPUFreq.QuadPart)) << "s\n";
+	}
 
+	// After welding, which numbers vertices in triangle order
 	QueryPerformanceCounter(&start);
-	ProcessGeometry(mFBXScene->GetRootNode());
+	ConvertCoordinates();
 	QueryPerformanceCounter(&end);
-	std::cout << "Processing Geometry: " << ((end.QuadPart - start.QuadPart) / static_cast<float>(mCPUFreq.QuadPart)) << "s\n";
+	*mLog << "Converting Coordinates: " << ((end.QuadPart - start.QuadPart) / static_cast<float>(mCPUFreq.QuadPart)) << "s\n";
+
+	if (mHasAnimation)
+	{
+		QueryPerformanceCounter(&start);
+		BakeLocalAnimation();
+		QueryPerformanceCounter(&end);
+		*mLog << "Baking Animation: " << ((end.QuadPart - start.QuadPart) / static_cast<float>(mCPUFreq.QuadPart)) << "s\n";
+	}
+
+	// Before LODs and meshlets, which keep to the split draw ranges
+	if (mHasAnimation && mBonePaletteSize > 0)
+	{
+		QueryPerformanceCounter(&start);
+		PartitionBones();
+		QueryPerformanceCounter(&end);
+		*mLog << "Partitioning Bones: " << ((end.QuadPart - start.QuadPart) / static_cast<float>(mCPUFreq.QuadPart)) << "s\n";
+	}
 
+	// Flattens the triangles for the stages after it
 	QueryPerformanceCounter(&start);
-	Optimize();
+	ComputeStatistics();
 	QueryPerformanceCounter(&end);
-	std::cout << "Optimization: " << ((end.QuadPart - start.QuadPart) / static_cast<float>(mCPUFreq.QuadPart)) << "s\n";
-	std::cout << "\n\n";
+	*mLog << "Computing Statistics: " << ((end.QuadPart - start.QuadPart) / static_cast<float>(mCPUFreq.QuadPart)) << "s\n";
+
+	if (inMeshFileStages && mLodLevelCount > 0)
+	{
+		QueryPerformanceCounter(&start);
+		GenerateLods();
+		QueryPerformanceCounter(&end);
+		*mLog << "Generating LODs: " << ((end.QuadPart - start.QuadPart) / static_cast<float>(mCPUFreq.QuadPart)) << "s\n";
+	}
+
+	if (inMeshFileStages && mGenerateMeshlets)
+	{
+		QueryPerformanceCounter(&start);
+		GenerateMeshlets();
+		QueryPerformanceCounter(&end);
+		*mLog << "Generating Meshlets: " << ((end.QuadPart - start.QuadPart) / static_cast<float>(mCPUFreq.QuadPart)) << "s\n";
+	}
+
+	if (inMeshFileStages && mGenerateBvh)
+	{
+		QueryPerformanceCounter(&start);
+		GenerateBvh();
+		QueryPerformanceCounter(&end);
+		*mLog << "Generating BVH: " << ((end.QuadPart - start.QuadPart) / static_cast<float>(mCPUFreq.QuadPart)) << "s\n";
+	}
+
+	*mLog << "\n\n";
 
 	QueryPerformanceCounter(&start);
-	ProcessMaterials(mFBXScene->GetRootNode());
+	OptimizeMaterials();
 	QueryPerformanceCounter(&end);
-	std::cout << "Processing Materials: " << ((end.QuadPart - start.QuadPart) / static_cast<float>(mCPUFreq.QuadPart)) << "s\n";
-	//PrintMaterial();
+	*mLog << "Processing Materials: " << ((end.QuadPart - start.QuadPart) / static_cast<float>(mCPUFreq.QuadPart)) << "s\n";
 
 	return true;
 }
@@ -1181,52 +2568,371 @@ bool FBXExporter::ExportAsMesh(const char* inOutputPath)
 	// Remember about PrintTriangles
 	std::string file_name = inOutputPath;
 	file_name += ".static_mesh";
-	std::ofstream output(file_name.c_str(), std::ofstream::binary | std::ofstream::trunc);
 
-	WriteMeshToFile(output);
+	std::vector<unsigned int> textureSizes;
+	if (!GetTextureSizes(textureSizes))
+	{
+		return false;
+	}
+
+	MeshFileWriter output;
+	if (mCompressOutput)
+	{
+		// Sections are compressed from an uncompressed image in memory
+		output.OpenMemory(ComputeMeshFileSize(textureSizes));
+		if (!WriteMeshToFile(output, textureSizes) ||
+			!MeshFileCompressor::Write(output.GetData(), *reinterpret_cast<const SM_header*>(output.GetData()), mSections, file_name, mSyncOutput))
+		{
+			*mLog << "\nError. Can't write file \"" << file_name << "\"\n";
+			return false;
+		}
+	}
+	else
+	{
+		if (!output.Open(file_name, ComputeMeshFileSize(textureSizes), mSyncOutput))
+		{
+			*mLog << "\nError. Can't create file \"" << file_name << "\"\n";
+			return false;
+		}
+
+		if (!WriteMeshToFile(output, textureSizes) || !output.Commit())
+		{
+			output.Abort();
+			return false;
+		}
+	}
+
+	if (mHasAnimation && mLocalAnimation.mFrameCount > 0)
+	{
+		std::string anim_file_name = inOutputPath;
+		anim_file_name += ".static_anim";
+
+		MeshFileWriter animOutput;
+		if (!animOutput.Open(anim_file_name, ComputeAnimationFileSize(), mSyncOutput))
+		{
+			*mLog << "\nError. Can't create file \"" << anim_file_name << "\"\n";
+			return false;
+		}
+
+		if (!WriteAnimationToFile(animOutput) || !animOutput.Commit())
+		{
+			animOutput.Abort();
+			return false;
+		}
+	}
+
+	*mLog << "\nExport done!\n";
 
-	output.close();
+	return true;
+}
 
-	printf("\nExport done!\n");
+bool FBXExporter::GetTextureSizes(std::vector<unsigned int>& outSizes)
+{
+	outSizes.resize(mTextures.size());
+	for (unsigned int i = 0; i < mTextures.size(); i++)
+	{
+		std::ifstream texture_file(mTextures[i].name, std::ifstream::binary | std::ifstream::ate);
+		if (!texture_file.is_open())
+		{
+			*mLog << "\nError. Can't open file \"" << mTextures[i].name << "\"\n";
+			return false;
+		}
+		outSizes[i] = static_cast<unsigned int>(texture_file.tellg());
+	}
 
 	return true;
 }
 
-bool FBXExporter::WriteMeshToFile(std::ostream& inStream)
+void FBXExporter::GetVertexStreamFormats(std::vector<VertexStreamFormat>& outFormats) const
+{
+	outFormats.clear();
+	outFormats.push_back(GetStreamFormat<StaticMeshVertexFormat>());
+	for (unsigned int k = 1; k < mUVSetCount; k++)
+	{
+		outFormats.push_back(GetUVSetFormat(k));
+	}
+	for (unsigned int k = 0; k < mColorSetCount; k++)
+	{
+		outFormats.push_back(GetColorSetFormat(k));
+	}
+	if (!mBonePalettes.empty())
+	{
+		outFormats.push_back(GetStreamFormat<SkinVertexFormat>());
+	}
+}
+
+// Must match the layout written by WriteMeshToFile
+size_t FBXExporter::ComputeMeshFileSize(const std::vector<unsigned int>& inTextureSizes)
+{
+	const size_t vertexCount = mVertices.size();
+	size_t size = sizeof(SM_header);
+	std::vector<VertexStreamFormat> streamFormats;
+	GetVertexStreamFormats(streamFormats);
+	for (unsigned int i = 0; i < streamFormats.size(); i++)
+	{
+		size += streamFormats[i].mAttributeCount * sizeof(SM_vertex_attribute) + vertexCount * streamFormats[i].mStride;
+	}
+	size += mTriangleCount * sizeof(SM_triangle);
+	size += mMeshNodes.size() * sizeof(SM_node);
+	size += mDrawRanges.size() * sizeof(SM_draw_range);
+	size += mBonePalettes.size() * sizeof(SM_bone_palette) + mPaletteJoints.size() * sizeof(unsigned int);
+	size += (mMeshNodes.size() + mDrawRanges.size()) * sizeof(SM_range_stats);
+	size += mLodLevels.size() * sizeof(SM_lod);
+	for (unsigned int i = 0; i < mLodLevels.size(); i++)
+	{
+		size += mLodLevels[i].mIndices.size() / 3 * sizeof(SM_triangle) + mLodLevels[i].mDrawRanges.size() * sizeof(SM_draw_range);
+	}
+	size += mMeshlets.mMeshlets.size() * sizeof(SM_meshlet) + mMeshlets.mVertices.size() * sizeof(unsigned int);
+	size += (mMeshlets.mTriangles.size() + 3) & ~static_cast<size_t>(3);
+	size += mMaterialLookUp.size() * sizeof(SM_material);
+	for (unsigned int i = 0; i < inTextureSizes.size(); i++)
+	{
+		size += sizeof(unsigned int) + inTextureSizes[i];
+	}
+	if (!mBvh.mNodes.empty())
+	{
+		size += SM_BVH_ALIGNMENT - 1;
+		size += mBvh.mNodes.size() * sizeof(SM_bvh_node) + (mMeshNodes.size() + mTriangleCount) * sizeof(unsigned int);
+	}
+
+	return size;
+}
+
+// Sections are only recorded for the section table of compressed files
+void FBXExporter::BeginSection(MeshFileWriter& inWriter, unsigned int inType, unsigned int inCodec, unsigned int inRecordSize)
+{
+	EndSection(inWriter);
+
+	SM_section section;
+	section.type = inType;
+	section.codec = inCodec;
+	section.record_size = inRecordSize;
+	section.raw_offset = static_cast<unsigned int>(inWriter.GetOffset());
+	section.raw_size = 0;
+	section.first_block = 0;
+	section.NumOf_Blocks = 0;
+	mSections.push_back(section);
+}
+
+// Closes the open section, empty sections are dropped
+void FBXExporter::EndSection(MeshFileWriter& inWriter)
+{
+	if (mSections.empty() || mSections.back().raw_size > 0)
+	{
+		return;
+	}
+
+	SM_section& currSection = mSections.back();
+	currSection.raw_size = static_cast<unsigned int>(inWriter.GetOffset()) - currSection.raw_offset;
+	if (currSection.raw_size == 0)
+	{
+		mSections.pop_back();
+	}
+}
+
+static void WriteBounds(const BoundingVolume& inBounds, SM_bounds& outBounds)
+{
+	outBounds.Min = inBounds.mMin;
+	outBounds.Max = inBounds.mMax;
+	outBounds.Center = inBounds.mCenter;
+	outBounds.Radius = inBounds.mRadius;
+}
+
+static void WriteVertexStream(MeshFileWriter& ioWriter, const VertexStreams& inStreams, const VertexStreamFormat& inFormat)
+{
+	const unsigned int vertexCount = inStreams.mPositions.size();
+	inFormat.mPack(inStreams, 0, vertexCount, ioWriter.Reserve(static_cast<size_t>(vertexCount) * inFormat.mStride));
+}
+
+bool FBXExporter::WriteMeshToFile(MeshFileWriter& ioWriter, const std::vector<unsigned int>& inTextureSizes)
 {
 	// Header
-	SM_header *header = new SM_header;
-	header->version = 1.0f;
+	const unsigned int vertexCodec = mGeometryCodec ? SM_CODEC_VERTEX : (mShuffleVertices ? SM_CODEC_SHUFFLE : SM_CODEC_NONE);
+
+	// Every section is serialized in place in the mapped file
+	SM_header *header = ioWriter.ReserveArray<SM_header>(1);
+	header->version = 2.3f;
 	header->NumOf_Vertices = mVertices.size();
 	header->NumOf_Triangles = mTriangleCount;
 	header->NumOf_Materials = mMaterialLookUp.size();
 	header->NumOf_Textures = mTextures.size();
-	inStream.write((char*)header, sizeof(SM_header));
-
-	// Vertices
-	SM_vertex *vertices = new SM_vertex[header->NumOf_Vertices];
-	for (unsigned int i = 0; i < header->NumOf_Vertices; i++)
-	{
-		vertices[i].Position = mVertices[i].mPosition;
-		vertices[i].Normal = mVertices[i].mNormal;
-		vertices[i].Tex0 = mVertices[i].mUV;
-	}
-	inStream.write((char*)vertices, sizeof(SM_vertex)*header->NumOf_Vertices);
-	delete[] vertices;
+	header->NumOf_UVSets = mUVSetCount;
+	header->NumOf_ColorSets = mColorSetCount;
+	header->NumOf_VertexAttributes = 0;
+	header->NumOf_Nodes = mMeshNodes.size();
+	header->NumOf_DrawRanges = mDrawRanges.size();
+	header->NumOf_BonePalettes = mBonePalettes.size();
+	header->NumOf_PaletteJoints = mPaletteJoints.size();
+	header->NumOf_LODs = mLodLevels.size();
+	header->NumOf_Meshlets = mMeshlets.mMeshlets.size();
+	header->NumOf_MeshletVertices = mMeshlets.mVertices.size();
+	header->NumOf_MeshletTriangles = mMeshlets.mTriangles.size() / 3;
+	header->NumOf_BvhNodes = mBvh.mNodes.size();
+	header->Bvh_offset = 0;
+	WriteBounds(mSceneBounds, header->Bounds);
+	header->Flags = 0;
+	header->NumOf_Sections = 0;
+	header->NumOf_Blocks = 0;
+	mSections.clear();
+
+	// Vertex layout, one record per attribute of every vertex stream
+	std::vector<VertexStreamFormat> streamFormats;
+	GetVertexStreamFormats(streamFormats);
+	std::vector<SM_vertex_attribute> attributes;
+	for (unsigned int s = 0; s < streamFormats.size(); s++)
+		streamFormats[s].mDescribe(s, attributes);
+	header->NumOf_VertexAttributes = attributes.size();
+	BeginSection(ioWriter, SM_SECTION_VERTEX_LAYOUT, SM_CODEC_NONE, 1);
+	ioWriter.Write(attributes.data(), sizeof(SM_vertex_attribute) * attributes.size());
+
+	// Vertices, gathered once and packed stream by stream
+	VertexStreams streams;
+	streams.Gather(mVertices, mUVSetCount, mColorSetCount, header->NumOf_BonePalettes > 0);
+	unsigned int stream = 0;
+	BeginSection(ioWriter, SM_SECTION_VERTICES, vertexCodec, streamFormats[stream].mStride);
+	WriteVertexStream(ioWriter, streams, streamFormats[stream++]);
+
+	// Additional UV sets and vertex colors, one stream per set
+	BeginSection(ioWriter, SM_SECTION_UV_SETS, vertexCodec, sizeof(XMFLOAT2));
+	for (unsigned int k = 1; k < header->NumOf_UVSets; k++)
+		WriteVertexStream(ioWriter, streams, streamFormats[stream++]);
+
+	BeginSection(ioWriter, SM_SECTION_COLOR_SETS, vertexCodec, sizeof(XMFLOAT4));
+	for (unsigned int k = 0; k < header->NumOf_ColorSets; k++)
+		WriteVertexStream(ioWriter, streams, streamFormats[stream++]);
+
+	// Palette local blend indices and weights
+	BeginSection(ioWriter, SM_SECTION_SKIN, vertexCodec, sizeof(SM_skin_vertex));
+	if (header->NumOf_BonePalettes > 0)
+		WriteVertexStream(ioWriter, streams, streamFormats[stream++]);
 
 	// Triangles
-	SM_triangle *triangles = new SM_triangle[header->NumOf_Triangles];
+	BeginSection(ioWriter, SM_SECTION_TRIANGLES, mGeometryCodec ? SM_CODEC_INDEX : SM_CODEC_NONE, sizeof(SM_triangle));
+	SM_triangle *triangles = ioWriter.ReserveArray<SM_triangle>(header->NumOf_Triangles);
 	for (unsigned int i = 0; i < header->NumOf_Triangles; i++)
 	{
 		for (int j = 0; j < 3; j++)
 			triangles[i].indices[j] = mTriangles[i].mIndices[j];
 		triangles[i].material_index = (int)mTriangles[i].mMaterialIndex;
 	}
-	inStream.write((char*)triangles, sizeof(SM_triangle)*header->NumOf_Triangles);
-	delete[] triangles;
+
+	// Nodes
+	BeginSection(ioWriter, SM_SECTION_NODES, SM_CODEC_NONE, 1);
+	SM_node *nodes = ioWriter.ReserveArray<SM_node>(header->NumOf_Nodes);
+	for (unsigned int i = 0; i < header->NumOf_Nodes; i++)
+	{
+		memset(nodes[i].Name, 0, sizeof(nodes[i].Name));
+		strncpy(nodes[i].Name, mMeshNodes[i].mName.c_str(), sizeof(nodes[i].Name) - 1);
+		for (int r = 0; r < 4; r++)
+			for (int c = 0; c < 4; c++)
+				nodes[i].Transform[r * 4 + c] = static_cast<float>(mMeshNodes[i].mGlobalTransform.Get(r, c));
+		nodes[i].First_triangle = mMeshNodes[i].mFirstTriangle;
+		nodes[i].NumOf_Triangles = mMeshNodes[i].mTriangleCount;
+		nodes[i].First_vertex = mMeshNodes[i].mFirstVertex;
+		nodes[i].NumOf_Vertices = mMeshNodes[i].mVertexCount;
+		nodes[i].Instance_of = mMeshNodes[i].mInstanceOf;
+	}
+
+	// Draw ranges
+	BeginSection(ioWriter, SM_SECTION_DRAW_RANGES, SM_CODEC_NONE, 1);
+	SM_draw_range *ranges = ioWriter.ReserveArray<SM_draw_range>(header->NumOf_DrawRanges);
+	for (unsigned int i = 0; i < header->NumOf_DrawRanges; i++)
+	{
+		ranges[i].node_index = mDrawRanges[i].mNodeIndex;
+		ranges[i].material_index = mDrawRanges[i].mMaterialIndex;
+		ranges[i].first_triangle = mDrawRanges[i].mFirstTriangle;
+		ranges[i].triangle_count = mDrawRanges[i].mTriangleCount;
+		ranges[i].first_vertex = mDrawRanges[i].mFirstVertex;
+		ranges[i].vertex_count = mDrawRanges[i].mVertexCount;
+	}
+
+	// Bone palettes, one per draw range, and the joints they list
+	BeginSection(ioWriter, SM_SECTION_BONE_PALETTES, SM_CODEC_NONE, 1);
+	SM_bone_palette *palettes = ioWriter.ReserveArray<SM_bone_palette>(header->NumOf_BonePalettes);
+	for (unsigned int i = 0; i < header->NumOf_BonePalettes; i++)
+	{
+		palettes[i].first_joint = mBonePalettes[i].mFirstJoint;
+		palettes[i].joint_count = mBonePalettes[i].mJointCount;
+	}
+	if (header->NumOf_PaletteJoints > 0)
+		ioWriter.Write(&mPaletteJoints[0], sizeof(unsigned int)*header->NumOf_PaletteJoints);
+
+	// Statistics of every node, then of every draw range
+	BeginSection(ioWriter, SM_SECTION_RANGE_STATS, SM_CODEC_NONE, 1);
+	SM_range_stats *stats = ioWriter.ReserveArray<SM_range_stats>(header->NumOf_Nodes + header->NumOf_DrawRanges);
+	for (unsigned int i = 0; i < header->NumOf_Nodes + header->NumOf_DrawRanges; i++)
+	{
+		const RangeStatistics& currStats = i < header->NumOf_Nodes ? mNodeStatistics[i] : mRangeStatistics[i - header->NumOf_Nodes];
+		WriteBounds(currStats.mBounds, stats[i].Bounds);
+		stats[i].SurfaceArea = currStats.mSurfaceArea;
+		stats[i].UVArea = currStats.mUVArea;
+		stats[i].UVDensity = currStats.mUVDensity;
+		stats[i].NumOf_Vertices = currStats.mVertexCount;
+		stats[i].NumOf_Triangles = currStats.mTriangleCount;
+	}
+
+	// Levels of detail: the table, then every level's triangles
+	// and draw ranges
+	BeginSection(ioWriter, SM_SECTION_LODS, SM_CODEC_NONE, 1);
+	SM_lod *lods = ioWriter.ReserveArray<SM_lod>(header->NumOf_LODs);
+	for (unsigned int i = 0; i < header->NumOf_LODs; i++)
+	{
+		lods[i].error = mLodLevels[i].mError;
+		lods[i].NumOf_Triangles = mLodLevels[i].mIndices.size() / 3;
+		lods[i].NumOf_DrawRanges = mLodLevels[i].mDrawRanges.size();
+	}
+
+	for (unsigned int i = 0; i < header->NumOf_LODs; i++)
+	{
+		const LodLevel& currLevel = mLodLevels[i];
+		SM_triangle *lodTriangles = ioWriter.ReserveArray<SM_triangle>(currLevel.mIndices.size() / 3);
+		SM_draw_range *lodRanges = ioWriter.ReserveArray<SM_draw_range>(currLevel.mDrawRanges.size());
+		for (unsigned int r = 0; r < currLevel.mDrawRanges.size(); r++)
+		{
+			const DrawRange& currRange = currLevel.mDrawRanges[r];
+			for (unsigned int t = currRange.mFirstTriangle; t < currRange.mFirstTriangle + currRange.mTriangleCount; t++)
+			{
+				for (int j = 0; j < 3; j++)
+					lodTriangles[t].indices[j] = currLevel.mIndices[t * 3 + j];
+				lodTriangles[t].material_index = (int)currRange.mMaterialIndex;
+			}
+			lodRanges[r].node_index = currRange.mNodeIndex;
+			lodRanges[r].material_index = currRange.mMaterialIndex;
+			lodRanges[r].first_triangle = currRange.mFirstTriangle;
+			lodRanges[r].triangle_count = currRange.mTriangleCount;
+			lodRanges[r].first_vertex = currRange.mFirstVertex;
+			lodRanges[r].vertex_count = currRange.mVertexCount;
+		}
+	}
+
+	// Meshlets
+	BeginSection(ioWriter, SM_SECTION_MESHLETS, SM_CODEC_NONE, 1);
+	SM_meshlet *meshlets = ioWriter.ReserveArray<SM_meshlet>(header->NumOf_Meshlets);
+	for (unsigned int i = 0; i < header->NumOf_Meshlets; i++)
+	{
+		const Meshlet& currMeshlet = mMeshlets.mMeshlets[i];
+		meshlets[i].vertex_offset = currMeshlet.mVertexOffset;
+		meshlets[i].vertex_count = currMeshlet.mVertexCount;
+		meshlets[i].triangle_offset = currMeshlet.mTriangleOffset / 3;
+		meshlets[i].triangle_count = currMeshlet.mTriangleCount;
+		meshlets[i].material_index = currMeshlet.mMaterialIndex;
+		meshlets[i].Center = currMeshlet.mCenter;
+		meshlets[i].Radius = currMeshlet.mRadius;
+		meshlets[i].ConeApex = currMeshlet.mConeApex;
+		meshlets[i].ConeAxis = currMeshlet.mConeAxis;
+		meshlets[i].ConeCutoff = currMeshlet.mConeCutoff;
+	}
+	if (header->NumOf_Meshlets > 0)
+	{
+		ioWriter.Write(&mMeshlets.mVertices[0], sizeof(unsigned int)*header->NumOf_MeshletVertices);
+		ioWriter.Write(&mMeshlets.mTriangles[0], 3 * header->NumOf_MeshletTriangles);
+	}
+	// Keeps the following sections 4 byte aligned
+	ioWriter.Pad(4);
 
 	// Materials
-	SM_material *materials = new SM_material[header->NumOf_Materials];
+	BeginSection(ioWriter, SM_SECTION_MATERIALS, SM_CODEC_NONE, 1);
+	SM_material *materials = ioWriter.ReserveArray<SM_material>(header->NumOf_Materials);
 	for (unsigned int i = 0; i < header->NumOf_Materials; i++)
 	{
 		materials[i].Ambient = mMaterialLookUp[i]->mAmbient;
@@ -1246,42 +2952,92 @@ bool FBXExporter::WriteMeshToFile(std::ostream& inStream)
 		materials[i].Texture_index[3] = mMaterialLookUp[i]->mNormalMap_index;
 		materials[i].Texture_index[4] = mMaterialLookUp[i]->mSpecularMap_index;
 	}
-	inStream.write((char*)materials, sizeof(SM_material)*header->NumOf_Materials);
-	delete[] materials;
 
-	// Textures
-	unsigned int size_of_texture;
-	char *texture;
+	// Textures are read straight into the file
+	BeginSection(ioWriter, SM_SECTION_TEXTURES, SM_CODEC_NONE, 1);
 	for (unsigned int i = 0; i < header->NumOf_Textures; i++)
 	{
-		std::ifstream texture_file(mTextures[i].name, std::ifstream::binary | std::ifstream::ate);
-
-		if (!texture_file.is_open())
+		std::ifstream texture_file(mTextures[i].name, std::ifstream::binary);
+		unsigned int size_of_texture = inTextureSizes[i];
+		ioWriter.Write(&size_of_texture, sizeof(unsigned int));
+		if (!texture_file.read(ioWriter.Reserve(size_of_texture), size_of_texture))
 		{
-			printf("\nError. Can't open file \"%s\"\n", mTextures[i].name);
+			*mLog << "\nError. Can't read file \"" << mTextures[i].name << "\"\n";
 			return false;
 		}
+	}
 
-		size_of_texture = texture_file.tellg();
-		texture_file.seekg(std::ifstream::beg);
-
-		texture = new char[size_of_texture];
-		texture_file.read(texture, size_of_texture);
-
-		inStream.write((char*)&size_of_texture, sizeof(unsigned int));
-		inStream.write(texture, size_of_texture);
+	// BVH section, 64 byte aligned so it can be mapped and used in place
+	if (header->NumOf_BvhNodes > 0)
+	{
+		BeginSection(ioWriter, SM_SECTION_BVH, SM_CODEC_NONE, 1);
+		ioWriter.Pad(SM_BVH_ALIGNMENT);
+		header->Bvh_offset = static_cast<unsigned int>(ioWriter.GetOffset());
 
-		delete[] texture;
-		texture_file.close();
+		ioWriter.Write(&mBvh.mNodes[0], sizeof(SM_bvh_node)*header->NumOf_BvhNodes);
+		ioWriter.Write(&mBvhRoots[0], sizeof(unsigned int)*header->NumOf_Nodes);
+		ioWriter.Write(&mBvh.mTriangles[0], sizeof(unsigned int)*header->NumOf_Triangles);
 	}
-
-	delete header;
+	EndSection(ioWriter);
 
 	return true;
 }
 
-bool FBXExporter::WriteAnimationToFile(std::ostream& inStream)
+// Must match the layout written by WriteAnimationToFile
+size_t FBXExporter::ComputeAnimationFileSize()
 {
+	const size_t keyCount = mSkeleton.mJoints.size() * static_cast<size_t>(mLocalAnimation.mFrameCount);
+	return sizeof(SA_header) + mSkeleton.mJoints.size() * sizeof(SA_joint) + keyCount * (mQuantizeRotations ? sizeof(SA_quantized_key) : sizeof(SA_key));
+}
+
+bool FBXExporter::WriteAnimationToFile(MeshFileWriter& ioWriter)
+{
+	SA_header *header = ioWriter.ReserveArray<SA_header>(1);
+	header->version = 1.0f;
+	header->NumOf_Joints = mSkeleton.mJoints.size();
+	header->NumOf_Frames = mLocalAnimation.mFrameCount;
+	header->Frames_per_second = 24.0f;
+	header->First_frame = static_cast<int>(mLocalAnimation.mFirstFrame);
+	header->Flags = mQuantizeRotations ? SA_FLAG_QUANTIZED_ROTATIONS : 0;
+	memset(header->Name, 0, sizeof(header->Name));
+	strncpy(header->Name, mAnimationName.c_str(), sizeof(header->Name) - 1);
+
+	// Joints
+	SA_joint *joints = ioWriter.ReserveArray<SA_joint>(header->NumOf_Joints);
+	for (unsigned int i = 0; i < header->NumOf_Joints; i++)
+	{
+		memset(joints[i].Name, 0, sizeof(joints[i].Name));
+		strncpy(joints[i].Name, mSkeleton.mJoints[i].mName.c_str(), sizeof(joints[i].Name) - 1);
+		joints[i].Parent = mSkeleton.mJoints[i].mParentIndex;
+		for (int r = 0; r < 4; r++)
+			for (int c = 0; c < 4; c++)
+				joints[i].Inverse_bindpose[r * 4 + c] = static_cast<float>(mSkeleton.mJoints[i].mGlobalBindposeInverse.Get(r, c));
+	}
+
+	// Keys
+	const size_t keyCount = header->NumOf_Joints * static_cast<size_t>(header->NumOf_Frames);
+	if (mQuantizeRotations)
+	{
+		SA_quantized_key *keys = ioWriter.ReserveArray<SA_quantized_key>(keyCount);
+		for (size_t i = 0; i < keyCount; i++)
+		{
+			keys[i].Translation = mLocalAnimation.mTranslations[i];
+			const float* rotation = &mLocalAnimation.mRotations[i].x;
+			for (int c = 0; c < 4; c++)
+				keys[i].Rotation[c] = VertexEncoder<SM_ENCODING_SNORM16>::Encode(rotation[c]);
+			keys[i].Scale = mLocalAnimation.mScales[i];
+		}
+	}
+	else
+	{
+		SA_key *keys = ioWriter.ReserveArray<SA_key>(keyCount);
+		for (size_t i = 0; i < keyCount; i++)
+		{
+			keys[i].Translation = mLocalAnimation.mTranslations[i];
+			keys[i].Rotation = mLocalAnimation.mRotations[i];
+			keys[i].Scale = mLocalAnimation.mScales[i];
+		}
+	}
 
 	return true;
 }
@@ -2,6 +2,22 @@
 #include "Utilities.h"
 #include <unordered_map>
 #include "Material.h"
+#include "MeshWelder.h"
+#include "MeshInstancer.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+#include "BvhBuilder.h"
+#include "MeshStatistics.h"
+#include "SceneArena.h"
+#include "MeshFileWriter.h"
+#include "VertexLayout.h"
+#include "MeshFileCompressor.h"
+#include "SceneSnapshot.h"
+#include "ImportProfile.h"
+#include "CoordinateConverter.h"
+#include "AnimationBaker.h"
+#include "BonePartitioner.h"
+#include "SkinWeights.h"
 
 enum Texture_type { DIFFUSE_MAP, EMMISIVE_MAP, GLOSS_MAP, NORMAL_MAP, SPECULAR_MAP };
 struct Texture
@@ -9,21 +25,138 @@ struct Texture
 	unsigned int length_of_name;
 	unsigned int texture_id;
 	Texture_type texture_type;
-	char *name;
+	// Owned by the material the texture was found on
+	const char *name;
 };
 
 class FBXExporter
 {
 public:
 	FBXExporter();
-	//~FBXExporter();
+	~FBXExporter();
 	bool Initialize();
 
+	// Clears the loaded scene and everything extracted from it, but
+	// keeps the FbxManager and its IO settings for the next LoadScene.
+	// LoadScene calls it itself when a scene is already loaded
+	void Reset();
+
+	// How many UV sets and vertex color layers are extracted into
+	// the vertex stream (clamped to MAX_UV_SETS / MAX_COLOR_SETS)
+	void SetVertexLayout(unsigned int inUVSetCount, unsigned int inColorSetCount);
+
+	// Axis system, units and texture v direction of the written files.
+	// Processing converts the vertices, triangles, node transforms and
+	// joint transforms once, every writer uses the converted data.
+	// CoordinateConverter::LeftHanded by default
+	void SetCoordinateConversion(const CoordinateConverter& inConverter);
+
+	// Nodes whose geometry and materials are identical to an earlier
+	// node's share its processed geometry and are written as instances
+	// of it (see SM_node). Only for .static_mesh files, and not used
+	// with static batching or skinning
+	void SetInstancing(bool inEnable);
+
+	// Bakes node transforms into static geometry and merges all
+	// triangles sharing a material into one draw range. With
+	// inSplitAt64k a range never spans more than 65536 vertices
+	void SetStaticBatching(bool inEnable, bool inSplitAt64k);
+
+	// Generates inLevelCount levels of detail after optimization,
+	// every level keeping inTriangleRatio of the previous one's triangles
+	void SetLodChain(unsigned int inLevelCount, float inTriangleRatio);
+
+	// Partitions every draw range into meshlets for cluster culling
+	void SetMeshletGeneration(bool inEnable);
+
+	// Bakes a SAH bounding volume hierarchy per node for raycasts
+	void SetBvhGeneration(bool inEnable);
+
+	// Skinned scenes also get a .static_anim file of parent relative
+	// translation, rotation and scale keys. With inQuantizeRotations
+	// the rotations are stored as 16 bit normalized integers
+	void SetAnimationOutput(bool inQuantizeRotations);
+
+	// Skinned vertices keep their MAX_INFLUENCES (SKIN_INFLUENCES, 4 or
+	// 8) strongest influences, without those weighing less than
+	// inMinWeight of them together, renormalized and quantized to 1/255
+	// steps that sum to exactly 1. 1/255 by default
+	void SetSkinWeights(float inMinWeight);
+
+	// Splits the draw ranges of skinned meshes so the vertices of each
+	// reference at most inMaxBones joints (clamped to [3 *
+	// MAX_INFLUENCES, 256]), and rewrites their blend indices as indices
+	// into the range's palette. The .static_mesh file then has a byte
+	// skin stream and the palette tables. 0 keeps the global joint indices
+	void SetBonePalettes(unsigned int inMaxBones);
+
+	// Flushes every written file to disk before it replaces the old one
+	void SetSyncOutput(bool inEnable);
+
+	// Stores the .static_mesh sections as independent LZ4 blocks. With
+	// inShuffleVertices the vertex streams are byte shuffled and delta
+	// coded first, which usually compresses them much better
+	void SetCompression(bool inEnable, bool inShuffleVertices);
+
+	// With compression, codes the triangles with the edge/vertex FIFO
+	// index codec and the vertex streams with the delta vertex codec
+	// (see GeometryCodec) instead
+	void SetGeometryCodec(bool inEnable);
+
+	// Text exports (.itpmesh/.itpanim) write floats as the shortest
+	// decimal that reads back exactly. inStreamCompatible restores the
+	// old std::ostream formatting for byte identical output. Vertices
+	// are formatted on up to inThreads threads
+	void SetTextOutput(bool inStreamCompatible, unsigned int inThreads);
+
+	// ImportScene reads binary FBX files with BinaryFbxImporter straight
+	// into the snapshot, without the FBX SDK, inflating their arrays on
+	// up to inInflateThreads threads. Files it cannot read (ASCII FBX,
+	// other formats) still go through FbxImporter
+	void SetNativeImport(bool inEnable, unsigned int inInflateThreads);
+
+	// Threads the LOD and BVH generation of one scene may use, all
+	// hardware threads by default
+	void SetWorkerThreads(unsigned int inThreads);
+
+	// Keeps the extracted scene in the snapshot while it is processed, so
+	// ProcessScene and ExportFBX can run again with other settings
+	// without a new import. This holds a second copy of the vertices.
+	// Off by default: the stages take the snapshot's data over, and a
+	// scene that only exists as a snapshot (native import, LoadSnapshot)
+	// can be processed once
+	void SetKeepSnapshot(bool inEnable);
+
+	// Progress, timings and errors go to inLog, std::cout by default
+	void SetLog(std::ostream* inLog);
+
+	// Limits the next imports to what one kind of export needs: the
+	// FbxIOSettings skip the other categories and embedded media, and
+	// extraction skips the stages the profile does not run
+	void SetImportProfile(ImportProfile inProfile);
+
+	// ImportScene followed by ProcessScene
 	bool LoadScene(const char* inFileName);
+	// Only reads the file into the FbxScene
+	bool ImportScene(const char* inFileName);
 
+	// Extracts the imported scene, the only step that reads the
+	// FbxScene, and processes it with the current settings. The stages
+	// work on the extracted data in place, see SetKeepSnapshot for
+	// processing the same scene again
 	bool ProcessScene();
+
+	// Saves the extracted scene (extracting it first if needed) in a
+	// binary snapshot. LoadSnapshot takes the place of ImportScene for
+	// such a file, it needs neither the FBX file nor Initialize. The
+	// vertex layout is the one the snapshot was extracted with
+	bool SaveSnapshot(const char* inPath);
+	bool LoadSnapshot(const char* inPath);
+
 	bool ExportAsMesh(const char* inOutputPath);
 	
+	// Processes the scene like ProcessScene, without the stages only the
+	// .static_mesh file holds, and writes the .itpmesh and .itpanim text
 	void ExportFBX();
 
 private:
@@ -32,46 +165,138 @@ private:
 	std::string mInputFilePath;
 	std::string mOutputFilePath;
 	bool mHasAnimation;
+	bool mSceneLoaded;
+	unsigned int mUVSetCount;
+	unsigned int mColorSetCount;
+	CoordinateConverter mCoordinateConverter;
+	bool mInstancing;
+	bool mStaticBatching;
+	bool mSplitBatchesAt64k;
+	unsigned int mLodLevelCount;
+	float mLodTriangleRatio;
+	bool mGenerateMeshlets;
+	bool mGenerateBvh;
+	bool mQuantizeRotations;
+	float mMinSkinWeight;
+	unsigned int mBonePaletteSize;
+	bool mSyncOutput;
+	bool mStreamCompatibleText;
+	unsigned int mTextThreads;
+	bool mCompressOutput;
+	bool mShuffleVertices;
+	bool mGeometryCodec;
+	bool mNativeImport;
+	unsigned int mInflateThreads;
+	unsigned int mWorkerThreads;
+	std::ostream* mLog;
+	ImportProfile mImportProfile;
+	ImportStages mImportStages;
 	std::unordered_map<unsigned int, CtrlPoint*> mControlPoints; 
 	unsigned int mTriangleCount;
 	std::vector<Triangle> mTriangles;
 	std::vector<PNTIWVertex> mVertices;
+	// mTriangles flattened by ComputeStatistics, for the stages after it
+	std::vector<unsigned int> mIndices;
 	std::vector<Texture> mTextures;
 	Skeleton mSkeleton;
+	std::vector<MeshNode> mMeshNodes;
+	std::vector<DrawRange> mDrawRanges;
+	// One per draw range when the bones are partitioned, into mPaletteJoints
+	std::vector<BonePalette> mBonePalettes;
+	std::vector<unsigned int> mPaletteJoints;
+	std::vector<LodLevel> mLodLevels;
+	MeshletData mMeshlets;
+	BvhData mBvh;
+	std::vector<unsigned int> mBvhRoots;
+	std::vector<RangeStatistics> mNodeStatistics;
+	std::vector<RangeStatistics> mRangeStatistics;
+	BoundingVolume mSceneBounds;
+	std::vector<SM_section> mSections;
+	// The extracted scene when it came from BinaryFbxImporter or a file,
+	// or is kept or saved, see SetKeepSnapshot
+	SceneSnapshot mSnapshot;
+	bool mHasSnapshot;
+	bool mKeepSnapshot;
+	// Materials are shared by the whole scene: mMaterialLookUp is keyed
+	// by global material index, mMaterialIndices maps a FBX material to it
+	// and mNodeMaterials maps the current node's material slots to it
 	std::unordered_map<unsigned int, Material*> mMaterialLookUp;
+	std::unordered_map<FbxSurfaceMaterial*, unsigned int> mMaterialIndices;
+	std::vector<unsigned int> mNodeMaterials;
 	FbxLongLong mAnimationLength;
 	std::string mAnimationName;
+	LocalAnimation mLocalAnimation;
 	LARGE_INTEGER mCPUFreq;
+	// Owns the per scene intermediate data, see CleanupFbxManager
+	SceneArena mArena;
 	
 
 private:
+	void ConfigureImportSettings();
+	void ExtractScene();
+	bool PrepareSceneData();
+	bool RunStages(bool inMeshFileStages);
+	void CaptureSnapshot();
+	void RestoreSnapshot();
 	void ProcessGeometry(FbxNode* inNode);
+	unsigned int CountPolygons(FbxNode* inNode);
 	void ProcessSkeletonHierarchy(FbxNode* inRootNode);
 	void ProcessSkeletonHierarchyRecursively(FbxNode* inNode, int inDepth, int myIndex, int inParentIndex);
 	void ProcessControlPoints(FbxNode* inNode);
 	void ProcessJointsAndAnimations(FbxNode* inNode);
 	unsigned int FindJointIndexUsingName(const std::string& inJointName);
 	void ProcessMesh(FbxNode* inNode);
-	void ReadUV(FbxMesh* inMesh, int inCtrlPointIndex, int inTextureUVIndex, int inUVLayer, XMFLOAT2& outUV);
+	unsigned int GetNodeMaterial(int inSlot);
+	void ReadUV(FbxMesh* inMesh, int inCtrlPointIndex, int inVertexCounter, int inUVLayer, XMFLOAT2& outUV);
+	void ReadColor(FbxMesh* inMesh, int inCtrlPointIndex, int inVertexCounter, int inColorLayer, XMFLOAT4& outColor);
 	void ReadNormal(FbxMesh* inMesh, int inCtrlPointIndex, int inVertexCounter, XMFLOAT3& outNormal);
 	void ReadBinormal(FbxMesh* inMesh, int inCtrlPointIndex, int inVertexCounter, XMFLOAT3& outBinormal);
 	void ReadTangent(FbxMesh* inMesh, int inCtrlPointIndex, int inVertexCounter, XMFLOAT3& outTangent);
+	void ProcessSkinWeights();
+	void DetectInstances();
 	void Optimize();
-	int FindVertex(const PNTIWVertex& inTargetVertex, const std::vector<PNTIWVertex>& uniqueVertices);
+	void ConvertCoordinates();
+	void BakeLocalAnimation();
+	void PartitionBones();
+	void BuildDrawRanges(unsigned int inNodeIndex);
+	void BakeNodeTransform(const MeshNode& inNode);
+	void BatchStaticGeometry();
+	void GenerateLods();
+	void GenerateLodLevel(const MeshSimplifier& inSimplifier, unsigned int inLevel);
+	void GenerateMeshlets();
+	void GenerateBvh();
+	void ComputeStatistics();
 
 	void AssociateMaterialToMesh(FbxNode* inNode);
 	void ProcessMaterials(FbxNode* inNode);
 	void ProcessMaterialAttribute(FbxSurfaceMaterial* inMaterial, unsigned int inMaterialIndex);
+	void AddDefaultMaterial();
+	Material* CreateDefaultMaterial();
 	void ProcessMaterialTexture(FbxSurfaceMaterial* inMaterial, Material* ioMaterial);
 	void PrintMaterial();
 	void PrintTriangles();
 	
 	void CleanupFbxManager();
+	void ClearSceneData();
+	void ClearProcessedData();
 	void WriteMeshToStream(std::ostream& inStream);
+	// Instantiated once per vertex layout, the skin lines are decided
+	// outside the vertex loop
+	template<bool Skinned>
+	void WriteVerticesText(TextWriter& ioWriter);
+	template<bool Skinned>
+	void WriteVertexText(TextWriter& ioWriter, const PNTIWVertex& inVertex);
 	void WriteAnimationToStream(std::ostream& inStream);
 
 	void OptimizeMaterials();
 
-	bool WriteMeshToFile(std::ostream& inStream);
-	bool WriteAnimationToFile(std::ostream& inStream);
+	void BeginSection(MeshFileWriter& inWriter, unsigned int inType, unsigned int inCodec, unsigned int inRecordSize);
+	void EndSection(MeshFileWriter& inWriter);
+	bool GetTextureSizes(std::vector<unsigned int>& outSizes);
+	// Stream 0 is SM_vertex, then the additional UV sets and the color sets
+	void GetVertexStreamFormats(std::vector<VertexStreamFormat>& outFormats) const;
+	size_t ComputeMeshFileSize(const std::vector<unsigned int>& inTextureSizes);
+	bool WriteMeshToFile(MeshFileWriter& ioWriter, const std::vector<unsigned int>& inTextureSizes);
+	size_t ComputeAnimationFileSize();
+	bool WriteAnimationToFile(MeshFileWriter& ioWriter);
 };
\ No newline at end of file
@@ -0,0 +1,406 @@
+#include "GeometryCodec.h"
+#include <cstring>
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define GEOMETRY_CODEC_SSE2
+#endif
+
+namespace
+{
+	const unsigned int kTriangleSize = 16;
+	const unsigned int kFifoSize = 16;
+	// Edge slots 0..14 are coded in the high nibble, 15 is a miss
+	const unsigned int kEdgeSlots = 15;
+	const unsigned char kMissCode = 0xF0;
+	const unsigned char kMaterialCode = 0xFF;
+
+	enum VertexMode { VERTEX_NEXT, VERTEX_FIFO, VERTEX_DELTA };
+
+	unsigned int ZigZag(unsigned int inValue)
+	{
+		return (inValue << 1) ^ static_cast<unsigned int>(static_cast<int>(inValue) >> 31);
+	}
+
+	unsigned int UnZigZag(unsigned int inValue)
+	{
+		return (inValue >> 1) ^ (0u - (inValue & 1));
+	}
+
+	void WriteVarint(unsigned int inValue, unsigned char*& ioOut)
+	{
+		while (inValue >= 0x80)
+		{
+			*ioOut++ = static_cast<unsigned char>(inValue | 0x80);
+			inValue >>= 7;
+		}
+		*ioOut++ = static_cast<unsigned char>(inValue);
+	}
+
+	bool ReadVarint(const unsigned char*& ioIn, const unsigned char* inEnd, unsigned int& outValue)
+	{
+		outValue = 0;
+		for (unsigned int shift = 0; shift < 35; shift += 7)
+		{
+			if (ioIn >= inEnd)
+			{
+				return false;
+			}
+			unsigned char byte = *ioIn++;
+			outValue |= static_cast<unsigned int>(byte & 0x7F) << shift;
+			if (!(byte & 0x80))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// State shared by encoder and decoder, both update it identically
+	struct IndexState
+	{
+		unsigned int mEdges[kFifoSize][2];
+		unsigned int mEdgeOffset;
+		unsigned int mVertices[kFifoSize];
+		unsigned int mVertexOffset;
+		unsigned int mNext;
+		unsigned int mLast;
+		unsigned int mMaterial;
+
+		IndexState()
+		{
+			memset(mEdges, 0xFF, sizeof(mEdges));
+			memset(mVertices, 0xFF, sizeof(mVertices));
+			mEdgeOffset = 0;
+			mVertexOffset = 0;
+			mNext = 0;
+			mLast = 0;
+			mMaterial = 0;
+		}
+
+		// Slot 0 is the most recent entry
+		const unsigned int* GetEdge(unsigned int inSlot) const
+		{
+			return mEdges[(mEdgeOffset - 1 - inSlot) & (kFifoSize - 1)];
+		}
+
+		unsigned int GetVertex(unsigned int inSlot) const
+		{
+			return mVertices[(mVertexOffset - 1 - inSlot) & (kFifoSize - 1)];
+		}
+
+		void PushEdge(unsigned int inA, unsigned int inB)
+		{
+			mEdges[mEdgeOffset & (kFifoSize - 1)][0] = inA;
+			mEdges[mEdgeOffset & (kFifoSize - 1)][1] = inB;
+			++mEdgeOffset;
+		}
+
+		void UseVertex(unsigned int inVertex, bool inFromFifo)
+		{
+			if (!inFromFifo)
+			{
+				mVertices[mVertexOffset & (kFifoSize - 1)] = inVertex;
+				++mVertexOffset;
+			}
+			if (inVertex + 1 > mNext)
+			{
+				mNext = inVertex + 1;
+			}
+			mLast = inVertex;
+		}
+
+		// A neighbour crosses a shared edge in the opposite direction
+		void PushTriangle(unsigned int inA, unsigned int inB, unsigned int inC)
+		{
+			PushEdge(inB, inA);
+			PushEdge(inC, inB);
+			PushEdge(inA, inC);
+		}
+	};
+
+	unsigned int EncodeVertex(IndexState& ioState, unsigned int inVertex, unsigned char*& ioData)
+	{
+		if (inVertex == ioState.mNext)
+		{
+			ioState.UseVertex(inVertex, false);
+			return VERTEX_NEXT;
+		}
+		for (unsigned int i = 0; i < kFifoSize; ++i)
+		{
+			if (ioState.GetVertex(i) == inVertex)
+			{
+				*ioData++ = static_cast<unsigned char>(i);
+				ioState.UseVertex(inVertex, true);
+				return VERTEX_FIFO;
+			}
+		}
+		WriteVarint(ZigZag(inVertex - ioState.mLast), ioData);
+		ioState.UseVertex(inVertex, false);
+		return VERTEX_DELTA;
+	}
+
+	bool DecodeVertex(IndexState& ioState, unsigned int inMode, const unsigned char*& ioIn, const unsigned char* inEnd, unsigned int& outVertex)
+	{
+		switch (inMode)
+		{
+		case VERTEX_NEXT:
+			outVertex = ioState.mNext;
+			ioState.UseVertex(outVertex, false);
+			return true;
+		case VERTEX_FIFO:
+			if (ioIn >= inEnd || *ioIn >= kFifoSize)
+			{
+				return false;
+			}
+			outVertex = ioState.GetVertex(*ioIn++);
+			ioState.UseVertex(outVertex, true);
+			return true;
+		case VERTEX_DELTA:
+		{
+			unsigned int delta;
+			if (!ReadVarint(ioIn, inEnd, delta))
+			{
+				return false;
+			}
+			outVertex = ioState.mLast + UnZigZag(delta);
+			ioState.UseVertex(outVertex, false);
+			return true;
+		}
+		default:
+			return false;
+		}
+	}
+}
+
+unsigned int GeometryCodec::GetIndexBound(unsigned int inTriangleCount)
+{
+	// Material change (6), code (1), vertex modes (1), 3 deltas (15)
+	return inTriangleCount * 23 + kTriangleSize;
+}
+
+unsigned int GeometryCodec::EncodeIndices(const char* inData, unsigned int inSize, char* outEncoded)
+{
+	const unsigned int triangleCount = inSize / kTriangleSize;
+	unsigned char* out = reinterpret_cast<unsigned char*>(outEncoded);
+	IndexState state;
+
+	for (unsigned int t = 0; t < triangleCount; ++t)
+	{
+		unsigned int triangle[4];
+		memcpy(triangle, inData + t * kTriangleSize, kTriangleSize);
+
+		if (triangle[3] != state.mMaterial)
+		{
+			*out++ = kMaterialCode;
+			WriteVarint(ZigZag(triangle[3] - state.mMaterial), out);
+			state.mMaterial = triangle[3];
+		}
+
+		// Rotation r starts the triangle at its r-th vertex
+		unsigned int hitSlot = kEdgeSlots;
+		unsigned int hitRotation = 0;
+		for (unsigned int slot = 0; slot < kEdgeSlots && hitSlot == kEdgeSlots; ++slot)
+		{
+			const unsigned int* edge = state.GetEdge(slot);
+			for (unsigned int r = 0; r < 3; ++r)
+			{
+				if (edge[0] == triangle[r] && edge[1] == triangle[(r + 1) % 3])
+				{
+					hitSlot = slot;
+					hitRotation = r;
+					break;
+				}
+			}
+		}
+
+		if (hitSlot < kEdgeSlots)
+		{
+			unsigned char* code = out++;
+			unsigned int mode = EncodeVertex(state, triangle[(hitRotation + 2) % 3], out);
+			*code = static_cast<unsigned char>((hitSlot << 4) | (hitRotation << 2) | mode);
+		}
+		else
+		{
+			*out++ = kMissCode;
+			unsigned char* modes = out++;
+			unsigned int modeA = EncodeVertex(state, triangle[0], out);
+			unsigned int modeB = EncodeVertex(state, triangle[1], out);
+			unsigned int modeC = EncodeVertex(state, triangle[2], out);
+			*modes = static_cast<unsigned char>(modeA | (modeB << 2) | (modeC << 4));
+		}
+		state.PushTriangle(triangle[0], triangle[1], triangle[2]);
+	}
+
+	const unsigned int tail = inSize - triangleCount * kTriangleSize;
+	memcpy(out, inData + triangleCount * kTriangleSize, tail);
+	out += tail;
+
+	return static_cast<unsigned int>(out - reinterpret_cast<unsigned char*>(outEncoded));
+}
+
+bool GeometryCodec::DecodeIndices(const char* inEncoded, unsigned int inEncodedSize, char* outData, unsigned int inRawSize)
+{
+	const unsigned int triangleCount = inRawSize / kTriangleSize;
+	const unsigned int tail = inRawSize - triangleCount * kTriangleSize;
+	const unsigned char* in = reinterpret_cast<const unsigned char*>(inEncoded);
+	const unsigned char* inEnd = in + inEncodedSize;
+	IndexState state;
+
+	unsigned int t = 0;
+	while (t < triangleCount)
+	{
+		if (in >= inEnd)
+		{
+			return false;
+		}
+		unsigned char code = *in++;
+		unsigned int triangle[4];
+
+		if (code == kMaterialCode)
+		{
+			unsigned int delta;
+			if (!ReadVarint(in, inEnd, delta))
+			{
+				return false;
+			}
+			state.mMaterial += UnZigZag(delta);
+			continue;
+		}
+		else if (code == kMissCode)
+		{
+			if (in >= inEnd)
+			{
+				return false;
+			}
+			unsigned char modes = *in++;
+			for (unsigned int i = 0; i < 3; ++i)
+			{
+				if (!DecodeVertex(state, (modes >> (i * 2)) & 3, in, inEnd, triangle[i]))
+				{
+					return false;
+				}
+			}
+		}
+		else
+		{
+			unsigned int slot = code >> 4;
+			unsigned int rotation = (code >> 2) & 3;
+			if (slot >= kEdgeSlots || rotation > 2)
+			{
+				return false;
+			}
+			const unsigned int* edge = state.GetEdge(slot);
+			triangle[rotation] = edge[0];
+			triangle[(rotation + 1) % 3] = edge[1];
+			if (!DecodeVertex(state, code & 3, in, inEnd, triangle[(rotation + 2) % 3]))
+			{
+				return false;
+			}
+		}
+
+		triangle[3] = state.mMaterial;
+		memcpy(outData + t * kTriangleSize, triangle, kTriangleSize);
+		state.PushTriangle(triangle[0], triangle[1], triangle[2]);
+		++t;
+	}
+
+	if (static_cast<unsigned int>(inEnd - in) != tail)
+	{
+		return false;
+	}
+	memcpy(outData + triangleCount * kTriangleSize, in, tail);
+	return true;
+}
+
+void GeometryCodec::EncodeVertices(const char* inData, unsigned int inSize, unsigned int inStride, char* outEncoded)
+{
+	const unsigned int count = inSize / inStride;
+	const unsigned int words = inStride / 4;
+	unsigned char* out = reinterpret_cast<unsigned char*>(outEncoded);
+
+	for (unsigned int k = 0; k < words; ++k)
+	{
+		unsigned int previous = 0;
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			unsigned int word;
+			memcpy(&word, inData + i * inStride + k * 4, 4);
+			unsigned int delta = ZigZag(word - previous);
+			previous = word;
+			for (unsigned int b = 0; b < 4; ++b)
+			{
+				out[(k * 4 + b) * count + i] = static_cast<unsigned char>(delta >> (b * 8));
+			}
+		}
+	}
+
+	memcpy(outEncoded + count * inStride, inData + count * inStride, inSize - count * inStride);
+}
+
+void GeometryCodec::DecodeVertices(const char* inEncoded, unsigned int inSize, unsigned int inStride, char* outData)
+{
+	const unsigned int count = inSize / inStride;
+	const unsigned int words = inStride / 4;
+	const unsigned char* in = reinterpret_cast<const unsigned char*>(inEncoded);
+
+	for (unsigned int k = 0; k < words; ++k)
+	{
+		const unsigned char* planes[4];
+		for (unsigned int b = 0; b < 4; ++b)
+		{
+			planes[b] = in + (k * 4 + b) * count;
+		}
+		char* out = outData + k * 4;
+		unsigned int previous = 0;
+		unsigned int i = 0;
+
+#ifdef GEOMETRY_CODEC_SSE2
+		// 16 records at a time: interleave the byte planes back into
+		// words, undo the zigzag and prefix sum 4 words per register
+		const __m128i one = _mm_set1_epi32(1);
+		for (; i + 16 <= count; i += 16)
+		{
+			__m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[0] + i));
+			__m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[1] + i));
+			__m128i p2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[2] + i));
+			__m128i p3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[3] + i));
+			__m128i low01 = _mm_unpacklo_epi8(p0, p1);
+			__m128i high01 = _mm_unpackhi_epi8(p0, p1);
+			__m128i low23 = _mm_unpacklo_epi8(p2, p3);
+			__m128i high23 = _mm_unpackhi_epi8(p2, p3);
+			__m128i groups[4] =
+			{
+				_mm_unpacklo_epi16(low01, low23), _mm_unpackhi_epi16(low01, low23),
+				_mm_unpacklo_epi16(high01, high23), _mm_unpackhi_epi16(high01, high23)
+			};
+
+			__m128i running = _mm_set1_epi32(static_cast<int>(previous));
+			for (unsigned int g = 0; g < 4; ++g)
+			{
+				__m128i delta = _mm_xor_si128(_mm_srli_epi32(groups[g], 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(groups[g], one)));
+				delta = _mm_add_epi32(delta, _mm_slli_si128(delta, 4));
+				delta = _mm_add_epi32(delta, _mm_slli_si128(delta, 8));
+				running = _mm_add_epi32(delta, running);
+
+				unsigned int values[4];
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(values), running);
+				for (unsigned int j = 0; j < 4; ++j)
+				{
+					memcpy(out + (i + g * 4 + j) * inStride, &values[j], 4);
+				}
+				running = _mm_shuffle_epi32(running, _MM_SHUFFLE(3, 3, 3, 3));
+			}
+			previous = static_cast<unsigned int>(_mm_cvtsi128_si32(running));
+		}
+#endif
+
+		for (; i < count; ++i)
+		{
+			unsigned int delta = planes[0][i] | (planes[1][i] << 8) | (planes[2][i] << 16) | (static_cast<unsigned int>(planes[3][i]) << 24);
+			previous += UnZigZag(delta);
+			memcpy(out + i * inStride, &previous, 4);
+		}
+	}
+
+	memcpy(outData + count * inStride, inEncoded + count * inStride, inSize - count * inStride);
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <vector>
+
+// Geometry aware codecs used in front of the block compressor
+// Both round trip exactly and reset their state per call, so every
+// compressed block stays independently decodable
+//
+// Index codec: triangles are SM_triangle records (3 indices and a
+// material). A triangle that shares an edge with one of the last 16
+// triangles is coded as that edge plus its third vertex; vertices are
+// coded as "the next unused index", a slot in a FIFO of recently used
+// vertices, or a delta to the previous vertex. Material changes are
+// coded inline. Welded, cache ordered meshes take 1 to 2 bytes per
+// triangle before compression
+//
+// Vertex codec: records of inStride bytes (a multiple of 4) are seen as
+// 32 bit words. Every word is stored as the zigzagged difference to the
+// same word of the previous record, in byte planes, so the mostly zero
+// high bytes end up next to each other. Decoding uses SSE2 when available
+class GeometryCodec
+{
+public:
+	// Worst case size of EncodeIndices output
+	static unsigned int GetIndexBound(unsigned int inTriangleCount);
+
+	// inData holds inSize / 16 SM_triangle records; a partial record at
+	// the end is copied as is. Returns the encoded size
+	static unsigned int EncodeIndices(const char* inData, unsigned int inSize, char* outEncoded);
+	// outData must hold inRawSize bytes. False on corrupt input
+	static bool DecodeIndices(const char* inEncoded, unsigned int inEncodedSize, char* outData, unsigned int inRawSize);
+
+	// The encoded size is always inSize
+	static void EncodeVertices(const char* inData, unsigned int inSize, unsigned int inStride, char* outEncoded);
+	static void DecodeVertices(const char* inEncoded, unsigned int inSize, unsigned int inStride, char* outData);
+};
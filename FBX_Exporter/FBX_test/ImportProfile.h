@@ -0,0 +1,40 @@
+#pragma once
+
+// What an import reads from the file and extracts from it, see
+// FBXExporter::SetImportProfile
+enum ImportProfile
+{
+	// Everything, the default
+	IMPORT_FULL,
+	// Geometry and materials, no skeleton, skin or animation
+	IMPORT_STATIC_MESH,
+	// Geometry, materials, skeleton and skin weights with the bind
+	// pose, no keyframes
+	IMPORT_SKINNED_MESH,
+	// Skeleton, bind pose and keyframes, no vertices or materials
+	IMPORT_ANIMATION_ONLY,
+	// Only the materials of the mesh nodes
+	IMPORT_MATERIALS_ONLY
+};
+
+// Extraction stages a profile runs
+struct ImportStages
+{
+	// ProcessSkeletonHierarchy and the skin clusters
+	bool mSkeleton;
+	// Keyframes of the skinned joints
+	bool mAnimation;
+	// Vertices and triangles
+	bool mMesh;
+	bool mMaterials;
+};
+
+inline ImportStages GetImportStages(ImportProfile inProfile)
+{
+	ImportStages stages;
+	stages.mSkeleton = inProfile == IMPORT_FULL || inProfile == IMPORT_SKINNED_MESH || inProfile == IMPORT_ANIMATION_ONLY;
+	stages.mAnimation = inProfile == IMPORT_FULL || inProfile == IMPORT_ANIMATION_ONLY;
+	stages.mMesh = inProfile == IMPORT_FULL || inProfile == IMPORT_STATIC_MESH || inProfile == IMPORT_SKINNED_MESH;
+	stages.mMaterials = inProfile == IMPORT_FULL || inProfile == IMPORT_STATIC_MESH || inProfile == IMPORT_SKINNED_MESH || inProfile == IMPORT_MATERIALS_ONLY;
+	return stages;
+}
@@ -0,0 +1,433 @@
+#include "Inflater.h"
+#include <cstring>
+
+namespace
+{
+	const unsigned int kMaxBits = 15;
+	// Codes up to this length are decoded with one table lookup
+	const unsigned int kFastBits = 10;
+	const unsigned int kMaxLiteralCodes = 288;
+	const unsigned int kMaxDistanceCodes = 30;
+
+	const unsigned short kLengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const unsigned char kLengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const unsigned short kDistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const unsigned char kDistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+	const unsigned char kCodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	// LSB first, as deflate packs its bits. Reading past the end
+	// yields zeros and is reported by Overrun
+	class BitReader
+	{
+	public:
+		BitReader(const unsigned char* inData, const unsigned char* inEnd) :
+			mIn(inData),
+			mEnd(inEnd),
+			mBuffer(0),
+			mCount(0),
+			mPadding(0)
+		{}
+
+		unsigned int Peek(unsigned int inBits)
+		{
+			if (mCount < inBits)
+			{
+				Refill();
+			}
+			return static_cast<unsigned int>(mBuffer & ((1ull << inBits) - 1));
+		}
+
+		void Consume(unsigned int inBits)
+		{
+			mBuffer >>= inBits;
+			mCount -= inBits;
+		}
+
+		unsigned int Read(unsigned int inBits)
+		{
+			if (inBits == 0)
+			{
+				return 0;
+			}
+			unsigned int value = Peek(inBits);
+			Consume(inBits);
+			return value;
+		}
+
+		// Stored blocks start at a byte boundary
+		void AlignToByte()
+		{
+			Consume(mCount & 7);
+		}
+
+		bool ReadBytes(unsigned char* outData, unsigned int inSize)
+		{
+			// The whole bytes still in the buffer come first
+			while (inSize > 0 && mCount >= 8)
+			{
+				*outData++ = static_cast<unsigned char>(Read(8));
+				--inSize;
+			}
+			if (static_cast<size_t>(mEnd - mIn) < inSize)
+			{
+				return false;
+			}
+			memcpy(outData, mIn, inSize);
+			mIn += inSize;
+			return true;
+		}
+
+		bool Overrun() const
+		{
+			return mPadding * 8 > mCount;
+		}
+
+	private:
+		void Refill()
+		{
+			while (mCount <= 56)
+			{
+				if (mIn < mEnd)
+				{
+					mBuffer |= static_cast<unsigned long long>(*mIn++) << mCount;
+				}
+				else
+				{
+					++mPadding;
+				}
+				mCount += 8;
+			}
+		}
+
+		const unsigned char* mIn;
+		const unsigned char* mEnd;
+		unsigned long long mBuffer;
+		unsigned int mCount;
+		unsigned int mPadding;
+	};
+
+	// Canonical Huffman code. mFast holds symbol << 4 | length for the
+	// codes of up to kFastBits bits (indexed by the bit reversed code),
+	// longer codes are decoded one bit at a time from mCount/mSymbol
+	struct Huffman
+	{
+		unsigned short mFast[1 << kFastBits];
+		unsigned short mCount[kMaxBits + 1];
+		unsigned short mSymbol[kMaxLiteralCodes];
+
+		// Incomplete codes are allowed (a single distance code is),
+		// oversubscribed ones are not
+		bool Build(const unsigned char* inLengths, unsigned int inCount)
+		{
+			memset(mCount, 0, sizeof(mCount));
+			for (unsigned int i = 0; i < inCount; ++i)
+			{
+				++mCount[inLengths[i]];
+			}
+			mCount[0] = 0;
+
+			int left = 1;
+			unsigned short offsets[kMaxBits + 2];
+			offsets[1] = 0;
+			for (unsigned int length = 1; length <= kMaxBits; ++length)
+			{
+				left = (left << 1) - mCount[length];
+				if (left < 0)
+				{
+					return false;
+				}
+				offsets[length + 1] = offsets[length] + mCount[length];
+			}
+			for (unsigned int i = 0; i < inCount; ++i)
+			{
+				if (inLengths[i] != 0)
+				{
+					mSymbol[offsets[inLengths[i]]++] = static_cast<unsigned short>(i);
+				}
+			}
+
+			memset(mFast, 0, sizeof(mFast));
+			unsigned int code = 0;
+			unsigned int index = 0;
+			for (unsigned int length = 1; length <= kFastBits; ++length)
+			{
+				for (unsigned int i = 0; i < mCount[length]; ++i, ++code, ++index)
+				{
+					unsigned int reversed = 0;
+					for (unsigned int bit = 0; bit < length; ++bit)
+					{
+						reversed |= ((code >> bit) & 1) << (length - 1 - bit);
+					}
+					unsigned short entry = static_cast<unsigned short>(mSymbol[index] << 4 | length);
+					for (unsigned int j = reversed; j < (1u << kFastBits); j += 1u << length)
+					{
+						mFast[j] = entry;
+					}
+				}
+				code <<= 1;
+			}
+			return true;
+		}
+
+		int Decode(BitReader& ioReader) const
+		{
+			unsigned int bits = ioReader.Peek(kMaxBits);
+			unsigned int entry = mFast[bits & ((1 << kFastBits) - 1)];
+			if (entry != 0)
+			{
+				ioReader.Consume(entry & 15);
+				return entry >> 4;
+			}
+
+			int code = 0;
+			int first = 0;
+			int index = 0;
+			for (unsigned int length = 1; length <= kMaxBits; ++length)
+			{
+				code |= (bits >> (length - 1)) & 1;
+				int count = mCount[length];
+				if (code - first < count)
+				{
+					ioReader.Consume(length);
+					return mSymbol[index + code - first];
+				}
+				index += count;
+				first = (first + count) << 1;
+				code <<= 1;
+			}
+			return -1;
+		}
+	};
+
+	struct FixedCodes
+	{
+		Huffman mLiterals;
+		Huffman mDistances;
+
+		FixedCodes()
+		{
+			unsigned char lengths[kMaxLiteralCodes];
+			memset(lengths, 8, 144);
+			memset(lengths + 144, 9, 112);
+			memset(lengths + 256, 7, 24);
+			memset(lengths + 280, 8, 8);
+			mLiterals.Build(lengths, kMaxLiteralCodes);
+			memset(lengths, 5, kMaxDistanceCodes);
+			mDistances.Build(lengths, kMaxDistanceCodes);
+		}
+	};
+
+	bool ReadDynamicCodes(BitReader& ioReader, Huffman& outLiterals, Huffman& outDistances)
+	{
+		unsigned int literalCount = ioReader.Read(5) + 257;
+		unsigned int distanceCount = ioReader.Read(5) + 1;
+		unsigned int codeLengthCount = ioReader.Read(4) + 4;
+		if (literalCount > 286 || distanceCount > kMaxDistanceCodes)
+		{
+			return false;
+		}
+
+		unsigned char lengths[kMaxLiteralCodes + kMaxDistanceCodes];
+		memset(lengths, 0, 19);
+		for (unsigned int i = 0; i < codeLengthCount; ++i)
+		{
+			lengths[kCodeLengthOrder[i]] = static_cast<unsigned char>(ioReader.Read(3));
+		}
+		Huffman codeLengths;
+		if (!codeLengths.Build(lengths, 19))
+		{
+			return false;
+		}
+
+		// Literal and distance lengths form one sequence, repeats
+		// may cross from one into the other
+		unsigned int count = literalCount + distanceCount;
+		for (unsigned int i = 0; i < count;)
+		{
+			int symbol = codeLengths.Decode(ioReader);
+			if (symbol < 0)
+			{
+				return false;
+			}
+			if (symbol < 16)
+			{
+				lengths[i++] = static_cast<unsigned char>(symbol);
+				continue;
+			}
+
+			unsigned char value = 0;
+			unsigned int repeat;
+			if (symbol == 16)
+			{
+				if (i == 0)
+				{
+					return false;
+				}
+				value = lengths[i - 1];
+				repeat = 3 + ioReader.Read(2);
+			}
+			else if (symbol == 17)
+			{
+				repeat = 3 + ioReader.Read(3);
+			}
+			else
+			{
+				repeat = 11 + ioReader.Read(7);
+			}
+			if (i + repeat > count)
+			{
+				return false;
+			}
+			memset(lengths + i, value, repeat);
+			i += repeat;
+		}
+
+		// A block without end of block code could never end
+		if (lengths[256] == 0 || ioReader.Overrun())
+		{
+			return false;
+		}
+		return outLiterals.Build(lengths, literalCount) && outDistances.Build(lengths + literalCount, distanceCount);
+	}
+
+	bool InflateBlock(BitReader& ioReader, const Huffman& inLiterals, const Huffman& inDistances, unsigned char* inBegin, unsigned char*& ioOut, unsigned char* inEnd)
+	{
+		unsigned char* out = ioOut;
+		for (;;)
+		{
+			int symbol = inLiterals.Decode(ioReader);
+			if (symbol < 256)
+			{
+				if (symbol < 0 || out == inEnd)
+				{
+					return false;
+				}
+				*out++ = static_cast<unsigned char>(symbol);
+				continue;
+			}
+			if (symbol == 256)
+			{
+				break;
+			}
+
+			symbol -= 257;
+			if (symbol >= 29)
+			{
+				return false;
+			}
+			unsigned int length = kLengthBase[symbol] + ioReader.Read(kLengthExtra[symbol]);
+
+			symbol = inDistances.Decode(ioReader);
+			if (symbol < 0 || symbol >= 30)
+			{
+				return false;
+			}
+			unsigned int distance = kDistanceBase[symbol] + ioReader.Read(kDistanceExtra[symbol]);
+			if (distance > static_cast<size_t>(out - inBegin) || length > static_cast<size_t>(inEnd - out) || ioReader.Overrun())
+			{
+				return false;
+			}
+
+			// Byte by byte, matches may overlap their own output
+			const unsigned char* match = out - distance;
+			for (unsigned int i = 0; i < length; ++i)
+			{
+				out[i] = match[i];
+			}
+			out += length;
+		}
+		ioOut = out;
+		return true;
+	}
+
+	unsigned int Adler32(const unsigned char* inData, size_t inSize)
+	{
+		const unsigned int kModulus = 65521;
+		// Largest run before the sums can overflow 32 bits
+		const size_t kRun = 5552;
+		unsigned int a = 1;
+		unsigned int b = 0;
+		while (inSize > 0)
+		{
+			size_t run = inSize < kRun ? inSize : kRun;
+			inSize -= run;
+			for (size_t i = 0; i < run; ++i)
+			{
+				a += inData[i];
+				b += a;
+			}
+			inData += run;
+			a %= kModulus;
+			b %= kModulus;
+		}
+		return (b << 16) | a;
+	}
+}
+
+bool Inflater::Decompress(const char* inSource, unsigned int inSize, char* outDestination, unsigned int inRawSize)
+{
+	const unsigned char* in = reinterpret_cast<const unsigned char*>(inSource);
+	if (inSize < 6)
+	{
+		return false;
+	}
+	// Deflate without preset dictionary
+	if ((in[0] & 0x0F) != 8 || (in[0] >> 4) > 7 || (in[1] & 0x20) || ((in[0] << 8) | in[1]) % 31 != 0)
+	{
+		return false;
+	}
+
+	static const FixedCodes fixedCodes;
+	Huffman literals;
+	Huffman distances;
+
+	// The Adler-32 of the output follows the deflate stream
+	BitReader reader(in + 2, in + inSize - 4);
+	unsigned char* outBegin = reinterpret_cast<unsigned char*>(outDestination);
+	unsigned char* out = outBegin;
+	unsigned char* outEnd = outBegin + inRawSize;
+	unsigned int last;
+	do
+	{
+		last = reader.Read(1);
+		unsigned int type = reader.Read(2);
+		if (type == 0)
+		{
+			reader.AlignToByte();
+			unsigned int length = reader.Read(16);
+			unsigned int complement = reader.Read(16);
+			if ((length ^ 0xFFFF) != complement || length > static_cast<size_t>(outEnd - out) || !reader.ReadBytes(out, length))
+			{
+				return false;
+			}
+			out += length;
+		}
+		else if (type == 1)
+		{
+			if (!InflateBlock(reader, fixedCodes.mLiterals, fixedCodes.mDistances, outBegin, out, outEnd))
+			{
+				return false;
+			}
+		}
+		else if (type == 2)
+		{
+			if (!ReadDynamicCodes(reader, literals, distances) || !InflateBlock(reader, literals, distances, outBegin, out, outEnd))
+			{
+				return false;
+			}
+		}
+		else
+		{
+			return false;
+		}
+
+		if (reader.Overrun())
+		{
+			return false;
+		}
+	} while (!last);
+
+	const unsigned char* checksum = in + inSize - 4;
+	unsigned int expected = (checksum[0] << 24) | (checksum[1] << 16) | (checksum[2] << 8) | checksum[3];
+	return out == outEnd && Adler32(outBegin, inRawSize) == expected;
+}
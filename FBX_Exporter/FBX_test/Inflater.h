@@ -0,0 +1,12 @@
+#pragma once
+
+// zlib stream (RFC 1950 / 1951) decoder for the compressed array
+// properties of binary FBX files, written for the exporter so no
+// library has to be linked. Only decompression is supported
+class Inflater
+{
+public:
+	// outDestination must hold inRawSize bytes. False on corrupt input,
+	// a checksum mismatch or output that is not exactly inRawSize bytes
+	static bool Decompress(const char* inSource, unsigned int inSize, char* outDestination, unsigned int inRawSize);
+};
@@ -0,0 +1,114 @@
+#include "MappedFile.h"
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+MappedFile::MappedFile() :
+	mData(nullptr),
+	mSize(0)
+{
+#ifdef _WIN32
+	mFile = INVALID_HANDLE_VALUE;
+	mMapping = nullptr;
+#else
+	mFile = -1;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const std::string& inPath)
+{
+	Close();
+
+#ifdef _WIN32
+	mFile = CreateFileA(inPath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (mFile == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (GetFileSizeEx(mFile, &size) && size.QuadPart > 0)
+	{
+		mSize = static_cast<size_t>(size.QuadPart);
+		mMapping = CreateFileMappingA(mFile, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mMapping)
+		{
+			mData = static_cast<const char*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, mSize));
+		}
+	}
+#else
+	mFile = open(inPath.c_str(), O_RDONLY);
+	if (mFile < 0)
+	{
+		return false;
+	}
+
+	struct stat status;
+	if (fstat(mFile, &status) == 0 && status.st_size > 0)
+	{
+		mSize = static_cast<size_t>(status.st_size);
+		void* data = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, mFile, 0);
+		mData = data != MAP_FAILED ? static_cast<const char*>(data) : nullptr;
+	}
+#endif
+
+	if (!mData)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (mData)
+	{
+		UnmapViewOfFile(mData);
+	}
+	if (mMapping)
+	{
+		CloseHandle(mMapping);
+		mMapping = nullptr;
+	}
+	if (mFile != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(mFile);
+		mFile = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (mData)
+	{
+		munmap(const_cast<char*>(mData), mSize);
+	}
+	if (mFile >= 0)
+	{
+		close(mFile);
+		mFile = -1;
+	}
+#endif
+	mData = nullptr;
+	mSize = 0;
+}
+
+const char* MappedFile::GetData() const
+{
+	return mData;
+}
+
+size_t MappedFile::GetSize() const
+{
+	return mSize;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <string>
+
+// Read only memory mapping of a whole file, the reading counterpart of
+// MeshFileWriter. Pages are only read from disk when they are touched
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	// False if the file cannot be opened or is empty
+	bool Open(const std::string& inPath);
+	void Close();
+
+	const char* GetData() const;
+	size_t GetSize() const;
+
+private:
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	const char* mData;
+	size_t mSize;
+#ifdef _WIN32
+	void* mFile;
+	void* mMapping;
+#else
+	int mFile;
+#endif
+};
@@ -2,6 +2,7 @@
 
 const XMFLOAT2 MathHelper::vector2Epsilon = XMFLOAT2(0.00001f, 0.00001f);
 const XMFLOAT3 MathHelper::vector3Epsilon = XMFLOAT3(0.00001f, 0.00001f, 0.00001f);
+const XMFLOAT4 MathHelper::vector4Epsilon = XMFLOAT4(0.00001f, 0.00001f, 0.00001f, 0.00001f);
 
 
 bool MathHelper::CompareVector3WithEpsilon(const XMFLOAT3& lhs, const XMFLOAT3& rhs)
@@ -13,3 +14,8 @@ bool MathHelper::CompareVector2WithEpsilon(const XMFLOAT2& lhs, const XMFLOAT2&
 {
 	return XMVector3NearEqual(XMLoadFloat2(&lhs), XMLoadFloat2(&rhs), XMLoadFloat2(&vector2Epsilon)) == TRUE;
 }
+
+bool MathHelper::CompareVector4WithEpsilon(const XMFLOAT4& lhs, const XMFLOAT4& rhs)
+{
+	return XMVector4NearEqual(XMLoadFloat4(&lhs), XMLoadFloat4(&rhs), XMLoadFloat4(&vector4Epsilon)) == TRUE;
+}
\ No newline at end of file
@@ -7,6 +7,7 @@ class MathHelper
 {
 public:
 
+	static const XMFLOAT4 vector4Epsilon;
 	static const XMFLOAT3 vector3Epsilon;
 	static const XMFLOAT2 vector2Epsilon;
 	static const XMFLOAT3 vector3True;
@@ -14,4 +15,5 @@ public:
 
 	static bool CompareVector2WithEpsilon(const XMFLOAT2& lhs, const XMFLOAT2& rhs);
 	static bool CompareVector3WithEpsilon(const XMFLOAT3& lhs, const XMFLOAT3& rhs);
+	static bool CompareVector4WithEpsilon(const XMFLOAT4& lhs, const XMFLOAT4& rhs);
 };
\ No newline at end of file
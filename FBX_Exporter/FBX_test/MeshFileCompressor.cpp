@@ -0,0 +1,280 @@
+#include "MeshFileCompressor.h"
+#include "BlockCodec.h"
+#include "GeometryCodec.h"
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <cstring>
+
+namespace
+{
+	struct CompressedBlock
+	{
+		const char* mRaw;
+		unsigned int mRawSize;
+		unsigned int mEncodedSize;
+		std::vector<char> mData;
+	};
+
+	void CompressBlock(const SM_section& inSection, CompressedBlock& ioBlock)
+	{
+		const char* encoded = ioBlock.mRaw;
+		ioBlock.mEncodedSize = ioBlock.mRawSize;
+		std::vector<char> buffer;
+		switch (inSection.codec)
+		{
+		case SM_CODEC_SHUFFLE:
+			buffer.resize(ioBlock.mRawSize);
+			BlockCodec::Shuffle(ioBlock.mRaw, ioBlock.mRawSize, inSection.record_size, &buffer[0]);
+			break;
+		case SM_CODEC_VERTEX:
+			buffer.resize(ioBlock.mRawSize);
+			GeometryCodec::EncodeVertices(ioBlock.mRaw, ioBlock.mRawSize, inSection.record_size, &buffer[0]);
+			break;
+		case SM_CODEC_INDEX:
+			buffer.resize(GeometryCodec::GetIndexBound(ioBlock.mRawSize / inSection.record_size));
+			ioBlock.mEncodedSize = GeometryCodec::EncodeIndices(ioBlock.mRaw, ioBlock.mRawSize, &buffer[0]);
+			break;
+		}
+		if (!buffer.empty())
+		{
+			encoded = &buffer[0];
+		}
+
+		ioBlock.mData.resize(ioBlock.mEncodedSize);
+		unsigned int size = BlockCodec::Compress(encoded, ioBlock.mEncodedSize, &ioBlock.mData[0]);
+		if (size == 0)
+		{
+			memcpy(&ioBlock.mData[0], encoded, ioBlock.mEncodedSize);
+			size = ioBlock.mEncodedSize;
+		}
+		ioBlock.mData.resize(size);
+	}
+}
+
+bool MeshFileCompressor::Write(const char* inImage, const SM_header& inHeader, std::vector<SM_section>& ioSections,
+	const std::string& inPath, bool inSync)
+{
+	// Cut the sections into blocks; filtered blocks hold whole records
+	std::vector<CompressedBlock> blocks;
+	for (unsigned int i = 0; i < ioSections.size(); ++i)
+	{
+		SM_section& currSection = ioSections[i];
+		const unsigned int recordSize = std::max(currSection.record_size, 1u);
+		const unsigned int blockSize = BlockCodec::kBlockSize - BlockCodec::kBlockSize % recordSize;
+		currSection.first_block = blocks.size();
+		for (unsigned int offset = 0; offset < currSection.raw_size; offset += blockSize)
+		{
+			CompressedBlock currBlock;
+			currBlock.mRaw = inImage + currSection.raw_offset + offset;
+			currBlock.mRawSize = std::min(blockSize, currSection.raw_size - offset);
+			blocks.push_back(currBlock);
+		}
+		currSection.NumOf_Blocks = blocks.size() - currSection.first_block;
+	}
+
+	std::vector<unsigned int> blockSections(blocks.size());
+	for (unsigned int i = 0; i < ioSections.size(); ++i)
+	{
+		std::fill(blockSections.begin() + ioSections[i].first_block, blockSections.begin() + ioSections[i].first_block + ioSections[i].NumOf_Blocks, i);
+	}
+
+	std::atomic<unsigned int> nextBlock(0);
+	auto compressBlocks = [&]()
+	{
+		for (unsigned int i = nextBlock++; i < blocks.size(); i = nextBlock++)
+		{
+			CompressBlock(ioSections[blockSections[i]], blocks[i]);
+		}
+	};
+	std::vector<std::thread> threads;
+	const unsigned int threadCount = std::min(std::max(std::thread::hardware_concurrency(), 1u), static_cast<unsigned int>(blocks.size()));
+	for (unsigned int i = 1; i < threadCount; ++i)
+	{
+		threads.push_back(std::thread(compressBlocks));
+	}
+	compressBlocks();
+	for (unsigned int i = 0; i < threads.size(); ++i)
+	{
+		threads[i].join();
+	}
+
+	size_t fileSize = sizeof(SM_header) + sizeof(SM_section) * ioSections.size() + sizeof(SM_block) * blocks.size();
+	for (unsigned int i = 0; i < blocks.size(); ++i)
+	{
+		fileSize += blocks[i].mData.size();
+	}
+
+	MeshFileWriter output;
+	if (!output.Open(inPath, fileSize, inSync))
+	{
+		return false;
+	}
+
+	SM_header* header = output.ReserveArray<SM_header>(1);
+	*header = inHeader;
+	header->Flags |= SM_FLAG_COMPRESSED;
+	header->NumOf_Sections = ioSections.size();
+	header->NumOf_Blocks = blocks.size();
+	if (!ioSections.empty())
+	{
+		output.Write(&ioSections[0], sizeof(SM_section) * ioSections.size());
+	}
+
+	SM_block* blockTable = output.ReserveArray<SM_block>(blocks.size());
+	for (unsigned int i = 0; i < blocks.size(); ++i)
+	{
+		blockTable[i].raw_size = blocks[i].mRawSize;
+		blockTable[i].encoded_size = blocks[i].mEncodedSize;
+		blockTable[i].compressed_size = blocks[i].mData.size();
+		blockTable[i].file_offset = static_cast<unsigned int>(output.GetOffset());
+		output.Write(blocks[i].mData.data(), blocks[i].mData.size());
+	}
+
+	return output.Commit();
+}
+
+bool MeshFileCompressor::DecompressBlock(const char* inFile, const SM_section& inSection, const SM_block& inBlock, char* outRaw)
+{
+	const char* source = inFile + inBlock.file_offset;
+	if (inSection.codec == SM_CODEC_NONE)
+	{
+		if (inBlock.encoded_size != inBlock.raw_size)
+		{
+			return false;
+		}
+		if (inBlock.compressed_size == inBlock.encoded_size)
+		{
+			memcpy(outRaw, source, inBlock.raw_size);
+			return true;
+		}
+		return BlockCodec::Decompress(source, inBlock.compressed_size, outRaw, inBlock.raw_size);
+	}
+
+	std::vector<char> encoded(inBlock.encoded_size + 1);
+	if (inBlock.compressed_size == inBlock.encoded_size)
+	{
+		memcpy(&encoded[0], source, inBlock.encoded_size);
+	}
+	else if (!BlockCodec::Decompress(source, inBlock.compressed_size, &encoded[0], inBlock.encoded_size))
+	{
+		return false;
+	}
+
+	switch (inSection.codec)
+	{
+	case SM_CODEC_SHUFFLE:
+		if (inBlock.encoded_size != inBlock.raw_size)
+		{
+			return false;
+		}
+		BlockCodec::Unshuffle(&encoded[0], inBlock.raw_size, inSection.record_size, outRaw);
+		return true;
+	case SM_CODEC_VERTEX:
+		if (inBlock.encoded_size != inBlock.raw_size || inSection.record_size % 4 != 0)
+		{
+			return false;
+		}
+		GeometryCodec::DecodeVertices(&encoded[0], inBlock.raw_size, inSection.record_size, outRaw);
+		return true;
+	case SM_CODEC_INDEX:
+		return GeometryCodec::DecodeIndices(&encoded[0], inBlock.encoded_size, outRaw, inBlock.raw_size);
+	default:
+		return false;
+	}
+}
+
+bool MeshFileCompressor::Decompress(const char* inFile, size_t inFileSize, std::vector<char>& outImage)
+{
+	if (inFileSize < sizeof(SM_header))
+	{
+		return false;
+	}
+	SM_header header;
+	memcpy(&header, inFile, sizeof(SM_header));
+	if (!(header.Flags & SM_FLAG_COMPRESSED))
+	{
+		outImage.assign(inFile, inFile + inFileSize);
+		return true;
+	}
+
+	const size_t tableSize = sizeof(SM_section) * header.NumOf_Sections + sizeof(SM_block) * header.NumOf_Blocks;
+	if (inFileSize - sizeof(SM_header) < tableSize)
+	{
+		return false;
+	}
+	std::vector<SM_section> sections(header.NumOf_Sections);
+	std::vector<SM_block> blocks(header.NumOf_Blocks);
+	if (!sections.empty())
+	{
+		memcpy(&sections[0], inFile + sizeof(SM_header), sizeof(SM_section) * sections.size());
+	}
+	if (!blocks.empty())
+	{
+		memcpy(&blocks[0], inFile + sizeof(SM_header) + sizeof(SM_section) * sections.size(), sizeof(SM_block) * blocks.size());
+	}
+
+	// Everything that sizes an allocation is checked first: the sections
+	// follow the header without gaps or overlaps, each is made of the
+	// blocks after the previous one's, and no block decodes to more than
+	// Write produces
+	const size_t tablesEnd = sizeof(SM_header) + tableSize;
+	const unsigned int blockSize = BlockCodec::kBlockSize;
+	const unsigned int maxEncodedSize = std::max(blockSize, GeometryCodec::GetIndexBound(blockSize / sizeof(SM_triangle)));
+	size_t imageSize = sizeof(SM_header);
+	unsigned int nextBlock = 0;
+	for (unsigned int i = 0; i < sections.size(); ++i)
+	{
+		const SM_section& currSection = sections[i];
+		if (currSection.raw_offset != imageSize || currSection.first_block != nextBlock ||
+			currSection.NumOf_Blocks > blocks.size() - nextBlock)
+		{
+			return false;
+		}
+		size_t sectionSize = 0;
+		for (unsigned int b = currSection.first_block; b < currSection.first_block + currSection.NumOf_Blocks; ++b)
+		{
+			const SM_block& currBlock = blocks[b];
+			if (currBlock.raw_size > blockSize || currBlock.encoded_size > maxEncodedSize ||
+				currBlock.file_offset < tablesEnd || currBlock.file_offset > inFileSize ||
+				currBlock.compressed_size > inFileSize - currBlock.file_offset ||
+				currBlock.compressed_size > currBlock.encoded_size)
+			{
+				return false;
+			}
+			sectionSize += currBlock.raw_size;
+		}
+		if (sectionSize != currSection.raw_size)
+		{
+			return false;
+		}
+		imageSize += sectionSize;
+		nextBlock += currSection.NumOf_Blocks;
+	}
+	if (nextBlock != blocks.size())
+	{
+		return false;
+	}
+
+	outImage.assign(imageSize, 0);
+	header.Flags &= ~SM_FLAG_COMPRESSED;
+	header.NumOf_Sections = 0;
+	header.NumOf_Blocks = 0;
+	memcpy(&outImage[0], &header, sizeof(SM_header));
+
+	for (unsigned int i = 0; i < sections.size(); ++i)
+	{
+		const SM_section& currSection = sections[i];
+		size_t offset = currSection.raw_offset;
+		for (unsigned int b = currSection.first_block; b < currSection.first_block + currSection.NumOf_Blocks; ++b)
+		{
+			if (!DecompressBlock(inFile, currSection, blocks[b], &outImage[offset]))
+			{
+				return false;
+			}
+			offset += blocks[b].raw_size;
+		}
+	}
+
+	return true;
+}
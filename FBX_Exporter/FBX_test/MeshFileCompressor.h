@@ -0,0 +1,28 @@
+#pragma once
+#include "Vertex.h"
+#include "static_mesh_struct.h"
+#include "MeshFileWriter.h"
+
+// Block compression of .static_mesh files
+// The exporter writes the uncompressed file into memory and records
+// where each section starts; the sections are then cut into blocks of
+// at most BlockCodec::kBlockSize bytes, coded with the section's codec
+// and compressed on several threads. Readers can decompress the blocks
+// in any order
+class MeshFileCompressor
+{
+public:
+	// inImage is the uncompressed file, inSections its sections with
+	// type, codec, record_size, raw_offset and raw_size filled in
+	// Writes the compressed file with inHeader, to which the flag and
+	// the table sizes are added
+	static bool Write(const char* inImage, const SM_header& inHeader, std::vector<SM_section>& ioSections,
+		const std::string& inPath, bool inSync);
+
+	// Rebuilds the uncompressed file from a compressed one
+	static bool Decompress(const char* inFile, size_t inFileSize, std::vector<char>& outImage);
+
+	// Decompresses one block into outRaw (inBlock.raw_size bytes). The
+	// block must have passed Decompress's checks against the file
+	static bool DecompressBlock(const char* inFile, const SM_section& inSection, const SM_block& inBlock, char* outRaw);
+};
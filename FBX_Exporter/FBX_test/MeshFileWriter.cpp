@@ -0,0 +1,242 @@
+#include "MeshFileWriter.h"
+#include <cstring>
+#include <stdexcept>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <cstdio>
+#endif
+
+MeshFileWriter::MeshFileWriter() :
+	mSync(false),
+	mData(nullptr),
+	mSize(0),
+	mOffset(0)
+{
+#ifdef _WIN32
+	mFile = INVALID_HANDLE_VALUE;
+	mMapping = nullptr;
+#else
+	mFile = -1;
+#endif
+}
+
+MeshFileWriter::~MeshFileWriter()
+{
+	Abort();
+}
+
+bool MeshFileWriter::Open(const std::string& inPath, size_t inMaxSize, bool inSync)
+{
+	Abort();
+
+	mPath = inPath;
+	mTempPath = inPath + ".tmp";
+	mSync = inSync;
+	mSize = inMaxSize > 0 ? inMaxSize : 1;
+	mOffset = 0;
+
+#ifdef _WIN32
+	mFile = CreateFileA(mTempPath.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (mFile == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	// Creating the mapping also grows the file to mSize
+	unsigned long long size = mSize;
+	mMapping = CreateFileMappingA(mFile, NULL, PAGE_READWRITE, static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), NULL);
+	if (mMapping)
+	{
+		mData = static_cast<char*>(MapViewOfFile(mMapping, FILE_MAP_WRITE, 0, 0, mSize));
+	}
+#else
+	mFile = open(mTempPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (mFile < 0)
+	{
+		return false;
+	}
+
+	if (ftruncate(mFile, mSize) == 0)
+	{
+		void* data = mmap(nullptr, mSize, PROT_READ | PROT_WRITE, MAP_SHARED, mFile, 0);
+		mData = data != MAP_FAILED ? static_cast<char*>(data) : nullptr;
+	}
+#endif
+
+	if (!mData)
+	{
+		Abort();
+		return false;
+	}
+
+	return true;
+}
+
+void MeshFileWriter::OpenMemory(size_t inMaxSize)
+{
+	Abort();
+
+	mSize = inMaxSize > 0 ? inMaxSize : 1;
+	mOffset = 0;
+	mMemory.assign(mSize, 0);
+	mData = &mMemory[0];
+}
+
+const char* MeshFileWriter::GetData() const
+{
+	return mData;
+}
+
+char* MeshFileWriter::Reserve(size_t inSize)
+{
+	if (!mData || inSize > mSize - mOffset)
+	{
+		throw std::runtime_error("MeshFileWriter: writing past the reserved size");
+	}
+
+	char* result = mData + mOffset;
+	mOffset += inSize;
+	return result;
+}
+
+void MeshFileWriter::Write(const void* inData, size_t inSize)
+{
+	if (inSize > 0)
+	{
+		memcpy(Reserve(inSize), inData, inSize);
+	}
+}
+
+void MeshFileWriter::Pad(size_t inAlignment)
+{
+	size_t padding = (inAlignment - mOffset % inAlignment) % inAlignment;
+	memset(Reserve(padding), 0, padding);
+}
+
+size_t MeshFileWriter::GetOffset() const
+{
+	return mOffset;
+}
+
+void MeshFileWriter::Unmap()
+{
+	if (!mMemory.empty())
+	{
+		mMemory.clear();
+		mData = nullptr;
+		return;
+	}
+#ifdef _WIN32
+	if (mData)
+	{
+		if (mSync)
+		{
+			FlushViewOfFile(mData, 0);
+		}
+		UnmapViewOfFile(mData);
+	}
+	if (mMapping)
+	{
+		CloseHandle(mMapping);
+		mMapping = nullptr;
+	}
+#else
+	if (mData)
+	{
+		if (mSync)
+		{
+			msync(mData, mSize, MS_SYNC);
+		}
+		munmap(mData, mSize);
+	}
+#endif
+	mData = nullptr;
+}
+
+bool MeshFileWriter::Commit()
+{
+	if (!mData || !mMemory.empty())
+	{
+		return false;
+	}
+	Unmap();
+
+	// The file was sized for the worst case, cut it to what was written
+	bool succeeded = true;
+#ifdef _WIN32
+	LARGE_INTEGER end;
+	end.QuadPart = static_cast<LONGLONG>(mOffset);
+	succeeded = SetFilePointerEx(mFile, end, NULL, FILE_BEGIN) && SetEndOfFile(mFile);
+	if (succeeded && mSync)
+	{
+		succeeded = FlushFileBuffers(mFile) != 0;
+	}
+	CloseHandle(mFile);
+	mFile = INVALID_HANDLE_VALUE;
+
+	if (succeeded)
+	{
+		succeeded = MoveFileExA(mTempPath.c_str(), mPath.c_str(), MOVEFILE_REPLACE_EXISTING | (mSync ? MOVEFILE_WRITE_THROUGH : 0)) != 0;
+	}
+	if (!succeeded)
+	{
+		DeleteFileA(mTempPath.c_str());
+	}
+#else
+	succeeded = ftruncate(mFile, mOffset) == 0;
+	if (succeeded && mSync)
+	{
+		succeeded = fsync(mFile) == 0;
+	}
+	close(mFile);
+	mFile = -1;
+
+	if (succeeded)
+	{
+		succeeded = rename(mTempPath.c_str(), mPath.c_str()) == 0;
+	}
+	if (!succeeded)
+	{
+		unlink(mTempPath.c_str());
+	}
+	// The rename is only durable once the directory entry is on disk
+	else if (mSync)
+	{
+		size_t slash = mPath.find_last_of('/');
+		std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : mPath.substr(0, slash);
+		int directoryFile = open(directory.c_str(), O_RDONLY);
+		succeeded = directoryFile >= 0 && fsync(directoryFile) == 0;
+		if (directoryFile >= 0)
+		{
+			close(directoryFile);
+		}
+	}
+#endif
+
+	return succeeded;
+}
+
+void MeshFileWriter::Abort()
+{
+	mSync = false;
+	Unmap();
+#ifdef _WIN32
+	if (mFile != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(mFile);
+		mFile = INVALID_HANDLE_VALUE;
+		DeleteFileA(mTempPath.c_str());
+	}
+#else
+	if (mFile >= 0)
+	{
+		close(mFile);
+		mFile = -1;
+		unlink(mTempPath.c_str());
+	}
+#endif
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Writes a binary file of known size straight into a memory mapped
+// temporary file, so sections are serialized in place instead of being
+// built in a heap array and copied through an ostream
+// Commit truncates the file to what was written and renames it over
+// the target, so readers never see a half written file
+class MeshFileWriter
+{
+public:
+	MeshFileWriter();
+	~MeshFileWriter();
+
+	// Maps <inPath>.tmp with room for inMaxSize bytes
+	// With inSync, Commit flushes the data to disk before renaming, and
+	// on POSIX the directory after it
+	bool Open(const std::string& inPath, size_t inMaxSize, bool inSync);
+	// Same, but into memory, for an image that is post processed
+	// (compressed) before it goes to disk. Cannot be committed
+	void OpenMemory(size_t inMaxSize);
+	const char* GetData() const;
+
+	// Returns inSize bytes at the current offset and advances past them
+	// Throws when writing past the size given to Open
+	char* Reserve(size_t inSize);
+
+	// The mapping is page aligned, the caller keeps the offset a
+	// multiple of alignof(T) so the result can be written to directly
+	template<typename T>
+	T* ReserveArray(size_t inCount)
+	{
+		return reinterpret_cast<T*>(Reserve(sizeof(T) * inCount));
+	}
+
+	// Copy of unaligned or already serialized data
+	void Write(const void* inData, size_t inSize);
+	// Zeros up to the next multiple of inAlignment
+	void Pad(size_t inAlignment);
+
+	size_t GetOffset() const;
+
+	bool Commit();
+	// Drops the temporary file, also done by the destructor
+	void Abort();
+
+private:
+	MeshFileWriter(const MeshFileWriter&);
+	MeshFileWriter& operator=(const MeshFileWriter&);
+
+	void Unmap();
+
+	std::string mPath;
+	std::string mTempPath;
+	bool mSync;
+	char* mData;
+	size_t mSize;
+	size_t mOffset;
+	std::vector<char> mMemory;
+#ifdef _WIN32
+	void* mFile;
+	void* mMapping;
+#else
+	int mFile;
+#endif
+};
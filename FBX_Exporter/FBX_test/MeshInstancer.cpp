@@ -0,0 +1,87 @@
+#include "MeshInstancer.h"
+#include <cstring>
+
+namespace
+{
+	const unsigned long long kFnvOffset = 14695981039346656037ULL;
+	const unsigned long long kFnvPrime = 1099511628211ULL;
+
+	// FNV-1a
+	void HashBytes(const void* inData, size_t inSize, unsigned long long& ioHash)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(inData);
+		for (size_t i = 0; i < inSize; ++i)
+		{
+			ioHash = (ioHash ^ bytes[i]) * kFnvPrime;
+		}
+	}
+}
+
+unsigned long long MeshInstancer::Hash(const std::vector<PNTIWVertex>& inVertices, const unsigned int* inIndices,
+	const unsigned int* inMaterials, unsigned int inTriangleCount)
+{
+	unsigned long long hash = kFnvOffset;
+	HashBytes(&inTriangleCount, sizeof(inTriangleCount), hash);
+	for (unsigned int i = 0; i < inTriangleCount; ++i)
+	{
+		HashBytes(&inMaterials[i], sizeof(inMaterials[i]), hash);
+		for (unsigned int j = 0; j < 3; ++j)
+		{
+			const PNTIWVertex& vertex = inVertices[inIndices[i * 3 + j]];
+			HashBytes(&vertex.mPosition, sizeof(vertex.mPosition), hash);
+			HashBytes(&vertex.mNormal, sizeof(vertex.mNormal), hash);
+			HashBytes(vertex.mUV, sizeof(vertex.mUV), hash);
+			HashBytes(vertex.mColor, sizeof(vertex.mColor), hash);
+			for (const VertexBlendingInfo& blendingInfo : vertex.mVertexBlendingInfos)
+			{
+				HashBytes(&blendingInfo.mBlendingIndex, sizeof(blendingInfo.mBlendingIndex), hash);
+				HashBytes(&blendingInfo.mBlendingWeight, sizeof(blendingInfo.mBlendingWeight), hash);
+			}
+		}
+	}
+	return hash;
+}
+
+bool MeshInstancer::SameGeometry(const std::vector<PNTIWVertex>& inVertices, const unsigned int* inIndices1, const unsigned int* inMaterials1,
+	const unsigned int* inIndices2, const unsigned int* inMaterials2, unsigned int inTriangleCount)
+{
+	for (unsigned int i = 0; i < inTriangleCount; ++i)
+	{
+		if (inMaterials1[i] != inMaterials2[i])
+		{
+			return false;
+		}
+		for (unsigned int j = 0; j < 3; ++j)
+		{
+			if (!SameVertex(inVertices[inIndices1[i * 3 + j]], inVertices[inIndices2[i * 3 + j]]))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// Unlike PNTIWVertex::operator== without tolerance, so copies are
+// only merged when nothing in the output changes
+bool MeshInstancer::SameVertex(const PNTIWVertex& inVertex1, const PNTIWVertex& inVertex2)
+{
+	if (memcmp(&inVertex1.mPosition, &inVertex2.mPosition, sizeof(inVertex1.mPosition)) != 0 ||
+		memcmp(&inVertex1.mNormal, &inVertex2.mNormal, sizeof(inVertex1.mNormal)) != 0 ||
+		memcmp(inVertex1.mUV, inVertex2.mUV, sizeof(inVertex1.mUV)) != 0 ||
+		memcmp(inVertex1.mColor, inVertex2.mColor, sizeof(inVertex1.mColor)) != 0 ||
+		inVertex1.mVertexBlendingInfos.size() != inVertex2.mVertexBlendingInfos.size())
+	{
+		return false;
+	}
+
+	for (size_t i = 0; i < inVertex1.mVertexBlendingInfos.size(); ++i)
+	{
+		if (inVertex1.mVertexBlendingInfos[i].mBlendingIndex != inVertex2.mVertexBlendingInfos[i].mBlendingIndex ||
+			inVertex1.mVertexBlendingInfos[i].mBlendingWeight != inVertex2.mVertexBlendingInfos[i].mBlendingWeight)
+		{
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include "Vertex.h"
+
+// Recognizes mesh nodes that are copies of each other (the same prop
+// placed under many nodes), so their geometry is processed and written
+// once. Works on the unwelded per corner vertices, where two copies of
+// a mesh have identical vertices in the same order
+class MeshInstancer
+{
+public:
+	// Of the vertices inVertices[inIndices[i]] of inTriangleCount
+	// triangles and of their materials
+	static unsigned long long Hash(const std::vector<PNTIWVertex>& inVertices, const unsigned int* inIndices,
+		const unsigned int* inMaterials, unsigned int inTriangleCount);
+
+	// Whether two triangle lists of inTriangleCount triangles have
+	// bitwise identical vertices and the same materials
+	static bool SameGeometry(const std::vector<PNTIWVertex>& inVertices, const unsigned int* inIndices1, const unsigned int* inMaterials1,
+		const unsigned int* inIndices2, const unsigned int* inMaterials2, unsigned int inTriangleCount);
+
+private:
+	static bool SameVertex(const PNTIWVertex& inVertex1, const PNTIWVertex& inVertex2);
+};
@@ -0,0 +1,321 @@
+#include "MeshSimplifier.h"
+#include <unordered_map>
+#include <cmath>
+
+namespace
+{
+	// Vertex normals that are further apart than this are never merged
+	const float kMinNormalDot = 0.5f;
+
+	void Cross(const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c, double outNormal[3])
+	{
+		double e1[3] = { b.x - a.x, b.y - a.y, b.z - a.z };
+		double e2[3] = { c.x - a.x, c.y - a.y, c.z - a.z };
+		outNormal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+		outNormal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+		outNormal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+	}
+}
+
+MeshSimplifier::Quadric::Quadric()
+{
+	for (int i = 0; i < 10; ++i)
+	{
+		a[i] = 0.0;
+	}
+	mWeight = 0.0;
+}
+
+void MeshSimplifier::Quadric::AddPlane(double inA, double inB, double inC, double inD, double inWeight)
+{
+	a[0] += inWeight * inA * inA;
+	a[1] += inWeight * inA * inB;
+	a[2] += inWeight * inA * inC;
+	a[3] += inWeight * inA * inD;
+	a[4] += inWeight * inB * inB;
+	a[5] += inWeight * inB * inC;
+	a[6] += inWeight * inB * inD;
+	a[7] += inWeight * inC * inC;
+	a[8] += inWeight * inC * inD;
+	a[9] += inWeight * inD * inD;
+	mWeight += inWeight;
+}
+
+void MeshSimplifier::Quadric::Add(const Quadric& inOther)
+{
+	for (int i = 0; i < 10; ++i)
+	{
+		a[i] += inOther.a[i];
+	}
+	mWeight += inOther.mWeight;
+}
+
+double MeshSimplifier::Quadric::Evaluate(const XMFLOAT3& inPoint) const
+{
+	double x = inPoint.x;
+	double y = inPoint.y;
+	double z = inPoint.z;
+	double error = a[0] * x * x + 2 * a[1] * x * y + 2 * a[2] * x * z + 2 * a[3] * x
+		+ a[4] * y * y + 2 * a[5] * y * z + 2 * a[6] * y
+		+ a[7] * z * z + 2 * a[8] * z
+		+ a[9];
+
+	return (error > 0.0 && mWeight > 0.0) ? error / mWeight : 0.0;
+}
+
+MeshSimplifier::MeshSimplifier(const std::vector<PNTIWVertex>& inVertices) :
+	mVertices(inVertices)
+{
+}
+
+bool MeshSimplifier::CanCollapse(unsigned int inFrom, unsigned int inTo) const
+{
+	const PNTIWVertex& from = mVertices[inFrom];
+	const PNTIWVertex& to = mVertices[inTo];
+
+	float normalDot = from.mNormal.x * to.mNormal.x + from.mNormal.y * to.mNormal.y + from.mNormal.z * to.mNormal.z;
+	if (normalDot < kMinNormalDot)
+	{
+		return false;
+	}
+
+	// Blending infos are sorted by weight, so [0] is the dominant joint
+	if (!from.mVertexBlendingInfos.empty() && !to.mVertexBlendingInfos.empty() &&
+		from.mVertexBlendingInfos[0].mBlendingIndex != to.mVertexBlendingInfos[0].mBlendingIndex)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+bool MeshSimplifier::FlipsTriangle(unsigned int inFrom, unsigned int inTo, const std::vector<unsigned int>& inIndices,
+	const std::vector<unsigned int>& inVertexIds, const std::vector<unsigned int>& inAdjacencyOffsets, const std::vector<unsigned int>& inAdjacency) const
+{
+	for (unsigned int i = inAdjacencyOffsets[inFrom]; i < inAdjacencyOffsets[inFrom + 1]; ++i)
+	{
+		unsigned int triangle = inAdjacency[i];
+		unsigned int a = inIndices[triangle * 3 + 0];
+		unsigned int b = inIndices[triangle * 3 + 1];
+		unsigned int c = inIndices[triangle * 3 + 2];
+
+		// Triangles on the collapsed edge disappear
+		if (a == inTo || b == inTo || c == inTo)
+		{
+			continue;
+		}
+
+		double before[3];
+		double after[3];
+		Cross(mVertices[inVertexIds[a]].mPosition, mVertices[inVertexIds[b]].mPosition, mVertices[inVertexIds[c]].mPosition, before);
+		Cross(mVertices[inVertexIds[a == inFrom ? inTo : a]].mPosition, mVertices[inVertexIds[b == inFrom ? inTo : b]].mPosition,
+			mVertices[inVertexIds[c == inFrom ? inTo : c]].mPosition, after);
+
+		double dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+		double lengths = sqrt(before[0] * before[0] + before[1] * before[1] + before[2] * before[2]) *
+			sqrt(after[0] * after[0] + after[1] * after[1] + after[2] * after[2]);
+		if (dot <= 0.25 * lengths)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+float MeshSimplifier::Simplify(const std::vector<unsigned int>& inIndices, unsigned int inTargetTriangleCount, std::vector<unsigned int>& outIndices) const
+{
+	// The range's vertices get local indices, so the work per call is
+	// bound by the range and not by the whole vertex buffer
+	std::vector<unsigned int> vertexIds(inIndices);
+	std::sort(vertexIds.begin(), vertexIds.end());
+	vertexIds.erase(std::unique(vertexIds.begin(), vertexIds.end()), vertexIds.end());
+	const unsigned int vertexCount = vertexIds.size();
+	outIndices.resize(inIndices.size());
+	for (unsigned int i = 0; i < inIndices.size(); ++i)
+	{
+		outIndices[i] = static_cast<unsigned int>(std::lower_bound(vertexIds.begin(), vertexIds.end(), inIndices[i]) - vertexIds.begin());
+	}
+
+	// Area weighted plane quadrics of every triangle
+	std::vector<Quadric> quadrics(vertexCount);
+	for (unsigned int i = 0; i < outIndices.size(); i += 3)
+	{
+		const XMFLOAT3& p0 = mVertices[vertexIds[outIndices[i]]].mPosition;
+		double normal[3];
+		Cross(p0, mVertices[vertexIds[outIndices[i + 1]]].mPosition, mVertices[vertexIds[outIndices[i + 2]]].mPosition, normal);
+		double length = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		if (length <= 0.0)
+		{
+			continue;
+		}
+
+		double a = normal[0] / length;
+		double b = normal[1] / length;
+		double c = normal[2] / length;
+		double d = -(a * p0.x + b * p0.y + c * p0.z);
+		for (unsigned int j = 0; j < 3; ++j)
+		{
+			quadrics[outIndices[i + j]].AddPlane(a, b, c, d, length * 0.5);
+		}
+	}
+
+	// Vertices on edges used by a single triangle are locked
+	std::vector<unsigned char> locked(vertexCount, 0);
+	{
+		std::unordered_map<unsigned long long, unsigned int> edgeUses;
+		edgeUses.reserve(outIndices.size());
+		for (unsigned int i = 0; i < outIndices.size(); i += 3)
+		{
+			for (unsigned int j = 0; j < 3; ++j)
+			{
+				unsigned long long a = outIndices[i + j];
+				unsigned long long b = outIndices[i + (j + 1) % 3];
+				++edgeUses[a < b ? (a << 32) | b : (b << 32) | a];
+			}
+		}
+		for (auto itr = edgeUses.begin(); itr != edgeUses.end(); ++itr)
+		{
+			if (itr->second == 1)
+			{
+				locked[itr->first >> 32] = 1;
+				locked[itr->first & 0xffffffffull] = 1;
+			}
+		}
+	}
+
+	std::vector<unsigned int> adjacencyOffsets(vertexCount + 1);
+	std::vector<unsigned int> adjacency;
+	std::vector<Collapse> collapses;
+	std::vector<unsigned int> remap(vertexCount);
+	std::vector<unsigned char> touched(vertexCount);
+	double maxError = 0.0;
+
+	// Every pass collapses a batch of the cheapest independent edges
+	while (outIndices.size() / 3 > inTargetTriangleCount)
+	{
+		const unsigned int triangleCount = outIndices.size() / 3;
+
+		// Vertex to triangle adjacency
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for (unsigned int i = 0; i < outIndices.size(); ++i)
+		{
+			++adjacencyOffsets[outIndices[i] + 1];
+		}
+		for (unsigned int i = 0; i < vertexCount; ++i)
+		{
+			adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+		}
+		adjacency.resize(outIndices.size());
+		{
+			std::vector<unsigned int> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (unsigned int i = 0; i < outIndices.size(); ++i)
+			{
+				adjacency[cursor[outIndices[i]]++] = i / 3;
+			}
+		}
+
+		collapses.clear();
+		for (unsigned int i = 0; i < outIndices.size(); i += 3)
+		{
+			for (unsigned int j = 0; j < 3; ++j)
+			{
+				unsigned int a = outIndices[i + j];
+				unsigned int b = outIndices[i + (j + 1) % 3];
+				for (unsigned int k = 0; k < 2; ++k)
+				{
+					unsigned int from = k == 0 ? a : b;
+					unsigned int to = k == 0 ? b : a;
+					if (locked[from] || !CanCollapse(vertexIds[from], vertexIds[to]))
+					{
+						continue;
+					}
+
+					Quadric edgeQuadric = quadrics[from];
+					edgeQuadric.Add(quadrics[to]);
+					Collapse currCollapse;
+					currCollapse.mFrom = from;
+					currCollapse.mTo = to;
+					currCollapse.mError = edgeQuadric.Evaluate(mVertices[vertexIds[to]].mPosition);
+					collapses.push_back(currCollapse);
+				}
+			}
+		}
+		std::sort(collapses.begin(), collapses.end());
+
+		// A collapse removes about two triangles
+		const unsigned int wantedCollapses = (triangleCount - inTargetTriangleCount + 1) / 2;
+		unsigned int appliedCollapses = 0;
+		for (unsigned int i = 0; i < vertexCount; ++i)
+		{
+			remap[i] = i;
+		}
+		std::fill(touched.begin(), touched.end(), 0);
+
+		for (unsigned int i = 0; i < collapses.size() && appliedCollapses < wantedCollapses; ++i)
+		{
+			const Collapse& currCollapse = collapses[i];
+			if (touched[currCollapse.mFrom] || touched[currCollapse.mTo])
+			{
+				continue;
+			}
+
+			// Neighbours collapsed in this pass are still at their old
+			// position in outIndices, lock the whole one ring instead
+			bool ringTouched = false;
+			for (unsigned int j = adjacencyOffsets[currCollapse.mFrom]; j < adjacencyOffsets[currCollapse.mFrom + 1] && !ringTouched; ++j)
+			{
+				unsigned int triangle = adjacency[j];
+				for (unsigned int k = 0; k < 3; ++k)
+				{
+					ringTouched = ringTouched || touched[outIndices[triangle * 3 + k]];
+				}
+			}
+			if (ringTouched || FlipsTriangle(currCollapse.mFrom, currCollapse.mTo, outIndices, vertexIds, adjacencyOffsets, adjacency))
+			{
+				continue;
+			}
+
+			remap[currCollapse.mFrom] = currCollapse.mTo;
+			quadrics[currCollapse.mTo].Add(quadrics[currCollapse.mFrom]);
+			maxError = std::max(maxError, currCollapse.mError);
+			for (unsigned int j = adjacencyOffsets[currCollapse.mFrom]; j < adjacencyOffsets[currCollapse.mFrom + 1]; ++j)
+			{
+				unsigned int triangle = adjacency[j];
+				for (unsigned int k = 0; k < 3; ++k)
+				{
+					touched[outIndices[triangle * 3 + k]] = 1;
+				}
+			}
+			++appliedCollapses;
+		}
+
+		if (appliedCollapses == 0)
+		{
+			break;
+		}
+
+		// Apply the collapses and drop the degenerated triangles
+		unsigned int writeIndex = 0;
+		for (unsigned int i = 0; i < outIndices.size(); i += 3)
+		{
+			unsigned int a = remap[outIndices[i + 0]];
+			unsigned int b = remap[outIndices[i + 1]];
+			unsigned int c = remap[outIndices[i + 2]];
+			if (a == b || b == c || c == a)
+			{
+				continue;
+			}
+			outIndices[writeIndex++] = a;
+			outIndices[writeIndex++] = b;
+			outIndices[writeIndex++] = c;
+		}
+		outIndices.resize(writeIndex);
+	}
+
+	for (unsigned int i = 0; i < outIndices.size(); ++i)
+	{
+		outIndices[i] = vertexIds[outIndices[i]];
+	}
+	return static_cast<float>(sqrt(maxError));
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "Vertex.h"
+
+// Quadric error metric edge collapse simplifier
+// Vertices are collapsed onto one of their neighbours, so every
+// simplified index list still indexes the full resolution vertex
+// buffer and all levels of detail can share it
+//
+// Vertices on open edges are never moved. As welded vertices on
+// UV or normal seams are split, seams are open edges as well and
+// stay intact. Collapses between vertices whose normals or dominant
+// joints disagree are rejected
+//
+// Simplify does not modify the simplifier, so several levels
+// can be generated from one simplifier on different threads
+class MeshSimplifier
+{
+public:
+	explicit MeshSimplifier(const std::vector<PNTIWVertex>& inVertices);
+
+	// Simplifies inIndices (3 per triangle) to about inTargetTriangleCount
+	// triangles. Returns the error of the worst collapse: the RMS distance,
+	// in model units, of the kept vertex to the planes of the triangles
+	// merged into it
+	float Simplify(const std::vector<unsigned int>& inIndices, unsigned int inTargetTriangleCount, std::vector<unsigned int>& outIndices) const;
+
+private:
+	// Symmetric 4x4 matrix: xx xy xz xw yy yz yw zz zw ww
+	// mWeight is the summed area, so that the error is a mean
+	// squared distance
+	struct Quadric
+	{
+		double a[10];
+		double mWeight;
+
+		Quadric();
+		void AddPlane(double inA, double inB, double inC, double inD, double inWeight);
+		void Add(const Quadric& inOther);
+		double Evaluate(const XMFLOAT3& inPoint) const;
+	};
+
+	struct Collapse
+	{
+		unsigned int mFrom;
+		unsigned int mTo;
+		double mError;
+
+		bool operator<(const Collapse& rhs) const
+		{
+			return mError < rhs.mError;
+		}
+	};
+
+	bool CanCollapse(unsigned int inFrom, unsigned int inTo) const;
+	// inFrom, inTo and inIndices are local, inVertexIds maps them to
+	// mVertices
+	bool FlipsTriangle(unsigned int inFrom, unsigned int inTo, const std::vector<unsigned int>& inIndices,
+		const std::vector<unsigned int>& inVertexIds, const std::vector<unsigned int>& inAdjacencyOffsets, const std::vector<unsigned int>& inAdjacency) const;
+
+	const std::vector<PNTIWVertex>& mVertices;
+};
@@ -0,0 +1,136 @@
+#include "MeshStatistics.h"
+#include <cmath>
+
+BoundingVolume::BoundingVolume() :
+	mMin(0.0f, 0.0f, 0.0f),
+	mMax(0.0f, 0.0f, 0.0f),
+	mCenter(0.0f, 0.0f, 0.0f),
+	mRadius(0.0f),
+	mEmpty(true)
+{}
+
+void BoundingVolume::Grow(const XMFLOAT3& inPoint)
+{
+	if (mEmpty)
+	{
+		mMin = mMax = mCenter = inPoint;
+		mRadius = 0.0f;
+		mEmpty = false;
+		return;
+	}
+
+	mMin = XMFLOAT3(std::min(mMin.x, inPoint.x), std::min(mMin.y, inPoint.y), std::min(mMin.z, inPoint.z));
+	mMax = XMFLOAT3(std::max(mMax.x, inPoint.x), std::max(mMax.y, inPoint.y), std::max(mMax.z, inPoint.z));
+
+	float dx = inPoint.x - mCenter.x;
+	float dy = inPoint.y - mCenter.y;
+	float dz = inPoint.z - mCenter.z;
+	float distanceSq = dx * dx + dy * dy + dz * dz;
+	if (distanceSq > mRadius * mRadius)
+	{
+		// Move the center towards the point just enough to enclose it
+		float distance = sqrtf(distanceSq);
+		float newRadius = (mRadius + distance) * 0.5f;
+		float shift = (newRadius - mRadius) / distance;
+		mCenter = XMFLOAT3(mCenter.x + dx * shift, mCenter.y + dy * shift, mCenter.z + dz * shift);
+		mRadius = newRadius;
+	}
+}
+
+void BoundingVolume::Merge(const BoundingVolume& inOther)
+{
+	if (inOther.mEmpty)
+	{
+		return;
+	}
+	if (mEmpty)
+	{
+		*this = inOther;
+		return;
+	}
+
+	mMin = XMFLOAT3(std::min(mMin.x, inOther.mMin.x), std::min(mMin.y, inOther.mMin.y), std::min(mMin.z, inOther.mMin.z));
+	mMax = XMFLOAT3(std::max(mMax.x, inOther.mMax.x), std::max(mMax.y, inOther.mMax.y), std::max(mMax.z, inOther.mMax.z));
+
+	float dx = inOther.mCenter.x - mCenter.x;
+	float dy = inOther.mCenter.y - mCenter.y;
+	float dz = inOther.mCenter.z - mCenter.z;
+	float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+	if (distance + inOther.mRadius <= mRadius)
+	{
+		return;
+	}
+	if (distance + mRadius <= inOther.mRadius)
+	{
+		mCenter = inOther.mCenter;
+		mRadius = inOther.mRadius;
+		return;
+	}
+
+	float newRadius = (distance + mRadius + inOther.mRadius) * 0.5f;
+	float shift = (newRadius - mRadius) / distance;
+	mCenter = XMFLOAT3(mCenter.x + dx * shift, mCenter.y + dy * shift, mCenter.z + dz * shift);
+	mRadius = newRadius;
+}
+
+RangeStatistics::RangeStatistics() :
+	mSurfaceArea(0.0f),
+	mUVArea(0.0f),
+	mUVDensity(0.0f),
+	mVertexCount(0),
+	mTriangleCount(0)
+{}
+
+void RangeStatistics::Merge(const RangeStatistics& inOther)
+{
+	mBounds.Merge(inOther.mBounds);
+	mSurfaceArea += inOther.mSurfaceArea;
+	mUVArea += inOther.mUVArea;
+	mUVDensity = mUVArea > 0.0f ? sqrtf(mSurfaceArea / mUVArea) : 0.0f;
+	mVertexCount += inOther.mVertexCount;
+	mTriangleCount += inOther.mTriangleCount;
+}
+
+RangeStatistics MeshStatistics::Compute(const std::vector<PNTIWVertex>& inVertices, const unsigned int* inIndices,
+	unsigned int inIndexCount, std::vector<unsigned int>& ioVisited, unsigned int inStamp)
+{
+	RangeStatistics stats;
+	double surfaceArea = 0.0;
+	double uvArea = 0.0;
+
+	for (unsigned int i = 0; i + 2 < inIndexCount; i += 3)
+	{
+		const PNTIWVertex* corners[3];
+		for (unsigned int j = 0; j < 3; ++j)
+		{
+			unsigned int index = inIndices[i + j];
+			corners[j] = &inVertices[index];
+			if (ioVisited[index] != inStamp)
+			{
+				ioVisited[index] = inStamp;
+				stats.mBounds.Grow(corners[j]->mPosition);
+				++stats.mVertexCount;
+			}
+		}
+
+		const XMFLOAT3& p0 = corners[0]->mPosition;
+		const XMFLOAT3& p1 = corners[1]->mPosition;
+		const XMFLOAT3& p2 = corners[2]->mPosition;
+		double e1[3] = { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+		double e2[3] = { p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+		double n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+		surfaceArea += 0.5 * sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+		const XMFLOAT2& t0 = corners[0]->mUV[0];
+		const XMFLOAT2& t1 = corners[1]->mUV[0];
+		const XMFLOAT2& t2 = corners[2]->mUV[0];
+		uvArea += 0.5 * fabs((t1.x - t0.x) * (t2.y - t0.y) - (t2.x - t0.x) * (t1.y - t0.y));
+
+		++stats.mTriangleCount;
+	}
+
+	stats.mSurfaceArea = static_cast<float>(surfaceArea);
+	stats.mUVArea = static_cast<float>(uvArea);
+	stats.mUVDensity = uvArea > 0.0 ? static_cast<float>(sqrt(surfaceArea / uvArea)) : 0.0f;
+	return stats;
+}
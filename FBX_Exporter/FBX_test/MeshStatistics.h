@@ -0,0 +1,46 @@
+#pragma once
+#include "Vertex.h"
+
+// Axis aligned box and bounding sphere of a set of points
+// The sphere is grown incrementally (Ritter), so both can be
+// built in a single pass
+struct BoundingVolume
+{
+	XMFLOAT3 mMin;
+	XMFLOAT3 mMax;
+	XMFLOAT3 mCenter;
+	float mRadius;
+	bool mEmpty;
+
+	BoundingVolume();
+	void Grow(const XMFLOAT3& inPoint);
+	void Merge(const BoundingVolume& inOther);
+};
+
+// Statistics of a draw range or a whole node
+// mUVDensity is sqrt(surface area / UV area) of UV set 0, the
+// model space length covered by one unit of UV space
+struct RangeStatistics
+{
+	BoundingVolume mBounds;
+	float mSurfaceArea;
+	float mUVArea;
+	float mUVDensity;
+	unsigned int mVertexCount;
+	unsigned int mTriangleCount;
+
+	RangeStatistics();
+	void Merge(const RangeStatistics& inOther);
+};
+
+class MeshStatistics
+{
+public:
+	// Bounds, areas and the count of distinct vertices of the triangles
+	// inIndices[inFirstIndex, inFirstIndex + inIndexCount), in one pass
+	// ioVisited must have one entry per vertex; entries equal to inStamp
+	// mark vertices already counted, so a fresh stamp per call avoids
+	// clearing it
+	static RangeStatistics Compute(const std::vector<PNTIWVertex>& inVertices, const unsigned int* inIndices,
+		unsigned int inIndexCount, std::vector<unsigned int>& ioVisited, unsigned int inStamp);
+};
@@ -0,0 +1,101 @@
+#include "MeshWelder.h"
+#include "MathHelper.h"
+#include <unordered_map>
+#include <cmath>
+
+namespace
+{
+	const long long kCellRange = 1LL << 40;
+
+	long long CellCoordinate(float inValue, double inCellSize)
+	{
+		double cell = floor(inValue / inCellSize);
+		// NaN and far away positions share the outermost cells
+		if (!(cell > -kCellRange))
+		{
+			return -kCellRange;
+		}
+		return cell < kCellRange ? static_cast<long long>(cell) : kCellRange;
+	}
+
+	// 21 bits per axis, cells that wrap onto the same key only add
+	// candidates to compare
+	unsigned long long CellKey(long long inX, long long inY, long long inZ)
+	{
+		const unsigned long long mask = (1ULL << 21) - 1;
+		return (static_cast<unsigned long long>(inX) & mask) | (static_cast<unsigned long long>(inY) & mask) << 21 |
+			(static_cast<unsigned long long>(inZ) & mask) << 42;
+	}
+
+	// Unique vertices of a cell in ascending order: mFirst, mNext[mFirst]...
+	struct Cell
+	{
+		unsigned int mFirst;
+		unsigned int mLast;
+	};
+}
+
+void MeshWelder::Weld(const std::vector<PNTIWVertex>& inVertices, unsigned int* ioIndices, unsigned int inIndexCount,
+	std::vector<PNTIWVertex>& ioUniqueVertices)
+{
+	const unsigned int firstVertex = ioUniqueVertices.size();
+	const unsigned int none = 0xffffffff;
+	// Positions within the comparison epsilon are at most one cell apart
+	const double cellSize = 4.0 * MathHelper::vector3Epsilon.x;
+	std::unordered_map<unsigned long long, Cell> cells;
+	cells.reserve(inIndexCount / 2);
+	// Indexed by unique vertex - firstVertex
+	std::vector<unsigned int> next;
+	next.reserve(inIndexCount / 2);
+
+	for(unsigned int i = 0; i < inIndexCount; ++i)
+	{
+		const PNTIWVertex& vertex = inVertices[ioIndices[i]];
+		long long x = CellCoordinate(vertex.mPosition.x, cellSize);
+		long long y = CellCoordinate(vertex.mPosition.y, cellSize);
+		long long z = CellCoordinate(vertex.mPosition.z, cellSize);
+
+		unsigned int match = none;
+		for(long long dz = -1; dz <= 1; ++dz)
+		{
+			for(long long dy = -1; dy <= 1; ++dy)
+			{
+				for(long long dx = -1; dx <= 1; ++dx)
+				{
+					auto cell = cells.find(CellKey(x + dx, y + dy, z + dz));
+					if(cell == cells.end())
+					{
+						continue;
+					}
+					// Ascending, nothing later in the cell can beat match
+					for(unsigned int unique = cell->second.mFirst; unique != none && unique < match; unique = next[unique - firstVertex])
+					{
+						if(vertex == ioUniqueVertices[unique])
+						{
+							match = unique;
+						}
+					}
+				}
+			}
+		}
+
+		if(match == none)
+		{
+			match = ioUniqueVertices.size();
+			ioUniqueVertices.push_back(vertex);
+			next.push_back(none);
+			auto inserted = cells.insert(std::make_pair(CellKey(x, y, z), Cell()));
+			Cell& cell = inserted.first->second;
+			if(inserted.second)
+			{
+				cell.mFirst = match;
+			}
+			else
+			{
+				next[cell.mLast - firstVertex] = match;
+			}
+			cell.mLast = match;
+		}
+		ioIndices[i] = match;
+	}
+}
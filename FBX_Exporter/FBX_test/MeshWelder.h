@@ -0,0 +1,17 @@
+#pragma once
+#include "Vertex.h"
+
+// Removes duplicated vertices the importer emits for every triangle
+// corner. Vertices are compared with PNTIWVertex::operator==, a vertex
+// welds to the first unique vertex it equals, like a linear search
+// would. Only unique vertices in the neighbouring cells of a position
+// grid are compared, so welding n corners takes O(n) on usual meshes
+class MeshWelder
+{
+public:
+	// Welds the vertices inVertices[ioIndices[i]] of inIndexCount indices
+	// into ioUniqueVertices and points ioIndices at them. Vertices already
+	// in ioUniqueVertices are never shared with the new ones
+	static void Weld(const std::vector<PNTIWVertex>& inVertices, unsigned int* ioIndices, unsigned int inIndexCount,
+		std::vector<PNTIWVertex>& ioUniqueVertices);
+};
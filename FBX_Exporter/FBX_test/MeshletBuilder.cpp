@@ -0,0 +1,205 @@
+#include "MeshletBuilder.h"
+#include <cmath>
+#include <climits>
+
+void MeshletBuilder::Build(const std::vector<PNTIWVertex>& inVertices, const std::vector<unsigned int>& inIndices,
+	unsigned int inMaterialIndex, MeshletData& ioMeshlets)
+{
+	const unsigned int triangleCount = inIndices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// The list's vertices get compact indices, so the work per call is
+	// bound by the list and not by the whole vertex buffer
+	std::vector<unsigned int> vertexIds(inIndices);
+	std::sort(vertexIds.begin(), vertexIds.end());
+	vertexIds.erase(std::unique(vertexIds.begin(), vertexIds.end()), vertexIds.end());
+	const unsigned int vertexCount = vertexIds.size();
+	std::vector<unsigned int> indices(inIndices.size());
+	for (unsigned int i = 0; i < inIndices.size(); ++i)
+	{
+		indices[i] = static_cast<unsigned int>(std::lower_bound(vertexIds.begin(), vertexIds.end(), inIndices[i]) - vertexIds.begin());
+	}
+
+	// Vertex to triangle adjacency of this triangle list
+	std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+	for (unsigned int i = 0; i < indices.size(); ++i)
+	{
+		++adjacencyOffsets[indices[i] + 1];
+	}
+	for (unsigned int i = 0; i < vertexCount; ++i)
+	{
+		adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+	}
+	std::vector<unsigned int> adjacency(indices.size());
+	{
+		std::vector<unsigned int> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (unsigned int i = 0; i < indices.size(); ++i)
+		{
+			adjacency[cursor[indices[i]]++] = i / 3;
+		}
+	}
+
+	std::vector<unsigned char> emitted(triangleCount, 0);
+	// Local index of a vertex in the current meshlet, valid if
+	// localOwner matches the current meshlet
+	std::vector<unsigned char> localIndex(vertexCount);
+	std::vector<unsigned int> localOwner(vertexCount, UINT_MAX);
+	// Compact indices of the current meshlet's vertices
+	std::vector<unsigned int> meshletVertices;
+	meshletVertices.reserve(kMaxVertices);
+	unsigned int nextSeed = 0;
+
+	while (true)
+	{
+		while (nextSeed < triangleCount && emitted[nextSeed])
+		{
+			++nextSeed;
+		}
+		if (nextSeed == triangleCount)
+		{
+			break;
+		}
+
+		Meshlet currMeshlet;
+		currMeshlet.mVertexOffset = ioMeshlets.mVertices.size();
+		currMeshlet.mVertexCount = 0;
+		currMeshlet.mTriangleOffset = ioMeshlets.mTriangles.size();
+		currMeshlet.mTriangleCount = 0;
+		currMeshlet.mMaterialIndex = inMaterialIndex;
+		const unsigned int meshletId = ioMeshlets.mMeshlets.size();
+		meshletVertices.clear();
+
+		unsigned int triangle = nextSeed;
+		while (triangle != UINT_MAX)
+		{
+			emitted[triangle] = 1;
+			for (unsigned int j = 0; j < 3; ++j)
+			{
+				unsigned int vertex = indices[triangle * 3 + j];
+				if (localOwner[vertex] != meshletId)
+				{
+					localOwner[vertex] = meshletId;
+					localIndex[vertex] = static_cast<unsigned char>(currMeshlet.mVertexCount++);
+					meshletVertices.push_back(vertex);
+					ioMeshlets.mVertices.push_back(vertexIds[vertex]);
+				}
+				ioMeshlets.mTriangles.push_back(localIndex[vertex]);
+			}
+			++currMeshlet.mTriangleCount;
+
+			// Pick the next triangle among the neighbours of the meshlet
+			triangle = UINT_MAX;
+			if (currMeshlet.mTriangleCount == kMaxTriangles)
+			{
+				break;
+			}
+			unsigned int bestNewVertices = 4;
+			for (unsigned int i = 0; i < meshletVertices.size() && bestNewVertices > 0; ++i)
+			{
+				unsigned int vertex = meshletVertices[i];
+				for (unsigned int k = adjacencyOffsets[vertex]; k < adjacencyOffsets[vertex + 1]; ++k)
+				{
+					unsigned int candidate = adjacency[k];
+					if (emitted[candidate])
+					{
+						continue;
+					}
+
+					unsigned int newVertices = 0;
+					for (unsigned int j = 0; j < 3; ++j)
+					{
+						newVertices += localOwner[indices[candidate * 3 + j]] != meshletId ? 1 : 0;
+					}
+					if (newVertices < bestNewVertices && currMeshlet.mVertexCount + newVertices <= kMaxVertices)
+					{
+						bestNewVertices = newVertices;
+						triangle = candidate;
+					}
+				}
+			}
+		}
+
+		ComputeBounds(inVertices, ioMeshlets, currMeshlet);
+		ioMeshlets.mMeshlets.push_back(currMeshlet);
+	}
+}
+
+void MeshletBuilder::ComputeBounds(const std::vector<PNTIWVertex>& inVertices, const MeshletData& inMeshlets, Meshlet& ioMeshlet)
+{
+	// Sphere around the center of the bounding box
+	XMFLOAT3 minimum = inVertices[inMeshlets.mVertices[ioMeshlet.mVertexOffset]].mPosition;
+	XMFLOAT3 maximum = minimum;
+	for (unsigned int i = 0; i < ioMeshlet.mVertexCount; ++i)
+	{
+		const XMFLOAT3& p = inVertices[inMeshlets.mVertices[ioMeshlet.mVertexOffset + i]].mPosition;
+		minimum = XMFLOAT3(std::min(minimum.x, p.x), std::min(minimum.y, p.y), std::min(minimum.z, p.z));
+		maximum = XMFLOAT3(std::max(maximum.x, p.x), std::max(maximum.y, p.y), std::max(maximum.z, p.z));
+	}
+	XMFLOAT3 center((minimum.x + maximum.x) * 0.5f, (minimum.y + maximum.y) * 0.5f, (minimum.z + maximum.z) * 0.5f);
+	float radiusSq = 0.0f;
+	for (unsigned int i = 0; i < ioMeshlet.mVertexCount; ++i)
+	{
+		const XMFLOAT3& p = inVertices[inMeshlets.mVertices[ioMeshlet.mVertexOffset + i]].mPosition;
+		float dx = p.x - center.x;
+		float dy = p.y - center.y;
+		float dz = p.z - center.z;
+		radiusSq = std::max(radiusSq, dx * dx + dy * dy + dz * dz);
+	}
+	ioMeshlet.mCenter = center;
+	ioMeshlet.mRadius = sqrtf(radiusSq);
+
+	// Normal cone around the average triangle normal
+	std::vector<XMFLOAT3> normals(ioMeshlet.mTriangleCount);
+	std::vector<XMFLOAT3> corners(ioMeshlet.mTriangleCount);
+	float axis[3] = { 0.0f, 0.0f, 0.0f };
+	for (unsigned int i = 0; i < ioMeshlet.mTriangleCount; ++i)
+	{
+		const unsigned char* local = &inMeshlets.mTriangles[ioMeshlet.mTriangleOffset + i * 3];
+		const XMFLOAT3& p0 = inVertices[inMeshlets.mVertices[ioMeshlet.mVertexOffset + local[0]]].mPosition;
+		const XMFLOAT3& p1 = inVertices[inMeshlets.mVertices[ioMeshlet.mVertexOffset + local[1]]].mPosition;
+		const XMFLOAT3& p2 = inVertices[inMeshlets.mVertices[ioMeshlet.mVertexOffset + local[2]]].mPosition;
+		float e1[3] = { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+		float e2[3] = { p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+		float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+		float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		float scale = length > 0.0f ? 1.0f / length : 0.0f;
+		normals[i] = XMFLOAT3(n[0] * scale, n[1] * scale, n[2] * scale);
+		corners[i] = p0;
+		axis[0] += normals[i].x;
+		axis[1] += normals[i].y;
+		axis[2] += normals[i].z;
+	}
+	float axisLength = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+	float axisScale = axisLength > 0.0f ? 1.0f / axisLength : 0.0f;
+	XMFLOAT3 coneAxis(axis[0] * axisScale, axis[1] * axisScale, axis[2] * axisScale);
+
+	float minDot = 1.0f;
+	for (unsigned int i = 0; i < ioMeshlet.mTriangleCount; ++i)
+	{
+		minDot = std::min(minDot, normals[i].x * coneAxis.x + normals[i].y * coneAxis.y + normals[i].z * coneAxis.z);
+	}
+
+	ioMeshlet.mConeAxis = coneAxis;
+	ioMeshlet.mConeApex = center;
+	if (axisLength <= 0.0f || minDot <= 0.1f)
+	{
+		// Spread over more than a hemisphere, never culled
+		ioMeshlet.mConeCutoff = 1.0f;
+		return;
+	}
+
+	// Move the apex back along the axis until every triangle
+	// plane is in front of it
+	float maxT = 0.0f;
+	for (unsigned int i = 0; i < ioMeshlet.mTriangleCount; ++i)
+	{
+		float dc = (center.x - corners[i].x) * normals[i].x + (center.y - corners[i].y) * normals[i].y + (center.z - corners[i].z) * normals[i].z;
+		float dn = coneAxis.x * normals[i].x + coneAxis.y * normals[i].y + coneAxis.z * normals[i].z;
+		maxT = std::max(maxT, dc / dn);
+	}
+	ioMeshlet.mConeApex = XMFLOAT3(center.x - coneAxis.x * maxT, center.y - coneAxis.y * maxT, center.z - coneAxis.z * maxT);
+	ioMeshlet.mConeCutoff = sqrtf(1.0f - minDot * minDot);
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "Vertex.h"
+
+// A cluster of up to 64 vertices and 124 triangles for cluster culling
+// Its triangles are stored as 3 local (byte) indices into its slice of
+// the meshlet vertex list, which in turn indexes the mesh vertices
+struct Meshlet
+{
+	unsigned int mVertexOffset;
+	unsigned int mVertexCount;
+	unsigned int mTriangleOffset;
+	unsigned int mTriangleCount;
+	unsigned int mMaterialIndex;
+
+	// Bounding sphere
+	XMFLOAT3 mCenter;
+	float mRadius;
+
+	// Normal cone: the meshlet is backfacing for a camera at c if
+	// dot(normalize(mConeApex - c), mConeAxis) >= mConeCutoff
+	// A cutoff of 1 means the cone is too wide to ever cull
+	XMFLOAT3 mConeApex;
+	XMFLOAT3 mConeAxis;
+	float mConeCutoff;
+};
+
+struct MeshletData
+{
+	std::vector<Meshlet> mMeshlets;
+	std::vector<unsigned int> mVertices;
+	std::vector<unsigned char> mTriangles;
+};
+
+class MeshletBuilder
+{
+public:
+	static const unsigned int kMaxVertices = 64;
+	static const unsigned int kMaxTriangles = 124;
+
+	// Greedily grows meshlets over the triangle list inIndices (3 per
+	// triangle, all of one material), always picking the neighbouring
+	// triangle that adds the fewest new vertices, and appends them
+	static void Build(const std::vector<PNTIWVertex>& inVertices, const std::vector<unsigned int>& inIndices,
+		unsigned int inMaterialIndex, MeshletData& ioMeshlets);
+
+private:
+	static void ComputeBounds(const std::vector<PNTIWVertex>& inVertices, const MeshletData& inMeshlets, Meshlet& ioMeshlet);
+};
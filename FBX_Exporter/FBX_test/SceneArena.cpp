@@ -0,0 +1,105 @@
+#include "SceneArena.h"
+#include <cstdlib>
+
+SceneArena::SceneArena(size_t inBlockSize) :
+	mBlockSize(inBlockSize),
+	mCurrentBlock(0),
+	mOffset(0),
+	mBytesUsed(0)
+{}
+
+SceneArena::~SceneArena()
+{
+	Reset();
+	for (unsigned int i = 0; i < mBlocks.size(); ++i)
+	{
+		free(mBlocks[i].mData);
+	}
+}
+
+void* SceneArena::Allocate(size_t inSize, size_t inAlignment)
+{
+	// Blocks come from malloc, aligned for any fundamental type
+	// Big requests neither skip the rest of the current block nor stay
+	// allocated across scenes
+	if (inSize > mBlockSize)
+	{
+		Block largeBlock;
+		largeBlock.mSize = inSize;
+		largeBlock.mData = static_cast<char*>(malloc(inSize));
+		if (!largeBlock.mData)
+		{
+			throw std::bad_alloc();
+		}
+		mLargeBlocks.push_back(largeBlock);
+		mBytesUsed += inSize;
+		return largeBlock.mData;
+	}
+
+	while (mCurrentBlock < mBlocks.size())
+	{
+		Block& currBlock = mBlocks[mCurrentBlock];
+		size_t alignedOffset = (mOffset + inAlignment - 1) & ~(inAlignment - 1);
+		if (alignedOffset + inSize <= currBlock.mSize)
+		{
+			mOffset = alignedOffset + inSize;
+			mBytesUsed += inSize;
+			return currBlock.mData + alignedOffset;
+		}
+
+		++mCurrentBlock;
+		mOffset = 0;
+	}
+
+	// Out of blocks
+	Block newBlock;
+	newBlock.mSize = mBlockSize;
+	newBlock.mData = static_cast<char*>(malloc(newBlock.mSize));
+	if (!newBlock.mData)
+	{
+		throw std::bad_alloc();
+	}
+	mBlocks.push_back(newBlock);
+	mCurrentBlock = mBlocks.size() - 1;
+	mOffset = inSize;
+	mBytesUsed += inSize;
+	return newBlock.mData;
+}
+
+void SceneArena::Reset()
+{
+	for (size_t i = mDestructors.size(); i > 0; --i)
+	{
+		mDestructors[i - 1].mDestroy(mDestructors[i - 1].mObject);
+	}
+	mDestructors.clear();
+
+	for (unsigned int i = 0; i < mLargeBlocks.size(); ++i)
+	{
+		free(mLargeBlocks[i].mData);
+	}
+	mLargeBlocks.clear();
+
+	mCurrentBlock = 0;
+	mOffset = 0;
+	mBytesUsed = 0;
+}
+
+size_t SceneArena::GetBytesUsed() const
+{
+	return mBytesUsed;
+}
+
+size_t SceneArena::GetBytesReserved() const
+{
+	size_t reserved = 0;
+	for (unsigned int i = 0; i < mBlocks.size(); ++i)
+	{
+		reserved += mBlocks[i].mSize;
+	}
+	for (unsigned int i = 0; i < mLargeBlocks.size(); ++i)
+	{
+		reserved += mLargeBlocks[i].mSize;
+	}
+	return reserved;
+}
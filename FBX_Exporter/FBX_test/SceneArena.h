@@ -0,0 +1,83 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+// Bump allocator for everything that only lives while one scene is
+// being processed and written
+// Memory comes from large blocks. Reset() runs the destructors of the
+// objects created with New and rewinds all blocks at once; the blocks
+// are kept, so processing scene after scene does not grow the heap.
+// Requests larger than a block get an allocation of their own, which
+// Reset() releases
+// Only data that dies with the scene belongs here, the exporter's
+// output is allocated elsewhere
+class SceneArena
+{
+public:
+	explicit SceneArena(size_t inBlockSize = 1 << 20);
+	~SceneArena();
+
+	void* Allocate(size_t inSize, size_t inAlignment);
+
+	// Objects that are not trivially destructible get their destructor
+	// called on Reset, in reverse order of creation
+	template<typename T, typename... Args>
+	T* New(Args&&... inArgs)
+	{
+		T* object = new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(inArgs)...);
+		if (!std::is_trivially_destructible<T>::value)
+		{
+			Destructor destructor;
+			destructor.mDestroy = &Destroy<T>;
+			destructor.mObject = object;
+			mDestructors.push_back(destructor);
+		}
+		return object;
+	}
+
+	// Uninitialized storage for plain data
+	template<typename T>
+	T* NewArray(size_t inCount)
+	{
+		static_assert(std::is_trivially_destructible<T>::value, "Arena arrays are never destructed");
+		return static_cast<T*>(Allocate(sizeof(T) * (inCount > 0 ? inCount : 1), alignof(T)));
+	}
+
+	void Reset();
+
+	size_t GetBytesUsed() const;
+	size_t GetBytesReserved() const;
+
+private:
+	struct Block
+	{
+		char* mData;
+		size_t mSize;
+	};
+
+	struct Destructor
+	{
+		void (*mDestroy)(void*);
+		void* mObject;
+	};
+
+	template<typename T>
+	static void Destroy(void* inObject)
+	{
+		static_cast<T*>(inObject)->~T();
+	}
+
+	SceneArena(const SceneArena&);
+	SceneArena& operator=(const SceneArena&);
+
+	size_t mBlockSize;
+	std::vector<Block> mBlocks;
+	std::vector<Block> mLargeBlocks;
+	unsigned int mCurrentBlock;
+	size_t mOffset;
+	size_t mBytesUsed;
+	std::vector<Destructor> mDestructors;
+};
@@ -0,0 +1,480 @@
+#include "SceneSnapshot.h"
+#include "MeshFileWriter.h"
+#include <algorithm>
+#include <fstream>
+
+namespace
+{
+	const char kMagic[4] = { 'F', 'X', 'S', 'N' };
+	const unsigned int kVersion = 2;
+
+	// Position, normal, UV sets, color sets and the blending info count.
+	// The file records MAX_UV_SETS and MAX_COLOR_SETS, a build with other
+	// limits cannot read it
+	const size_t kVertexRecordSize = sizeof(XMFLOAT3) * 2 + sizeof(XMFLOAT2) * MAX_UV_SETS + sizeof(XMFLOAT4) * MAX_COLOR_SETS + sizeof(unsigned int);
+	// Joint index and weight
+	const size_t kBlendingRecordSize = sizeof(unsigned int) + sizeof(double);
+	const size_t kMatrixSize = sizeof(double) * 16;
+
+	size_t GetStringSize(const std::string& inString)
+	{
+		return sizeof(unsigned int) + inString.size();
+	}
+
+	template<typename T>
+	void WriteValue(MeshFileWriter& ioWriter, const T& inValue)
+	{
+		ioWriter.Write(&inValue, sizeof(T));
+	}
+
+	void WriteString(MeshFileWriter& ioWriter, const std::string& inString)
+	{
+		WriteValue(ioWriter, static_cast<unsigned int>(inString.size()));
+		ioWriter.Write(inString.data(), inString.size());
+	}
+
+	// Bounds checked reads from the loaded file; after the first read
+	// past the end every read fails
+	class SnapshotReader
+	{
+	public:
+		SnapshotReader(const char* inData, size_t inSize) :
+			mData(inData),
+			mSize(inSize),
+			mOffset(0),
+			mFailed(false)
+		{
+		}
+
+		const char* Read(size_t inSize)
+		{
+			if (mFailed || inSize > mSize - mOffset)
+			{
+				mFailed = true;
+				return nullptr;
+			}
+			const char* data = mData + mOffset;
+			mOffset += inSize;
+			return data;
+		}
+
+		template<typename T>
+		bool ReadValue(T& outValue)
+		{
+			const char* data = Read(sizeof(T));
+			if (!data)
+			{
+				return false;
+			}
+			memcpy(&outValue, data, sizeof(T));
+			return true;
+		}
+
+		bool ReadString(std::string& outString)
+		{
+			unsigned int length;
+			const char* data = ReadValue(length) ? Read(length) : nullptr;
+			if (!data)
+			{
+				return false;
+			}
+			outString.assign(data, length);
+			return true;
+		}
+
+		// Rejects counts the rest of the file cannot hold before
+		// anything is allocated for them, failing the reader
+		bool CanHold(unsigned long long inCount, size_t inRecordSize)
+		{
+			mFailed = mFailed || inCount * inRecordSize > mSize - mOffset;
+			return !mFailed;
+		}
+
+		bool Failed() const
+		{
+			return mFailed;
+		}
+
+	private:
+		const char* mData;
+		size_t mSize;
+		size_t mOffset;
+		bool mFailed;
+	};
+}
+
+SceneSnapshot::SceneSnapshot()
+{
+	Clear();
+}
+
+void SceneSnapshot::Clear()
+{
+	mSourceFile.clear();
+	mUVSetCount = 0;
+	mColorSetCount = 0;
+	mVertices.clear();
+	mIndices.clear();
+	mMaterialIndices.clear();
+	mNodes.clear();
+	mMaterials.clear();
+	mHasAnimation = false;
+	mAnimationName.clear();
+	mAnimationLength = 0;
+	mJoints.clear();
+}
+
+size_t SceneSnapshot::GetFileSize() const
+{
+	size_t size = sizeof(kMagic) + sizeof(unsigned int) * 12 + sizeof(long long);
+	size += GetStringSize(mSourceFile) + GetStringSize(mAnimationName);
+
+	size += mVertices.size() * kVertexRecordSize;
+	for (unsigned int i = 0; i < mVertices.size(); ++i)
+	{
+		size += mVertices[i].mVertexBlendingInfos.size() * kBlendingRecordSize;
+	}
+	size += (mIndices.size() + mMaterialIndices.size()) * sizeof(unsigned int);
+
+	for (unsigned int i = 0; i < mNodes.size(); ++i)
+	{
+		size += GetStringSize(mNodes[i].mName) + kMatrixSize + sizeof(unsigned int) * 4;
+	}
+	for (unsigned int i = 0; i < mMaterials.size(); ++i)
+	{
+		const SnapshotMaterial& currMaterial = mMaterials[i];
+		size += sizeof(unsigned int) + sizeof(XMFLOAT3) * 5 + sizeof(double) * 4;
+		size += GetStringSize(currMaterial.mName) + GetStringSize(currMaterial.mDiffuseMapName) + GetStringSize(currMaterial.mEmissiveMapName) +
+			GetStringSize(currMaterial.mGlossMapName) + GetStringSize(currMaterial.mNormalMapName) + GetStringSize(currMaterial.mSpecularMapName);
+	}
+	for (unsigned int i = 0; i < mJoints.size(); ++i)
+	{
+		size += GetStringSize(mJoints[i].mName) + sizeof(int) + kMatrixSize + sizeof(unsigned int);
+		size += mJoints[i].mAnimation.size() * (sizeof(long long) + kMatrixSize);
+	}
+
+	return size;
+}
+
+bool SceneSnapshot::Save(const std::string& inPath, bool inSync) const
+{
+	MeshFileWriter writer;
+	if (!writer.Open(inPath, GetFileSize(), inSync))
+	{
+		return false;
+	}
+
+	unsigned int blendingCount = 0;
+	for (unsigned int i = 0; i < mVertices.size(); ++i)
+	{
+		blendingCount += mVertices[i].mVertexBlendingInfos.size();
+	}
+
+	writer.Write(kMagic, sizeof(kMagic));
+	WriteValue(writer, kVersion);
+	WriteValue(writer, static_cast<unsigned int>(MAX_UV_SETS));
+	WriteValue(writer, static_cast<unsigned int>(MAX_COLOR_SETS));
+	WriteValue(writer, mUVSetCount);
+	WriteValue(writer, mColorSetCount);
+	WriteValue(writer, static_cast<unsigned int>(mVertices.size()));
+	WriteValue(writer, blendingCount);
+	WriteValue(writer, static_cast<unsigned int>(mMaterialIndices.size()));
+	WriteValue(writer, static_cast<unsigned int>(mNodes.size()));
+	WriteValue(writer, static_cast<unsigned int>(mMaterials.size()));
+	WriteValue(writer, static_cast<unsigned int>(mJoints.size()));
+	WriteValue(writer, static_cast<unsigned int>(mHasAnimation ? 1 : 0));
+	WriteValue(writer, mAnimationLength);
+	WriteString(writer, mSourceFile);
+	WriteString(writer, mAnimationName);
+
+	// Vertices, then all their blending infos
+	char* vertices = writer.Reserve(mVertices.size() * kVertexRecordSize);
+	for (unsigned int i = 0; i < mVertices.size(); ++i)
+	{
+		const PNTIWVertex& currVertex = mVertices[i];
+		unsigned int currBlendingCount = currVertex.mVertexBlendingInfos.size();
+		memcpy(vertices, &currVertex.mPosition, sizeof(XMFLOAT3));
+		memcpy(vertices + sizeof(XMFLOAT3), &currVertex.mNormal, sizeof(XMFLOAT3));
+		memcpy(vertices + sizeof(XMFLOAT3) * 2, currVertex.mUV, sizeof(currVertex.mUV));
+		memcpy(vertices + sizeof(XMFLOAT3) * 2 + sizeof(currVertex.mUV), currVertex.mColor, sizeof(currVertex.mColor));
+		memcpy(vertices + kVertexRecordSize - sizeof(unsigned int), &currBlendingCount, sizeof(unsigned int));
+		vertices += kVertexRecordSize;
+	}
+	char* blendingInfos = writer.Reserve(blendingCount * kBlendingRecordSize);
+	for (unsigned int i = 0; i < mVertices.size(); ++i)
+	{
+		const std::vector<VertexBlendingInfo>& currInfos = mVertices[i].mVertexBlendingInfos;
+		for (unsigned int j = 0; j < currInfos.size(); ++j)
+		{
+			memcpy(blendingInfos, &currInfos[j].mBlendingIndex, sizeof(unsigned int));
+			memcpy(blendingInfos + sizeof(unsigned int), &currInfos[j].mBlendingWeight, sizeof(double));
+			blendingInfos += kBlendingRecordSize;
+		}
+	}
+
+	if (!mIndices.empty())
+	{
+		writer.Write(&mIndices[0], mIndices.size() * sizeof(unsigned int));
+		writer.Write(&mMaterialIndices[0], mMaterialIndices.size() * sizeof(unsigned int));
+	}
+
+	for (unsigned int i = 0; i < mNodes.size(); ++i)
+	{
+		const SnapshotNode& currNode = mNodes[i];
+		WriteString(writer, currNode.mName);
+		writer.Write(currNode.mGlobalTransform, kMatrixSize);
+		WriteValue(writer, currNode.mFirstTriangle);
+		WriteValue(writer, currNode.mTriangleCount);
+		WriteValue(writer, currNode.mFirstVertex);
+		WriteValue(writer, currNode.mVertexCount);
+	}
+
+	for (unsigned int i = 0; i < mMaterials.size(); ++i)
+	{
+		const SnapshotMaterial& currMaterial = mMaterials[i];
+		WriteValue(writer, static_cast<unsigned int>(currMaterial.mPhong ? 1 : 0));
+		WriteValue(writer, currMaterial.mAmbient);
+		WriteValue(writer, currMaterial.mDiffuse);
+		WriteValue(writer, currMaterial.mEmissive);
+		WriteValue(writer, currMaterial.mSpecular);
+		WriteValue(writer, currMaterial.mReflection);
+		WriteValue(writer, currMaterial.mTransparencyFactor);
+		WriteValue(writer, currMaterial.mSpecularPower);
+		WriteValue(writer, currMaterial.mShininess);
+		WriteValue(writer, currMaterial.mReflectionFactor);
+		WriteString(writer, currMaterial.mName);
+		WriteString(writer, currMaterial.mDiffuseMapName);
+		WriteString(writer, currMaterial.mEmissiveMapName);
+		WriteString(writer, currMaterial.mGlossMapName);
+		WriteString(writer, currMaterial.mNormalMapName);
+		WriteString(writer, currMaterial.mSpecularMapName);
+	}
+
+	for (unsigned int i = 0; i < mJoints.size(); ++i)
+	{
+		const SnapshotJoint& currJoint = mJoints[i];
+		WriteString(writer, currJoint.mName);
+		WriteValue(writer, currJoint.mParentIndex);
+		writer.Write(currJoint.mGlobalBindposeInverse, kMatrixSize);
+		WriteValue(writer, static_cast<unsigned int>(currJoint.mAnimation.size()));
+		for (unsigned int j = 0; j < currJoint.mAnimation.size(); ++j)
+		{
+			WriteValue(writer, currJoint.mAnimation[j].mFrameNum);
+			writer.Write(currJoint.mAnimation[j].mGlobalTransform, kMatrixSize);
+		}
+	}
+
+	return writer.Commit();
+}
+
+bool SceneSnapshot::Load(const std::string& inPath)
+{
+	Clear();
+
+	std::ifstream input(inPath.c_str(), std::ios::binary);
+	if (!input)
+	{
+		return false;
+	}
+	input.seekg(0, std::ios::end);
+	std::vector<char> file(static_cast<size_t>(input.tellg()));
+	input.seekg(0, std::ios::beg);
+	if (file.empty() || !input.read(&file[0], file.size()))
+	{
+		return false;
+	}
+
+	SnapshotReader reader(&file[0], file.size());
+	const char* magic = reader.Read(sizeof(kMagic));
+	unsigned int version = 0;
+	unsigned int maxUVSets = 0;
+	unsigned int maxColorSets = 0;
+	if (!magic || memcmp(magic, kMagic, sizeof(kMagic)) != 0 || !reader.ReadValue(version) || version != kVersion ||
+		!reader.ReadValue(maxUVSets) || maxUVSets != MAX_UV_SETS || !reader.ReadValue(maxColorSets) || maxColorSets != MAX_COLOR_SETS)
+	{
+		return false;
+	}
+
+	unsigned int vertexCount = 0;
+	unsigned int blendingCount = 0;
+	unsigned int triangleCount = 0;
+	unsigned int nodeCount = 0;
+	unsigned int materialCount = 0;
+	unsigned int jointCount = 0;
+	unsigned int hasAnimation = 0;
+	reader.ReadValue(mUVSetCount);
+	reader.ReadValue(mColorSetCount);
+	reader.ReadValue(vertexCount);
+	reader.ReadValue(blendingCount);
+	reader.ReadValue(triangleCount);
+	reader.ReadValue(nodeCount);
+	reader.ReadValue(materialCount);
+	reader.ReadValue(jointCount);
+	reader.ReadValue(hasAnimation);
+	reader.ReadValue(mAnimationLength);
+	reader.ReadString(mSourceFile);
+	reader.ReadString(mAnimationName);
+	mHasAnimation = hasAnimation != 0;
+	if (mUVSetCount > MAX_UV_SETS || mColorSetCount > MAX_COLOR_SETS)
+	{
+		Clear();
+		return false;
+	}
+
+	// Vertices, blending infos, 3 indices and a material per triangle
+	if (!reader.CanHold(static_cast<unsigned long long>(vertexCount) * kVertexRecordSize + static_cast<unsigned long long>(blendingCount) * kBlendingRecordSize +
+		static_cast<unsigned long long>(triangleCount) * sizeof(unsigned int) * 4, 1))
+	{
+		Clear();
+		return false;
+	}
+
+	const char* vertices = reader.Read(vertexCount * kVertexRecordSize);
+	const char* blendingInfos = reader.Read(blendingCount * kBlendingRecordSize);
+	mVertices.resize(vertexCount);
+	unsigned int blendingLeft = blendingCount;
+	for (unsigned int i = 0; i < vertexCount; ++i)
+	{
+		PNTIWVertex& currVertex = mVertices[i];
+		unsigned int currBlendingCount;
+		memcpy(&currVertex.mPosition, vertices, sizeof(XMFLOAT3));
+		memcpy(&currVertex.mNormal, vertices + sizeof(XMFLOAT3), sizeof(XMFLOAT3));
+		memcpy(currVertex.mUV, vertices + sizeof(XMFLOAT3) * 2, sizeof(currVertex.mUV));
+		memcpy(currVertex.mColor, vertices + sizeof(XMFLOAT3) * 2 + sizeof(currVertex.mUV), sizeof(currVertex.mColor));
+		memcpy(&currBlendingCount, vertices + kVertexRecordSize - sizeof(unsigned int), sizeof(unsigned int));
+		vertices += kVertexRecordSize;
+
+		if (currBlendingCount > blendingLeft)
+		{
+			Clear();
+			return false;
+		}
+		blendingLeft -= currBlendingCount;
+		currVertex.mVertexBlendingInfos.resize(currBlendingCount);
+		for (unsigned int j = 0; j < currBlendingCount; ++j)
+		{
+			memcpy(&currVertex.mVertexBlendingInfos[j].mBlendingIndex, blendingInfos, sizeof(unsigned int));
+			memcpy(&currVertex.mVertexBlendingInfos[j].mBlendingWeight, blendingInfos + sizeof(unsigned int), sizeof(double));
+			blendingInfos += kBlendingRecordSize;
+		}
+	}
+
+	mIndices.resize(triangleCount * 3);
+	mMaterialIndices.resize(triangleCount);
+	if (triangleCount > 0)
+	{
+		memcpy(&mIndices[0], reader.Read(mIndices.size() * sizeof(unsigned int)), mIndices.size() * sizeof(unsigned int));
+		memcpy(&mMaterialIndices[0], reader.Read(mMaterialIndices.size() * sizeof(unsigned int)), mMaterialIndices.size() * sizeof(unsigned int));
+	}
+	for (unsigned int i = 0; i < mIndices.size(); ++i)
+	{
+		if (mIndices[i] >= vertexCount)
+		{
+			Clear();
+			return false;
+		}
+	}
+
+	// Every node, material and joint takes at least its string length
+	if (!reader.CanHold(static_cast<unsigned long long>(nodeCount) + materialCount + jointCount, sizeof(unsigned int)))
+	{
+		Clear();
+		return false;
+	}
+
+	mNodes.resize(nodeCount);
+	for (unsigned int i = 0; i < nodeCount && !reader.Failed(); ++i)
+	{
+		SnapshotNode& currNode = mNodes[i];
+		reader.ReadString(currNode.mName);
+		reader.ReadValue(currNode.mGlobalTransform);
+		reader.ReadValue(currNode.mFirstTriangle);
+		reader.ReadValue(currNode.mTriangleCount);
+		reader.ReadValue(currNode.mFirstVertex);
+		reader.ReadValue(currNode.mVertexCount);
+		if (static_cast<unsigned long long>(currNode.mFirstTriangle) + currNode.mTriangleCount > triangleCount ||
+			static_cast<unsigned long long>(currNode.mFirstVertex) + currNode.mVertexCount > vertexCount)
+		{
+			Clear();
+			return false;
+		}
+	}
+
+	mMaterials.resize(materialCount);
+	for (unsigned int i = 0; i < materialCount && !reader.Failed(); ++i)
+	{
+		SnapshotMaterial& currMaterial = mMaterials[i];
+		unsigned int phong = 0;
+		reader.ReadValue(phong);
+		currMaterial.mPhong = phong != 0;
+		reader.ReadValue(currMaterial.mAmbient);
+		reader.ReadValue(currMaterial.mDiffuse);
+		reader.ReadValue(currMaterial.mEmissive);
+		reader.ReadValue(currMaterial.mSpecular);
+		reader.ReadValue(currMaterial.mReflection);
+		reader.ReadValue(currMaterial.mTransparencyFactor);
+		reader.ReadValue(currMaterial.mSpecularPower);
+		reader.ReadValue(currMaterial.mShininess);
+		reader.ReadValue(currMaterial.mReflectionFactor);
+		reader.ReadString(currMaterial.mName);
+		reader.ReadString(currMaterial.mDiffuseMapName);
+		reader.ReadString(currMaterial.mEmissiveMapName);
+		reader.ReadString(currMaterial.mGlossMapName);
+		reader.ReadString(currMaterial.mNormalMapName);
+		reader.ReadString(currMaterial.mSpecularMapName);
+	}
+	// A scene without materials gets a default material 0
+	for (unsigned int i = 0; i < mMaterialIndices.size(); ++i)
+	{
+		if (mMaterialIndices[i] >= std::max(materialCount, 1u))
+		{
+			Clear();
+			return false;
+		}
+	}
+
+	mJoints.resize(jointCount);
+	for (unsigned int i = 0; i < jointCount && !reader.Failed(); ++i)
+	{
+		SnapshotJoint& currJoint = mJoints[i];
+		unsigned int keyframeCount = 0;
+		reader.ReadString(currJoint.mName);
+		reader.ReadValue(currJoint.mParentIndex);
+		reader.ReadValue(currJoint.mGlobalBindposeInverse);
+		reader.ReadValue(keyframeCount);
+		if (currJoint.mParentIndex < -1 || currJoint.mParentIndex >= static_cast<int>(jointCount) ||
+			!reader.CanHold(keyframeCount, sizeof(long long) + kMatrixSize))
+		{
+			Clear();
+			return false;
+		}
+
+		currJoint.mAnimation.resize(keyframeCount);
+		for (unsigned int j = 0; j < keyframeCount; ++j)
+		{
+			reader.ReadValue(currJoint.mAnimation[j].mFrameNum);
+			reader.ReadValue(currJoint.mAnimation[j].mGlobalTransform);
+		}
+	}
+
+	if (reader.Failed())
+	{
+		Clear();
+		return false;
+	}
+
+	for (unsigned int i = 0; i < vertexCount; ++i)
+	{
+		const std::vector<VertexBlendingInfo>& currInfos = mVertices[i].mVertexBlendingInfos;
+		for (unsigned int j = 0; j < currInfos.size(); ++j)
+		{
+			if (currInfos[j].mBlendingIndex >= jointCount)
+			{
+				Clear();
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include "Vertex.h"
+#include <string>
+
+// SDK independent copy of everything the exporter extracts from an
+// FbxScene, taken before any processing. It is the input of the
+// processing stages and the writers, so changing their settings does
+// not need another FBX import, and saved as a binary snapshot it can
+// be reprocessed without the FBX file
+//
+// Polygon corners are already resolved: every triangle corner is a
+// vertex of its own carrying the attribute layers and the skin weights
+// of its control point. Matrices are 16 doubles in FbxAMatrix layout
+// (row vectors, translation in [12..14])
+
+#define SNAPSHOT_SUFFIX ".fbxsnap"
+
+struct SnapshotNode
+{
+	std::string mName;
+	double mGlobalTransform[16];
+	unsigned int mFirstTriangle;
+	unsigned int mTriangleCount;
+	unsigned int mFirstVertex;
+	unsigned int mVertexCount;
+};
+
+struct SnapshotKeyframe
+{
+	long long mFrameNum;
+	double mGlobalTransform[16];
+};
+
+struct SnapshotJoint
+{
+	std::string mName;
+	int mParentIndex;
+	double mGlobalBindposeInverse[16];
+	std::vector<SnapshotKeyframe> mAnimation;
+};
+
+// LambertMaterial or PhongMaterial; the Phong terms are zero for Lambert
+struct SnapshotMaterial
+{
+	bool mPhong;
+	std::string mName;
+	XMFLOAT3 mAmbient;
+	XMFLOAT3 mDiffuse;
+	XMFLOAT3 mEmissive;
+	XMFLOAT3 mSpecular;
+	XMFLOAT3 mReflection;
+	double mTransparencyFactor;
+	double mSpecularPower;
+	double mShininess;
+	double mReflectionFactor;
+	std::string mDiffuseMapName;
+	std::string mEmissiveMapName;
+	std::string mGlossMapName;
+	std::string mNormalMapName;
+	std::string mSpecularMapName;
+};
+
+class SceneSnapshot
+{
+public:
+	SceneSnapshot();
+
+	// Keeps the capacity of the containers
+	void Clear();
+
+	bool Save(const std::string& inPath, bool inSync) const;
+	// False if the file is missing, truncated, of another version or of a
+	// build with other vertex limits, or references out of range
+	bool Load(const std::string& inPath);
+
+	std::string mSourceFile;
+	// Layout the vertices were extracted with
+	unsigned int mUVSetCount;
+	unsigned int mColorSetCount;
+
+	std::vector<PNTIWVertex> mVertices;
+	// 3 per triangle, and the global material index of every triangle
+	std::vector<unsigned int> mIndices;
+	std::vector<unsigned int> mMaterialIndices;
+	std::vector<SnapshotNode> mNodes;
+	std::vector<SnapshotMaterial> mMaterials;
+
+	bool mHasAnimation;
+	std::string mAnimationName;
+	long long mAnimationLength;
+	std::vector<SnapshotJoint> mJoints;
+
+private:
+	size_t GetFileSize() const;
+};
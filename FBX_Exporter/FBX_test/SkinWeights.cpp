@@ -0,0 +1,150 @@
+#include "SkinWeights.h"
+#include <emmintrin.h>
+
+void SkinWeights::Process(std::vector<PNTIWVertex>& ioVertices, float inMinWeight)
+{
+	const size_t vertexCount = ioVertices.size();
+	const size_t stride = (vertexCount + 3) & ~static_cast<size_t>(3);
+	std::vector<unsigned int> joints(stride * MAX_INFLUENCES, 0);
+	std::vector<float> weights(stride * MAX_INFLUENCES, 0.0f);
+	std::vector<unsigned char> quantized(stride * MAX_INFLUENCES);
+
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		SelectStrongest(ioVertices[i].mVertexBlendingInfos, stride, &joints[i], &weights[i]);
+	}
+
+	if (stride > 0)
+	{
+		Quantize(&weights[0], stride, stride, inMinWeight, &quantized[0]);
+	}
+
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		std::vector<VertexBlendingInfo>& currInfos = ioVertices[i].mVertexBlendingInfos;
+		currInfos.resize(MAX_INFLUENCES);
+		for (unsigned int k = 0; k < MAX_INFLUENCES; ++k)
+		{
+			const unsigned char weight = quantized[k * stride + i];
+			currInfos[k].mBlendingIndex = weight > 0 ? joints[k * stride + i] : 0;
+			currInfos[k].mBlendingWeight = weight / 255.0;
+		}
+	}
+}
+
+void SkinWeights::SelectStrongest(const std::vector<VertexBlendingInfo>& inInfluences, size_t inStride,
+	unsigned int* outJoints, float* outWeights)
+{
+	unsigned int selectedJoints[MAX_INFLUENCES];
+	float selectedWeights[MAX_INFLUENCES];
+	unsigned int selectedCount = 0;
+
+	// Insertion into the sorted selection, at most MAX_INFLUENCES long
+	for (size_t i = 0; i < inInfluences.size(); ++i)
+	{
+		const float weight = static_cast<float>(inInfluences[i].mBlendingWeight);
+		const unsigned int joint = inInfluences[i].mBlendingIndex;
+		if (!(weight > 0.0f))
+		{
+			continue;
+		}
+
+		unsigned int position = selectedCount;
+		while (position > 0 && (selectedWeights[position - 1] < weight ||
+			(selectedWeights[position - 1] == weight && selectedJoints[position - 1] > joint)))
+		{
+			--position;
+		}
+		if (position == MAX_INFLUENCES)
+		{
+			continue;
+		}
+
+		const unsigned int last = selectedCount < MAX_INFLUENCES ? selectedCount : MAX_INFLUENCES - 1;
+		for (unsigned int k = last; k > position; --k)
+		{
+			selectedJoints[k] = selectedJoints[k - 1];
+			selectedWeights[k] = selectedWeights[k - 1];
+		}
+		selectedJoints[position] = joint;
+		selectedWeights[position] = weight;
+		if (selectedCount < MAX_INFLUENCES)
+		{
+			++selectedCount;
+		}
+	}
+
+	for (unsigned int k = 0; k < selectedCount; ++k)
+	{
+		outJoints[k * inStride] = selectedJoints[k];
+		outWeights[k * inStride] = selectedWeights[k];
+	}
+}
+
+void SkinWeights::Quantize(const float* inWeights, size_t inStride, size_t inCount, float inMinWeight,
+	unsigned char* outQuantized)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 minWeight = _mm_set1_ps(inMinWeight);
+	const __m128 steps = _mm_set1_ps(255.0f);
+	const __m128i one = _mm_set1_epi32(1);
+
+	for (size_t i = 0; i < inCount; i += 4)
+	{
+		__m128 weights[MAX_INFLUENCES];
+		__m128 sum = zero;
+		for (unsigned int k = 0; k < MAX_INFLUENCES; ++k)
+		{
+			weights[k] = _mm_loadu_ps(inWeights + k * inStride + i);
+			sum = _mm_add_ps(sum, weights[k]);
+		}
+
+		// Pruning against the selected sum, the first (strongest) stays
+		const __m128 threshold = _mm_mul_ps(minWeight, sum);
+		sum = weights[0];
+		for (unsigned int k = 1; k < MAX_INFLUENCES; ++k)
+		{
+			weights[k] = _mm_and_ps(weights[k], _mm_cmpge_ps(weights[k], threshold));
+			sum = _mm_add_ps(sum, weights[k]);
+		}
+
+		// Renormalized to 255 steps, vertices without influences stay 0
+		const __m128 skinned = _mm_cmpgt_ps(sum, zero);
+		const __m128 scale = _mm_and_ps(_mm_div_ps(steps, sum), skinned);
+		__m128i quantized[MAX_INFLUENCES];
+		__m128 remainders[MAX_INFLUENCES];
+		__m128i quantizedSum = _mm_setzero_si128();
+		for (unsigned int k = 0; k < MAX_INFLUENCES; ++k)
+		{
+			const __m128 scaled = _mm_mul_ps(weights[k], scale);
+			quantized[k] = _mm_cvttps_epi32(scaled);
+			remainders[k] = _mm_sub_ps(scaled, _mm_cvtepi32_ps(quantized[k]));
+			quantizedSum = _mm_add_epi32(quantizedSum, quantized[k]);
+		}
+		const __m128i deficit = _mm_and_si128(_mm_sub_epi32(_mm_set1_epi32(255), quantizedSum), _mm_castps_si128(skinned));
+
+		// An influence gets a step if fewer than deficit influences have
+		// a larger remainder (or an equal one and come first)
+		for (unsigned int k = 0; k < MAX_INFLUENCES; ++k)
+		{
+			__m128i rank = _mm_setzero_si128();
+			for (unsigned int j = 0; j < MAX_INFLUENCES; ++j)
+			{
+				if (j == k)
+				{
+					continue;
+				}
+				const __m128 larger = j < k ? _mm_cmpge_ps(remainders[j], remainders[k]) : _mm_cmpgt_ps(remainders[j], remainders[k]);
+				rank = _mm_sub_epi32(rank, _mm_castps_si128(larger));
+			}
+			quantized[k] = _mm_add_epi32(quantized[k], _mm_and_si128(_mm_cmplt_epi32(rank, deficit), one));
+
+			int values[4];
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(values), quantized[k]);
+			for (unsigned int lane = 0; lane < 4; ++lane)
+			{
+				outQuantized[k * inStride + i + lane] = static_cast<unsigned char>(values[lane]);
+			}
+		}
+	}
+}
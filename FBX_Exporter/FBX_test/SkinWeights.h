@@ -0,0 +1,33 @@
+#pragma once
+#include "Vertex.h"
+
+// Turns the raw skin influences of the extracted vertices (any number
+// per vertex, not necessarily normalized) into exactly MAX_INFLUENCES
+// per vertex: the strongest ones, sorted by weight, those below a
+// minimum weight pruned, renormalized and quantized to multiples of
+// 1/255 that add up to exactly 1
+// Unused influences have joint 0 and weight 0, vertices without any
+// influence keep all weights 0
+//
+// The influences are selected vertex by vertex into MAX_INFLUENCES
+// planes of joints and weights, then normalized, pruned and quantized
+// four vertices at a time with SSE2. Quantization rounds down and
+// hands the missing steps to the largest remainders
+class SkinWeights
+{
+public:
+	// inMinWeight is relative to the sum of the selected weights. The
+	// strongest influence is never pruned
+	static void Process(std::vector<PNTIWVertex>& ioVertices, float inMinWeight);
+
+private:
+	// The MAX_INFLUENCES strongest of inInfluences, strongest first and
+	// the lower joint first on ties, to outJoints[k * inStride] and
+	// outWeights[k * inStride]
+	static void SelectStrongest(const std::vector<VertexBlendingInfo>& inInfluences, size_t inStride,
+		unsigned int* outJoints, float* outWeights);
+
+	// inCount (a multiple of 4) vertices of weight planes inStride apart
+	static void Quantize(const float* inWeights, size_t inStride, size_t inCount, float inMinWeight,
+		unsigned char* outQuantized);
+};
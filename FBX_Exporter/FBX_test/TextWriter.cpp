@@ -0,0 +1,289 @@
+#include "TextWriter.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+	// Buffered text is handed to the stream in chunks of about this size
+	const size_t kFlushSize = 1 << 20;
+
+	// Powers of ten up to 1e22 are exact doubles
+	const double kPow10[] =
+	{
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	// Exact but slow: the shortest %g precision that reads back
+	int FormatFloatSlow(float inValue, char* outText)
+	{
+		int length = 0;
+		for (int precision = 1; precision <= 9; ++precision)
+		{
+			length = snprintf(outText, 32, "%.*g", precision, inValue);
+			if (strtof(outText, nullptr) == inValue)
+			{
+				break;
+			}
+		}
+		return length;
+	}
+}
+
+TextWriter::TextWriter(std::ostream* inStream, bool inStreamCompatible) :
+	mStream(inStream),
+	mStreamCompatible(inStreamCompatible)
+{
+	mBuffer.reserve(mStream ? kFlushSize + 256 : 4096);
+}
+
+TextWriter::~TextWriter()
+{
+	Flush();
+}
+
+void TextWriter::Append(const char* inText, size_t inLength)
+{
+	mBuffer.append(inText, inLength);
+	if (mStream && mBuffer.size() >= kFlushSize)
+	{
+		Flush();
+	}
+}
+
+void TextWriter::Append(const TextWriter& inOther)
+{
+	Append(inOther.mBuffer.data(), inOther.mBuffer.size());
+}
+
+void TextWriter::Flush()
+{
+	if (mStream && !mBuffer.empty())
+	{
+		mStream->write(mBuffer.data(), mBuffer.size());
+		mBuffer.clear();
+	}
+}
+
+TextWriter& TextWriter::operator<<(const char* inText)
+{
+	Append(inText, strlen(inText));
+	return *this;
+}
+
+TextWriter& TextWriter::operator<<(const std::string& inText)
+{
+	Append(inText.data(), inText.size());
+	return *this;
+}
+
+TextWriter& TextWriter::operator<<(char inChar)
+{
+	Append(&inChar, 1);
+	return *this;
+}
+
+TextWriter& TextWriter::operator<<(int inValue)
+{
+	return *this << static_cast<long long>(inValue);
+}
+
+TextWriter& TextWriter::operator<<(unsigned int inValue)
+{
+	AppendUnsigned(inValue, false);
+	return *this;
+}
+
+TextWriter& TextWriter::operator<<(long inValue)
+{
+	return *this << static_cast<long long>(inValue);
+}
+
+TextWriter& TextWriter::operator<<(unsigned long inValue)
+{
+	AppendUnsigned(inValue, false);
+	return *this;
+}
+
+TextWriter& TextWriter::operator<<(long long inValue)
+{
+	// Negate as unsigned so the smallest value does not overflow
+	AppendUnsigned(inValue < 0 ? 0ull - static_cast<unsigned long long>(inValue) : static_cast<unsigned long long>(inValue), inValue < 0);
+	return *this;
+}
+
+TextWriter& TextWriter::operator<<(unsigned long long inValue)
+{
+	AppendUnsigned(inValue, false);
+	return *this;
+}
+
+void TextWriter::AppendUnsigned(unsigned long long inValue, bool inNegative)
+{
+	char text[24];
+	char* end = text + sizeof(text);
+	char* begin = end;
+	do
+	{
+		*--begin = static_cast<char>('0' + inValue % 10);
+		inValue /= 10;
+	} while (inValue > 0);
+	if (inNegative)
+	{
+		*--begin = '-';
+	}
+	Append(begin, end - begin);
+}
+
+TextWriter& TextWriter::operator<<(float inValue)
+{
+	char text[32];
+	int length = mStreamCompatible ? snprintf(text, sizeof(text), "%g", inValue) : FormatFloat(inValue, text);
+	Append(text, length);
+	return *this;
+}
+
+int TextWriter::FormatFloat(float inValue, char* outText)
+{
+	if (inValue == 0.0f)
+	{
+		return snprintf(outText, 32, std::signbit(inValue) ? "-0" : "0");
+	}
+	if (!std::isfinite(inValue))
+	{
+		return snprintf(outText, 32, "%g", inValue);
+	}
+
+	char* out = outText;
+	if (inValue < 0.0f)
+	{
+		*out++ = '-';
+		inValue = -inValue;
+	}
+
+	// Decimal exponent of the first digit. Outside of this range the
+	// scale factors are no longer exact doubles
+	const double value = inValue;
+	int exponent = static_cast<int>(floor(log10(value)));
+	if (exponent < -13 || exponent > 13)
+	{
+		return static_cast<int>(out - outText) + FormatFloatSlow(inValue, out);
+	}
+
+	// Decimals strictly between the halfway points to the neighbouring
+	// floats read back to inValue. The doubles below only approximate the
+	// decimal, so one this close to a halfway point (an exact tie reads
+	// back to the float with the even mantissa) is decided by parsing it
+	const double below = (value + static_cast<double>(nextafterf(inValue, 0.0f))) * 0.5;
+	const double above = (value + static_cast<double>(nextafterf(inValue, HUGE_VALF))) * 0.5;
+	const double tolerance = value * 1e-15;
+
+	// Fewest significant digits that read back to inValue
+	unsigned long long digits = 0;
+	int digitCount = 0;
+	for (int precision = 1; precision <= 9; ++precision)
+	{
+		int scale = precision - 1 - exponent;
+		double scaled = scale >= 0 ? value * kPow10[scale] : value / kPow10[-scale];
+		double rounded = floor(scaled + 0.5);
+		double decimal = scale >= 0 ? rounded / kPow10[scale] : rounded * kPow10[-scale];
+		if (decimal > below + tolerance && decimal < above - tolerance)
+		{
+			digits = static_cast<unsigned long long>(rounded);
+			digitCount = precision;
+			break;
+		}
+		if (fabs(decimal - below) <= tolerance || fabs(decimal - above) <= tolerance)
+		{
+			char candidate[32];
+			snprintf(candidate, sizeof(candidate), "%.*e", precision - 1, value);
+			if (strtof(candidate, nullptr) == inValue)
+			{
+				char* exponentText = strchr(candidate, 'e');
+				for (const char* c = candidate; c < exponentText; ++c)
+				{
+					if (*c != '.')
+					{
+						digits = digits * 10 + (*c - '0');
+					}
+				}
+				exponent = atoi(exponentText + 1);
+				digitCount = precision;
+				break;
+			}
+		}
+	}
+	if (digitCount == 0)
+	{
+		return static_cast<int>(out - outText) + FormatFloatSlow(inValue, out);
+	}
+
+	// log10 can be off by one next to powers of ten, and 9.96 rounds
+	// up to 10 at two digits
+	while (digits >= static_cast<unsigned long long>(kPow10[digitCount]))
+	{
+		digits /= 10;
+		++exponent;
+	}
+	while (digitCount > 1 && digits < static_cast<unsigned long long>(kPow10[digitCount - 1]))
+	{
+		--digitCount;
+		--exponent;
+	}
+
+	char digitText[16];
+	for (int i = digitCount - 1; i >= 0; --i)
+	{
+		digitText[i] = static_cast<char>('0' + digits % 10);
+		digits /= 10;
+	}
+	while (digitCount > 1 && digitText[digitCount - 1] == '0')
+	{
+		--digitCount;
+	}
+
+	// Same choice between fixed and scientific notation as %g
+	if (exponent >= -5 && exponent < 9)
+	{
+		if (exponent < 0)
+		{
+			*out++ = '0';
+			*out++ = '.';
+			for (int i = -1; i > exponent; --i)
+			{
+				*out++ = '0';
+			}
+			memcpy(out, digitText, digitCount);
+			out += digitCount;
+		}
+		else
+		{
+			for (int i = 0; i <= exponent; ++i)
+			{
+				*out++ = i < digitCount ? digitText[i] : '0';
+			}
+			if (digitCount > exponent + 1)
+			{
+				*out++ = '.';
+				memcpy(out, digitText + exponent + 1, digitCount - exponent - 1);
+				out += digitCount - exponent - 1;
+			}
+		}
+	}
+	else
+	{
+		*out++ = digitText[0];
+		if (digitCount > 1)
+		{
+			*out++ = '.';
+			memcpy(out, digitText + 1, digitCount - 1);
+			out += digitCount - 1;
+		}
+		out += snprintf(out, 8, "e%c%02d", exponent < 0 ? '-' : '+', exponent < 0 ? -exponent : exponent);
+	}
+	*out = '\0';
+
+	return static_cast<int>(out - outText);
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <ostream>
+#include <string>
+
+// Buffered text output for the .itpmesh / .itpanim exports
+// Text is collected in a string and handed to the stream in large
+// chunks, never flushing per line. Floats are written as the shortest
+// decimal that reads back to the same float; with inStreamCompatible
+// they are formatted exactly like std::ostream does by default (%g),
+// so the output is byte identical to the old exporter
+//
+// A writer without a stream just accumulates text, which is how
+// blocks are formatted on several threads and appended in order
+class TextWriter
+{
+public:
+	TextWriter(std::ostream* inStream, bool inStreamCompatible);
+	~TextWriter();
+
+	TextWriter& operator<<(const char* inText);
+	TextWriter& operator<<(const std::string& inText);
+	TextWriter& operator<<(char inChar);
+	TextWriter& operator<<(int inValue);
+	TextWriter& operator<<(unsigned int inValue);
+	TextWriter& operator<<(long inValue);
+	TextWriter& operator<<(unsigned long inValue);
+	TextWriter& operator<<(long long inValue);
+	TextWriter& operator<<(unsigned long long inValue);
+	TextWriter& operator<<(float inValue);
+
+	void Append(const TextWriter& inOther);
+	// Hands the buffered text to the stream, without flushing the stream
+	void Flush();
+
+	// Writes the shortest representation of inValue to outText (at least
+	// 32 bytes) and returns its length
+	static int FormatFloat(float inValue, char* outText);
+
+private:
+	void Append(const char* inText, size_t inLength);
+	void AppendUnsigned(unsigned long long inValue, bool inNegative);
+
+	std::ostream* mStream;
+	bool mStreamCompatible;
+	std::string mBuffer;
+};
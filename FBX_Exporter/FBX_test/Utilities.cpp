@@ -1,8 +1,8 @@
 #include "Utilities.h"
 
-void Utilities::WriteMatrix(std::ostream& inStream, FbxMatrix& inMatrix, bool inIsRoot)
+void Utilities::WriteMatrix(TextWriter& inWriter, const FbxMatrix& inMatrix, bool inIsRoot)
 {
-	inStream << "<mat>" << static_cast<float>(inMatrix.Get(0, 0)) << "," << static_cast<float>(inMatrix.Get(0, 1)) << "," << static_cast<float>(inMatrix.Get(0, 2)) << "," << static_cast<float>(inMatrix.Get(0, 3)) << ","
+	inWriter << "<mat>" << static_cast<float>(inMatrix.Get(0, 0)) << "," << static_cast<float>(inMatrix.Get(0, 1)) << "," << static_cast<float>(inMatrix.Get(0, 2)) << "," << static_cast<float>(inMatrix.Get(0, 3)) << ","
 		<< static_cast<float>(inMatrix.Get(1, 0)) << "," << static_cast<float>(inMatrix.Get(1, 1)) << "," << static_cast<float>(inMatrix.Get(1, 2)) << "," << static_cast<float>(inMatrix.Get(1, 3)) << ","
 		<< static_cast<float>(inMatrix.Get(2, 0)) << "," << static_cast<float>(inMatrix.Get(2, 1)) << "," << static_cast<float>(inMatrix.Get(2, 2)) << "," << static_cast<float>(inMatrix.Get(2, 3)) << ","
 		<< static_cast<float>(inMatrix.Get(3, 0)) << "," << static_cast<float>(inMatrix.Get(3, 1)) << "," << static_cast<float>(inMatrix.Get(3, 2)) << "," << static_cast<float>(inMatrix.Get(3, 3)) << "</mat>\n";
@@ -63,4 +63,8 @@ std::string Utilities::RemoveSuffix(const std::string& inInput)
 	{
 		return inInput;
 	}
-}
\ No newline at end of file
+}
+bool Utilities::EndsWith(const std::string& inInput, const std::string& inSuffix)
+{
+	return inInput.size() >= inSuffix.size() && inInput.compare(inInput.size() - inSuffix.size(), inSuffix.size(), inSuffix) == 0;
+}
@@ -3,6 +3,7 @@
 #include <iostream>
 #include <string>
 #include "Vertex.h"
+#include "TextWriter.h"
 
 struct BlendingIndexWeightPair
 {
@@ -49,6 +50,7 @@ struct Keyframe
 };
 
 // This is the actual representation of a joint in a game engine
+// Its keyframes are allocated from the exporter's scene arena
 struct Joint
 {
 	std::string mName;
@@ -65,15 +67,6 @@ struct Joint
 		mParentIndex = -1;
 	}
 
-	~Joint()
-	{
-		while(mAnimation)
-		{
-			Keyframe* temp = mAnimation->mNext;
-			delete mAnimation;
-			mAnimation = temp;
-		}
-	}
 };
 
 struct Skeleton
@@ -87,19 +80,76 @@ struct Triangle
 	std::string mMaterialName;
 	unsigned int mMaterialIndex;
 
-	bool operator<(const Triangle& rhs)
+	bool operator<(const Triangle& rhs) const
 	{
 		return mMaterialIndex < rhs.mMaterialIndex;
 	}
 };
 
+// Every mesh node of the scene owns a contiguous range of
+// triangles and, after welding, a contiguous range of vertices
+struct MeshNode
+{
+	std::string mName;
+	FbxAMatrix mGlobalTransform;
+	unsigned int mFirstTriangle;
+	unsigned int mTriangleCount;
+	unsigned int mFirstVertex;
+	unsigned int mVertexCount;
+	// Node whose triangles and vertices this one shares, -1 if it owns them
+	int mInstanceOf;
+
+	MeshNode() :
+		mFirstTriangle(0),
+		mTriangleCount(0),
+		mFirstVertex(0),
+		mVertexCount(0),
+		mInstanceOf(-1)
+	{
+		mGlobalTransform.SetIdentity();
+	}
+};
+
+// A run of triangles of one node that share one material
+// This is what a renderer issues as a single draw call
+struct DrawRange
+{
+	unsigned int mNodeIndex;
+	unsigned int mMaterialIndex;
+	unsigned int mFirstTriangle;
+	unsigned int mTriangleCount;
+	unsigned int mFirstVertex;
+	unsigned int mVertexCount;
+};
+
+// Joints referenced by the vertices of a draw range, a slice of the
+// exporter's palette joint list. Blend indices are positions in it
+struct BonePalette
+{
+	unsigned int mFirstJoint;
+	unsigned int mJointCount;
+};
+
+// A simplified version of the mesh. Its triangles index the
+// full resolution vertex buffer and are grouped by draw range
+struct LodLevel
+{
+	std::vector<unsigned int> mIndices;
+	std::vector<DrawRange> mDrawRanges;
+	float mError;
+
+	LodLevel() :
+		mError(0.0f)
+	{}
+};
+
 
 class Utilities
 {
 public:
 
 	// This function should be changed if exporting to another format
-	static void WriteMatrix(std::ostream& inStream, FbxMatrix& inMatrix, bool inIsRoot);
+	static void WriteMatrix(TextWriter& inWriter, const FbxMatrix& inMatrix, bool inIsRoot);
 
 	static void PrintMatrix(FbxMatrix& inMatrix);
 	
@@ -108,6 +158,8 @@ public:
 	static std::string GetFileName(const std::string& inInput);
 
 	static std::string RemoveSuffix(const std::string& inInput);
+
+	static bool EndsWith(const std::string& inInput, const std::string& inSuffix);
 };
 
 
@@ -2,7 +2,20 @@
 #include "MathHelper.h"
 #include <vector>
 #include <algorithm>
+#include <cstring>
 
+// Upper bound of texture coordinate sets and vertex color layers
+// a vertex can carry. How many of them are actually extracted is
+// configured on the exporter (see FBXExporter::SetVertexLayout)
+const unsigned int MAX_UV_SETS = 4;
+const unsigned int MAX_COLOR_SETS = 2;
+// Joint influences of a skinned vertex after SkinWeights, 4 or 8 for
+// the whole build (define SKIN_INFLUENCES=8 for 8)
+#ifndef SKIN_INFLUENCES
+#define SKIN_INFLUENCES 4
+#endif
+static_assert(SKIN_INFLUENCES == 4 || SKIN_INFLUENCES == 8, "SKIN_INFLUENCES must be 4 or 8");
+const unsigned int MAX_INFLUENCES = SKIN_INFLUENCES;
 
 struct PNTVertex
 {
@@ -44,9 +57,17 @@ struct PNTIWVertex
 {
 	XMFLOAT3 mPosition;
 	XMFLOAT3 mNormal;
-	XMFLOAT2 mUV;
+	XMFLOAT2 mUV[MAX_UV_SETS];
+	XMFLOAT4 mColor[MAX_COLOR_SETS];
 	std::vector<VertexBlendingInfo> mVertexBlendingInfos;
 
+	PNTIWVertex()
+	{
+		// Unused sets stay zero so they never break vertex comparison
+		memset(mUV, 0, sizeof(mUV));
+		memset(mColor, 0, sizeof(mColor));
+	}
+
 	void SortBlendingInfoByWeight()
 	{
 		std::sort(mVertexBlendingInfos.begin(), mVertexBlendingInfos.end());
@@ -54,13 +75,13 @@ struct PNTIWVertex
 
 	bool operator==(const PNTIWVertex& rhs) const
 	{
-		bool sameBlendingInfo = true;
+		bool sameBlendingInfo = mVertexBlendingInfos.size() == rhs.mVertexBlendingInfos.size();
 
-		// We only compare the blending info when there is blending info
-		if(!(mVertexBlendingInfos.empty() && rhs.mVertexBlendingInfos.empty()))
+		// Skinned vertices have MAX_INFLUENCES pairs (see SkinWeights),
+		// others none
+		if(sameBlendingInfo)
 		{
-			// Each vertex should only have 4 index-weight blending info pairs
-			for (unsigned int i = 0; i < 4; ++i)
+			for (unsigned int i = 0; i < mVertexBlendingInfos.size(); ++i)
 			{
 				if (mVertexBlendingInfos[i].mBlendingIndex != rhs.mVertexBlendingInfos[i].mBlendingIndex ||
 					abs(mVertexBlendingInfos[i].mBlendingWeight - rhs.mVertexBlendingInfos[i].mBlendingWeight) > 0.001)
@@ -73,8 +94,17 @@ struct PNTIWVertex
 		
 		bool result1 = MathHelper::CompareVector3WithEpsilon(mPosition, rhs.mPosition);
 		bool result2 = MathHelper::CompareVector3WithEpsilon(mNormal, rhs.mNormal);
-		bool result3 = MathHelper::CompareVector2WithEpsilon(mUV, rhs.mUV);
+		bool result3 = true;
+		for (unsigned int i = 0; i < MAX_UV_SETS && result3; ++i)
+		{
+			result3 = MathHelper::CompareVector2WithEpsilon(mUV[i], rhs.mUV[i]);
+		}
+		bool result4 = true;
+		for (unsigned int i = 0; i < MAX_COLOR_SETS && result4; ++i)
+		{
+			result4 = MathHelper::CompareVector4WithEpsilon(mColor[i], rhs.mColor[i]);
+		}
 
-		return result1 && result2 && result3 && sameBlendingInfo;
+		return result1 && result2 && result3 && result4 && sameBlendingInfo;
 	}
 };
@@ -0,0 +1,77 @@
+#include "VertexLayout.h"
+
+void VertexStreams::Gather(const std::vector<PNTIWVertex>& inVertices, unsigned int inUVSetCount, unsigned int inColorSetCount, bool inSkinned)
+{
+	const unsigned int vertexCount = static_cast<unsigned int>(inVertices.size());
+	mPositions.resize(vertexCount);
+	mNormals.resize(vertexCount);
+	for (unsigned int i = 0; i < vertexCount; ++i)
+	{
+		mPositions[i] = inVertices[i].mPosition;
+		mNormals[i] = inVertices[i].mNormal;
+	}
+
+	for (unsigned int k = 0; k < MAX_UV_SETS; ++k)
+	{
+		mUVs[k].resize(k < inUVSetCount ? vertexCount : 0);
+	}
+	for (unsigned int k = 0; k < inUVSetCount && k < MAX_UV_SETS; ++k)
+	{
+		for (unsigned int i = 0; i < vertexCount; ++i)
+		{
+			mUVs[k][i] = inVertices[i].mUV[k];
+		}
+	}
+
+	for (unsigned int k = 0; k < MAX_COLOR_SETS; ++k)
+	{
+		mColors[k].resize(k < inColorSetCount ? vertexCount : 0);
+	}
+	for (unsigned int k = 0; k < inColorSetCount && k < MAX_COLOR_SETS; ++k)
+	{
+		for (unsigned int i = 0; i < vertexCount; ++i)
+		{
+			mColors[k][i] = inVertices[i].mColor[k];
+		}
+	}
+
+	mBlendWeights.assign(inSkinned ? static_cast<size_t>(vertexCount) * MAX_INFLUENCES : 0, 0.0f);
+	mBlendIndices.assign(inSkinned ? static_cast<size_t>(vertexCount) * MAX_INFLUENCES : 0, 0.0f);
+	if (!inSkinned)
+	{
+		return;
+	}
+	for (unsigned int i = 0; i < vertexCount; ++i)
+	{
+		const std::vector<VertexBlendingInfo>& infos = inVertices[i].mVertexBlendingInfos;
+		for (unsigned int j = 0; j < infos.size() && j < MAX_INFLUENCES; ++j)
+		{
+			mBlendWeights[static_cast<size_t>(i) * MAX_INFLUENCES + j] = static_cast<float>(infos[j].mBlendingWeight);
+			mBlendIndices[static_cast<size_t>(i) * MAX_INFLUENCES + j] = static_cast<float>(infos[j].mBlendingIndex);
+		}
+	}
+}
+
+VertexStreamFormat GetUVSetFormat(unsigned int inSet)
+{
+	static_assert(MAX_UV_SETS == 4, "One format per UV set");
+	static const VertexStreamFormat formats[MAX_UV_SETS] =
+	{
+		GetStreamFormat<UVSetFormat<0>>(),
+		GetStreamFormat<UVSetFormat<1>>(),
+		GetStreamFormat<UVSetFormat<2>>(),
+		GetStreamFormat<UVSetFormat<3>>()
+	};
+	return formats[inSet];
+}
+
+VertexStreamFormat GetColorSetFormat(unsigned int inSet)
+{
+	static_assert(MAX_COLOR_SETS == 2, "One format per color set");
+	static const VertexStreamFormat formats[MAX_COLOR_SETS] =
+	{
+		GetStreamFormat<ColorSetFormat<0>>(),
+		GetStreamFormat<ColorSetFormat<1>>()
+	};
+	return formats[inSet];
+}
@@ -0,0 +1,280 @@
+#pragma once
+#include "Vertex.h"
+#include "static_mesh_struct.h"
+
+// Vertex formats declared as lists of attribute descriptors
+//
+//	typedef VertexFormat<
+//		VertexAttribute<SM_SEMANTIC_POSITION, 0, SM_ENCODING_FLOAT32>,
+//		VertexAttribute<SM_SEMANTIC_NORMAL, 0, SM_ENCODING_SNORM16>> Format;
+//
+// interleaves the listed attributes in that order. Offsets, stride and
+// encoders are resolved at compile time, so Format::Pack is a straight
+// conversion loop per attribute without any branch on the layout, and
+// Format::Describe emits the matching SM_vertex_attribute records that
+// make the file self describing
+
+// Vertex attributes gathered into one array per attribute, the input
+// of the packers
+struct VertexStreams
+{
+	std::vector<XMFLOAT3> mPositions;
+	std::vector<XMFLOAT3> mNormals;
+	std::vector<XMFLOAT2> mUVs[MAX_UV_SETS];
+	std::vector<XMFLOAT4> mColors[MAX_COLOR_SETS];
+	// MAX_INFLUENCES per vertex, empty unless gathered as skinned
+	std::vector<float> mBlendWeights;
+	std::vector<float> mBlendIndices;
+
+	void Gather(const std::vector<PNTIWVertex>& inVertices, unsigned int inUVSetCount, unsigned int inColorSetCount, bool inSkinned);
+};
+
+// Rounds to nearest, values out of the half range become infinity and
+// values below it zero
+inline unsigned short FloatToHalf(float inValue)
+{
+	unsigned int bits;
+	memcpy(&bits, &inValue, sizeof(bits));
+	const unsigned int sign = (bits >> 16) & 0x8000;
+	const int exponent = static_cast<int>((bits >> 23) & 0xff) - 112;
+	const unsigned int mantissa = bits & 0x7fffff;
+	if (exponent <= 0)
+	{
+		return static_cast<unsigned short>(sign);
+	}
+	if (exponent >= 31)
+	{
+		return static_cast<unsigned short>(sign | 0x7c00);
+	}
+	// A rounding carry out of the mantissa correctly bumps the exponent
+	return static_cast<unsigned short>((sign | (exponent << 10) | (mantissa >> 13)) + ((mantissa >> 12) & 1));
+}
+
+// Float array of a semantic, kComponents floats per vertex
+template<unsigned int Semantic, unsigned int Set>
+struct VertexSource;
+
+template<>
+struct VertexSource<SM_SEMANTIC_POSITION, 0>
+{
+	static constexpr unsigned int kComponents = 3;
+	static const float* Data(const VertexStreams& inStreams) { return inStreams.mPositions.empty() ? nullptr : &inStreams.mPositions[0].x; }
+};
+
+template<>
+struct VertexSource<SM_SEMANTIC_NORMAL, 0>
+{
+	static constexpr unsigned int kComponents = 3;
+	static const float* Data(const VertexStreams& inStreams) { return inStreams.mNormals.empty() ? nullptr : &inStreams.mNormals[0].x; }
+};
+
+template<unsigned int Set>
+struct VertexSource<SM_SEMANTIC_TEXCOORD, Set>
+{
+	static_assert(Set < MAX_UV_SETS, "No such UV set");
+	static constexpr unsigned int kComponents = 2;
+	static const float* Data(const VertexStreams& inStreams) { return inStreams.mUVs[Set].empty() ? nullptr : &inStreams.mUVs[Set][0].x; }
+};
+
+template<unsigned int Set>
+struct VertexSource<SM_SEMANTIC_COLOR, Set>
+{
+	static_assert(Set < MAX_COLOR_SETS, "No such color set");
+	static constexpr unsigned int kComponents = 4;
+	static const float* Data(const VertexStreams& inStreams) { return inStreams.mColors[Set].empty() ? nullptr : &inStreams.mColors[Set][0].x; }
+};
+
+template<>
+struct VertexSource<SM_SEMANTIC_BLEND_WEIGHTS, 0>
+{
+	static constexpr unsigned int kComponents = MAX_INFLUENCES;
+	static const float* Data(const VertexStreams& inStreams) { return inStreams.mBlendWeights.empty() ? nullptr : &inStreams.mBlendWeights[0]; }
+};
+
+template<>
+struct VertexSource<SM_SEMANTIC_BLEND_INDICES, 0>
+{
+	static constexpr unsigned int kComponents = MAX_INFLUENCES;
+	static const float* Data(const VertexStreams& inStreams) { return inStreams.mBlendIndices.empty() ? nullptr : &inStreams.mBlendIndices[0]; }
+};
+
+// Converts one float component to its stored type
+template<unsigned int Encoding>
+struct VertexEncoder;
+
+template<>
+struct VertexEncoder<SM_ENCODING_FLOAT32>
+{
+	typedef float Type;
+	static Type Encode(float inValue) { return inValue; }
+};
+
+template<>
+struct VertexEncoder<SM_ENCODING_FLOAT16>
+{
+	typedef unsigned short Type;
+	static Type Encode(float inValue) { return FloatToHalf(inValue); }
+};
+
+template<>
+struct VertexEncoder<SM_ENCODING_SNORM16>
+{
+	typedef short Type;
+	static Type Encode(float inValue)
+	{
+		const float value = std::min(std::max(inValue, -1.0f), 1.0f) * 32767.0f;
+		return static_cast<Type>(value < 0.0f ? value - 0.5f : value + 0.5f);
+	}
+};
+
+template<>
+struct VertexEncoder<SM_ENCODING_UNORM8>
+{
+	typedef unsigned char Type;
+	static Type Encode(float inValue) { return static_cast<Type>(std::min(std::max(inValue, 0.0f), 1.0f) * 255.0f + 0.5f); }
+};
+
+template<>
+struct VertexEncoder<SM_ENCODING_UINT8>
+{
+	typedef unsigned char Type;
+	static Type Encode(float inValue) { return static_cast<Type>(std::min(std::max(inValue, 0.0f), 255.0f)); }
+};
+
+template<unsigned int Semantic, unsigned int Set, unsigned int Encoding>
+struct VertexAttribute
+{
+	typedef VertexSource<Semantic, Set> Source;
+	typedef VertexEncoder<Encoding> Encoder;
+
+	static constexpr unsigned int kSemantic = Semantic;
+	static constexpr unsigned int kSet = Set;
+	static constexpr unsigned int kEncoding = Encoding;
+	static constexpr unsigned int kComponents = Source::kComponents;
+	static constexpr unsigned int kSize = kComponents * sizeof(typename Encoder::Type);
+
+	// inCount vertices from inFirst on, the attribute of vertex i goes
+	// to outData + i * Stride
+	template<unsigned int Stride>
+	static void Pack(const VertexStreams& inStreams, unsigned int inFirst, unsigned int inCount, char* outData)
+	{
+		const float* source = Source::Data(inStreams) + static_cast<size_t>(inFirst) * kComponents;
+		for (unsigned int i = 0; i < inCount; i++)
+		{
+			typename Encoder::Type values[kComponents];
+			for (unsigned int c = 0; c < kComponents; c++)
+			{
+				values[c] = Encoder::Encode(source[c]);
+			}
+			memcpy(outData, values, kSize);
+			source += kComponents;
+			outData += Stride;
+		}
+	}
+};
+
+template<typename... Attributes>
+struct VertexFormat;
+
+template<>
+struct VertexFormat<>
+{
+	static constexpr unsigned int kStride = 0;
+	static constexpr unsigned int kAttributeCount = 0;
+
+	template<unsigned int Offset, unsigned int Stride>
+	static void PackAttributes(const VertexStreams&, unsigned int, unsigned int, char*) {}
+	static void DescribeAttributes(unsigned int, unsigned int, unsigned int, std::vector<SM_vertex_attribute>&) {}
+};
+
+template<typename First, typename... Rest>
+struct VertexFormat<First, Rest...>
+{
+	static constexpr unsigned int kStride = First::kSize + VertexFormat<Rest...>::kStride;
+	static constexpr unsigned int kAttributeCount = 1 + sizeof...(Rest);
+
+	// Interleaves inCount vertices from inFirst on into outData, which
+	// holds inCount * kStride bytes. Blocks of vertices are packed one
+	// attribute at a time while they are still in the cache
+	static void Pack(const VertexStreams& inStreams, unsigned int inFirst, unsigned int inCount, void* outData)
+	{
+		const unsigned int blockSize = 1024;
+		char* output = static_cast<char*>(outData);
+		for (unsigned int begin = 0; begin < inCount; begin += blockSize)
+		{
+			const unsigned int count = std::min(blockSize, inCount - begin);
+			PackAttributes<0, kStride>(inStreams, inFirst + begin, count, output + static_cast<size_t>(begin) * kStride);
+		}
+	}
+
+	// Appends the records of the attributes, as stream inStream
+	static void Describe(unsigned int inStream, std::vector<SM_vertex_attribute>& ioAttributes)
+	{
+		DescribeAttributes(inStream, 0, kStride, ioAttributes);
+	}
+
+	template<unsigned int Offset, unsigned int Stride>
+	static void PackAttributes(const VertexStreams& inStreams, unsigned int inFirst, unsigned int inCount, char* outData)
+	{
+		First::template Pack<Stride>(inStreams, inFirst, inCount, outData + Offset);
+		VertexFormat<Rest...>::template PackAttributes<Offset + First::kSize, Stride>(inStreams, inFirst, inCount, outData);
+	}
+
+	static void DescribeAttributes(unsigned int inStream, unsigned int inOffset, unsigned int inStride, std::vector<SM_vertex_attribute>& ioAttributes)
+	{
+		SM_vertex_attribute attribute;
+		attribute.semantic = First::kSemantic;
+		attribute.set = First::kSet;
+		attribute.encoding = First::kEncoding;
+		attribute.components = First::kComponents;
+		attribute.stream = inStream;
+		attribute.offset = inOffset;
+		attribute.stride = inStride;
+		ioAttributes.push_back(attribute);
+		VertexFormat<Rest...>::DescribeAttributes(inStream, inOffset + First::kSize, inStride, ioAttributes);
+	}
+};
+
+// SM_vertex, the first stream of .static_mesh files
+typedef VertexFormat<
+	VertexAttribute<SM_SEMANTIC_POSITION, 0, SM_ENCODING_FLOAT32>,
+	VertexAttribute<SM_SEMANTIC_TEXCOORD, 0, SM_ENCODING_FLOAT32>,
+	VertexAttribute<SM_SEMANTIC_NORMAL, 0, SM_ENCODING_FLOAT32>> StaticMeshVertexFormat;
+static_assert(StaticMeshVertexFormat::kStride == sizeof(SM_vertex), "StaticMeshVertexFormat must match SM_vertex");
+
+// The streams of the additional UV sets and of the color sets
+template<unsigned int Set>
+using UVSetFormat = VertexFormat<VertexAttribute<SM_SEMANTIC_TEXCOORD, Set, SM_ENCODING_FLOAT32>>;
+template<unsigned int Set>
+using ColorSetFormat = VertexFormat<VertexAttribute<SM_SEMANTIC_COLOR, Set, SM_ENCODING_FLOAT32>>;
+
+// SM_skin_vertex, blend indices must already be palette local and the
+// weights quantized to 1/255 steps, which UNORM8 then stores exactly
+typedef VertexFormat<
+	VertexAttribute<SM_SEMANTIC_BLEND_INDICES, 0, SM_ENCODING_UINT8>,
+	VertexAttribute<SM_SEMANTIC_BLEND_WEIGHTS, 0, SM_ENCODING_UNORM8>> SkinVertexFormat;
+static_assert(SkinVertexFormat::kStride == sizeof(SM_skin_vertex), "SkinVertexFormat must match SM_skin_vertex");
+
+// A format picked at run time, the set index of a stream is only known
+// then. The call goes through a pointer once per stream, not per vertex
+struct VertexStreamFormat
+{
+	unsigned int mStride;
+	unsigned int mAttributeCount;
+	void(*mPack)(const VertexStreams&, unsigned int, unsigned int, void*);
+	void(*mDescribe)(unsigned int, std::vector<SM_vertex_attribute>&);
+};
+
+template<typename Format>
+VertexStreamFormat GetStreamFormat()
+{
+	VertexStreamFormat format;
+	format.mStride = Format::kStride;
+	format.mAttributeCount = Format::kAttributeCount;
+	format.mPack = &Format::Pack;
+	format.mDescribe = &Format::Describe;
+	return format;
+}
+
+VertexStreamFormat GetUVSetFormat(unsigned int inSet);
+VertexStreamFormat GetColorSetFormat(unsigned int inSet);
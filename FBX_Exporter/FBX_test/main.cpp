@@ -1,16 +1,36 @@
 #include "stdafx.h"
 #include "FBXExporter.h"
+#include "BatchExporter.h"
+#include <thread>
 
 int main(int argc, char** argv)
 {
 	// TODO: create binary format
 	// Output for materials
 
-	FBXExporter* myExporter = new FBXExporter();
-	myExporter->Initialize();
-	myExporter->LoadScene("two_textures_and_three_mat.FBX"/*argv[1]*/);
-	myExporter->ExportAsMesh("Testing");
-	//myExporter->ExportFBX();
+	if (argc < 2)
+	{
+		FBXExporter* myExporter = new FBXExporter();
+		myExporter->Initialize();
+		myExporter->LoadScene("two_textures_and_three_mat.FBX"/*argv[1]*/);
+		myExporter->ExportAsMesh("Testing");
+		//myExporter->ExportFBX();
+		delete myExporter;
+	}
+	else
+	{
+		// Files given on the command line go through the export pipeline,
+		// imported with the FBX SDK unless --native-import comes first
+		bool nativeImport = std::string(argv[1]) == "--native-import";
+		std::vector<std::string> inputFiles(argv + (nativeImport ? 2 : 1), argv + argc);
+		BatchExporter batchExporter;
+		batchExporter.SetStageThreads(1, std::max(std::thread::hardware_concurrency() / 2, 1u), 1);
+		batchExporter.SetConfiguration([nativeImport](FBXExporter& ioExporter)
+		{
+			ioExporter.SetNativeImport(nativeImport, std::max(std::thread::hardware_concurrency() / 2, 1u));
+		});
+		std::cout << batchExporter.Run(inputFiles) << " of " << inputFiles.size() << " files exported\n";
+	}
 
 	getch();
 }
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+// SA_header::Flags
+// Keys are SA_quantized_key instead of SA_key
+#define SA_FLAG_QUANTIZED_ROTATIONS 1
+
+struct SA_header
+{
+	float version;
+	unsigned int NumOf_Joints;
+	unsigned int NumOf_Frames;
+	float Frames_per_second;
+	// Frame number of the first key
+	int First_frame;
+	unsigned int Flags;
+	char Name[64];
+};
+
+// Joints are ordered so that parents come before their children
+struct SA_joint
+{
+	char Name[64];
+	int Parent;
+	// Mesh space to joint space at bind time
+	float Inverse_bindpose[16];
+};
+
+// Relative to the parent joint (to the mesh for roots). A joint's
+// matrix is scale, then rotation, then translation
+struct SA_key
+{
+	XMFLOAT3 Translation;
+	XMFLOAT4 Rotation;
+	XMFLOAT3 Scale;
+};
+
+// Rotation x, y, z, w as 16 bit [-1, 1] normalized integers
+struct SA_quantized_key
+{
+	XMFLOAT3 Translation;
+	short Rotation[4];
+	XMFLOAT3 Scale;
+};
+
+/*
+	.static_anim struct:
+	{
+		SA_header
+		SA_joint[NumOf_Joints]
+		// Key f of joint j at j * NumOf_Frames + f
+		SA_key or SA_quantized_key[NumOf_Joints * NumOf_Frames]
+	}
+*/
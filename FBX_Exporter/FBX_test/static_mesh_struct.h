@@ -1,5 +1,21 @@
 #pragma once
 
+#define SM_BVH_ALIGNMENT 64
+// bvh_roots entry of a node without triangles, it has no hierarchy
+#define SM_BVH_NO_ROOT 0xffffffff
+
+// SM_header::Flags
+#define SM_FLAG_COMPRESSED 1
+
+// Axis aligned box and bounding sphere
+struct SM_bounds
+{
+	XMFLOAT3 Min;
+	XMFLOAT3 Max;
+	XMFLOAT3 Center;
+	float Radius;
+};
+
 struct SM_header
 {
 	float version;
@@ -7,6 +23,27 @@ struct SM_header
 	unsigned int NumOf_Triangles;
 	unsigned int NumOf_Materials;
 	unsigned int NumOf_Textures;
+	unsigned int NumOf_UVSets;
+	unsigned int NumOf_ColorSets;
+	unsigned int NumOf_VertexAttributes;
+	unsigned int NumOf_Nodes;
+	unsigned int NumOf_DrawRanges;
+	// Skinned meshes split into bone palettes: NumOf_DrawRanges or 0
+	unsigned int NumOf_BonePalettes;
+	unsigned int NumOf_PaletteJoints;
+	unsigned int NumOf_LODs;
+	unsigned int NumOf_Meshlets;
+	unsigned int NumOf_MeshletVertices;
+	unsigned int NumOf_MeshletTriangles;
+	unsigned int NumOf_BvhNodes;
+	// Byte offset of the BVH section from the start of the file
+	unsigned int Bvh_offset;
+	// Of the whole scene, with node transforms applied
+	SM_bounds Bounds;
+	unsigned int Flags;
+	// Only used by compressed files
+	unsigned int NumOf_Sections;
+	unsigned int NumOf_Blocks;
 };
 
 struct SM_vertex
@@ -16,12 +53,188 @@ struct SM_vertex
 	XMFLOAT3 Normal;
 };
 
+// Skin stream of meshes with bone palettes, MAX_INFLUENCES (4 or 8,
+// see Vertex.h) per vertex, strongest first. Indices are positions in
+// the palette of the vertex's draw range, weights are n / 255 and add
+// up to exactly 255. Unused influences have index and weight 0
+struct SM_skin_vertex
+{
+	unsigned char Indices[MAX_INFLUENCES];
+	unsigned char Weights[MAX_INFLUENCES];
+};
+
+enum SM_vertex_semantic
+{
+	SM_SEMANTIC_POSITION, SM_SEMANTIC_NORMAL, SM_SEMANTIC_TEXCOORD, SM_SEMANTIC_COLOR,
+	SM_SEMANTIC_BLEND_INDICES, SM_SEMANTIC_BLEND_WEIGHTS
+};
+
+// Per component: 32 and 16 bit floats, 16 bit [-1, 1] and 8 bit
+// [0, 1] normalized integers, 8 bit unsigned integers
+enum SM_vertex_encoding
+{
+	SM_ENCODING_FLOAT32, SM_ENCODING_FLOAT16, SM_ENCODING_SNORM16, SM_ENCODING_UNORM8, SM_ENCODING_UINT8
+};
+
+// Describes one attribute of the vertex streams: the attribute of the
+// vertex i starts at byte offset + i * stride of stream number stream
+// Stream 0 is the SM_vertex array, the streams of the additional UV
+// sets, of the color sets and the skin stream follow it in file order
+struct SM_vertex_attribute
+{
+	unsigned int semantic;
+	unsigned int set;
+	unsigned int encoding;
+	unsigned int components;
+	unsigned int stream;
+	unsigned int offset;
+	unsigned int stride;
+};
+
 struct SM_triangle
 {
 	unsigned int indices[3];
 	int material_index;
 };
 
+// Transform is the node's global transform in FbxAMatrix
+// layout (row vectors, translation in Transform[12..14])
+// An instance (Instance_of != -1) is another copy of node Instance_of:
+// it shares that node's triangles, vertices, draw ranges, statistics
+// and BVH, and only adds its own transform
+struct SM_node
+{
+	char Name[64];
+	float Transform[16];
+	unsigned int First_triangle;
+	unsigned int NumOf_Triangles;
+	unsigned int First_vertex;
+	unsigned int NumOf_Vertices;
+	int Instance_of;
+};
+
+// Triangles [first_triangle, first_triangle + triangle_count) of one
+// node with one material; their indices lie within
+// [first_vertex, first_vertex + vertex_count)
+// With static batching there is a single identity node and one range
+// per material (split at 65536 vertices on request, so indices minus
+// first_vertex fit in 16 bits)
+struct SM_draw_range
+{
+	unsigned int node_index;
+	unsigned int material_index;
+	unsigned int first_triangle;
+	unsigned int triangle_count;
+	unsigned int first_vertex;
+	unsigned int vertex_count;
+};
+
+// Joints referenced by the vertices of draw range i (and of draw range
+// i of every LOD): palette_joints[first_joint, first_joint +
+// joint_count), ascending. A palette never has more than 256 joints
+struct SM_bone_palette
+{
+	unsigned int first_joint;
+	unsigned int joint_count;
+};
+
+// A simplified level of detail. Its triangles index the same
+// vertices as the full mesh, its draw ranges index its own triangles
+// error is the largest one MeshSimplifier::Simplify returned for the
+// draw ranges: the RMS distance introduced by the worst collapse
+struct SM_lod
+{
+	float error;
+	unsigned int NumOf_Triangles;
+	unsigned int NumOf_DrawRanges;
+};
+
+// Cluster of at most 64 vertices and 124 triangles. Its vertices are
+// meshlet_vertices[vertex_offset, vertex_offset + vertex_count), its
+// triangles are triangle_count triplets of byte indices into them
+// starting at meshlet_triangles[triangle_offset]
+// It is backfacing for a camera at c if
+// dot(normalize(ConeApex - c), ConeAxis) >= ConeCutoff
+struct SM_meshlet
+{
+	unsigned int vertex_offset;
+	unsigned int vertex_count;
+	unsigned int triangle_offset;
+	unsigned int triangle_count;
+	unsigned int material_index;
+	XMFLOAT3 Center;
+	float Radius;
+	XMFLOAT3 ConeApex;
+	XMFLOAT3 ConeAxis;
+	float ConeCutoff;
+};
+
+// Same layout as BvhNode: the nodes of every hierarchy are stored
+// depth first, an inner node (count == 0) is followed by its left
+// child and left_or_first is its right child; a leaf references
+// bvh_triangles[left_or_first, left_or_first + count)
+struct SM_bvh_node
+{
+	XMFLOAT3 Min;
+	unsigned int left_or_first;
+	XMFLOAT3 Max;
+	unsigned int count;
+};
+
+// Node space bounds, surface and UV set 0 area of a node or draw range
+// UVDensity = sqrt(SurfaceArea / UVArea)
+struct SM_range_stats
+{
+	SM_bounds Bounds;
+	float SurfaceArea;
+	float UVArea;
+	float UVDensity;
+	unsigned int NumOf_Vertices;
+	unsigned int NumOf_Triangles;
+};
+
+enum SM_section_type
+{
+	SM_SECTION_VERTICES, SM_SECTION_UV_SETS, SM_SECTION_COLOR_SETS, SM_SECTION_TRIANGLES,
+	SM_SECTION_NODES, SM_SECTION_DRAW_RANGES, SM_SECTION_RANGE_STATS, SM_SECTION_LODS,
+	SM_SECTION_MESHLETS, SM_SECTION_MATERIALS, SM_SECTION_TEXTURES, SM_SECTION_BVH,
+	SM_SECTION_VERTEX_LAYOUT, SM_SECTION_SKIN, SM_SECTION_BONE_PALETTES
+};
+
+// How the blocks of a section are transformed before compression:
+// SHUFFLE groups the bytes of its records and delta codes them, VERTEX
+// and INDEX are the GeometryCodec vertex and triangle codecs
+enum SM_codec
+{
+	SM_CODEC_NONE, SM_CODEC_SHUFFLE, SM_CODEC_VERTEX, SM_CODEC_INDEX
+};
+
+// A section of the uncompressed file: bytes [raw_offset, raw_offset +
+// raw_size) of it, stored in blocks [first_block, first_block +
+// NumOf_Blocks). Its blocks hold whole records of record_size bytes
+struct SM_section
+{
+	unsigned int type;
+	unsigned int codec;
+	unsigned int record_size;
+	unsigned int raw_offset;
+	unsigned int raw_size;
+	unsigned int first_block;
+	unsigned int NumOf_Blocks;
+};
+
+// An independently decompressible block at file_offset: raw_size bytes
+// coded with the section's codec into encoded_size bytes, which are
+// LZ4 compressed into compressed_size bytes. If compressed_size equals
+// encoded_size the coded bytes are stored as is
+struct SM_block
+{
+	unsigned int raw_size;
+	unsigned int encoded_size;
+	unsigned int compressed_size;
+	unsigned int file_offset;
+};
+
 struct SM_material
 {
 	XMFLOAT3 Emissive;
@@ -44,12 +257,47 @@ struct SM_material
 	{
 
 		SM_header
+		SM_vertex_attribute[NumOf_VertexAttributes]
 		SM_vertex[NumOf_Vertices]
+		XMFLOAT2 Tex[NumOf_Vertices] * (NumOf_UVSets - 1)
+		XMFLOAT4 Color[NumOf_Vertices] * NumOf_ColorSets
+		SM_skin_vertex[NumOf_Vertices] if NumOf_BonePalettes > 0
 		SM_triangle[NumOf_Triangles]
+		SM_node[NumOf_Nodes]
+		SM_draw_range[NumOf_DrawRanges]
+		SM_bone_palette[NumOf_BonePalettes]
+		unsigned int palette_joints[NumOf_PaletteJoints]
+		SM_range_stats[NumOf_Nodes]
+		SM_range_stats[NumOf_DrawRanges]
+		SM_lod[NumOf_LODs]
+		{
+			SM_triangle[NumOf_Triangles]
+			SM_draw_range[NumOf_DrawRanges]
+		} * NumOf_LODs
+		SM_meshlet[NumOf_Meshlets]
+		unsigned int meshlet_vertices[NumOf_MeshletVertices]
+		unsigned char meshlet_triangles[NumOf_MeshletTriangles][3]
+		// zero padding to a multiple of 4 bytes
 		SM_material[NumOf_Materials]
 		{
 			unsigned int size_of_texture
 			char Texture_file[size_of_texture]
 		} * NumOf_Textures
+
+		// At Bvh_offset (a multiple of SM_BVH_ALIGNMENT), if NumOf_BvhNodes > 0
+		SM_bvh_node[NumOf_BvhNodes]
+		unsigned int bvh_roots[NumOf_Nodes]	// SM_BVH_NO_ROOT if the node has no triangles
+		unsigned int bvh_triangles[NumOf_Triangles]
+	}
+
+	Compressed (Flags & SM_FLAG_COMPRESSED):
+	{
+		SM_header
+		SM_section[NumOf_Sections]
+		SM_block[NumOf_Blocks]
+		block data
+
+		The sections decompress to the layout above minus its
+		header, in order and without gaps
 	}
 */